@@ -0,0 +1,88 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+/*
+ * Template for a reaction plugin, implementing the Gray-Scott model.
+ *
+ * Copy this file, adjust the kernel, the parameters and the descriptor, and
+ * build it as a shared library, e.g.
+ *
+ *     cc -O3 -march=native -shared -fPIC -I<turing>/src my_reaction.c -o my_reaction.so
+ *
+ * after which the model is available via
+ *
+ *     turing --reaction-plugin ./my_reaction.so --reaction my-reaction ...
+ */
+
+#include "turing_plugin.h"
+
+/* parameters, in the order of the parameter block */
+enum { PARAM_F, PARAM_K };
+
+static const char* const species_names[] = {"A", "B"};
+static const char* const parameter_names[] = {"f", "k"};
+static const double parameter_defaults[] = {0.06, 0.0609};
+
+/* reaction terms for a span of grid points */
+static void reaction(const double* const* c, double* const* r, unsigned int n, const double* params) {
+    const double f = params[PARAM_F];
+    const double k = params[PARAM_K];
+    const double* restrict a = c[0];
+    const double* restrict b = c[1];
+    double* restrict ra = r[0];
+    double* restrict rb = r[1];
+
+    for(unsigned int i=0; i<n; i++) {
+        const double abb = a[i] * b[i] * b[i];
+        ra[i] = -abb + f * (1.0 - a[i]);
+        rb[i] =  abb - (f + k) * b[i];
+    }
+}
+
+/* unreacted medium with a seeded square in the center */
+static void init(double* const* c, unsigned int width, unsigned int height, const double* params) {
+    for(unsigned int j=0; j<height; j++) {
+        for(unsigned int i=0; i<width; i++) {
+            const int seed = (i > 2 * width / 5 && i < 3 * width / 5 &&
+                              j > 2 * height / 5 && j < 3 * height / 5);
+            c[0][i + j * width] = seed ? 0.5 : 1.0;
+            c[1][i + j * width] = seed ? 0.25 : 0.0;
+        }
+    }
+}
+
+static const turing_reaction_plugin_t plugin = {
+    TURING_PLUGIN_ABI_VERSION,
+    "gray-scott-plugin",
+    "Gray-Scott",
+    2,
+    species_names,
+    2,
+    parameter_names,
+    parameter_defaults,
+    reaction,
+    init
+};
+
+const turing_reaction_plugin_t* turing_reaction_plugin(void) {
+    return &plugin;
+}
@@ -0,0 +1,181 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "two_dim_rd.h"
+#include "reaction_registry.h"
+
+namespace py = pybind11;
+
+namespace {
+
+/**
+ * @brief      Registry of the reaction systems, shared by all systems created from Python
+ */
+ReactionRegistry& get_registry() {
+    static ReactionRegistry registry;
+    return registry;
+}
+
+/**
+ * @brief      NumPy view on a concentration matrix
+ *
+ * The column-major width x height matrix is exposed as a row-major array of
+ * height x width, the layout in which vis.py reads the frames. The system
+ * is the base object of the view and is kept alive as long as the view
+ * exists.
+ *
+ * @param      m      The matrix
+ * @param[in]  owner  Python object owning the matrix
+ *
+ * @return     the view
+ */
+py::array_t<double> field_view(MatrixXXd& m, py::handle owner) {
+    const py::ssize_t W = m.rows();
+    const py::ssize_t H = m.cols();
+    return py::array_t<double>({H, W}, {W * (py::ssize_t)sizeof(double), (py::ssize_t)sizeof(double)},
+                               m.data(), owner);
+}
+
+/**
+ * @brief      Iterates over frames, integrating a number of time steps per frame
+ */
+class FrameIterator {
+private:
+    py::object owner;       //!< Python object of the system
+    TwoDimRD* rd;           //!< the system
+    unsigned int frames;    //!< number of frames
+    unsigned int tsteps;    //!< number of time steps per frame
+    unsigned int frame = 0; //!< current frame
+
+public:
+    FrameIterator(py::object _owner, unsigned int _frames, unsigned int _tsteps) :
+        owner(_owner),
+        rd(_owner.cast<TwoDimRD*>()),
+        frames(_frames),
+        tsteps(_tsteps) {}
+
+    /**
+     * @brief      Integrate the next frame
+     *
+     * @return     frame number and time
+     */
+    py::tuple next() {
+        if(this->frame >= this->frames) {
+            throw py::stop_iteration();
+        }
+
+        {
+            py::gil_scoped_release release;
+            this->rd->advance(this->tsteps);
+        }
+
+        this->frame++;
+        return py::make_tuple(this->frame, this->rd->get_time());
+    }
+};
+
+} // namespace
+
+PYBIND11_MODULE(turing, m) {
+    m.doc() = "Reaction-diffusion systems integrated in-process";
+
+    m.def("reactions", []() {
+        py::dict reactions;
+        for(const std::string& name : get_registry().get_names()) {
+            reactions[py::str(name)] = get_registry().get_description(name);
+        }
+        return reactions;
+    }, "Names and descriptions of the available reaction systems");
+
+    m.def("load_plugin", [](const std::string& path) {
+        return get_registry().load_plugin(path);
+    }, py::arg("path"), "Load a reaction plugin and return the name of its reaction system");
+
+    py::class_<FrameIterator>(m, "FrameIterator")
+        .def("__iter__", [](FrameIterator& it) -> FrameIterator& {
+            return it;
+        })
+        .def("__next__", &FrameIterator::next);
+
+    py::class_<TwoDimRD>(m, "TwoDimRD")
+        .def(py::init([](double Da, double Db, unsigned int width, unsigned int height, double dx, double dt,
+                         const std::string& reaction, const std::string& parameters, bool pbc, int stencil) {
+            if(!get_registry().has(reaction)) {
+                throw py::value_error("Invalid reaction: " + reaction);
+            }
+            if(stencil != STENCIL_5POINT && stencil != STENCIL_9POINT && stencil != STENCIL_13POINT) {
+                throw py::value_error("Invalid stencil: " + std::to_string(stencil) + " (choose 5, 9 or 13)");
+            }
+
+            // frames are not stored, hence the number of frames is irrelevant
+            auto rd = std::make_unique<TwoDimRD>(Da, Db, width, height, dx, dt, 0, 0);
+            rd->set_reaction(get_registry().create(reaction));
+            rd->set_parameters(parameters);
+            rd->set_pbc(pbc);
+            rd->set_stencil((LaplacianStencil)stencil);
+            return rd;
+        }), py::arg("Da"), py::arg("Db"), py::arg("width"), py::arg("height"), py::arg("dx"), py::arg("dt"),
+            py::arg("reaction"), py::arg("parameters"), py::arg("pbc") = false, py::arg("stencil") = 5)
+        .def_property_readonly("a", [](py::object self) {
+            return field_view(self.cast<TwoDimRD&>().get_a(), self);
+        }, "Concentration of A (height x width), shared with the system")
+        .def_property_readonly("b", [](py::object self) {
+            return field_view(self.cast<TwoDimRD&>().get_b(), self);
+        }, "Concentration of B (height x width), shared with the system")
+        .def_property_readonly("t", &TwoDimRD::get_time, "Time")
+        .def_property_readonly("width", &TwoDimRD::get_width)
+        .def_property_readonly("height", &TwoDimRD::get_height)
+        .def("set_diffusion_field", [](TwoDimRD& rd, const std::string& spec) {
+            rd.set_diffusion_field(new DiffusionField(spec, rd.get_width(), rd.get_height()));
+        }, py::arg("spec"), "Use a spatially varying or anisotropic medium")
+        .def("set_tiling", &TwoDimRD::set_tiling, py::arg("tile_size"), py::arg("tolerance") = 1e-10,
+             "Skip tiles that are at rest")
+        .def("step", [](TwoDimRD& rd, unsigned int n) {
+            py::gil_scoped_release release;
+            rd.advance(n);
+        }, py::arg("n") = 1, "Perform n time steps (without holding the GIL)")
+        .def("run", [](TwoDimRD& rd, unsigned int frames, unsigned int tsteps, py::object callback) {
+            for(unsigned int i=1; i<=frames; i++) {
+                {
+                    py::gil_scoped_release release;
+                    rd.advance(tsteps);
+                }
+
+                // the callback stops the integration by returning False
+                if(!callback.is_none()) {
+                    py::object result = callback(i, rd.get_time());
+                    if(!result.is_none() && !py::bool_(result)) {
+                        return i;
+                    }
+                }
+            }
+            return frames;
+        }, py::arg("frames"), py::arg("tsteps"), py::arg("callback") = py::none(),
+           "Integrate a number of frames, calling callback(frame, t) after every frame")
+        .def("frames", [](py::object self, unsigned int frames, unsigned int tsteps) {
+            return FrameIterator(self, frames, tsteps);
+        }, py::arg("frames"), py::arg("tsteps"),
+           "Iterate over frames, yielding (frame, t) after integrating every frame");
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+
+# Submit simulations to a server started with `turing serve --socket <path>`
+# and print the report of every job (one line of JSON) once it has finished.
+#
+#     turing_client.py /tmp/turing.sock -- --Da 1 --Db 100 ... --outfile a.bin
+#     turing_client.py /tmp/turing.sock --jobs jobs.txt     (one job per line)
+#     turing_client.py /tmp/turing.sock --status
+#     turing_client.py /tmp/turing.sock --shutdown
+#
+# The jobs of a file are submitted concurrently; the server decides when
+# they run. The exit code is non-zero when any of the jobs has failed.
+
+import argparse
+import json
+import shlex
+import socket
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+def request(path, line):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(path)
+        s.sendall((line.strip() + '\n').encode())
+        return s.makefile().readline().strip()
+
+def main():
+    parser = argparse.ArgumentParser(description='Submit jobs to a Turing job server.')
+    parser.add_argument('socket', help='socket of the server')
+    parser.add_argument('--jobs', help='file with one command line per job')
+    parser.add_argument('--status', action='store_true', help='print the state of the server')
+    parser.add_argument('--shutdown', action='store_true', help='stop the server once its jobs have finished')
+
+    # everything after -- is the command line of a single job
+    argv = sys.argv[1:]
+    args = argv[argv.index('--') + 1:] if '--' in argv else []
+    opts = parser.parse_args(argv[:argv.index('--')] if '--' in argv else argv)
+
+    if opts.status:
+        print(request(opts.socket, 'STATUS'))
+        return 0
+    if opts.shutdown:
+        print(request(opts.socket, 'SHUTDOWN'))
+        return 0
+
+    jobs = []
+    if opts.jobs:
+        with open(opts.jobs) as f:
+            jobs = [line for line in f if line.strip() and not line.startswith('#')]
+    if args:
+        jobs.append(' '.join(shlex.quote(a) for a in args))
+    if not jobs:
+        parser.error('no jobs given')
+
+    failed = False
+    with ThreadPoolExecutor(max_workers=len(jobs)) as pool:
+        for reply in pool.map(lambda job: request(opts.socket, job), jobs):
+            print(reply, flush=True)
+            failed |= json.loads(reply).get('status') != 'ok'
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
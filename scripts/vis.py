@@ -1,5 +1,7 @@
 #!/usr/bin/env python3
 
+import json
+import os
 import struct
 import numpy as np
 import matplotlib.pyplot as plt
@@ -11,6 +13,13 @@ vmax1 = float(sys.argv[3])
 vmin2 = float(sys.argv[4])
 vmax2 = float(sys.argv[5])
 
+# the metadata file lists the number of species stored per frame; only
+# the first two species are shown
+nspecies = 2
+if os.path.exists(sys.argv[1] + '.json'):
+    with open(sys.argv[1] + '.json') as f:
+        nspecies = json.load(f).get('species', 2)
+
 with open(sys.argv[1], "rb") as f:
     width = struct.unpack('i', f.read(4))[0]
     height = struct.unpack('i', f.read(4))[0]
@@ -19,6 +28,7 @@ with open(sys.argv[1], "rb") as f:
     for i in range(0, steps+1):
         a = np.fromfile(f, dtype=np.dtype('d'), count=width * height)
         b = np.fromfile(f, dtype=np.dtype('d'), count=width * height)
+        f.seek((nspecies - 2) * width * height * 8, os.SEEK_CUR)
 
         ap = a.reshape((height, width))
         bp = b.reshape((height, width))
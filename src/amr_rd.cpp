@@ -0,0 +1,980 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "amr_rd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _Da          Diffusion coefficient of compound A
+ * @param[in]  _Db          Diffusion coefficient of compound B
+ * @param[in]  _width       width of the system at the finest level
+ * @param[in]  _height      height of the system at the finest level
+ * @param[in]  _dx          size of the space interval at the finest level
+ * @param[in]  _dt          size of the time interval at the finest level
+ * @param[in]  _steps       number of frames
+ * @param[in]  _tsteps      number of time steps when to write a frame
+ * @param[in]  _max_level   number of refinement levels above the base level
+ * @param[in]  _block_size  number of cells along the edge of a block
+ */
+AmrRD::AmrRD(double _Da, double _Db,
+             unsigned int _width, unsigned int _height,
+             double _dx, double _dt, unsigned int _steps, unsigned int _tsteps,
+             unsigned int _max_level, unsigned int _block_size) :
+    Da(_Da),
+    Db(_Db),
+    width(_width),
+    height(_height),
+    dx(_dx),
+    dt(_dt),
+    steps(_steps),
+    tsteps(_tsteps),
+    max_level(_max_level),
+    block_size(_block_size),
+    refine_tolerance(0.05),
+    regrid_interval(100) {
+
+    if(this->block_size < 2 || this->block_size % 2 != 0) {
+        throw std::runtime_error("The block size of the adaptive mesh needs to be even");
+    }
+
+    const unsigned int unit = this->block_size << this->max_level;
+    if(this->width % unit != 0 || this->height % unit != 0) {
+        throw std::runtime_error("Width and height need to be a multiple of " + std::to_string(unit) +
+                                 " (block size times 2^levels) for the adaptive mesh");
+    }
+
+    this->nbi = this->width / unit;
+    this->nbj = this->height / unit;
+}
+
+void AmrRD::set_reaction(ReactionSystem* _reaction_system) {
+    this->reaction_system = std::unique_ptr<ReactionSystem>(_reaction_system);
+}
+
+/**
+ * @brief      Set the refinement criterion
+ *
+ * @param[in]  _refine_tolerance  refine when a jump between cells exceeds this value
+ * @param[in]  _regrid_interval   number of finest time steps between regrids
+ */
+void AmrRD::set_refinement(double _refine_tolerance, unsigned int _regrid_interval) {
+    this->refine_tolerance = _refine_tolerance;
+    this->regrid_interval = std::max(1u, _regrid_interval);
+}
+
+/**
+ * @brief      Set whether coarser levels take larger time steps
+ *
+ * @param[in]  _subcycle  Whether to subcycle
+ */
+void AmrRD::set_subcycle(bool _subcycle) {
+    this->subcycle = _subcycle;
+
+    if(this->subcycle && this->tsteps % (1u << this->max_level) != 0) {
+        throw std::runtime_error("With subcycling, tsteps needs to be a multiple of 2^levels");
+    }
+}
+
+/**
+ * @brief      Perform time integration
+ */
+void AmrRD::time_integrate() {
+    this->t = 0;
+
+    // build the tree from the initial concentrations
+    this->build();
+
+    if(this->renderer) {
+        this->renderer->push(0, {this->ta[0].data(), this->tb[0].data()});
+    }
+
+    if(this->analysis) {
+        this->analysis->analyze(0, this->t, {this->ta[0].data(), this->tb[0].data()});
+    }
+
+    if(this->features) {
+        this->features->extract(0, this->t, {this->ta[0].data(), this->tb[0].data()});
+    }
+
+    // only the reduced initial frame is kept
+    if(this->output_spec) {
+        this->output_spec->record(0, {this->ta[0].data(), this->tb[0].data()});
+        this->ta.clear();
+        this->tb.clear();
+    }
+
+    // number of finest time steps per step at the base level
+    const unsigned int ratio = this->subcycle ? (1u << this->max_level) : 1;
+    const unsigned int nsteps = this->tsteps / ratio;
+    const double dt0 = this->dt * (double)ratio;
+    const unsigned int regrid_steps = std::max(1u, this->regrid_interval / ratio);
+
+    if(this->metrics) {
+        if(this->renderer) {
+            this->metrics->add_backlog_source([this]() { return this->renderer->get_backlog(); });
+        }
+        this->metrics->start();
+    }
+
+    unsigned int since_regrid = 0;
+    for(int i : tq::trange(this->steps)) {
+        for(unsigned int j=0; j<nsteps; j++) {
+            this->advance(0, dt0);
+            this->t += dt0;
+
+            // a step of the coarsest level covers ratio steps of the finest level
+            if(this->metrics) {
+                this->metrics->progress(this->t, ratio);
+            }
+
+            if(++since_regrid >= regrid_steps) {
+                this->regrid();
+                since_regrid = 0;
+            }
+        }
+
+        MatrixXXd a(this->width, this->height);
+        MatrixXXd b(this->width, this->height);
+        this->resample(a, b);
+        this->nr_frames++;
+        if(this->output_spec) {
+            // AMR runs do not terminate early, hence the last frame is known
+            this->output_spec->record(this->nr_frames, {a.data(), b.data()},
+                                      this->nr_frames == this->steps);
+        } else {
+            this->ta.push_back(a);
+            this->tb.push_back(b);
+        }
+
+        if(this->renderer) {
+            this->renderer->push(this->nr_frames, {a.data(), b.data()});
+        }
+
+        if(this->analysis) {
+            this->analysis->analyze(this->nr_frames, this->t, {a.data(), b.data()});
+        }
+
+        if(this->features) {
+            this->features->extract(this->nr_frames, this->t, {a.data(), b.data()});
+        }
+
+        unsigned int nleaves = 0;
+        for(const auto& lv : this->leaves) {
+            nleaves += lv.size();
+        }
+        this->cell_fraction.push_back((double)(nleaves * this->block_size * this->block_size) /
+                                      (double)(this->width * this->height));
+    }
+
+    // give newline after tqdm progress bar
+    std::cout << std::endl;
+
+    if(this->renderer) {
+        this->renderer->finish();
+        std::cout << "Rendered " << this->renderer->get_nr_frames() << " frames." << std::endl;
+    }
+
+    if(this->analysis) {
+        this->analysis->write();
+        std::cout << "Wrote the analysis of " << this->analysis->get_nr_frames() << " frames to "
+                  << this->analysis->get_filename() << "." << std::endl;
+    }
+
+    if(this->features) {
+        this->features->write();
+        std::cout << "Wrote the features of " << this->features->get_nr_frames() << " frames to "
+                  << this->features->get_filename() << "." << std::endl;
+    }
+
+    if(this->metrics) {
+        this->metrics->finish();
+    }
+
+    double sum = 0.0;
+    for(double f : this->cell_fraction) {
+        sum += f;
+    }
+    std::cout << "Average number of cells relative to the uniform grid: "
+              << sum / (double)std::max((size_t)1, this->cell_fraction.size()) << std::endl;
+    for(unsigned int l=0; l<this->leaves.size(); l++) {
+        std::cout << "    level " << l << " (dx = " << this->spacing(l) << "): "
+                  << this->leaves[l].size() << " blocks" << std::endl;
+    }
+}
+
+/**
+ * @brief      Write the frames, resampled to the finest level, to the file
+ *
+ * @param[in]  filename  The filename
+ */
+void AmrRD::write_state_to_file(const std::string& filename) {
+    if(this->output_spec) {
+        this->output_spec->write(filename, this->chunk_size, this->compression, this->quantization);
+        return;
+    }
+
+    FrameWriter writer(filename, this->width, this->height, this->chunk_size, this->compression,
+                       this->quantization);
+
+    for(unsigned int i=0; i<this->ta.size(); i++) {
+        writer.write_frame(this->ta[i], this->tb[i]);
+    }
+
+    writer.close();
+}
+
+/**
+ * @brief      Write run metadata (JSON) to file
+ *
+ * @param[in]  filename  The filename
+ */
+void AmrRD::write_metadata_to_file(const std::string& filename) {
+    OutputMetadata metadata;
+
+    metadata.set("width", this->width);
+    metadata.set("height", this->height);
+    metadata.set("frames", this->nr_frames);
+    metadata.set("frames_requested", this->steps);
+    metadata.set("tsteps", this->tsteps);
+    metadata.set("dx", this->dx);
+    metadata.set("dt", this->dt);
+    metadata.set("Da", this->Da);
+    metadata.set("Db", this->Db);
+    metadata.set("species", this->reaction_system->get_nr_species());
+    metadata.set("species_names", this->reaction_system->get_species_names());
+    metadata.set("pbc", this->pbc);
+    metadata.set("t_final", this->t);
+    metadata.set("amr_levels", this->max_level);
+    metadata.set("amr_block_size", this->block_size);
+    metadata.set("amr_tolerance", this->refine_tolerance);
+    metadata.set("amr_subcycle", this->subcycle);
+    metadata.set("cell_fraction", this->cell_fraction);
+
+    if(this->output_spec) {
+        this->output_spec->add_metadata(metadata, this->chunk_size);
+    }
+
+    if(this->chunk_size > 0) {
+        metadata.set("layout", "chunked");
+        metadata.set("chunk_size", this->chunk_size);
+        metadata.set("compression", (unsigned int)this->compression);
+        if(!this->quantization.empty()) {
+            metadata.set("quantization", this->quantization);
+        }
+    }
+
+    metadata.write(filename);
+}
+
+/**
+ * @brief      Initialize the system at the finest level
+ */
+void AmrRD::init() {
+    this->init_a = MatrixXXd::Zero(this->width, this->height);
+    this->init_b = MatrixXXd::Zero(this->width, this->height);
+
+    this->reaction_system->init(this->init_a, this->init_b);
+}
+
+/**
+ * @brief      Build the block tree from the initial concentrations
+ */
+void AmrRD::build() {
+    const unsigned int B = this->block_size;
+    const unsigned int S = B + 2;
+    const unsigned int s = 1u << this->max_level;
+
+    this->blocks.clear();
+
+    // base level; concentrations are averaged from the finest level
+    for(unsigned int bj=0; bj<this->nbj; bj++) {
+        for(unsigned int bi=0; bi<this->nbi; bi++) {
+            AmrBlock blk;
+            blk.level = 0;
+            blk.bi = bi;
+            blk.bj = bj;
+            blk.a.assign(S * S, 0.0);
+            blk.b.assign(S * S, 0.0);
+            blk.delta_a.assign(B * B, 0.0);
+            blk.delta_b.assign(B * B, 0.0);
+            blk.reg_a.assign(4 * B, 0.0);
+            blk.reg_b.assign(4 * B, 0.0);
+
+            for(unsigned int j=0; j<B; j++) {
+                for(unsigned int i=0; i<B; i++) {
+                    blk.a[this->idx(i,j)] = this->init_a.block((bi * B + i) * s, (bj * B + j) * s, s, s).mean();
+                    blk.b[this->idx(i,j)] = this->init_b.block((bi * B + i) * s, (bj * B + j) * s, s, s).mean();
+                }
+            }
+
+            this->blocks.emplace(key(0, bi, bj), std::move(blk));
+        }
+    }
+
+    // refine level by level; while the initial concentrations are available,
+    // new blocks are filled from these rather than by interpolation
+    for(unsigned int l=0; l<this->max_level; l++) {
+        this->regrid();
+    }
+
+    this->init_a.resize(0,0);
+    this->init_b.resize(0,0);
+
+    this->collect_leaves();
+
+    MatrixXXd a(this->width, this->height);
+    MatrixXXd b(this->width, this->height);
+    this->resample(a, b);
+    this->ta.push_back(a);
+    this->tb.push_back(b);
+}
+
+/**
+ * @brief      Advance all leaves at a level and (recursively) all finer levels
+ *
+ * The increments of this level are evaluated before the finer levels are
+ * advanced, such that the finer levels see the state at the start of the
+ * step in their ghost layers, and are applied afterwards, once the flux
+ * registers have been filled by the finer levels.
+ *
+ * @param[in]  level  The level
+ * @param[in]  dt_l   time step at this level
+ */
+void AmrRD::advance(unsigned int level, double dt_l) {
+    std::vector<AmrBlock*>& lv = this->leaves[level];
+    const int n = lv.size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<n; k++) {
+        this->fill_ghosts(*lv[k]);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<n; k++) {
+        this->compute_increments(*lv[k], dt_l);
+    }
+
+    // only descend when there are finer leaves
+    bool finer = false;
+    for(unsigned int l=level+1; l<this->leaves.size(); l++) {
+        finer = finer || !this->leaves[l].empty();
+    }
+
+    if(finer) {
+        const unsigned int ratio = this->subcycle ? 2 : 1;
+        for(unsigned int r=0; r<ratio; r++) {
+            this->advance(level + 1, dt_l / (double)ratio);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<n; k++) {
+        this->apply_increments(*lv[k], dt_l);
+    }
+}
+
+/**
+ * @brief      Adapt the mesh to the refinement indicator
+ *
+ * Leaves whose indicator exceeds the tolerance are refined together with
+ * their neighbours at the same level, such that a front cannot leave the
+ * refined region before the next regrid. Afterwards the mesh is balanced,
+ * i.e. neighbouring leaves differ by at most a single level. Families of
+ * leaves whose indicators are well below the tolerance are merged.
+ */
+void AmrRD::regrid() {
+    this->collect_leaves();
+
+    std::vector<AmrBlock*> all;
+    for(const auto& lv : this->leaves) {
+        all.insert(all.end(), lv.begin(), lv.end());
+    }
+    const int n = all.size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<n; k++) {
+        this->fill_ghosts(*all[k]);
+        this->calculate_indicator(*all[k]);
+    }
+
+    // flag leaves and their neighbours for refinement
+    std::vector<AmrBlock*> flagged;
+    for(AmrBlock* blk : all) {
+        blk->flag_refine = (blk->level < this->max_level && blk->indicator > this->refine_tolerance);
+        if(blk->flag_refine) {
+            flagged.push_back(blk);
+        }
+    }
+    for(AmrBlock* blk : flagged) {
+        for(unsigned int side=0; side<4; side++) {
+            unsigned int nbi, nbj;
+            if(!this->neighbour_index(*blk, side, &nbi, &nbj)) {
+                continue;
+            }
+            AmrBlock* nb = this->find_block(blk->level, nbi, nbj);
+            if(nb != nullptr && nb->leaf) {
+                nb->flag_refine = true;
+            }
+        }
+    }
+
+    for(AmrBlock* blk : all) {
+        if(blk->flag_refine) {
+            this->refine_block(*blk);
+        }
+    }
+
+    // balance the mesh
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        this->collect_leaves();
+        for(const auto& lv : this->leaves) {
+            for(AmrBlock* blk : lv) {
+                for(unsigned int side=0; side<4; side++) {
+                    if(this->is_unbalanced(*blk, side)) {
+                        this->fill_ghosts(*blk);
+                        this->refine_block(*blk);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // merge families of leaves that no longer need the resolution
+    std::vector<AmrBlock*> parents;
+    for(auto& item : this->blocks) {
+        AmrBlock& blk = item.second;
+        if(!blk.leaf && this->can_coarsen(blk)) {
+            parents.push_back(&blk);
+        }
+    }
+    for(AmrBlock* parent : parents) {
+        if(this->can_coarsen(*parent)) {
+            this->coarsen_block(*parent);
+        }
+    }
+
+    this->collect_leaves();
+}
+
+/**
+ * @brief      Fill the ghost layer of a leaf and establish its neighbour types
+ *
+ * @param      blk   The block
+ */
+void AmrRD::fill_ghosts(AmrBlock& blk) {
+    const int B = this->block_size;
+
+    for(unsigned int side=0; side<4; side++) {
+        // own edge cells, ghost cells and the matching cells of the neighbour
+        auto edge = [&](int k) {
+            switch(side) {
+                case 0: return this->idx(0, k);
+                case 1: return this->idx(B-1, k);
+                case 2: return this->idx(k, 0);
+                default: return this->idx(k, B-1);
+            }
+        };
+        auto ghost = [&](int k) {
+            switch(side) {
+                case 0: return this->idx(-1, k);
+                case 1: return this->idx(B, k);
+                case 2: return this->idx(k, -1);
+                default: return this->idx(k, B);
+            }
+        };
+        auto other_i = [&](int k) {
+            return side == 0 ? B-1 : (side == 1 ? 0 : k);
+        };
+        auto other_j = [&](int k) {
+            return side == 2 ? B-1 : (side == 3 ? 0 : k);
+        };
+
+        unsigned int nbi, nbj;
+        if(!this->neighbour_index(blk, side, &nbi, &nbj)) {
+            // zero-flux; mirror the edge cells
+            blk.side_type[side] = SIDE_BOUNDARY;
+            for(int k=0; k<B; k++) {
+                blk.a[ghost(k)] = blk.a[edge(k)];
+                blk.b[ghost(k)] = blk.b[edge(k)];
+            }
+            continue;
+        }
+
+        const AmrBlock* nb = this->find_block(blk.level, nbi, nbj);
+        if(nb != nullptr && nb->leaf) {
+            blk.side_type[side] = SIDE_SAME;
+            for(int k=0; k<B; k++) {
+                const unsigned int o = this->idx(other_i(k), other_j(k));
+                blk.a[ghost(k)] = nb->a[o];
+                blk.b[ghost(k)] = nb->b[o];
+            }
+        } else if(nb != nullptr) {
+            // the flux over this side is supplied by the finer leaves via the
+            // flux registers; mirroring removes it from the stencil
+            blk.side_type[side] = SIDE_FINER;
+            for(int k=0; k<B; k++) {
+                blk.a[ghost(k)] = blk.a[edge(k)];
+                blk.b[ghost(k)] = blk.b[edge(k)];
+            }
+        } else {
+            const AmrBlock* p = this->find_block(blk.level - 1, nbi / 2, nbj / 2);
+            if(blk.level == 0 || p == nullptr || !p->leaf) {
+                throw std::logic_error("Adaptive mesh is not balanced");
+            }
+
+            blk.side_type[side] = SIDE_COARSER;
+            for(int k=0; k<B; k++) {
+                // coarse cell covering the ghost cell
+                const int gi = nbi * B + other_i(k);
+                const int gj = nbj * B + other_j(k);
+                const unsigned int o = this->idx(gi / 2 - p->bi * B, gj / 2 - p->bj * B);
+                blk.a[ghost(k)] = p->a[o];
+                blk.b[ghost(k)] = p->b[o];
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate the increments of a leaf
+ *
+ * @param      blk   The block
+ * @param[in]  dt_l  time step at the level of the block
+ */
+void AmrRD::compute_increments(AmrBlock& blk, double dt_l) {
+    const int B = this->block_size;
+    const int S = B + 2;
+    const double h = this->spacing(blk.level);
+    const double idx2 = 1.0 / (h * h);
+
+    const double* a = blk.a.data();
+    const double* b = blk.b.data();
+
+    // reaction terms of a single row of the block
+    thread_local std::vector<double> buffer;
+    buffer.resize(2 * B);
+    double* ra = buffer.data();
+    double* rb = ra + B;
+
+    for(int j=0; j<B; j++) {
+        const double* cp[2] = {&a[this->idx(0,j)], &b[this->idx(0,j)]};
+        double* rp[2] = {ra, rb};
+        this->reaction_system->reaction_batch(cp, rp, B);
+
+        for(int i=0; i<B; i++) {
+            const unsigned int c = this->idx(i,j);
+            const double lap_a = (-4.0 * a[c] + a[c-1] + a[c+1] + a[c-S] + a[c+S]) * idx2;
+            const double lap_b = (-4.0 * b[c] + b[c-1] + b[c+1] + b[c-S] + b[c+S]) * idx2;
+
+            blk.delta_a[i + j * B] = this->Da * lap_a + ra[i];
+            blk.delta_b[i + j * B] = this->Db * lap_b + rb[i];
+        }
+    }
+
+    // at a coarse-fine interface, the distance between the cell centers is
+    // 1.5 h instead of h; the same flux is removed from the coarse cell
+    for(unsigned int side=0; side<4; side++) {
+        if(blk.side_type[side] != SIDE_COARSER) {
+            continue;
+        }
+
+        // the ghost cells of this side were filled from the coarse neighbour
+        unsigned int nbi, nbj;
+        AmrBlock* p = nullptr;
+        if(this->neighbour_index(blk, side, &nbi, &nbj)) {
+            p = this->find_block(blk.level - 1, nbi / 2, nbj / 2);
+        }
+        if(p == nullptr) {
+            throw std::logic_error("Coarse-fine interface without a coarse neighbour");
+        }
+        const unsigned int pside = side ^ 1;
+
+        for(int k=0; k<B; k++) {
+            const int i = side == 0 ? 0 : (side == 1 ? B-1 : k);
+            const int j = side == 2 ? 0 : (side == 3 ? B-1 : k);
+            const int gi = side == 0 ? -1 : (side == 1 ? B : k);
+            const int gj = side == 2 ? -1 : (side == 3 ? B : k);
+
+            const double ja = a[this->idx(gi,gj)] - a[this->idx(i,j)];
+            const double jb = b[this->idx(gi,gj)] - b[this->idx(i,j)];
+
+            blk.delta_a[i + j * B] -= this->Da * ja * idx2 / 3.0;
+            blk.delta_b[i + j * B] -= this->Db * jb * idx2 / 3.0;
+
+            // index along the side of the coarse neighbour
+            const unsigned int kc = (side < 2) ? (blk.bj * B + k) / 2 - p->bj * B :
+                                                 (blk.bi * B + k) / 2 - p->bi * B;
+            p->reg_a[pside * B + kc] -= this->Da * ja * dt_l * idx2 / 6.0;
+            p->reg_b[pside * B + kc] -= this->Db * jb * dt_l * idx2 / 6.0;
+        }
+    }
+}
+
+/**
+ * @brief      Add the increments and the flux registers to a leaf
+ *
+ * @param      blk   The block
+ * @param[in]  dt_l  time step at the level of the block
+ */
+void AmrRD::apply_increments(AmrBlock& blk, double dt_l) {
+    const int B = this->block_size;
+
+    for(int j=0; j<B; j++) {
+        for(int i=0; i<B; i++) {
+            blk.a[this->idx(i,j)] += dt_l * blk.delta_a[i + j * B];
+            blk.b[this->idx(i,j)] += dt_l * blk.delta_b[i + j * B];
+        }
+    }
+
+    for(unsigned int side=0; side<4; side++) {
+        if(blk.side_type[side] != SIDE_FINER) {
+            continue;
+        }
+
+        for(int k=0; k<B; k++) {
+            const int i = side == 0 ? 0 : (side == 1 ? B-1 : k);
+            const int j = side == 2 ? 0 : (side == 3 ? B-1 : k);
+            blk.a[this->idx(i,j)] += blk.reg_a[side * B + k];
+            blk.b[this->idx(i,j)] += blk.reg_b[side * B + k];
+            blk.reg_a[side * B + k] = 0.0;
+            blk.reg_b[side * B + k] = 0.0;
+        }
+    }
+}
+
+/**
+ * @brief      Calculate the refinement indicator of a leaf
+ *
+ * The indicator is the largest jump between two neighbouring cells,
+ * including the cells in the ghost layer.
+ *
+ * @param      blk   The block
+ */
+void AmrRD::calculate_indicator(AmrBlock& blk) {
+    const int B = this->block_size;
+
+    double ind = 0.0;
+    for(int j=0; j<B; j++) {
+        for(int i=-1; i<B; i++) {
+            ind = std::max(ind, std::fabs(blk.a[this->idx(i+1,j)] - blk.a[this->idx(i,j)]));
+            ind = std::max(ind, std::fabs(blk.b[this->idx(i+1,j)] - blk.b[this->idx(i,j)]));
+            ind = std::max(ind, std::fabs(blk.a[this->idx(j,i+1)] - blk.a[this->idx(j,i)]));
+            ind = std::max(ind, std::fabs(blk.b[this->idx(j,i+1)] - blk.b[this->idx(j,i)]));
+        }
+    }
+
+    blk.indicator = ind;
+}
+
+/**
+ * @brief      Split a leaf into four children
+ *
+ * The children are filled by a conservative, slope-limited interpolation
+ * of the parent or, while building the tree, from the initial
+ * concentrations. The ghost layer of the parent needs to be filled.
+ *
+ * @param      blk   The block
+ */
+void AmrRD::refine_block(AmrBlock& blk) {
+    const int B = this->block_size;
+    const int S = B + 2;
+    const unsigned int level = blk.level + 1;
+    const unsigned int s = 1u << (this->max_level - level);
+    const bool from_init = (this->init_a.size() != 0);
+
+    auto minmod = [](double x, double y) {
+        if(x * y <= 0.0) {
+            return 0.0;
+        }
+        return std::fabs(x) < std::fabs(y) ? x : y;
+    };
+
+    for(unsigned int cj=0; cj<2; cj++) {
+        for(unsigned int ci=0; ci<2; ci++) {
+            AmrBlock child;
+            child.level = level;
+            child.bi = 2 * blk.bi + ci;
+            child.bj = 2 * blk.bj + cj;
+            child.a.assign(S * S, 0.0);
+            child.b.assign(S * S, 0.0);
+            child.delta_a.assign(B * B, 0.0);
+            child.delta_b.assign(B * B, 0.0);
+            child.reg_a.assign(4 * B, 0.0);
+            child.reg_b.assign(4 * B, 0.0);
+
+            // never merge blocks in the regrid in which they are created
+            child.indicator = INFINITY;
+
+            for(int j=0; j<B; j++) {
+                for(int i=0; i<B; i++) {
+                    if(from_init) {
+                        const unsigned int x = (child.bi * B + i) * s;
+                        const unsigned int y = (child.bj * B + j) * s;
+                        child.a[this->idx(i,j)] = this->init_a.block(x, y, s, s).mean();
+                        child.b[this->idx(i,j)] = this->init_b.block(x, y, s, s).mean();
+                        continue;
+                    }
+
+                    const int pi = (ci * B + i) / 2;
+                    const int pj = (cj * B + j) / 2;
+                    const double oi = ((ci * B + i) % 2 == 0) ? -0.25 : 0.25;
+                    const double oj = ((cj * B + j) % 2 == 0) ? -0.25 : 0.25;
+                    const unsigned int c = this->idx(pi, pj);
+
+                    const double* pa = blk.a.data();
+                    const double* pb = blk.b.data();
+                    child.a[this->idx(i,j)] = pa[c] + oi * minmod(pa[c+1] - pa[c], pa[c] - pa[c-1])
+                                                    + oj * minmod(pa[c+S] - pa[c], pa[c] - pa[c-S]);
+                    child.b[this->idx(i,j)] = pb[c] + oi * minmod(pb[c+1] - pb[c], pb[c] - pb[c-1])
+                                                    + oj * minmod(pb[c+S] - pb[c], pb[c] - pb[c-S]);
+                }
+            }
+
+            this->blocks.emplace(key(child.level, child.bi, child.bj), std::move(child));
+        }
+    }
+
+    blk.leaf = false;
+    blk.flag_refine = false;
+    std::vector<double>().swap(blk.a);
+    std::vector<double>().swap(blk.b);
+    std::vector<double>().swap(blk.delta_a);
+    std::vector<double>().swap(blk.delta_b);
+    std::vector<double>().swap(blk.reg_a);
+    std::vector<double>().swap(blk.reg_b);
+}
+
+/**
+ * @brief      Merge four children into their parent
+ *
+ * @param      parent  The parent block
+ */
+void AmrRD::coarsen_block(AmrBlock& parent) {
+    const int B = this->block_size;
+    const int S = B + 2;
+
+    parent.a.assign(S * S, 0.0);
+    parent.b.assign(S * S, 0.0);
+    parent.delta_a.assign(B * B, 0.0);
+    parent.delta_b.assign(B * B, 0.0);
+    parent.reg_a.assign(4 * B, 0.0);
+    parent.reg_b.assign(4 * B, 0.0);
+
+    for(unsigned int cj=0; cj<2; cj++) {
+        for(unsigned int ci=0; ci<2; ci++) {
+            const uint64_t k = key(parent.level + 1, 2 * parent.bi + ci, 2 * parent.bj + cj);
+            const AmrBlock& child = this->blocks.at(k);
+
+            for(int j=0; j<B; j++) {
+                for(int i=0; i<B; i++) {
+                    const unsigned int c = this->idx((ci * B + i) / 2, (cj * B + j) / 2);
+                    parent.a[c] += 0.25 * child.a[this->idx(i,j)];
+                    parent.b[c] += 0.25 * child.b[this->idx(i,j)];
+                }
+            }
+
+            this->blocks.erase(k);
+        }
+    }
+
+    parent.leaf = true;
+    parent.indicator = INFINITY;
+}
+
+/**
+ * @brief      Whether coarsening the children of a block keeps the mesh balanced
+ *
+ * @param[in]  parent  The parent block
+ *
+ * @return     true if the children can be merged
+ */
+bool AmrRD::can_coarsen(const AmrBlock& parent) {
+    const unsigned int level = parent.level + 1;
+
+    for(unsigned int cj=0; cj<2; cj++) {
+        for(unsigned int ci=0; ci<2; ci++) {
+            const AmrBlock* child = this->find_block(level, 2 * parent.bi + ci, 2 * parent.bj + cj);
+            if(child == nullptr || !child->leaf || child->indicator > 0.25 * this->refine_tolerance) {
+                return false;
+            }
+
+            // the parent may not become a neighbour of a leaf two levels finer
+            for(unsigned int side=0; side<4; side++) {
+                unsigned int nbi, nbj;
+                if(!this->neighbour_index(*child, side, &nbi, &nbj)) {
+                    continue;
+                }
+                if(nbi / 2 == parent.bi && nbj / 2 == parent.bj) {
+                    continue;
+                }
+                const AmrBlock* nb = this->find_block(level, nbi, nbj);
+                if(nb != nullptr && !nb->leaf) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Whether a neighbour of a leaf is refined more than one level further
+ *
+ * @param[in]  blk   The block
+ * @param[in]  side  The side
+ *
+ * @return     true if the mesh is unbalanced at this side
+ */
+bool AmrRD::is_unbalanced(const AmrBlock& blk, unsigned int side) {
+    unsigned int nbi, nbj;
+    if(!this->neighbour_index(blk, side, &nbi, &nbj)) {
+        return false;
+    }
+
+    const AmrBlock* nb = this->find_block(blk.level, nbi, nbj);
+    if(nb == nullptr || nb->leaf) {
+        return false;
+    }
+
+    // the two children of the neighbour that face this block
+    for(unsigned int k=0; k<2; k++) {
+        const unsigned int ci = side == 0 ? 1 : (side == 1 ? 0 : k);
+        const unsigned int cj = side == 2 ? 1 : (side == 3 ? 0 : k);
+        const AmrBlock* child = this->find_block(blk.level + 1, 2 * nbi + ci, 2 * nbj + cj);
+        if(child != nullptr && !child->leaf) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Rebuild the list of leaves per level
+ */
+void AmrRD::collect_leaves() {
+    this->leaves.assign(this->max_level + 1, std::vector<AmrBlock*>());
+
+    for(auto& item : this->blocks) {
+        if(item.second.leaf) {
+            this->leaves[item.second.level].push_back(&item.second);
+        }
+    }
+
+    // order the blocks along the memory layout of the uniform grid
+    for(auto& lv : this->leaves) {
+        std::sort(lv.begin(), lv.end(), [](const AmrBlock* x, const AmrBlock* y) {
+            return x->bj != y->bj ? x->bj < y->bj : x->bi < y->bi;
+        });
+    }
+}
+
+/**
+ * @brief      Resample the leaves onto the uniform grid of the finest level
+ *
+ * @param      a     Concentration matrix A
+ * @param      b     Concentration matrix B
+ */
+void AmrRD::resample(MatrixXXd& a, MatrixXXd& b) const {
+    const int B = this->block_size;
+
+    for(const auto& lv : this->leaves) {
+        const int n = lv.size();
+
+        #pragma omp parallel for schedule(static)
+        for(int k=0; k<n; k++) {
+            const AmrBlock& blk = *lv[k];
+            const unsigned int s = 1u << (this->max_level - blk.level);
+
+            for(int j=0; j<B; j++) {
+                for(int i=0; i<B; i++) {
+                    const unsigned int x = (blk.bi * B + i) * s;
+                    const unsigned int y = (blk.bj * B + j) * s;
+                    a.block(x, y, s, s).setConstant(blk.a[this->idx(i,j)]);
+                    b.block(x, y, s, s).setConstant(blk.b[this->idx(i,j)]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Find a block in the tree
+ *
+ * @param[in]  level  The level
+ * @param[in]  bi     block index along the rows
+ * @param[in]  bj     block index along the columns
+ *
+ * @return     pointer to the block or nullptr if it does not exist
+ */
+AmrBlock* AmrRD::find_block(unsigned int level, unsigned int bi, unsigned int bj) {
+    auto got = this->blocks.find(key(level, bi, bj));
+    if(got == this->blocks.end()) {
+        return nullptr;
+    }
+    return &got->second;
+}
+
+/**
+ * @brief      Get the indices of the neighbouring block at the same level
+ *
+ * @param[in]  blk   The block
+ * @param[in]  side  The side (0: -i, 1: +i, 2: -j, 3: +j)
+ * @param      nbi   block index along the rows of the neighbour
+ * @param      nbj   block index along the columns of the neighbour
+ *
+ * @return     false if the neighbour lies outside a non-periodic system
+ */
+bool AmrRD::neighbour_index(const AmrBlock& blk, unsigned int side, unsigned int* nbi, unsigned int* nbj) const {
+    const int ni = this->nbi << blk.level;
+    const int nj = this->nbj << blk.level;
+
+    int i = blk.bi;
+    int j = blk.bj;
+    switch(side) {
+        case 0: i--; break;
+        case 1: i++; break;
+        case 2: j--; break;
+        default: j++; break;
+    }
+
+    if(i < 0 || j < 0 || i >= ni || j >= nj) {
+        if(!this->pbc) {
+            return false;
+        }
+        i = (i + ni) % ni;
+        j = (j + nj) % nj;
+    }
+
+    *nbi = i;
+    *nbj = j;
+    return true;
+}
@@ -0,0 +1,421 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "reaction_system.h"
+#include "output_metadata.h"
+#include "output_spec.h"
+#include "frame_renderer.h"
+#include "field_analysis.h"
+#include "feature_extractor.h"
+#include "metrics_exporter.h"
+#include "frame_writer.h"
+#include "tqdm.hpp"
+
+/**
+ * @brief      Block of the adaptive mesh
+ *
+ * Every block holds block_size x block_size cells. A block at level l
+ * covers the same area as 4 blocks at level l+1. Only leaf blocks hold
+ * concentrations.
+ */
+struct AmrBlock {
+    unsigned int level;             //!< refinement level
+    unsigned int bi;                //!< block index along the rows at this level
+    unsigned int bj;                //!< block index along the columns at this level
+    bool leaf = true;               //!< whether the block is a leaf
+
+    std::vector<double> a;          //!< concentration A including a ghost layer
+    std::vector<double> b;          //!< concentration B including a ghost layer
+    std::vector<double> delta_a;    //!< increment of A
+    std::vector<double> delta_b;    //!< increment of B
+    std::vector<double> reg_a;      //!< flux register of A for the four sides
+    std::vector<double> reg_b;      //!< flux register of B for the four sides
+
+    int side_type[4];               //!< neighbour type for each side
+
+    double indicator = 0.0;         //!< refinement indicator
+    bool flag_refine = false;       //!< whether the block is to be refined
+};
+
+/**
+ * @brief      Reaction-diffusion system on a block-structured adaptive mesh
+ *
+ * The finest level has the resolution of the uniform system (width x height
+ * with spacing dx); every coarser level doubles the grid spacing. Diffusion
+ * is evaluated in flux form. At coarse-fine interfaces the flux is computed
+ * once on the fine side and is transferred to the coarse cells via flux
+ * registers, which keeps the scheme conservative. Optionally, every level
+ * takes time steps that are twice as large as those of the next finer level
+ * (subcycling).
+ */
+class AmrRD {
+private:
+    double Da;              //!< Diffusion coefficient of compound A
+    double Db;              //!< Diffusion coefficient of compound B
+
+    unsigned int width;     //!< width of the system at the finest level
+    unsigned int height;    //!< height of the system at the finest level
+    double dx;              //!< size of the space interval at the finest level
+    double dt;              //!< size of the time interval at the finest level
+    unsigned int steps;     //!< number of frames
+    unsigned int tsteps;    //!< number of (finest) time steps when to write a frame
+
+    unsigned int max_level;         //!< number of refinement levels above the base level
+    unsigned int block_size;        //!< number of cells along the edge of a block
+    double refine_tolerance;        //!< refine when a jump between cells exceeds this value
+    bool subcycle = false;          //!< whether coarser levels take larger time steps
+    unsigned int regrid_interval;   //!< number of finest time steps between regrids
+
+    unsigned int nbi;       //!< number of base blocks along the rows
+    unsigned int nbj;       //!< number of base blocks along the columns
+
+    std::unordered_map<uint64_t, AmrBlock> blocks;      //!< all blocks in the tree
+    std::vector<std::vector<AmrBlock*>> leaves;         //!< leaf blocks per level
+
+    MatrixXXd init_a;       //!< initial concentration A at the finest level
+    MatrixXXd init_b;       //!< initial concentration B at the finest level
+
+    std::vector<MatrixXXd> ta;  //!< matrix to hold temporal data
+    std::vector<MatrixXXd> tb;  //!< matrix to hold temporal data
+    std::vector<double> cell_fraction;  //!< number of cells relative to the uniform grid per frame
+    unsigned int nr_frames = 0;         //!< number of frames integrated
+
+    std::unique_ptr<OutputSpec> output_spec;    //!< Optional selection and reduction of the output
+    std::unique_ptr<FrameRenderer> renderer;    //!< Optional rendering of the frames to images
+    std::unique_ptr<FieldAnalysis> analysis;    //!< Optional statistics and spectra of the frames
+    std::unique_ptr<FeatureExtractor> features; //!< Optional spots and spiral tips of the frames
+    std::unique_ptr<MetricsExporter> metrics;   //!< Optional status file, rewritten while integrating
+    unsigned int chunk_size = 0;    //!< edge length of the chunks of the output (0 = contiguous frames)
+    int compression = 0;            //!< zlib compression level of the chunks
+    std::string quantization;       //!< quantization of the chunks (see FrameQuantizer, empty = none)
+
+    double t = 0.0;     //!< Total time t
+
+    std::unique_ptr<ReactionSystem> reaction_system;    //!< Pointer to reaction system
+
+    bool pbc = true;    //!< Whether to employ periodic boundary conditions
+
+    enum SideType {
+        SIDE_SAME,      //!< neighbour is a leaf at the same level
+        SIDE_COARSER,   //!< neighbour is a leaf at the next coarser level
+        SIDE_FINER,     //!< neighbour consists of leaves at the next finer level
+        SIDE_BOUNDARY   //!< zero-flux boundary of the system
+    };
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _Da          Diffusion coefficient of compound A
+     * @param[in]  _Db          Diffusion coefficient of compound B
+     * @param[in]  _width       width of the system at the finest level
+     * @param[in]  _height      height of the system at the finest level
+     * @param[in]  _dx          size of the space interval at the finest level
+     * @param[in]  _dt          size of the time interval at the finest level
+     * @param[in]  _steps       number of frames
+     * @param[in]  _tsteps      number of time steps when to write a frame
+     * @param[in]  _max_level   number of refinement levels above the base level
+     * @param[in]  _block_size  number of cells along the edge of a block
+     */
+    AmrRD(double _Da, double _Db,
+          unsigned int _width, unsigned int _height,
+          double _dx, double _dt, unsigned int _steps, unsigned int _tsteps,
+          unsigned int _max_level, unsigned int _block_size);
+
+    /**
+     * @brief      Sets the reaction.
+     *
+     * @param      _reaction_system  The reaction system
+     */
+    void set_reaction(ReactionSystem* _reaction_system);
+
+    /**
+     * @brief      Set whether system has periodic boundary conditions
+     *
+     * @param[in]  _pbc  Periodic boundary conditions
+     */
+    inline void set_pbc(bool _pbc) {
+        this->pbc = _pbc;
+    }
+
+    /**
+     * @brief      Set the refinement criterion
+     *
+     * @param[in]  _refine_tolerance  refine when a jump between cells exceeds this value
+     * @param[in]  _regrid_interval   number of finest time steps between regrids
+     */
+    void set_refinement(double _refine_tolerance, unsigned int _regrid_interval);
+
+    /**
+     * @brief      Set whether coarser levels take larger time steps
+     *
+     * @param[in]  _subcycle  Whether to subcycle
+     */
+    void set_subcycle(bool _subcycle);
+
+    /**
+     * @brief      Select, crop and downsample the fields that are written
+     *
+     * @param      _output_spec  The output specification
+     */
+    inline void set_output_spec(OutputSpec* _output_spec) {
+        this->output_spec = std::unique_ptr<OutputSpec>(_output_spec);
+    }
+
+    /**
+     * @brief      Store the output as (optionally compressed) chunks
+     *
+     * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  _compression   zlib compression level of the chunks
+     * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    inline void set_chunking(unsigned int _chunk_size, int _compression, const std::string& _quantization = "") {
+        this->chunk_size = _chunk_size;
+        this->compression = _compression;
+        this->quantization = _quantization;
+    }
+
+    /**
+     * @brief      Render the frames, resampled to the finest level, to images while integrating
+     *
+     * @param      _renderer  The renderer
+     */
+    inline void set_renderer(FrameRenderer* _renderer) {
+        this->renderer = std::unique_ptr<FrameRenderer>(_renderer);
+    }
+
+    /**
+     * @brief      Compute statistics and power spectra of the frames, resampled to the finest level, while integrating
+     *
+     * @param      _analysis  The analysis
+     */
+    inline void set_analysis(FieldAnalysis* _analysis) {
+        this->analysis = std::unique_ptr<FieldAnalysis>(_analysis);
+    }
+
+    /**
+     * @brief      Extract spots and spiral tips from the frames, resampled to the finest level, while integrating
+     *
+     * @param      _features  The feature extractor
+     */
+    inline void set_features(FeatureExtractor* _features) {
+        this->features = std::unique_ptr<FeatureExtractor>(_features);
+    }
+
+    /**
+     * @brief      Periodically write the progress of the integration to a status file
+     *
+     * @param      _metrics  The metrics exporter
+     */
+    inline void set_metrics(MetricsExporter* _metrics) {
+        this->metrics = std::unique_ptr<MetricsExporter>(_metrics);
+    }
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    inline void set_parameters(const std::string& params) {
+        this->reaction_system->set_parameters(params);
+        this->init();
+    }
+
+    /**
+     * @brief      Perform time integration
+     */
+    void time_integrate();
+
+    /**
+     * @brief      Write the frames, resampled to the finest level, to the file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_state_to_file(const std::string& filename);
+
+    /**
+     * @brief      Write run metadata (JSON) to file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_metadata_to_file(const std::string& filename);
+
+private:
+    /**
+     * @brief      Initialize the system at the finest level
+     */
+    void init();
+
+    /**
+     * @brief      Build the block tree from the initial concentrations
+     */
+    void build();
+
+    /**
+     * @brief      Advance all leaves at a level and (recursively) all finer levels
+     *
+     * @param[in]  level  The level
+     * @param[in]  dt_l   time step at this level
+     */
+    void advance(unsigned int level, double dt_l);
+
+    /**
+     * @brief      Adapt the mesh to the refinement indicator
+     */
+    void regrid();
+
+    /**
+     * @brief      Fill the ghost layer of a leaf and establish its neighbour types
+     *
+     * @param      blk   The block
+     */
+    void fill_ghosts(AmrBlock& blk);
+
+    /**
+     * @brief      Calculate the increments of a leaf
+     *
+     * Fluxes over coarse-fine interfaces are deposited in the flux register
+     * of the coarse neighbour.
+     *
+     * @param      blk   The block
+     * @param[in]  dt_l  time step at the level of the block
+     */
+    void compute_increments(AmrBlock& blk, double dt_l);
+
+    /**
+     * @brief      Add the increments and the flux registers to a leaf
+     *
+     * @param      blk   The block
+     * @param[in]  dt_l  time step at the level of the block
+     */
+    void apply_increments(AmrBlock& blk, double dt_l);
+
+    /**
+     * @brief      Calculate the refinement indicator of a leaf
+     *
+     * @param      blk   The block
+     */
+    void calculate_indicator(AmrBlock& blk);
+
+    /**
+     * @brief      Split a leaf into four children
+     *
+     * @param      blk   The block
+     */
+    void refine_block(AmrBlock& blk);
+
+    /**
+     * @brief      Merge four children into their parent
+     *
+     * @param      parent  The parent block
+     */
+    void coarsen_block(AmrBlock& parent);
+
+    /**
+     * @brief      Whether coarsening the children of a block keeps the mesh balanced
+     *
+     * @param[in]  parent  The parent block
+     *
+     * @return     true if the children can be merged
+     */
+    bool can_coarsen(const AmrBlock& parent);
+
+    /**
+     * @brief      Whether a neighbour of a leaf is refined more than one level further
+     *
+     * @param[in]  blk   The block
+     * @param[in]  side  The side
+     *
+     * @return     true if the mesh is unbalanced at this side
+     */
+    bool is_unbalanced(const AmrBlock& blk, unsigned int side);
+
+    /**
+     * @brief      Rebuild the list of leaves per level
+     */
+    void collect_leaves();
+
+    /**
+     * @brief      Resample the leaves onto the uniform grid of the finest level
+     *
+     * @param      a     Concentration matrix A
+     * @param      b     Concentration matrix B
+     */
+    void resample(MatrixXXd& a, MatrixXXd& b) const;
+
+    /**
+     * @brief      Find a block in the tree
+     *
+     * @param[in]  level  The level
+     * @param[in]  bi     block index along the rows
+     * @param[in]  bj     block index along the columns
+     *
+     * @return     pointer to the block or nullptr if it does not exist
+     */
+    AmrBlock* find_block(unsigned int level, unsigned int bi, unsigned int bj);
+
+    /**
+     * @brief      Get the indices of the neighbouring block at the same level
+     *
+     * @param[in]  blk   The block
+     * @param[in]  side  The side (0: -i, 1: +i, 2: -j, 3: +j)
+     * @param      nbi   block index along the rows of the neighbour
+     * @param      nbj   block index along the columns of the neighbour
+     *
+     * @return     false if the neighbour lies outside a non-periodic system
+     */
+    bool neighbour_index(const AmrBlock& blk, unsigned int side, unsigned int* nbi, unsigned int* nbj) const;
+
+    /**
+     * @brief      Construct the key of a block
+     */
+    static inline uint64_t key(unsigned int level, unsigned int bi, unsigned int bj) {
+        return ((uint64_t)level << 56) | ((uint64_t)bi << 28) | (uint64_t)bj;
+    }
+
+    /**
+     * @brief      Index of a cell in the ghosted storage of a block
+     *
+     * @param[in]  i     row index (-1 to block_size)
+     * @param[in]  j     column index (-1 to block_size)
+     */
+    inline unsigned int idx(int i, int j) const {
+        return (i + 1) + (j + 1) * (this->block_size + 2);
+    }
+
+    /**
+     * @brief      Size of the grid spacing at a level
+     */
+    inline double spacing(unsigned int level) const {
+        return this->dx * (double)(1u << (this->max_level - level));
+    }
+};
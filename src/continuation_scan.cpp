@@ -0,0 +1,294 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "continuation_scan.h"
+#include "output_metadata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec           specification of the scan
+ * @param[in]  _parameters    parameters of the reaction system, which contain the varied parameter
+ * @param[in]  species_names  names of all species
+ * @param[in]  width          width of the system
+ * @param[in]  height         height of the system
+ * @param[in]  _filename      file to write the bifurcation diagram to
+ */
+ContinuationScan::ContinuationScan(const std::string& spec, const std::string& _parameters,
+                                   const std::vector<std::string>& species_names,
+                                   unsigned int width, unsigned int height, const std::string& _filename) :
+    parameters(_parameters),
+    names(species_names),
+    size((size_t)width * height),
+    filename(_filename) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid continuation specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "param" && key != "from" && key != "to" && key != "n" && key != "values" && key != "backward") {
+            throw std::runtime_error("Invalid continuation specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    if(params.count("param") == 0) {
+        throw std::runtime_error("Invalid continuation specification: the parameter (param) is missing");
+    }
+    this->parameter = params["param"];
+
+    // the varied parameter replaces its value among the parameters of the reaction system
+    bool found = false;
+    boost::split(pieces, this->parameters, boost::is_any_of(";"), boost::token_compress_on);
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece.substr(0, piece.find('='))) == this->parameter) {
+            found = true;
+        }
+    }
+    if(!found) {
+        throw std::runtime_error("Invalid continuation specification: " + this->parameter +
+                                 " is not among the parameters of the reaction system");
+    }
+
+    std::vector<double> path;
+    if(params.count("values") > 0) {
+        if(params.count("from") > 0 || params.count("to") > 0 || params.count("n") > 0) {
+            throw std::runtime_error("Invalid continuation specification: give either values or from, to and n");
+        }
+        std::vector<std::string> items;
+        boost::split(items, params["values"], boost::is_any_of(","), boost::token_compress_on);
+        for(const std::string& item : items) {
+            path.push_back(boost::lexical_cast<double>(boost::trim_copy(item)));
+        }
+    } else {
+        if(params.count("from") == 0 || params.count("to") == 0) {
+            throw std::runtime_error("Invalid continuation specification: give values or from and to");
+        }
+        const double from = boost::lexical_cast<double>(params["from"]);
+        const double to = boost::lexical_cast<double>(params["to"]);
+        const unsigned int n = params.count("n") > 0 ? boost::lexical_cast<unsigned int>(params["n"]) : 11;
+        if(n < 2) {
+            throw std::runtime_error("Invalid continuation specification: n has to be at least 2");
+        }
+        for(unsigned int i=0; i<n; i++) {
+            path.push_back(((double)(n - 1 - i) * from + (double)i * to) / (double)(n - 1));
+        }
+    }
+
+    for(double value : path) {
+        Case c;
+        c.value = value;
+        this->cases.push_back(c);
+    }
+
+    // the return path starts next to the turning point
+    if(params.count("backward") > 0 && boost::lexical_cast<bool>(params["backward"])) {
+        for(size_t i=path.size() - 1; i-- > 0;) {
+            Case c;
+            c.value = path[i];
+            c.backward = true;
+            this->cases.push_back(c);
+        }
+    }
+}
+
+/**
+ * @brief      Get the parameters of the reaction system for a case
+ *
+ * @param[in]  i     case
+ *
+ * @return     parameter string
+ */
+std::string ContinuationScan::get_parameters(size_t i) const {
+    std::vector<std::string> pieces;
+    boost::split(pieces, this->parameters, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::string result;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        if(!result.empty()) {
+            result += ";";
+        }
+        if(boost::trim_copy(piece.substr(0, piece.find('='))) == this->parameter) {
+            result += this->parameter + "=" + boost::lexical_cast<std::string>(this->cases[i].value);
+        } else {
+            result += piece;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief      Record the final state of a case
+ *
+ * @param[in]  i          case
+ * @param[in]  frames     number of frames integrated
+ * @param[in]  time       time integrated
+ * @param[in]  converged  whether a steady state was reached
+ * @param[in]  periodic   whether the steady state is periodic
+ * @param[in]  period     period of a periodic steady state
+ * @param[in]  c          concentrations of all species
+ */
+void ContinuationScan::record(size_t i, unsigned int frames, double time, bool converged, bool periodic, double period,
+                              const std::vector<const double*>& c) {
+    Case& result = this->cases[i];
+    result.frames = frames;
+    result.time = time;
+    result.converged = converged;
+    result.periodic = periodic;
+    result.period = period;
+    result.mean.clear();
+    result.stdev.clear();
+    result.min.clear();
+    result.max.clear();
+
+    const long int n = (long int)this->size;
+    for(const double* data : c) {
+        double sum = 0.0;
+        double lo = data[0];
+        double hi = data[0];
+        #pragma omp parallel for reduction(+:sum) reduction(min:lo) reduction(max:hi)
+        for(long int k=0; k<n; k++) {
+            sum += data[k];
+            lo = std::min(lo, data[k]);
+            hi = std::max(hi, data[k]);
+        }
+        const double mean = sum / (double)n;
+
+        double sq = 0.0;
+        #pragma omp parallel for reduction(+:sq)
+        for(long int k=0; k<n; k++) {
+            sq += (data[k] - mean) * (data[k] - mean);
+        }
+
+        result.mean.push_back(mean);
+        result.stdev.push_back(std::sqrt(sq / (double)n));
+        result.min.push_back(lo);
+        result.max.push_back(hi);
+    }
+}
+
+/**
+ * @brief      Write the bifurcation diagram to file
+ */
+void ContinuationScan::write() const {
+    auto array = [](const std::vector<double>& values) {
+        std::ostringstream ss;
+        ss << "[";
+        for(size_t i=0; i<values.size(); i++) {
+            ss << (i == 0 ? "" : ", ") << OutputMetadata::encode(values[i]);
+        }
+        ss << "]";
+        return ss.str();
+    };
+
+    OutputMetadata diagram;
+    diagram.set("parameter", this->parameter);
+    diagram.set("cases", (unsigned int)this->cases.size());
+
+    std::vector<double> frames, time, period;
+    std::vector<std::string> direction;
+    std::ostringstream converged, periodic;
+    for(size_t i=0; i<this->cases.size(); i++) {
+        const Case& c = this->cases[i];
+        frames.push_back(c.frames);
+        time.push_back(c.time);
+        period.push_back(c.period);
+        direction.push_back(c.backward ? "backward" : "forward");
+        converged << (i == 0 ? "" : ", ") << (c.converged ? "true" : "false");
+        periodic << (i == 0 ? "" : ", ") << (c.periodic ? "true" : "false");
+    }
+    diagram.set("value", this->get_values());
+    diagram.set("direction", direction);
+    diagram.set("frames", frames);
+    diagram.set("time", time);
+    diagram.set_raw("converged", "[" + converged.str() + "]");
+    diagram.set_raw("periodic", "[" + periodic.str() + "]");
+    diagram.set("period", period);
+
+    // one object per species holding the order parameters along the path
+    for(unsigned int s=0; s<this->names.size(); s++) {
+        std::vector<double> mean, stdev, min, max;
+        for(const Case& c : this->cases) {
+            mean.push_back(c.mean.empty() ? NAN : c.mean[s]);
+            stdev.push_back(c.stdev.empty() ? NAN : c.stdev[s]);
+            min.push_back(c.min.empty() ? NAN : c.min[s]);
+            max.push_back(c.max.empty() ? NAN : c.max[s]);
+        }
+        diagram.set_raw(this->names[s], "{\"mean\": " + array(mean) + ", \"std\": " + array(stdev) +
+                                        ", \"min\": " + array(min) + ", \"max\": " + array(max) + "}");
+    }
+
+    diagram.write(this->filename);
+}
+
+/**
+ * @brief      Get the values of the parameter along the path
+ *
+ * @return     values
+ */
+std::vector<double> ContinuationScan::get_values() const {
+    std::vector<double> values;
+    for(const Case& c : this->cases) {
+        values.push_back(c.value);
+    }
+    return values;
+}
+
+/**
+ * @brief      Get a short description of the scan
+ *
+ * @return     description
+ */
+std::string ContinuationScan::get_description() const {
+    const size_t forward = std::count_if(this->cases.begin(), this->cases.end(),
+                                         [](const Case& c) { return !c.backward; });
+    std::ostringstream ss;
+    ss << this->parameter << " from " << this->cases.front().value << " to " << this->cases[forward - 1].value
+       << " in " << forward << " steps";
+    if(forward < this->cases.size()) {
+        ss << " and back";
+    }
+    return ss.str();
+}
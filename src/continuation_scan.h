@@ -0,0 +1,161 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Sweeps a parameter of the reaction system along a path, starting every case from the previous state
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     param=f          parameter of the reaction system that is varied
+ *     from=0.02        first value of the path
+ *     to=0.07          last value of the path
+ *     n=11             number of equidistant values from `from` to `to` (default: 11)
+ *     values=a,b,c     explicit path (instead of from, to and n)
+ *     backward=1       return along the path to expose hysteresis (default: 0)
+ *
+ * Only the first case starts from the initial condition of the reaction
+ * system; every next case continues from the final state of the previous
+ * one, which skips most of the transient when the path is finely sampled.
+ * A case ends once the convergence monitor finds a (periodic) steady state,
+ * or after the requested number of frames. The mean, standard deviation,
+ * minimum and maximum of every species in the final state of each case
+ * give the bifurcation diagram, which is written as JSON.
+ */
+class ContinuationScan {
+public:
+    /**
+     * @brief      A single value of the parameter along the path
+     */
+    struct Case {
+        double value = 0.0;         //!< value of the parameter
+        bool backward = false;      //!< whether the case lies on the return path
+        unsigned int frames = 0;    //!< number of frames integrated
+        double time = 0.0;          //!< time integrated
+        bool converged = false;     //!< whether a steady state was reached
+        bool periodic = false;      //!< whether the steady state is periodic
+        double period = 0.0;        //!< period of a periodic steady state
+        std::vector<double> mean;   //!< mean concentration per species
+        std::vector<double> stdev;  //!< standard deviation of the concentration per species
+        std::vector<double> min;    //!< minimum concentration per species
+        std::vector<double> max;    //!< maximum concentration per species
+    };
+
+private:
+    std::string parameter;          //!< name of the varied parameter
+    std::string parameters;         //!< parameters of the reaction system
+    std::vector<std::string> names; //!< names of all species
+    size_t size;                    //!< number of grid points
+    std::string filename;           //!< output file
+    std::vector<Case> cases;        //!< cases along the path
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec           specification of the scan
+     * @param[in]  _parameters    parameters of the reaction system, which contain the varied parameter
+     * @param[in]  species_names  names of all species
+     * @param[in]  width          width of the system
+     * @param[in]  height         height of the system
+     * @param[in]  _filename      file to write the bifurcation diagram to
+     */
+    ContinuationScan(const std::string& spec, const std::string& _parameters,
+                     const std::vector<std::string>& species_names,
+                     unsigned int width, unsigned int height, const std::string& _filename);
+
+    /**
+     * @brief      Get the parameters of the reaction system for a case
+     *
+     * @param[in]  i     case
+     *
+     * @return     parameter string
+     */
+    std::string get_parameters(size_t i) const;
+
+    /**
+     * @brief      Record the final state of a case
+     *
+     * @param[in]  i          case
+     * @param[in]  frames     number of frames integrated
+     * @param[in]  time       time integrated
+     * @param[in]  converged  whether a steady state was reached
+     * @param[in]  periodic   whether the steady state is periodic
+     * @param[in]  period     period of a periodic steady state
+     * @param[in]  c          concentrations of all species
+     */
+    void record(size_t i, unsigned int frames, double time, bool converged, bool periodic, double period,
+                const std::vector<const double*>& c);
+
+    /**
+     * @brief      Write the bifurcation diagram to file
+     */
+    void write() const;
+
+    /**
+     * @brief      Get the values of the parameter along the path
+     *
+     * @return     values
+     */
+    std::vector<double> get_values() const;
+
+    /**
+     * @brief      Get a short description of the scan
+     *
+     * @return     description
+     */
+    std::string get_description() const;
+
+    /**
+     * @brief      Get the number of cases
+     */
+    inline size_t get_nr_cases() const {
+        return this->cases.size();
+    }
+
+    /**
+     * @brief      Get a case
+     *
+     * @param[in]  i     case
+     */
+    inline const Case& get_case(size_t i) const {
+        return this->cases[i];
+    }
+
+    /**
+     * @brief      Get the name of the varied parameter
+     */
+    inline const std::string& get_parameter() const {
+        return this->parameter;
+    }
+
+    /**
+     * @brief      Get the output file
+     */
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+};
@@ -0,0 +1,201 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "convergence_monitor.h"
+
+#include <algorithm>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _tolerance           tolerance on max|dc/dt| (0 disables)
+ * @param[in]  _nframes             number of consecutive frames required
+ * @param[in]  _detect_periodic     whether to detect periodic states
+ * @param[in]  _periodic_tolerance  relative tolerance on period and amplitude
+ */
+ConvergenceMonitor::ConvergenceMonitor(double _tolerance, unsigned int _nframes,
+                                       bool _detect_periodic, double _periodic_tolerance) :
+    tolerance(_tolerance),
+    nframes(std::max(1u, _nframes)),
+    detect_periodic(_detect_periodic),
+    periodic_tolerance(_periodic_tolerance) {
+
+}
+
+/**
+ * @brief      Add probe values for a single time step
+ *
+ * @param[in]  t       current time
+ * @param[in]  values  probe values
+ */
+void ConvergenceMonitor::add_sample(double t, const std::vector<double>& values) {
+    if(this->probes.size() != values.size()) {
+        this->probes.resize(values.size());
+    }
+
+    if(!this->probes.empty()) {
+        this->sample_interval = t - this->probes[0].t_cur;
+    }
+
+    for(unsigned int i=0; i<values.size(); i++) {
+        ProbeSeries& p = this->probes[i];
+        const double v = values[i];
+
+        // a maximum is found when the series starts to decrease; ignore
+        // maxima that are not separated from the last one by a real trough
+        if(p.prev < p.cur && v <= p.cur) {
+            const double eps = 1e-9 * std::max(1.0, std::fabs(p.cur));
+            if(p.cur - p.trough > eps) {
+                p.peak_times.push_back(p.t_cur);
+                p.peak_values.push_back(p.cur);
+                p.trough = INFINITY;
+            }
+        }
+
+        p.trough = std::min(p.trough, v);
+        p.prev = p.cur;
+        p.cur = v;
+        p.t_cur = t;
+    }
+}
+
+/**
+ * @brief      Evaluate the convergence criteria at the end of a frame
+ *
+ * @param[in]  t        current time
+ * @param[in]  _rate_a  max|da/dt| of the last time step
+ * @param[in]  _rate_b  max|db/dt| of the last time step
+ *
+ * @return     true when a (periodic) steady state has been reached
+ */
+bool ConvergenceMonitor::check_frame(double t, double _rate_a, double _rate_b) {
+    this->rate_a = _rate_a;
+    this->rate_b = _rate_b;
+
+    if(this->converged) {
+        return true;
+    }
+
+    // stationary state
+    if(this->tolerance > 0.0) {
+        if(_rate_a < this->tolerance && _rate_b < this->tolerance) {
+            this->counter++;
+        } else {
+            this->counter = 0;
+        }
+
+        if(this->counter >= this->nframes) {
+            this->converged = true;
+            this->convergence_time = t;
+            return true;
+        }
+    }
+
+    // periodic state; all oscillating probes need to agree on the period
+    if(this->detect_periodic) {
+        unsigned int nr_periodic = 0;
+        double T0 = 0.0;
+        for(const ProbeSeries& p : this->probes) {
+            if(p.peak_times.empty()) {
+                continue;
+            }
+
+            double T = 0.0;
+            if(!this->probe_is_periodic(p, &T)) {
+                return false;
+            }
+
+            if(nr_periodic == 0) {
+                T0 = T;
+            } else if(std::fabs(T - T0) > std::max(this->periodic_tolerance * T0,
+                                                   1.5 * this->sample_interval)) {
+                return false;
+            }
+            nr_periodic++;
+        }
+
+        if(nr_periodic > 0) {
+            this->converged = true;
+            this->periodic = true;
+            this->period = T0;
+            this->convergence_time = t;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Forget the history, such that a new steady state can be detected
+ */
+void ConvergenceMonitor::reset() {
+    this->counter = 0;
+    this->converged = false;
+    this->periodic = false;
+    this->convergence_time = 0.0;
+    this->period = 0.0;
+    this->probes.clear();
+    this->sample_interval = 0.0;
+}
+
+/**
+ * @brief      Check whether a single probe has become periodic
+ *
+ * @param[in]  probe  The probe
+ * @param      T      period of the probe (output)
+ *
+ * @return     true if the probe is periodic
+ */
+bool ConvergenceMonitor::probe_is_periodic(const ProbeSeries& probe, double* T) const {
+    // require nframes full periods, but at least two
+    const unsigned int nperiods = std::max(2u, this->nframes);
+    const unsigned int npeaks = probe.peak_times.size();
+    if(npeaks < nperiods + 1) {
+        return false;
+    }
+
+    // average period and peak value over the last periods
+    double Tavg = 0.0;
+    double vavg = 0.0;
+    for(unsigned int i=npeaks-nperiods; i<npeaks; i++) {
+        Tavg += probe.peak_times[i] - probe.peak_times[i-1];
+        vavg += probe.peak_values[i];
+    }
+    Tavg /= (double)nperiods;
+    vavg /= (double)nperiods;
+
+    // maxima are only resolved up to a single sample interval
+    const double Ttol = std::max(this->periodic_tolerance * Tavg, 1.5 * this->sample_interval);
+    const double vscale = std::max(std::fabs(vavg), 1e-12);
+    for(unsigned int i=npeaks-nperiods; i<npeaks; i++) {
+        const double Ti = probe.peak_times[i] - probe.peak_times[i-1];
+        if(std::fabs(Ti - Tavg) > Ttol) {
+            return false;
+        }
+        if(std::fabs(probe.peak_values[i] - vavg) > this->periodic_tolerance * vscale) {
+            return false;
+        }
+    }
+
+    *T = Tavg;
+    return true;
+}
@@ -0,0 +1,168 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief      Detects stationary and periodic steady states
+ *
+ * The rate of change max|da/dt| and max|db/dt| is supplied at the end of
+ * every frame. When both stay below the tolerance for a number of
+ * consecutive frames, the system is considered stationary.
+ *
+ * Periodic (oscillating) steady states are detected from a small set of
+ * probe values that are supplied every time step. A probe is periodic when
+ * the intervals between its successive maxima and the values at these
+ * maxima no longer change.
+ */
+class ConvergenceMonitor {
+private:
+    double tolerance;               //!< tolerance on the rate of change
+    unsigned int nframes;           //!< number of consecutive frames required
+    bool detect_periodic;           //!< whether to look for periodic states
+    double periodic_tolerance;      //!< relative tolerance on period and amplitude
+
+    unsigned int counter = 0;       //!< consecutive frames below the tolerance
+
+    bool converged = false;         //!< whether a steady state was found
+    bool periodic = false;          //!< whether the steady state is periodic
+    double convergence_time = 0.0;  //!< time at which the steady state was found
+    double period = 0.0;            //!< period of the oscillation
+
+    double rate_a = 0.0;            //!< last reported rate of change for A
+    double rate_b = 0.0;            //!< last reported rate of change for B
+
+    /**
+     * @brief      Time series of a single probe
+     */
+    struct ProbeSeries {
+        double prev = NAN;              //!< second to last value
+        double cur = NAN;               //!< last value
+        double t_cur = 0.0;             //!< time of last value
+        double trough = INFINITY;       //!< lowest value since last maximum
+        std::vector<double> peak_times; //!< times of the maxima
+        std::vector<double> peak_values;//!< values at the maxima
+    };
+
+    std::vector<ProbeSeries> probes;    //!< probe time series
+    double sample_interval = 0.0;       //!< time between successive samples
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _tolerance           tolerance on max|dc/dt| (0 disables)
+     * @param[in]  _nframes             number of consecutive frames required
+     * @param[in]  _detect_periodic     whether to detect periodic states
+     * @param[in]  _periodic_tolerance  relative tolerance on period and amplitude
+     */
+    ConvergenceMonitor(double _tolerance, unsigned int _nframes,
+                       bool _detect_periodic, double _periodic_tolerance);
+
+    /**
+     * @brief      Add probe values for a single time step
+     *
+     * @param[in]  t       current time
+     * @param[in]  values  probe values
+     */
+    void add_sample(double t, const std::vector<double>& values);
+
+    /**
+     * @brief      Evaluate the convergence criteria at the end of a frame
+     *
+     * @param[in]  t        current time
+     * @param[in]  _rate_a  max|da/dt| of the last time step
+     * @param[in]  _rate_b  max|db/dt| of the last time step
+     *
+     * @return     true when a (periodic) steady state has been reached
+     */
+    bool check_frame(double t, double _rate_a, double _rate_b);
+
+    /**
+     * @brief      Forget the history, such that a new steady state can be detected
+     */
+    void reset();
+
+    /**
+     * @brief      Whether probe values are required
+     *
+     * @return     true if periodic states are detected
+     */
+    inline bool detects_periodic() const {
+        return this->detect_periodic;
+    }
+
+    /**
+     * @brief      Whether a steady state has been reached
+     */
+    inline bool is_converged() const {
+        return this->converged;
+    }
+
+    /**
+     * @brief      Whether the steady state is periodic
+     */
+    inline bool is_periodic() const {
+        return this->periodic;
+    }
+
+    /**
+     * @brief      Get the time at which the steady state was detected
+     */
+    inline double get_convergence_time() const {
+        return this->convergence_time;
+    }
+
+    /**
+     * @brief      Get the period of a periodic steady state
+     */
+    inline double get_period() const {
+        return this->period;
+    }
+
+    /**
+     * @brief      Get the last reported rate of change of A
+     */
+    inline double get_rate_a() const {
+        return this->rate_a;
+    }
+
+    /**
+     * @brief      Get the last reported rate of change of B
+     */
+    inline double get_rate_b() const {
+        return this->rate_b;
+    }
+
+private:
+    /**
+     * @brief      Check whether a single probe has become periodic
+     *
+     * @param[in]  probe  The probe
+     * @param      T      period of the probe (output)
+     *
+     * @return     true if the probe is periodic
+     */
+    bool probe_is_periodic(const ProbeSeries& probe, double* T) const;
+};
@@ -0,0 +1,392 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "diffusion_field.h"
+#include "laplacian.h"
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec     specification of the field
+ * @param[in]  _width   width of the system
+ * @param[in]  _height  height of the system
+ */
+DiffusionField::DiffusionField(const std::string& spec, unsigned int _width, unsigned int _height) :
+    width(_width),
+    height(_height),
+    description(spec) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+    const std::string type = boost::trim_copy(pieces[0]);
+
+    std::unordered_map<std::string, std::string> params;
+    for(unsigned int p=1; p<pieces.size(); p++) {
+        std::vector<std::string> vars;
+        boost::split(vars, pieces[p], boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid diffusion field parameter: " + pieces[p]);
+        }
+        params.emplace(boost::trim_copy(vars[0]), boost::trim_copy(vars[1]));
+    }
+
+    auto get = [&](const std::string& key, double def) {
+        auto got = params.find(key);
+        return got != params.end() ? boost::lexical_cast<double>(got->second) : def;
+    };
+
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+    this->kxx = MatrixXXd::Ones(W, H);
+    this->kxy = MatrixXXd::Zero(W, H);
+
+    if(type == "uniform") {
+        this->kxx.setConstant(get("value", 1.0));
+    } else if(type == "layers") {
+        // alternating layers stacked along the axis
+        const unsigned int n = std::max(1.0, get("n", 4));
+        const double low = get("low", 0.2);
+        const double high = get("high", 1.0);
+        const bool along_x = params.count("axis") > 0 && params["axis"] == "x";
+        for(unsigned int j=0; j<H; j++) {
+            for(unsigned int i=0; i<W; i++) {
+                const unsigned int layer = along_x ? (i * n) / W : (j * n) / H;
+                this->kxx(i,j) = (layer % 2 == 0) ? high : low;
+            }
+        }
+    } else if(type == "inclusion") {
+        // disc in the center of the system
+        const double radius = get("radius", 0.25) * std::min(W, H);
+        const double value = get("value", 0.1);
+        for(unsigned int j=0; j<H; j++) {
+            for(unsigned int i=0; i<W; i++) {
+                const double x = i + 0.5 - 0.5 * W;
+                const double y = j + 0.5 - 0.5 * H;
+                if(x * x + y * y < radius * radius) {
+                    this->kxx(i,j) = value;
+                }
+            }
+        }
+    } else if(type == "fibres") {
+        // diffusion along the fibres is unity and ratio across them; the
+        // fibre orientation rotates by twist degrees from bottom to top
+        const double angle = get("angle", 0.0);
+        const double ratio = get("ratio", 0.1);
+        const double twist = get("twist", 0.0);
+        this->kyy = MatrixXXd::Ones(W, H);
+        for(unsigned int j=0; j<H; j++) {
+            const double theta = (angle + twist * (j + 0.5) / H) * M_PI / 180.0;
+            const double cs = std::cos(theta);
+            const double sn = std::sin(theta);
+            for(unsigned int i=0; i<W; i++) {
+                this->kxx(i,j) = cs * cs + ratio * sn * sn;
+                this->kyy(i,j) = sn * sn + ratio * cs * cs;
+                this->kxy(i,j) = (1.0 - ratio) * sn * cs;
+            }
+        }
+    } else if(type == "file") {
+        if(params.count("path") == 0) {
+            throw std::runtime_error("Diffusion field of type file requires a path");
+        }
+        this->load(params["path"]);
+    } else {
+        throw std::runtime_error("Invalid diffusion field: " + type + " (choose uniform, layers, inclusion, fibres or file)");
+    }
+
+    if(this->kyy.size() == 0) {
+        this->kyy = this->kxx;
+    }
+
+    // K has to be positive semi-definite
+    for(unsigned int k=0; k<W*H; k++) {
+        const double xx = this->kxx.data()[k];
+        const double yy = this->kyy.data()[k];
+        const double xy = this->kxy.data()[k];
+        if(xx < 0.0 || yy < 0.0 || xx * yy < xy * xy * (1.0 - 1e-12)) {
+            throw std::runtime_error("Diffusion field is not positive semi-definite");
+        }
+        if(xy != 0.0) {
+            this->anisotropic = true;
+        }
+    }
+}
+
+/**
+ * @brief      Derive the face coefficients for the boundary conditions
+ *
+ * For zero-flux boundaries, the coefficients of the faces at the edges of
+ * the system are zero.
+ *
+ * @param[in]  _pbc  whether periodic boundary conditions are used
+ */
+void DiffusionField::prepare(bool _pbc) {
+    this->pbc = _pbc;
+
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+
+    auto harmonic = [](double x, double y) {
+        return (x + y > 0.0) ? 2.0 * x * y / (x + y) : 0.0;
+    };
+
+    this->face_x = MatrixXXd::Zero(W, H);
+    this->face_y = MatrixXXd::Zero(W, H);
+    this->cross_x = MatrixXXd::Zero(W, H);
+    this->cross_y = MatrixXXd::Zero(W, H);
+    for(unsigned int j=0; j<H; j++) {
+        const unsigned int jr = (j + 1) % H;
+        for(unsigned int i=0; i<W; i++) {
+            const unsigned int id = (i + 1) % W;
+            if(this->pbc || i < W - 1) {
+                this->face_x(i,j) = harmonic(this->kxx(i,j), this->kxx(id,j));
+                this->cross_x(i,j) = 0.5 * (this->kxy(i,j) + this->kxy(id,j));
+            }
+            if(this->pbc || j < H - 1) {
+                this->face_y(i,j) = harmonic(this->kyy(i,j), this->kyy(i,jr));
+                this->cross_y(i,j) = 0.5 * (this->kxy(i,j) + this->kxy(i,jr));
+            }
+        }
+    }
+
+    // a tile is uniform when K is isotropic and constant over the tile and
+    // the cells surrounding it
+    this->tiles_i = (W + TILE - 1) / TILE;
+    this->tiles_j = (H + TILE - 1) / TILE;
+    this->tile_value.assign(this->tiles_i * this->tiles_j, NAN);
+    for(unsigned int tj=0; tj<this->tiles_j; tj++) {
+        for(unsigned int ti=0; ti<this->tiles_i; ti++) {
+            const double v = this->kxx(ti * TILE, tj * TILE);
+            bool uniform = true;
+
+            const int jb = (int)(tj * TILE) - 1;
+            const int je = std::min(H, (tj + 1) * TILE) + 1;
+            const int ib = (int)(ti * TILE) - 1;
+            const int ie = std::min(W, (ti + 1) * TILE) + 1;
+            for(int j=jb; j<je && uniform; j++) {
+                for(int i=ib; i<ie && uniform; i++) {
+                    if(!this->pbc && (i < 0 || j < 0 || i >= (int)W || j >= (int)H)) {
+                        continue;
+                    }
+                    const unsigned int wi = this->wrap(i, W);
+                    const unsigned int wj = this->wrap(j, H);
+                    uniform = (this->kxx(wi,wj) == v && this->kyy(wi,wj) == v && this->kxy(wi,wj) == 0.0);
+                }
+            }
+
+            if(uniform) {
+                this->tile_value[ti + tj * this->tiles_i] = v;
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate div(K grad c) on a block of the grid
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void DiffusionField::divergence_block(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                                      unsigned int i0, unsigned int i1,
+                                      unsigned int j0, unsigned int j1) const {
+    const double idx2 = 1.0 / (dx * dx);
+
+    for(unsigned int j=j0; j<j1; j++) {
+        double* d = &delta_c(0, j);
+        const unsigned int tj = j / TILE;
+
+        // split the column at the tile boundaries; consecutive tiles with
+        // the same value are evaluated at once
+        const double* tv = &this->tile_value[tj * this->tiles_i];
+        unsigned int ie = i0;
+        for(unsigned int ib=i0; ib<i1; ib=ie) {
+            const double v = tv[ib / TILE];
+            ie = std::min(i1, (ib / TILE + 1) * TILE);
+            while(ie < i1 && (tv[ie / TILE] == v || (std::isnan(v) && std::isnan(tv[ie / TILE])))) {
+                ie = std::min(i1, ie + TILE);
+            }
+
+            if(std::isnan(v)) {
+                this->divergence_segment(d, c, idx2, ib, ie, j);
+                continue;
+            }
+
+            // constant coefficient
+            if(this->pbc) {
+                laplacian_block_pbc(delta_c, c, dx, ib, ie, j, j+1);
+            } else {
+                laplacian_block_zeroflux(delta_c, c, dx, ib, ie, j, j+1);
+            }
+            if(v != 1.0) {
+                for(unsigned int i=ib; i<ie; i++) {
+                    d[i] *= v;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate div(K grad c) on a segment of a column with a general field
+ *
+ * The faces at the edges of the system carry a zero coefficient for
+ * zero-flux boundaries, hence the neighbours across these faces may be
+ * taken periodically. The mixed derivatives at the faces mirror the
+ * concentrations in the edges for zero-flux boundaries.
+ */
+void DiffusionField::divergence_segment(double* d, const MatrixXXd& c, double idx2,
+                                        unsigned int ib, unsigned int ie, unsigned int j) const {
+    const unsigned int rows = this->width;
+    const unsigned int cols = this->height;
+
+    const unsigned int jl = (j == 0) ? cols - 1 : j - 1;
+    const unsigned int jr = (j == cols - 1) ? 0 : j + 1;
+
+    const double* cc = &c(0, j);
+    const double* cl = &c(0, jl);
+    const double* cr = &c(0, jr);
+    const double* fx = &this->face_x(0, j);
+    const double* fyl = &this->face_y(0, jl);
+    const double* fyr = &this->face_y(0, j);
+
+    auto cell = [&](unsigned int i, unsigned int iu, unsigned int id) {
+        d[i] = (fx[i] * (cc[id] - cc[i]) - fx[iu] * (cc[i] - cc[iu]) +
+                fyr[i] * (cr[i] - cc[i]) - fyl[i] * (cc[i] - cl[i])) * idx2;
+    };
+
+    unsigned int b = ib;
+    unsigned int e = ie;
+    if(b == 0) {
+        cell(0, rows - 1, rows > 1 ? 1 : 0);
+        b = 1;
+    }
+    if(e == rows && b < e) {
+        cell(rows - 1, rows - 2, 0);
+        e = rows - 1;
+    }
+    for(unsigned int i=b; i<e; i++) {
+        cell(i, i-1, i+1);
+    }
+
+    if(!this->anisotropic) {
+        return;
+    }
+
+    // mixed derivatives
+    const double* clm = &c(0, this->wrap((int)j - 1, cols));
+    const double* crm = &c(0, this->wrap((int)j + 1, cols));
+    const double* gx = &this->cross_x(0, j);
+    const double* gyl = &this->cross_y(0, jl);
+    const double* gyr = &this->cross_y(0, j);
+
+    auto mixed = [&](unsigned int i, unsigned int iu, unsigned int id, unsigned int im, unsigned int ip) {
+        // Kxy dc/dy at the faces i-1/2 and i+1/2
+        const double fx_lo = gx[iu] * (crm[iu] + crm[i] - clm[iu] - clm[i]);
+        const double fx_hi = gx[i] * (crm[i] + crm[id] - clm[i] - clm[id]);
+
+        // Kxy dc/dx at the faces j-1/2 and j+1/2
+        const double fy_lo = gyl[i] * (cc[ip] + cl[ip] - cc[im] - cl[im]);
+        const double fy_hi = gyr[i] * (cc[ip] + cr[ip] - cc[im] - cr[im]);
+
+        d[i] += 0.25 * (fx_hi - fx_lo + fy_hi - fy_lo) * idx2;
+    };
+
+    b = ib;
+    e = ie;
+    if(b == 0) {
+        mixed(0, rows - 1, rows > 1 ? 1 : 0, this->wrap(-1, rows), this->wrap(1, rows));
+        b = 1;
+    }
+    if(e == rows && b < e) {
+        mixed(rows - 1, rows - 2, 0, rows - 2, this->wrap(rows, rows));
+        e = rows - 1;
+    }
+    for(unsigned int i=b; i<e; i++) {
+        mixed(i, i-1, i+1, i-1, i+1);
+    }
+}
+
+/**
+ * @brief      Largest eigenvalue of K over the system
+ */
+double DiffusionField::get_max() const {
+    double kmax = 0.0;
+    for(unsigned int k=0; k<this->kxx.size(); k++) {
+        const double xx = this->kxx.data()[k];
+        const double yy = this->kyy.data()[k];
+        const double xy = this->kxy.data()[k];
+        kmax = std::max(kmax, 0.5 * (xx + yy) + std::sqrt(0.25 * (xx - yy) * (xx - yy) + xy * xy));
+    }
+    return kmax;
+}
+
+/**
+ * @brief      Fraction of the tiles that are evaluated using the fast path
+ */
+double DiffusionField::get_uniform_fraction() const {
+    unsigned int n = 0;
+    for(double v : this->tile_value) {
+        n += std::isnan(v) ? 0 : 1;
+    }
+    return this->tile_value.empty() ? 0.0 : (double)n / (double)this->tile_value.size();
+}
+
+/**
+ * @brief      Read the field from a file
+ *
+ * @param[in]  path  The path
+ */
+void DiffusionField::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if(!in.good()) {
+        throw std::runtime_error("Cannot open diffusion field: " + path);
+    }
+
+    const size_t n = this->width * this->height;
+    const size_t nvalues = in.tellg() / sizeof(double);
+    in.seekg(0);
+
+    if(nvalues == n) {
+        in.read((char*)this->kxx.data(), n * sizeof(double));
+    } else if(nvalues == 3 * n) {
+        this->kyy = MatrixXXd(this->width, this->height);
+        in.read((char*)this->kxx.data(), n * sizeof(double));
+        in.read((char*)this->kyy.data(), n * sizeof(double));
+        in.read((char*)this->kxy.data(), n * sizeof(double));
+    } else {
+        throw std::runtime_error("Diffusion field " + path + " should hold " + std::to_string(n) +
+                                 " or " + std::to_string(3 * n) + " doubles");
+    }
+}
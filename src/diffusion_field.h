@@ -0,0 +1,169 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Spatially varying and anisotropic diffusion
+ *
+ * The medium is described by a dimensionless, symmetric tensor field K
+ * (with components Kxx, Kyy and Kxy per grid point) that multiplies the
+ * diffusion coefficient of every species, i.e. the diffusion term of
+ * species s reads D_s div(K grad c_s).
+ *
+ * The divergence is discretized in flux form, such that the amount of
+ * material leaving a cell equals the amount entering its neighbour. The
+ * coefficient at a cell face is the harmonic mean of the adjacent cells,
+ * which is exact for layered media. Mixed derivatives for anisotropic
+ * media use the four cells around the face.
+ *
+ * Tiles in which K is isotropic and constant (including the cells around
+ * the tile) are evaluated with the five-point Laplacian.
+ */
+class DiffusionField {
+public:
+    static const unsigned int TILE = 16;    //!< edge length of the tiles for the fast path
+
+private:
+    unsigned int width;         //!< width of the system
+    unsigned int height;        //!< height of the system
+    std::string description;    //!< specification of the field
+
+    MatrixXXd kxx;              //!< xx component of K
+    MatrixXXd kyy;              //!< yy component of K
+    MatrixXXd kxy;              //!< xy component of K
+    bool anisotropic = false;   //!< whether any xy component is nonzero
+
+    // quantities derived by prepare()
+    bool pbc = true;            //!< whether periodic boundary conditions are used
+    MatrixXXd face_x;           //!< Kxx at the face between (i,j) and (i+1,j)
+    MatrixXXd face_y;           //!< Kyy at the face between (i,j) and (i,j+1)
+    MatrixXXd cross_x;          //!< Kxy at the face between (i,j) and (i+1,j)
+    MatrixXXd cross_y;          //!< Kxy at the face between (i,j) and (i,j+1)
+    unsigned int tiles_i = 0;   //!< number of tiles along the rows
+    unsigned int tiles_j = 0;   //!< number of tiles along the columns
+    std::vector<double> tile_value;     //!< value of K in a uniform tile, NAN otherwise
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * The specification starts with the type of field, followed by its
+     * parameters, e.g. "layers;n=4;low=0.2;high=1". Available are
+     *
+     *   uniform;value=v
+     *   layers;n=4;low=0.2;high=1;axis=y
+     *   inclusion;radius=0.25;value=0.1
+     *   fibres;angle=0;ratio=0.1;twist=0
+     *   file;path=field.bin
+     *
+     * @param[in]  spec     specification of the field
+     * @param[in]  _width   width of the system
+     * @param[in]  _height  height of the system
+     */
+    DiffusionField(const std::string& spec, unsigned int _width, unsigned int _height);
+
+    /**
+     * @brief      Derive the face coefficients for the boundary conditions
+     *
+     * @param[in]  _pbc  whether periodic boundary conditions are used
+     */
+    void prepare(bool _pbc);
+
+    /**
+     * @brief      Calculate div(K grad c) on a block of the grid
+     *
+     * @param      delta_c  Concentration update matrix
+     * @param[in]  c        Current concentration matrix
+     * @param[in]  dx       size of the space interval
+     * @param[in]  i0       first row of the block
+     * @param[in]  i1       last row (exclusive) of the block
+     * @param[in]  j0       first column of the block
+     * @param[in]  j1       last column (exclusive) of the block
+     */
+    void divergence_block(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                          unsigned int i0, unsigned int i1,
+                          unsigned int j0, unsigned int j1) const;
+
+    /**
+     * @brief      Largest eigenvalue of K over the system
+     */
+    double get_max() const;
+
+    /**
+     * @brief      Fraction of the tiles that are evaluated using the fast path
+     */
+    double get_uniform_fraction() const;
+
+    /**
+     * @brief      Get the specification of the field
+     */
+    inline const std::string& get_description() const {
+        return this->description;
+    }
+
+    /**
+     * @brief      Whether the field is anisotropic
+     */
+    inline bool is_anisotropic() const {
+        return this->anisotropic;
+    }
+
+private:
+    /**
+     * @brief      Read the field from a file
+     *
+     * The file holds width x height doubles (isotropic) or three planes of
+     * width x height doubles (Kxx, Kyy and Kxy), ordered in the same way as
+     * the frames of the output file.
+     *
+     * @param[in]  path  The path
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief      Calculate div(K grad c) on a segment of a column with a general field
+     */
+    void divergence_segment(double* d, const MatrixXXd& c, double idx2,
+                            unsigned int ib, unsigned int ie, unsigned int j) const;
+
+    /**
+     * @brief      Index of a neighbour along an axis of n grid points
+     *
+     * For zero-flux boundaries, the cell itself is returned at the edges.
+     */
+    inline unsigned int wrap(int i, int n) const {
+        if(i < 0) {
+            return this->pbc ? i + n : 0;
+        }
+        if(i >= n) {
+            return this->pbc ? i - n : n - 1;
+        }
+        return i;
+    }
+};
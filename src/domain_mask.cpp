@@ -0,0 +1,361 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "domain_mask.h"
+#include "laplacian.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object from a mask image
+ *
+ * @param[in]  spec     specification of the mask
+ * @param[in]  _width   width of the system
+ * @param[in]  _height  height of the system
+ */
+DomainMask::DomainMask(const std::string& spec, unsigned int _width, unsigned int _height) :
+    width(_width),
+    height(_height),
+    description(spec) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid mask specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "path" && key != "threshold" && key != "invert") {
+            throw std::runtime_error("Invalid mask specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    if(params.count("path") == 0) {
+        throw std::runtime_error("Invalid mask specification: the image (path) is missing");
+    }
+    const double threshold = params.count("threshold") > 0 ? boost::lexical_cast<double>(params["threshold"]) : 0.5;
+    const bool invert = params.count("invert") > 0 && boost::lexical_cast<bool>(params["invert"]);
+
+    this->load(params["path"], threshold, invert);
+    this->prepare(this->pbc);
+}
+
+/**
+ * @brief      Constructs the object from the active grid points
+ *
+ * @param[in]  _active  whether a grid point lies inside, ordered as the matrices
+ * @param[in]  _width   width of the system
+ * @param[in]  _height  height of the system
+ */
+DomainMask::DomainMask(const std::vector<unsigned char>& _active, unsigned int _width, unsigned int _height) :
+    width(_width),
+    height(_height),
+    description("array"),
+    active(_active) {
+
+    if(this->active.size() != (size_t)this->width * this->height) {
+        throw std::runtime_error("The mask does not match the size of the system");
+    }
+    this->nr_active = std::count_if(this->active.begin(), this->active.end(), [](unsigned char v) { return v != 0; });
+    if(this->nr_active == 0) {
+        throw std::runtime_error("The mask does not contain any grid point");
+    }
+    this->prepare(this->pbc);
+}
+
+/**
+ * @brief      Build the blocks and the neighbour tables for the boundary conditions
+ *
+ * @param[in]  _pbc  whether periodic boundary conditions are used
+ */
+void DomainMask::prepare(bool _pbc) {
+    this->pbc = _pbc;
+    this->blocks.clear();
+    this->run_offset.clear();
+    this->neighbours.clear();
+
+    const int W = this->width;
+    const int H = this->height;
+    const unsigned int tiles_i = (W + TILE - 1) / TILE;
+    const unsigned int tiles_j = (H + TILE - 1) / TILE;
+
+    // index of a neighbour; outside of the domain, the cell itself is
+    // returned such that there is no flux across the boundary
+    auto neighbour = [&](int i, int j, unsigned int self) -> unsigned int {
+        if(i < 0 || j < 0 || i >= W || j >= H) {
+            if(!this->pbc) {
+                return self;
+            }
+            i = (i + W) % W;
+            j = (j + H) % H;
+        }
+        const unsigned int k = i + j * W;
+        return this->active[k] ? k : self;
+    };
+
+    // a tile is interior when the five-point stencil of none of its cells
+    // reaches outside of the domain
+    std::vector<unsigned char> interior(tiles_i * tiles_j, 0);
+    for(unsigned int tj=0; tj<tiles_j; tj++) {
+        for(unsigned int ti=0; ti<tiles_i; ti++) {
+            const int i0 = ti * TILE;
+            const int i1 = std::min(i0 + (int)TILE, W);
+            const int j0 = tj * TILE;
+            const int j1 = std::min(j0 + (int)TILE, H);
+
+            bool full = true;
+            for(int j=j0-1; j<=j1 && full; j++) {
+                for(int i=i0-1; i<=i1 && full; i++) {
+                    if((i == i0 - 1 || i == i1) && (j == j0 - 1 || j == j1)) {
+                        continue;   // corners are not part of the stencil
+                    }
+                    if(!this->pbc && (i < 0 || j < 0 || i >= W || j >= H)) {
+                        continue;   // the edge of the system is handled by the kernel
+                    }
+                    full = this->active[(i + W) % W + ((j + H) % H) * W] != 0;
+                }
+            }
+
+            if(full) {
+                interior[ti + tj * tiles_i] = 1;
+                this->blocks.push_back({(unsigned int)i0, (unsigned int)i1, (unsigned int)j0, (unsigned int)j1});
+            }
+        }
+    }
+    this->nr_interior = this->blocks.size();
+
+    // the active cells of the other tiles form runs along the columns
+    for(unsigned int tj=0; tj<tiles_j; tj++) {
+        for(unsigned int ti=0; ti<tiles_i; ti++) {
+            if(interior[ti + tj * tiles_i]) {
+                continue;
+            }
+            const int i0 = ti * TILE;
+            const int i1 = std::min(i0 + (int)TILE, W);
+            const int j0 = tj * TILE;
+            const int j1 = std::min(j0 + (int)TILE, H);
+
+            for(int j=j0; j<j1; j++) {
+                int i = i0;
+                while(i < i1) {
+                    if(!this->active[i + j * W]) {
+                        i++;
+                        continue;
+                    }
+                    const int ib = i;
+                    while(i < i1 && this->active[i + j * W]) {
+                        i++;
+                    }
+
+                    this->blocks.push_back({(unsigned int)ib, (unsigned int)i, (unsigned int)j, (unsigned int)j + 1});
+                    this->run_offset.push_back(this->neighbours.size());
+                    for(int r=ib; r<i; r++) {
+                        const unsigned int self = r + j * W;
+                        this->neighbours.push_back(neighbour(r - 1, j, self));
+                        this->neighbours.push_back(neighbour(r + 1, j, self));
+                        this->neighbours.push_back(neighbour(r, j - 1, self));
+                        this->neighbours.push_back(neighbour(r, j + 1, self));
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate the Laplacian on a single block
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  k        index of the block
+ */
+void DomainMask::block_laplacian(MatrixXXd& delta_c, const MatrixXXd& c, double dx, size_t k) const {
+    const Block& block = this->blocks[k];
+
+    // interior tiles share the kernel of the full grid
+    if(k < this->nr_interior) {
+        laplacian_block(delta_c, c, dx, STENCIL_5POINT, this->pbc, block.i0, block.i1, block.j0, block.j1);
+        return;
+    }
+
+    const double idx2 = 1.0 / (dx * dx);
+    const double* pc = c.data();
+    double* d = delta_c.data();
+    const unsigned int* nb = &this->neighbours[this->run_offset[k - this->nr_interior]];
+
+    for(size_t self = block.i0 + (size_t)block.j0 * this->width; self < block.i1 + (size_t)block.j0 * this->width; self++) {
+        d[self] = (pc[nb[0]] + pc[nb[1]] + pc[nb[2]] + pc[nb[3]] - 4.0 * pc[self]) * idx2;
+        nb += 4;
+    }
+}
+
+/**
+ * @brief      Calculate the Laplacian on all active cells
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ */
+void DomainMask::laplacian(MatrixXXd& delta_c, const MatrixXXd& c, double dx) const {
+    const int nblocks = this->blocks.size();
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<nblocks; k++) {
+        this->block_laplacian(delta_c, c, dx, k);
+    }
+}
+
+/**
+ * @brief      Set the cells outside of the domain to zero
+ *
+ * @param      c     concentration matrix
+ */
+void DomainMask::clear_outside(MatrixXXd& c) const {
+    double* pc = c.data();
+    for(size_t k=0; k<this->active.size(); k++) {
+        if(!this->active[k]) {
+            pc[k] = 0.0;
+        }
+    }
+}
+
+/**
+ * @brief      Fraction of the grid points that lie inside
+ */
+double DomainMask::get_active_fraction() const {
+    return (double)this->nr_active / (double)this->active.size();
+}
+
+/**
+ * @brief      Fraction of the active grid points that lie in interior tiles
+ */
+double DomainMask::get_interior_fraction() const {
+    size_t cells = 0;
+    for(unsigned int k=0; k<this->nr_interior; k++) {
+        const Block& block = this->blocks[k];
+        cells += (size_t)(block.i1 - block.i0) * (block.j1 - block.j0);
+    }
+    return (double)cells / (double)this->nr_active;
+}
+
+/**
+ * @brief      Read the domain from a PGM image
+ *
+ * @param[in]  path       The path
+ * @param[in]  threshold  grey value (relative to white) from which a pixel lies inside
+ * @param[in]  invert     whether the dark pixels form the domain
+ */
+void DomainMask::load(const std::string& path, double threshold, bool invert) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("Cannot open mask image " + path);
+    }
+
+    // header fields are separated by whitespace and may be interleaved with comments
+    auto token = [&in]() {
+        std::string t;
+        char ch;
+        while(in.get(ch)) {
+            if(ch == '#' && t.empty()) {
+                std::string comment;
+                std::getline(in, comment);
+            } else if(std::isspace((unsigned char)ch)) {
+                if(!t.empty()) {
+                    break;
+                }
+            } else {
+                t += ch;
+            }
+        }
+        return t;
+    };
+
+    const std::string magic = token();
+    if(magic != "P2" && magic != "P5") {
+        throw std::runtime_error("Mask image " + path + " is not a PGM image (P2 or P5)");
+    }
+    unsigned int pw = 0, ph = 0, maxval = 0;
+    try {
+        pw = boost::lexical_cast<unsigned int>(token());
+        ph = boost::lexical_cast<unsigned int>(token());
+        maxval = boost::lexical_cast<unsigned int>(token());
+    } catch(const boost::bad_lexical_cast&) {
+        throw std::runtime_error("Invalid header of mask image " + path);
+    }
+    if(pw == 0 || ph == 0 || maxval == 0 || maxval > 65535) {
+        throw std::runtime_error("Invalid header of mask image " + path);
+    }
+
+    // pixels are stored row by row, starting at the top of the image
+    std::vector<unsigned int> pixels((size_t)pw * ph);
+    if(magic == "P5") {
+        const unsigned int nbytes = (maxval < 256) ? 1 : 2;
+        std::vector<unsigned char> raw(pixels.size() * nbytes);
+        in.read((char*)raw.data(), raw.size());
+        if(!in) {
+            throw std::runtime_error("Mask image " + path + " is truncated");
+        }
+        for(size_t k=0; k<pixels.size(); k++) {
+            pixels[k] = (nbytes == 1) ? raw[k] : (raw[2*k] << 8 | raw[2*k+1]);
+        }
+    } else {
+        for(size_t k=0; k<pixels.size(); k++) {
+            const std::string t = token();
+            if(t.empty()) {
+                throw std::runtime_error("Mask image " + path + " is truncated");
+            }
+            pixels[k] = boost::lexical_cast<unsigned int>(t);
+        }
+    }
+
+    // nearest pixel, with the first grid row at the bottom of the image
+    this->active.assign((size_t)this->width * this->height, 0);
+    for(unsigned int j=0; j<this->height; j++) {
+        const unsigned int y = ph - 1 - std::min(ph - 1, (unsigned int)(((double)j + 0.5) * ph / this->height));
+        for(unsigned int i=0; i<this->width; i++) {
+            const unsigned int x = std::min(pw - 1, (unsigned int)(((double)i + 0.5) * pw / this->width));
+            const bool inside = (double)pixels[(size_t)y * pw + x] >= threshold * maxval;
+            this->active[i + (size_t)j * this->width] = (inside != invert);
+        }
+    }
+
+    this->nr_active = std::count(this->active.begin(), this->active.end(), 1);
+    if(this->nr_active == 0) {
+        throw std::runtime_error("Mask image " + path + " does not contain any grid point of the domain");
+    }
+}
@@ -0,0 +1,171 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Irregular domain given by a mask image
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     path=shape.pgm   PGM image (P2 or P5) holding the domain
+ *     threshold=0.5    grey value (relative to white) from which a pixel lies inside
+ *     invert=1         the dark pixels form the domain (default: 0)
+ *
+ * The image is resampled to the grid (nearest pixel), with the first grid
+ * row at the bottom of the image. Cells outside of the domain are set to
+ * zero and never evaluated; the boundary of the domain is zero-flux.
+ *
+ * The grid is divided into tiles. Tiles in which all cells, including the
+ * cells around the tile, lie inside the domain are evaluated by the same
+ * five-point kernel as the full grid. The active cells of the other tiles
+ * are stored as runs along the columns, for which the neighbours of every
+ * cell are precomputed, with neighbours outside of the domain replaced by
+ * the cell itself. Tiles outside of the domain cost nothing.
+ */
+class DomainMask {
+public:
+    static const unsigned int TILE = 32;    //!< edge length of the tiles
+
+    /**
+     * @brief      Rectangular block of active cells spanning rows [i0,i1) and columns [j0,j1)
+     */
+    struct Block {
+        unsigned int i0;    //!< first row
+        unsigned int i1;    //!< last row (exclusive)
+        unsigned int j0;    //!< first column
+        unsigned int j1;    //!< last column (exclusive)
+    };
+
+private:
+    unsigned int width;                 //!< width of the system
+    unsigned int height;                //!< height of the system
+    std::string description;            //!< specification of the mask
+    std::vector<unsigned char> active;  //!< whether a grid point lies inside, ordered as the matrices
+    size_t nr_active = 0;               //!< number of grid points inside
+
+    // quantities derived by prepare()
+    bool pbc = true;                        //!< whether periodic boundary conditions are used
+    std::vector<Block> blocks;              //!< interior tiles, followed by the runs of the other tiles
+    unsigned int nr_interior = 0;           //!< number of interior tiles at the front of the blocks
+    std::vector<unsigned int> run_offset;   //!< first cell of a run in the neighbour table
+    std::vector<unsigned int> neighbours;   //!< four neighbours (up, down, left, right) per cell of the runs
+
+public:
+    /**
+     * @brief      Constructs the object from a mask image
+     *
+     * @param[in]  spec     specification of the mask
+     * @param[in]  _width   width of the system
+     * @param[in]  _height  height of the system
+     */
+    DomainMask(const std::string& spec, unsigned int _width, unsigned int _height);
+
+    /**
+     * @brief      Constructs the object from the active grid points
+     *
+     * @param[in]  _active  whether a grid point lies inside, ordered as the matrices
+     * @param[in]  _width   width of the system
+     * @param[in]  _height  height of the system
+     */
+    DomainMask(const std::vector<unsigned char>& _active, unsigned int _width, unsigned int _height);
+
+    /**
+     * @brief      Build the blocks and the neighbour tables for the boundary conditions
+     *
+     * @param[in]  _pbc  whether periodic boundary conditions are used
+     */
+    void prepare(bool _pbc);
+
+    /**
+     * @brief      Calculate the Laplacian on a single block
+     *
+     * @param      delta_c  Concentration update matrix
+     * @param[in]  c        Current concentration matrix
+     * @param[in]  dx       size of the space interval
+     * @param[in]  k        index of the block
+     */
+    void block_laplacian(MatrixXXd& delta_c, const MatrixXXd& c, double dx, size_t k) const;
+
+    /**
+     * @brief      Calculate the Laplacian on all active cells
+     *
+     * @param      delta_c  Concentration update matrix
+     * @param[in]  c        Current concentration matrix
+     * @param[in]  dx       size of the space interval
+     */
+    void laplacian(MatrixXXd& delta_c, const MatrixXXd& c, double dx) const;
+
+    /**
+     * @brief      Set the cells outside of the domain to zero
+     *
+     * @param      c     concentration matrix
+     */
+    void clear_outside(MatrixXXd& c) const;
+
+    /**
+     * @brief      Fraction of the grid points that lie inside
+     */
+    double get_active_fraction() const;
+
+    /**
+     * @brief      Fraction of the active grid points that lie in interior tiles
+     */
+    double get_interior_fraction() const;
+
+    /**
+     * @brief      Get the blocks of active cells
+     */
+    inline const std::vector<Block>& get_blocks() const {
+        return this->blocks;
+    }
+
+    /**
+     * @brief      Whether a grid point lies inside
+     */
+    inline bool is_active(unsigned int i, unsigned int j) const {
+        return this->active[i + (size_t)j * this->width];
+    }
+
+    /**
+     * @brief      Get the specification of the mask
+     */
+    inline const std::string& get_description() const {
+        return this->description;
+    }
+
+private:
+    /**
+     * @brief      Read the domain from a PGM image
+     *
+     * @param[in]  path       The path
+     * @param[in]  threshold  grey value (relative to white) from which a pixel lies inside
+     * @param[in]  invert     whether the dark pixels form the domain
+     */
+    void load(const std::string& path, double threshold, bool invert);
+};
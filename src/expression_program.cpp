@@ -0,0 +1,606 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "expression_program.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _variables  names of the input variables
+ */
+ExpressionProgram::ExpressionProgram(const std::vector<std::string>& _variables) :
+    variables(_variables) {
+}
+
+/**
+ * @brief      Define a named constant
+ *
+ * @param[in]  name   The name
+ * @param[in]  value  The value
+ */
+void ExpressionProgram::set_constant(const std::string& name, double value) {
+    this->constants[name] = value;
+}
+
+/**
+ * @brief      Parse an expression and add it as an output
+ *
+ * @param[in]  expression  The expression
+ *
+ * @return     index of the output
+ */
+unsigned int ExpressionProgram::add_output(const std::string& expression) {
+    this->source = expression;
+    this->pos = 0;
+
+    const int node = this->parse_expression();
+    if(this->peek() != '\0') {
+        this->error("unexpected character");
+    }
+
+    this->outputs.push_back(node);
+    this->compiled = false;
+
+    return this->outputs.size() - 1;
+}
+
+/**
+ * @brief      Whether an output does not depend on any variable
+ *
+ * @param[in]  output  index of the output
+ */
+bool ExpressionProgram::is_constant(unsigned int output) const {
+    return this->nodes[this->outputs[output]].op == OP_CONST;
+}
+
+/**
+ * @brief      Value of an output that does not depend on any variable
+ *
+ * @param[in]  output  index of the output
+ */
+double ExpressionProgram::get_constant(unsigned int output) const {
+    if(!this->is_constant(output)) {
+        throw std::runtime_error("Expression does not evaluate to a constant");
+    }
+    return this->nodes[this->outputs[output]].value;
+}
+
+/**
+ * @brief      Translate the expression graph into bytecode
+ *
+ * Nodes are created after their operands, hence the node order is a valid
+ * evaluation order. Registers of intermediate results are released after
+ * their last use and are reused by subsequent instructions.
+ */
+void ExpressionProgram::compile() {
+    const int nn = this->nodes.size();
+    const unsigned int nv = this->variables.size();
+
+    // only evaluate the nodes the outputs depend on
+    std::vector<bool> live(nn, false);
+    for(int o : this->outputs) {
+        live[o] = true;
+    }
+    for(int i=nn-1; i>=0; i--) {
+        if(!live[i]) {
+            continue;
+        }
+        if(this->nodes[i].l >= 0) {
+            live[this->nodes[i].l] = true;
+        }
+        if(this->nodes[i].r >= 0) {
+            live[this->nodes[i].r] = true;
+        }
+    }
+
+    // last instruction that reads a node; outputs are never released
+    std::vector<int> last_use(nn, -1);
+    for(int i=0; i<nn; i++) {
+        if(!live[i]) {
+            continue;
+        }
+        if(this->nodes[i].l >= 0) {
+            last_use[this->nodes[i].l] = i;
+        }
+        if(this->nodes[i].r >= 0) {
+            last_use[this->nodes[i].r] = i;
+        }
+    }
+    for(int o : this->outputs) {
+        last_use[o] = nn;
+    }
+
+    // variables and constants occupy the first registers
+    std::vector<unsigned int> reg(nn, 0);
+    std::vector<double> constant_values;
+    for(int i=0; i<nn; i++) {
+        if(!live[i]) {
+            continue;
+        }
+        if(this->nodes[i].op == OP_VAR) {
+            reg[i] = (unsigned int)this->nodes[i].value;
+        } else if(this->nodes[i].op == OP_CONST) {
+            reg[i] = nv + constant_values.size();
+            constant_values.push_back(this->nodes[i].value);
+        }
+    }
+    const unsigned int first_temp = nv + constant_values.size();
+
+    this->nr_constant_registers = constant_values.size();
+    this->constant_registers.resize(constant_values.size() * CHUNK);
+    for(unsigned int c=0; c<constant_values.size(); c++) {
+        std::fill(this->constant_registers.begin() + c * CHUNK,
+                  this->constant_registers.begin() + (c + 1) * CHUNK,
+                  constant_values[c]);
+    }
+
+    // allocate the intermediate results
+    this->program.clear();
+    std::vector<unsigned int> free_registers;
+    unsigned int nr_temp = 0;
+    for(int i=0; i<nn; i++) {
+        const Node& node = this->nodes[i];
+        if(!live[i] || node.op == OP_VAR || node.op == OP_CONST) {
+            continue;
+        }
+
+        // operands that are no longer needed free their register, which
+        // may directly be reused as destination
+        for(int operand : {node.l, node.r}) {
+            if(operand >= 0 && last_use[operand] == i && reg[operand] >= first_temp &&
+               std::find(free_registers.begin(), free_registers.end(), reg[operand]) == free_registers.end()) {
+                free_registers.push_back(reg[operand]);
+            }
+        }
+
+        if(free_registers.empty()) {
+            reg[i] = first_temp + nr_temp++;
+        } else {
+            reg[i] = free_registers.back();
+            free_registers.pop_back();
+        }
+
+        this->program.push_back({node.op, reg[i], reg[node.l], node.r >= 0 ? reg[node.r] : reg[node.l]});
+    }
+    this->nr_temp_registers = nr_temp;
+
+    this->output_registers.clear();
+    for(int o : this->outputs) {
+        this->output_registers.push_back(reg[o]);
+    }
+
+    this->compiled = true;
+}
+
+/**
+ * @brief      Evaluate all outputs for a batch of grid points
+ *
+ * @param[in]  in      input variables (one array per variable)
+ * @param      out     outputs (one array per output)
+ * @param[in]  nr_out  number of arrays in out, which has to match the number of outputs
+ * @param[in]  n       number of grid points
+ */
+void ExpressionProgram::evaluate(const double* const* in, double* const* out, unsigned int nr_out, unsigned int n) const {
+    if(!this->compiled) {
+        throw std::logic_error("Expression program needs to be compiled before evaluation");
+    }
+    if(nr_out != this->outputs.size()) {
+        throw std::logic_error("Expression program has " + std::to_string(this->outputs.size()) +
+                               " outputs, but " + std::to_string(nr_out) + " arrays were provided");
+    }
+
+    const unsigned int nv = this->variables.size();
+    const unsigned int first_temp = nv + this->nr_constant_registers;
+
+    // every thread has its own registers
+    thread_local std::vector<double> scratch;
+    thread_local std::vector<const double*> regs;
+    scratch.resize(this->nr_temp_registers * CHUNK);
+    regs.resize(first_temp + this->nr_temp_registers);
+
+    for(unsigned int c=0; c<this->nr_constant_registers; c++) {
+        regs[nv + c] = &this->constant_registers[c * CHUNK];
+    }
+    for(unsigned int t=0; t<this->nr_temp_registers; t++) {
+        regs[first_temp + t] = &scratch[t * CHUNK];
+    }
+
+    for(unsigned int start=0; start<n; start+=CHUNK) {
+        const unsigned int len = std::min(CHUNK, n - start);
+
+        for(unsigned int v=0; v<nv; v++) {
+            regs[v] = in[v] + start;
+        }
+
+        for(const Instruction& ins : this->program) {
+            // destinations are always intermediate registers
+            double* d = &scratch[(ins.dst - first_temp) * CHUNK];
+            const double* x = regs[ins.src1];
+            const double* y = regs[ins.src2];
+
+            switch(ins.op) {
+                case OP_ADD:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = x[k] + y[k]; }
+                    break;
+                case OP_SUB:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = x[k] - y[k]; }
+                    break;
+                case OP_MUL:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = x[k] * y[k]; }
+                    break;
+                case OP_DIV:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = x[k] / y[k]; }
+                    break;
+                case OP_NEG:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = -x[k]; }
+                    break;
+                case OP_MIN:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = std::min(x[k], y[k]); }
+                    break;
+                case OP_MAX:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = std::max(x[k], y[k]); }
+                    break;
+                case OP_ABS:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = std::fabs(x[k]); }
+                    break;
+                case OP_SQRT:
+                    #pragma omp simd
+                    for(unsigned int k=0; k<len; k++) { d[k] = std::sqrt(x[k]); }
+                    break;
+                default:
+                    for(unsigned int k=0; k<len; k++) { d[k] = apply(ins.op, x[k], y[k]); }
+                    break;
+            }
+        }
+
+        for(unsigned int o=0; o<this->output_registers.size(); o++) {
+            std::memcpy(out[o] + start, regs[this->output_registers[o]], len * sizeof(double));
+        }
+    }
+}
+
+/**
+ * @brief      Add a node to the graph, folding constants and reusing existing nodes
+ *
+ * @return     index of the node
+ */
+int ExpressionProgram::make_node(Op op, int l, int r, double value) {
+    if(op != OP_CONST && op != OP_VAR) {
+        const bool lc = this->nodes[l].op == OP_CONST;
+        const bool rc = (r < 0) || this->nodes[r].op == OP_CONST;
+
+        // constant folding
+        if(lc && rc) {
+            return this->make_node(OP_CONST, -1, -1, apply(op, this->nodes[l].value, r >= 0 ? this->nodes[r].value : 0.0));
+        }
+
+        auto is_value = [&](int n, double v) {
+            return this->nodes[n].op == OP_CONST && this->nodes[n].value == v;
+        };
+
+        // algebraic identities
+        switch(op) {
+            case OP_ADD:
+                if(is_value(l, 0.0)) { return r; }
+                if(is_value(r, 0.0)) { return l; }
+                if(this->nodes[r].op == OP_NEG) { return this->make_node(OP_SUB, l, this->nodes[r].l); }
+                if(this->nodes[l].op == OP_NEG) { return this->make_node(OP_SUB, r, this->nodes[l].l); }
+                break;
+            case OP_SUB:
+                if(is_value(r, 0.0)) { return l; }
+                if(is_value(l, 0.0)) { return this->make_node(OP_NEG, r, -1); }
+                if(this->nodes[r].op == OP_NEG) { return this->make_node(OP_ADD, l, this->nodes[r].l); }
+                break;
+            case OP_MUL:
+            case OP_DIV:
+                if(is_value(r, 1.0)) { return l; }
+                if(op == OP_MUL && is_value(l, 1.0)) { return r; }
+                if(op == OP_MUL && is_value(l, -1.0)) { return this->make_node(OP_NEG, r, -1); }
+                if(is_value(r, -1.0)) { return this->make_node(OP_NEG, l, -1); }
+                // negations are moved outwards, such that -a*b and a*b share a node
+                if(this->nodes[l].op == OP_NEG) {
+                    return this->make_node(OP_NEG, this->make_node(op, this->nodes[l].l, r), -1);
+                }
+                if(this->nodes[r].op == OP_NEG) {
+                    return this->make_node(OP_NEG, this->make_node(op, l, this->nodes[r].l), -1);
+                }
+                break;
+            case OP_NEG:
+                if(this->nodes[l].op == OP_NEG) { return this->nodes[l].l; }
+                break;
+            case OP_POW:
+                if(rc) {
+                    const double e = this->nodes[r].value;
+                    if(e == std::round(e) && std::fabs(e) <= 16.0) {
+                        return this->make_integer_power(l, (int)e);
+                    }
+                    if(e == 0.5) {
+                        return this->make_node(OP_SQRT, l, -1);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+
+        // normalize the operand order of commutative operations
+        if((op == OP_ADD || op == OP_MUL || op == OP_MIN || op == OP_MAX) && l > r) {
+            std::swap(l, r);
+        }
+    }
+
+    // reuse an identical node if it exists
+    std::string key = std::to_string(op) + ":" + std::to_string(l) + ":" + std::to_string(r);
+    if(op == OP_CONST || op == OP_VAR) {
+        char bits[sizeof(double)];
+        std::memcpy(bits, &value, sizeof(double));
+        key += ":" + std::string(bits, sizeof(double));
+    }
+
+    auto got = this->node_lookup.find(key);
+    if(got != this->node_lookup.end()) {
+        return got->second;
+    }
+
+    this->nodes.push_back({op, l, r, value});
+    this->node_lookup.emplace(key, this->nodes.size() - 1);
+
+    return this->nodes.size() - 1;
+}
+
+/**
+ * @brief      Build a node for an integer power by repeated multiplication
+ */
+int ExpressionProgram::make_integer_power(int base, int exponent) {
+    if(exponent == 0) {
+        return this->make_node(OP_CONST, -1, -1, 1.0);
+    }
+    if(exponent < 0) {
+        return this->make_node(OP_DIV, this->make_node(OP_CONST, -1, -1, 1.0),
+                               this->make_integer_power(base, -exponent));
+    }
+    if(exponent == 1) {
+        return base;
+    }
+
+    // exponentiation by squaring; shared factors are merged by make_node
+    const int half = this->make_integer_power(base, exponent / 2);
+    const int square = this->make_node(OP_MUL, half, half);
+    if(exponent % 2 == 0) {
+        return square;
+    }
+    return this->make_node(OP_MUL, square, base);
+}
+
+/**
+ * @brief      Evaluate a single operation on scalars
+ */
+double ExpressionProgram::apply(Op op, double x, double y) {
+    switch(op) {
+        case OP_ADD:  return x + y;
+        case OP_SUB:  return x - y;
+        case OP_MUL:  return x * y;
+        case OP_DIV:  return x / y;
+        case OP_NEG:  return -x;
+        case OP_POW:  return std::pow(x, y);
+        case OP_EXP:  return std::exp(x);
+        case OP_LOG:  return std::log(x);
+        case OP_SQRT: return std::sqrt(x);
+        case OP_SIN:  return std::sin(x);
+        case OP_COS:  return std::cos(x);
+        case OP_TANH: return std::tanh(x);
+        case OP_ABS:  return std::fabs(x);
+        case OP_MIN:  return std::min(x, y);
+        case OP_MAX:  return std::max(x, y);
+        default:
+            throw std::logic_error("Invalid operation in expression");
+    }
+}
+
+/**
+ * @brief      Sum or difference of terms
+ */
+int ExpressionProgram::parse_expression() {
+    int node = this->parse_term();
+
+    while(true) {
+        const char c = this->peek();
+        if(c == '+') {
+            this->pos++;
+            node = this->make_node(OP_ADD, node, this->parse_term());
+        } else if(c == '-') {
+            this->pos++;
+            node = this->make_node(OP_SUB, node, this->parse_term());
+        } else {
+            return node;
+        }
+    }
+}
+
+/**
+ * @brief      Product or quotient of factors
+ */
+int ExpressionProgram::parse_term() {
+    int node = this->parse_unary();
+
+    while(true) {
+        const char c = this->peek();
+        if(c == '*') {
+            this->pos++;
+            node = this->make_node(OP_MUL, node, this->parse_unary());
+        } else if(c == '/') {
+            this->pos++;
+            node = this->make_node(OP_DIV, node, this->parse_unary());
+        } else {
+            return node;
+        }
+    }
+}
+
+/**
+ * @brief      Optionally negated power
+ */
+int ExpressionProgram::parse_unary() {
+    const char c = this->peek();
+    if(c == '-') {
+        this->pos++;
+        return this->make_node(OP_NEG, this->parse_unary(), -1);
+    }
+    if(c == '+') {
+        this->pos++;
+        return this->parse_unary();
+    }
+
+    return this->parse_power();
+}
+
+/**
+ * @brief      Primary raised to a power (right-associative)
+ */
+int ExpressionProgram::parse_power() {
+    const int base = this->parse_primary();
+
+    if(this->peek() == '^') {
+        this->pos++;
+        return this->make_node(OP_POW, base, this->parse_unary());
+    }
+
+    return base;
+}
+
+/**
+ * @brief      Number, name, function call or parenthesized expression
+ */
+int ExpressionProgram::parse_primary() {
+    const char c = this->peek();
+
+    if(c == '(') {
+        this->pos++;
+        const int node = this->parse_expression();
+        if(this->peek() != ')') {
+            this->error("expected ')'");
+        }
+        this->pos++;
+        return node;
+    }
+
+    if(std::isdigit(c) || c == '.') {
+        const char* begin = this->source.c_str() + this->pos;
+        char* end = nullptr;
+        const double value = std::strtod(begin, &end);
+        if(end == begin) {
+            this->error("invalid number");
+        }
+        this->pos += end - begin;
+        return this->make_node(OP_CONST, -1, -1, value);
+    }
+
+    if(std::isalpha(c) || c == '_') {
+        const size_t start = this->pos;
+        while(this->pos < this->source.size() &&
+              (std::isalnum(this->source[this->pos]) || this->source[this->pos] == '_')) {
+            this->pos++;
+        }
+        const std::string name = this->source.substr(start, this->pos - start);
+
+        // function call
+        if(this->peek() == '(') {
+            static const std::unordered_map<std::string, Op> unary = {
+                {"exp", OP_EXP}, {"log", OP_LOG}, {"sqrt", OP_SQRT}, {"sin", OP_SIN},
+                {"cos", OP_COS}, {"tanh", OP_TANH}, {"abs", OP_ABS}
+            };
+            static const std::unordered_map<std::string, Op> binary = {
+                {"pow", OP_POW}, {"min", OP_MIN}, {"max", OP_MAX}
+            };
+
+            this->pos++;
+            const int first = this->parse_expression();
+            int node = -1;
+            if(unary.count(name) > 0) {
+                node = this->make_node(unary.at(name), first, -1);
+            } else if(binary.count(name) > 0) {
+                if(this->peek() != ',') {
+                    this->error("expected ',' in call of " + name);
+                }
+                this->pos++;
+                const int second = this->parse_expression();
+                node = this->make_node(binary.at(name), first, second);
+            } else {
+                this->error("unknown function " + name);
+            }
+
+            if(this->peek() != ')') {
+                this->error("expected ')'");
+            }
+            this->pos++;
+            return node;
+        }
+
+        for(unsigned int v=0; v<this->variables.size(); v++) {
+            if(this->variables[v] == name) {
+                return this->make_node(OP_VAR, -1, -1, (double)v);
+            }
+        }
+
+        auto got = this->constants.find(name);
+        if(got != this->constants.end()) {
+            return this->make_node(OP_CONST, -1, -1, got->second);
+        }
+
+        this->pos = start;
+        this->error("unknown name " + name);
+    }
+
+    this->error(c == '\0' ? "unexpected end of expression" : "unexpected character");
+}
+
+/**
+ * @brief      Skip whitespace and return the next character
+ */
+char ExpressionProgram::peek() {
+    while(this->pos < this->source.size() && std::isspace(this->source[this->pos])) {
+        this->pos++;
+    }
+    return this->pos < this->source.size() ? this->source[this->pos] : '\0';
+}
+
+/**
+ * @brief      Throw an error pointing at the current position
+ */
+void ExpressionProgram::error(const std::string& message) const {
+    throw std::runtime_error("Error in expression \"" + this->source + "\" at position " +
+                             std::to_string(this->pos + 1) + ": " + message);
+}
@@ -0,0 +1,214 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief      Arithmetic expressions compiled to a register-based bytecode
+ *
+ * Expressions are parsed into a directed acyclic graph in which identical
+ * subexpressions are represented by a single node (hash-consing), such
+ * that common subexpressions are only evaluated once. Operations on
+ * constants are folded while parsing and small integer powers are expanded
+ * into multiplications. The graph is subsequently translated into a list of
+ * instructions operating on registers that each hold a chunk of grid
+ * points, which amortizes the cost of interpreting an instruction over the
+ * chunk and allows the compiler to vectorize the loop of every operation.
+ *
+ * Supported are +, -, *, /, ^ (power), parentheses and the functions exp,
+ * log, sqrt, sin, cos, tanh, abs, pow, min and max.
+ */
+class ExpressionProgram {
+public:
+    static const unsigned int CHUNK = 64;   //!< number of grid points per register
+
+private:
+    enum Op {
+        OP_CONST,
+        OP_VAR,
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_NEG,
+        OP_POW,
+        OP_EXP,
+        OP_LOG,
+        OP_SQRT,
+        OP_SIN,
+        OP_COS,
+        OP_TANH,
+        OP_ABS,
+        OP_MIN,
+        OP_MAX
+    };
+
+    /**
+     * @brief      Node of the expression graph
+     */
+    struct Node {
+        Op op;              //!< operation
+        int l;              //!< first operand (node index)
+        int r;              //!< second operand (node index)
+        double value;       //!< value of a constant or index of a variable
+    };
+
+    /**
+     * @brief      Bytecode instruction
+     */
+    struct Instruction {
+        Op op;              //!< operation
+        unsigned int dst;   //!< destination register
+        unsigned int src1;  //!< first source register
+        unsigned int src2;  //!< second source register
+    };
+
+    std::vector<std::string> variables;                 //!< names of the input variables
+    std::unordered_map<std::string, double> constants;  //!< named constants
+
+    std::vector<Node> nodes;                            //!< expression graph
+    std::unordered_map<std::string, int> node_lookup;   //!< hash-consing table
+    std::vector<int> outputs;                           //!< node per output
+
+    std::vector<Instruction> program;           //!< compiled instructions
+    std::vector<unsigned int> output_registers; //!< register per output
+    std::vector<double> constant_registers;     //!< constant values broadcast over a chunk
+    unsigned int nr_constant_registers = 0;     //!< number of constant registers
+    unsigned int nr_temp_registers = 0;         //!< number of temporary registers
+    bool compiled = false;                      //!< whether compile() has been called
+
+    // state of the parser
+    std::string source;     //!< expression being parsed
+    size_t pos = 0;         //!< position in the expression
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _variables  names of the input variables
+     */
+    ExpressionProgram(const std::vector<std::string>& _variables);
+
+    /**
+     * @brief      Define a named constant
+     *
+     * @param[in]  name   The name
+     * @param[in]  value  The value
+     */
+    void set_constant(const std::string& name, double value);
+
+    /**
+     * @brief      Parse an expression and add it as an output
+     *
+     * @param[in]  expression  The expression
+     *
+     * @return     index of the output
+     */
+    unsigned int add_output(const std::string& expression);
+
+    /**
+     * @brief      Whether an output does not depend on any variable
+     *
+     * @param[in]  output  index of the output
+     */
+    bool is_constant(unsigned int output) const;
+
+    /**
+     * @brief      Value of an output that does not depend on any variable
+     *
+     * @param[in]  output  index of the output
+     */
+    double get_constant(unsigned int output) const;
+
+    /**
+     * @brief      Translate the expression graph into bytecode
+     */
+    void compile();
+
+    /**
+     * @brief      Evaluate all outputs for a batch of grid points
+     *
+     * @param[in]  in      input variables (one array per variable)
+     * @param      out     outputs (one array per output)
+     * @param[in]  nr_out  number of arrays in out, which has to match the number of outputs
+     * @param[in]  n       number of grid points
+     */
+    void evaluate(const double* const* in, double* const* out, unsigned int nr_out, unsigned int n) const;
+
+    /**
+     * @brief      Get the number of outputs
+     */
+    inline unsigned int get_nr_outputs() const {
+        return this->outputs.size();
+    }
+
+    /**
+     * @brief      Get the number of instructions
+     */
+    inline unsigned int get_nr_instructions() const {
+        return this->program.size();
+    }
+
+    /**
+     * @brief      Get the number of registers holding intermediate results
+     */
+    inline unsigned int get_nr_registers() const {
+        return this->nr_temp_registers;
+    }
+
+private:
+    /**
+     * @brief      Add a node to the graph, folding constants and reusing existing nodes
+     *
+     * @return     index of the node
+     */
+    int make_node(Op op, int l, int r, double value = 0.0);
+
+    /**
+     * @brief      Build a node for an integer power by repeated multiplication
+     */
+    int make_integer_power(int base, int exponent);
+
+    /**
+     * @brief      Evaluate a single operation on scalars
+     */
+    static double apply(Op op, double x, double y);
+
+    int parse_expression();     //!< sum or difference of terms
+    int parse_term();           //!< product or quotient of factors
+    int parse_unary();          //!< optionally negated power
+    int parse_power();          //!< primary raised to a power
+    int parse_primary();        //!< number, name, function call or parenthesized expression
+
+    /**
+     * @brief      Skip whitespace and return the next character
+     */
+    char peek();
+
+    /**
+     * @brief      Throw an error pointing at the current position
+     */
+    [[noreturn]] void error(const std::string& message) const;
+};
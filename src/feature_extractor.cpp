@@ -0,0 +1,531 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "feature_extractor.h"
+#include "output_metadata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+static const double pi = 3.14159265358979323846;
+
+//! marks grid points that are not part of any spot
+static const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec           specification of the features
+ * @param[in]  species_names  names of all species
+ * @param[in]  _width         width of the system
+ * @param[in]  _height        height of the system
+ * @param[in]  _dx            grid spacing
+ * @param[in]  _pbc           whether the boundaries are periodic
+ * @param[in]  _filename      file to write the feature tables to
+ */
+FeatureExtractor::FeatureExtractor(const std::string& spec, const std::vector<std::string>& species_names,
+                                   unsigned int _width, unsigned int _height, double _dx, bool _pbc,
+                                   const std::string& _filename) :
+    width(_width),
+    height(_height),
+    dx(_dx),
+    pbc(_pbc),
+    filename(_filename),
+    names(species_names) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid feature specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "spots" && key != "minsize" && key != "tips" && key != "every") {
+            throw std::runtime_error("Invalid feature specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    // species are given by name or by index
+    auto find_species = [&](const std::string& name) {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            if(this->names[s] == name) {
+                return s;
+            }
+        }
+        if(!name.empty() && name.find_first_not_of("0123456789") == std::string::npos &&
+           std::stoul(name) < this->names.size()) {
+            return (unsigned int)std::stoul(name);
+        }
+        throw std::runtime_error("Invalid feature specification: unknown species " + name);
+    };
+
+    if(params.count("spots") > 0) {
+        const std::string& item = params["spots"];
+        const size_t op = item.find_first_of("<>");
+        if(op == std::string::npos) {
+            throw std::runtime_error("Invalid feature specification: spots requires species>value or species<value");
+        }
+        this->spots = true;
+        this->spot_field = find_species(boost::trim_copy(item.substr(0, op)));
+        this->threshold = boost::lexical_cast<double>(boost::trim_copy(item.substr(op + 1)));
+        this->below = (item[op] == '<');
+    }
+    if(params.count("minsize") > 0) {
+        this->minsize = boost::lexical_cast<unsigned int>(params["minsize"]);
+    }
+
+    if(params.count("tips") > 0) {
+        std::vector<std::string> items;
+        boost::split(items, params["tips"], boost::is_any_of(","), boost::token_compress_on);
+        if(items.size() != 2) {
+            throw std::runtime_error("Invalid feature specification: tips requires two isolines, e.g. A:0.5,B:0.3");
+        }
+        for(unsigned int k=0; k<2; k++) {
+            const size_t colon = items[k].find(':');
+            if(colon == std::string::npos) {
+                throw std::runtime_error("Invalid feature specification: isoline " + items[k] + " (use species:value)");
+            }
+            this->tip_fields[k] = find_species(boost::trim_copy(items[k].substr(0, colon)));
+            this->tip_values[k] = boost::lexical_cast<double>(boost::trim_copy(items[k].substr(colon + 1)));
+        }
+        if(this->tip_fields[0] == this->tip_fields[1]) {
+            throw std::runtime_error("Invalid feature specification: tips require the isolines of two different species");
+        }
+        this->tips = true;
+    }
+
+    if(params.count("every") > 0) {
+        this->every = boost::lexical_cast<unsigned int>(params["every"]);
+        if(this->every == 0) {
+            throw std::runtime_error("Invalid feature specification: every has to be positive");
+        }
+    }
+
+    if(!this->spots && !this->tips) {
+        throw std::runtime_error("Invalid feature specification: select spots and/or tips");
+    }
+}
+
+/**
+ * @brief      Extract the features of a frame if it is due
+ *
+ * @param[in]  frame  frame number
+ * @param[in]  t      time
+ * @param[in]  c      concentrations of all species (column-major, width x height)
+ */
+void FeatureExtractor::extract(unsigned int frame, double t, const std::vector<const double*>& c) {
+    if(frame % this->every != 0) {
+        return;
+    }
+
+    this->frames.push_back(frame);
+    this->times.push_back(t);
+    if(this->spots) {
+        this->frame_spots.push_back(this->find_spots(c[this->spot_field]));
+    }
+    if(this->tips) {
+        this->frame_tips.push_back(this->find_tips(c[this->tip_fields[0]], c[this->tip_fields[1]]));
+    }
+}
+
+/**
+ * @brief      Label the spots of a field
+ *
+ * @param[in]  c     concentration (column-major, width x height)
+ *
+ * @return     spots ordered by their first grid point
+ */
+std::vector<FeatureExtractor::Spot> FeatureExtractor::find_spots(const double* c) {
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+    const long long n = (long long)W * H;
+    this->parent.resize(n);
+
+    #pragma omp parallel for schedule(static)
+    for(long long i=0; i<n; i++) {
+        const bool inside = this->below ? (c[i] < this->threshold) : (c[i] > this->threshold);
+        this->parent[i] = inside ? (unsigned int)i : NONE;
+    }
+
+    // label every tile in parallel; unions within a tile only touch its own grid points
+    const unsigned int tiles_i = (W + TILE - 1) / TILE;
+    const unsigned int tiles_j = (H + TILE - 1) / TILE;
+    #pragma omp parallel for schedule(dynamic)
+    for(unsigned int k=0; k<tiles_i * tiles_j; k++) {
+        const unsigned int i0 = (k % tiles_i) * TILE;
+        const unsigned int j0 = (k / tiles_i) * TILE;
+        const unsigned int i1 = std::min(i0 + TILE, W);
+        const unsigned int j1 = std::min(j0 + TILE, H);
+        for(unsigned int j=j0; j<j1; j++) {
+            for(unsigned int i=i0; i<i1; i++) {
+                const unsigned int p = j * W + i;
+                if(this->parent[p] == NONE) {
+                    continue;
+                }
+                if(i > i0 && this->parent[p - 1] != NONE) {
+                    this->unite(p - 1, p);
+                }
+                if(j > j0 && this->parent[p - W] != NONE) {
+                    this->unite(p - W, p);
+                }
+            }
+        }
+    }
+
+    // merge the components across the edges of the tiles and the periodic boundaries
+    auto merge = [&](unsigned int p, unsigned int q) {
+        if(this->parent[p] != NONE && this->parent[q] != NONE) {
+            this->unite(p, q);
+        }
+    };
+    for(unsigned int i0=TILE; i0<W; i0+=TILE) {
+        for(unsigned int j=0; j<H; j++) {
+            merge(j * W + i0 - 1, j * W + i0);
+        }
+    }
+    for(unsigned int j0=TILE; j0<H; j0+=TILE) {
+        for(unsigned int i=0; i<W; i++) {
+            merge((j0 - 1) * W + i, j0 * W + i);
+        }
+    }
+    if(this->pbc) {
+        for(unsigned int j=0; j<H && W > 1; j++) {
+            merge(j * W + W - 1, j * W);
+        }
+        for(unsigned int i=0; i<W && H > 1; i++) {
+            merge((H - 1) * W + i, i);
+        }
+    }
+
+    // roots are the first grid point of their component, which numbers the spots in order
+    std::vector<unsigned int> label(n, NONE);
+    unsigned int nspots = 0;
+    for(long long i=0; i<n; i++) {
+        if(this->parent[i] == NONE) {
+            continue;
+        }
+        const unsigned int root = this->find(i);
+        label[i] = (root == i) ? nspots++ : label[root];
+    }
+
+    // number of grid points and (circular) sums of the coordinates per spot
+    const unsigned int nsums = 5;
+    std::vector<double> sums((size_t)nspots * nsums, 0.0);
+    #pragma omp parallel
+    {
+        std::vector<double> local((size_t)nspots * nsums, 0.0);
+        #pragma omp for schedule(static)
+        for(unsigned int j=0; j<H; j++) {
+            const double phi = 2.0 * pi * j / H;
+            for(unsigned int i=0; i<W; i++) {
+                const unsigned int l = label[(size_t)j * W + i];
+                if(l == NONE) {
+                    continue;
+                }
+                const double theta = 2.0 * pi * i / W;
+                double* s = &local[(size_t)l * nsums];
+                s[0] += 1.0;
+                if(this->pbc) {
+                    s[1] += std::cos(theta);
+                    s[2] += std::sin(theta);
+                    s[3] += std::cos(phi);
+                    s[4] += std::sin(phi);
+                } else {
+                    s[1] += i;
+                    s[3] += j;
+                }
+            }
+        }
+        #pragma omp critical
+        for(size_t k=0; k<local.size(); k++) {
+            sums[k] += local[k];
+        }
+    }
+
+    // a periodic coordinate is the circular mean mapped back onto [0, L)
+    auto circular_mean = [](double cos_sum, double sin_sum, unsigned int L) {
+        double angle = std::atan2(sin_sum, cos_sum);
+        if(angle < 0.0) {
+            angle += 2.0 * pi;
+        }
+        const double x = angle * L / (2.0 * pi);
+        return x < L ? x : 0.0;
+    };
+
+    std::vector<Spot> result;
+    for(unsigned int l=0; l<nspots; l++) {
+        const double* s = &sums[(size_t)l * nsums];
+        if(s[0] < this->minsize) {
+            continue;
+        }
+        Spot spot;
+        spot.area = s[0] * this->dx * this->dx;
+        if(this->pbc) {
+            spot.x = circular_mean(s[1], s[2], W) * this->dx;
+            spot.y = circular_mean(s[3], s[4], H) * this->dx;
+        } else {
+            spot.x = s[1] / s[0] * this->dx;
+            spot.y = s[3] / s[0] * this->dx;
+        }
+        result.push_back(spot);
+    }
+
+    return result;
+}
+
+/**
+ * @brief      Locate the spiral tips
+ *
+ * @param[in]  u     first field (column-major, width x height)
+ * @param[in]  v     second field (column-major, width x height)
+ *
+ * @return     tips ordered by row
+ */
+std::vector<FeatureExtractor::Tip> FeatureExtractor::find_tips(const double* u, const double* v) const {
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+
+    // squares wrap around the periodic boundaries
+    const unsigned int nx = this->pbc ? W : W - 1;
+    const unsigned int ny = this->pbc ? H : H - 1;
+    std::vector<std::vector<Tip>> rows(ny);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(unsigned int j=0; j<ny; j++) {
+        const unsigned int jn = (j + 1) % H;
+        for(unsigned int i=0; i<nx; i++) {
+            const unsigned int in = (i + 1) % W;
+            const size_t p00 = (size_t)j * W + i;
+            const size_t p10 = (size_t)j * W + in;
+            const size_t p01 = (size_t)jn * W + i;
+            const size_t p11 = (size_t)jn * W + in;
+
+            const double f00 = u[p00] - this->tip_values[0];
+            const double f10 = u[p10] - this->tip_values[0];
+            const double f01 = u[p01] - this->tip_values[0];
+            const double f11 = u[p11] - this->tip_values[0];
+            const double g00 = v[p00] - this->tip_values[1];
+            const double g10 = v[p10] - this->tip_values[1];
+            const double g01 = v[p01] - this->tip_values[1];
+            const double g11 = v[p11] - this->tip_values[1];
+
+            // both isolines have to cross the square
+            const double fmin = std::min(std::min(f00, f10), std::min(f01, f11));
+            const double fmax = std::max(std::max(f00, f10), std::max(f01, f11));
+            const double gmin = std::min(std::min(g00, g10), std::min(g01, g11));
+            const double gmax = std::max(std::max(g00, g10), std::max(g01, g11));
+            if(fmin > 0.0 || fmax < 0.0 || gmin > 0.0 || gmax < 0.0) {
+                continue;
+            }
+
+            // bilinear interpolants f = a0 + a1 x + a2 y + a3 xy and g = b0 + b1 x + b2 y + b3 xy
+            const double a0 = f00, a1 = f10 - f00, a2 = f01 - f00, a3 = f11 - f10 - f01 + f00;
+            const double b0 = g00, b1 = g10 - g00, b2 = g01 - g00, b3 = g11 - g10 - g01 + g00;
+
+            // eliminating y from f = 0 yields a quadratic equation for x
+            const double A = b1 * a3 - b3 * a1;
+            const double B = b0 * a3 + b1 * a2 - b2 * a1 - b3 * a0;
+            const double C = b0 * a2 - b2 * a0;
+
+            double roots[2];
+            unsigned int nroots = 0;
+            if(std::fabs(A) <= 1e-12 * (std::fabs(B) + std::fabs(C))) {
+                if(B != 0.0) {
+                    roots[nroots++] = -C / B;
+                }
+            } else {
+                const double D = B * B - 4.0 * A * C;
+                if(D >= 0.0) {
+                    // avoid cancellation between B and the square root
+                    const double q = -0.5 * (B + std::copysign(std::sqrt(D), B));
+                    roots[nroots++] = q / A;
+                    if(q != 0.0) {
+                        roots[nroots++] = C / q;
+                    }
+                }
+            }
+
+            // half-open squares prevent a tip on an edge from being counted twice
+            for(unsigned int r=0; r<nroots; r++) {
+                const double x = roots[r];
+                if(!(x >= 0.0 && x < 1.0)) {
+                    continue;
+                }
+                const double fd = a2 + a3 * x;
+                const double gd = b2 + b3 * x;
+                const double y = std::fabs(fd) >= std::fabs(gd) ? -(a0 + a1 * x) / fd : -(b0 + b1 * x) / gd;
+                if(!(y >= 0.0 && y < 1.0)) {
+                    continue;
+                }
+                Tip tip;
+                tip.x = std::fmod(i + x, (double)W) * this->dx;
+                tip.y = std::fmod(j + y, (double)H) * this->dx;
+                rows[j].push_back(tip);
+            }
+        }
+    }
+
+    std::vector<Tip> result;
+    for(const auto& row : rows) {
+        result.insert(result.end(), row.begin(), row.end());
+    }
+
+    return result;
+}
+
+/**
+ * @brief      Write the feature tables to the file
+ */
+void FeatureExtractor::write() const {
+    OutputMetadata tables;
+    tables.set("width", this->width);
+    tables.set("height", this->height);
+    tables.set("dx", this->dx);
+    tables.set("every", this->every);
+    tables.set("frame", std::vector<double>(this->frames.begin(), this->frames.end()));
+    tables.set("t", this->times);
+
+    if(this->spots) {
+        tables.set("spot_field", this->names[this->spot_field]);
+        tables.set("spot_threshold", this->threshold);
+        tables.set("spot_below", this->below);
+        tables.set("spot_minsize", this->minsize);
+
+        std::vector<double> count, mean_area;
+        std::ostringstream table;
+        table << "[";
+        for(size_t f=0; f<this->frame_spots.size(); f++) {
+            const std::vector<Spot>& list = this->frame_spots[f];
+            double area = 0.0;
+            table << (f == 0 ? "" : ", ") << "[";
+            for(size_t k=0; k<list.size(); k++) {
+                table << (k == 0 ? "" : ", ") << "[" << OutputMetadata::encode(list[k].x) << ", "
+                      << OutputMetadata::encode(list[k].y) << ", " << OutputMetadata::encode(list[k].area) << "]";
+                area += list[k].area;
+            }
+            table << "]";
+            count.push_back(list.size());
+            mean_area.push_back(list.empty() ? 0.0 : area / list.size());
+        }
+        table << "]";
+
+        tables.set("spot_count", count);
+        tables.set("spot_mean_area", mean_area);
+        tables.set("spot_columns", std::vector<std::string>{"x", "y", "area"});
+        tables.set_raw("spots", table.str());
+    }
+
+    if(this->tips) {
+        tables.set("tip_fields", std::vector<std::string>{this->names[this->tip_fields[0]],
+                                                          this->names[this->tip_fields[1]]});
+        tables.set("tip_values", std::vector<double>{this->tip_values[0], this->tip_values[1]});
+
+        std::vector<double> count;
+        std::ostringstream table;
+        table << "[";
+        for(size_t f=0; f<this->frame_tips.size(); f++) {
+            const std::vector<Tip>& list = this->frame_tips[f];
+            table << (f == 0 ? "" : ", ") << "[";
+            for(size_t k=0; k<list.size(); k++) {
+                table << (k == 0 ? "" : ", ") << "[" << OutputMetadata::encode(list[k].x) << ", "
+                      << OutputMetadata::encode(list[k].y) << "]";
+            }
+            table << "]";
+            count.push_back(list.size());
+        }
+        table << "]";
+
+        tables.set("tip_count", count);
+        tables.set("tip_columns", std::vector<std::string>{"x", "y"});
+        tables.set_raw("tips", table.str());
+    }
+
+    tables.write(this->filename);
+}
+
+/**
+ * @brief      Get a description of the features
+ */
+std::string FeatureExtractor::get_description() const {
+    std::ostringstream ss;
+    if(this->spots) {
+        ss << "spots where " << this->names[this->spot_field] << (this->below ? " < " : " > ") << this->threshold;
+        if(this->minsize > 1) {
+            ss << " of at least " << this->minsize << " grid points";
+        }
+    }
+    if(this->tips) {
+        ss << (this->spots ? " and " : "") << "spiral tips at " << this->names[this->tip_fields[0]] << " = "
+           << this->tip_values[0] << ", " << this->names[this->tip_fields[1]] << " = " << this->tip_values[1];
+    }
+    if(this->every > 1) {
+        ss << " every " << this->every << " frames";
+    }
+    ss << " to " << this->filename;
+    return ss.str();
+}
+
+/**
+ * @brief      Find the root of a grid point, compressing the path
+ *
+ * @param[in]  i     grid point
+ */
+unsigned int FeatureExtractor::find(unsigned int i) {
+    while(this->parent[i] != i) {
+        this->parent[i] = this->parent[this->parent[i]];
+        i = this->parent[i];
+    }
+    return i;
+}
+
+/**
+ * @brief      Merge the components of two grid points
+ *
+ * The root with the larger index is attached to the other, such that
+ * every root is the first grid point of its component.
+ *
+ * @param[in]  i     first grid point
+ * @param[in]  j     second grid point
+ */
+void FeatureExtractor::unite(unsigned int i, unsigned int j) {
+    const unsigned int ri = this->find(i);
+    const unsigned int rj = this->find(j);
+    if(ri < rj) {
+        this->parent[rj] = ri;
+    } else if(rj < ri) {
+        this->parent[ri] = rj;
+    }
+}
@@ -0,0 +1,180 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Extracts spots and spiral tips from the fields while integrating
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     spots=A>0.5      label the regions where A exceeds (or with <, lies below) 0.5
+ *     minsize=n        discard spots of fewer than n grid points (default: 1)
+ *     tips=A:0.5,B:0.3 locate the intersections of the isolines A = 0.5 and B = 0.3
+ *     every=n          extract the features of every n-th frame (default: 1)
+ *
+ * Spots are the connected components (4-connectivity) of the thresholded
+ * field. They are labelled with a union-find structure: tiles are labelled
+ * in parallel, after which the components are merged across the tile edges
+ * (and across the periodic boundaries). Per spot, the area and the centroid
+ * are reported, where the centroid of a spot wrapping around a periodic
+ * boundary is the circular mean of its grid points.
+ *
+ * Spiral tips are located as in Barkley's method: within every square of
+ * four grid points, both fields are interpolated bilinearly and the
+ * intersections of the two isolines are found by solving the resulting
+ * quadratic equation.
+ */
+class FeatureExtractor {
+public:
+    /**
+     * @brief      Connected region of the thresholded field
+     */
+    struct Spot {
+        double area;    //!< area (number of grid points times dx^2)
+        double x;       //!< centroid along the width
+        double y;       //!< centroid along the height
+    };
+
+    /**
+     * @brief      Intersection of the two isolines
+     */
+    struct Tip {
+        double x;       //!< position along the width
+        double y;       //!< position along the height
+    };
+
+    static const unsigned int TILE = 64;    //!< edge length of the tiles that are labelled in parallel
+
+private:
+    unsigned int width;                     //!< width of the system
+    unsigned int height;                    //!< height of the system
+    double dx;                              //!< grid spacing
+    bool pbc;                               //!< whether the boundaries are periodic
+    std::string filename;                   //!< output file
+    std::vector<std::string> names;         //!< names of all species
+
+    bool spots = false;                     //!< whether to label spots
+    unsigned int spot_field = 0;            //!< species that is thresholded
+    double threshold = 0.0;                 //!< threshold of the spots
+    bool below = false;                     //!< whether spots lie below rather than above the threshold
+    unsigned int minsize = 1;               //!< minimum number of grid points of a spot
+
+    bool tips = false;                      //!< whether to locate spiral tips
+    unsigned int tip_fields[2] = {0, 1};    //!< species whose isolines intersect at a tip
+    double tip_values[2] = {0.0, 0.0};      //!< values of the isolines
+
+    unsigned int every = 1;                 //!< number of frames between extractions
+
+    std::vector<unsigned int> parent;       //!< union-find forest over the grid points
+
+    std::vector<unsigned int> frames;                   //!< frames at which features were extracted
+    std::vector<double> times;                          //!< time per frame
+    std::vector<std::vector<Spot>> frame_spots;         //!< spots per frame
+    std::vector<std::vector<Tip>> frame_tips;           //!< tips per frame
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec           specification of the features
+     * @param[in]  species_names  names of all species
+     * @param[in]  _width         width of the system
+     * @param[in]  _height        height of the system
+     * @param[in]  _dx            grid spacing
+     * @param[in]  _pbc           whether the boundaries are periodic
+     * @param[in]  _filename      file to write the feature tables to
+     */
+    FeatureExtractor(const std::string& spec, const std::vector<std::string>& species_names,
+                     unsigned int _width, unsigned int _height, double _dx, bool _pbc,
+                     const std::string& _filename);
+
+    /**
+     * @brief      Extract the features of a frame if it is due
+     *
+     * @param[in]  frame  frame number
+     * @param[in]  t      time
+     * @param[in]  c      concentrations of all species (column-major, width x height)
+     */
+    void extract(unsigned int frame, double t, const std::vector<const double*>& c);
+
+    /**
+     * @brief      Label the spots of a field
+     *
+     * @param[in]  c     concentration (column-major, width x height)
+     *
+     * @return     spots ordered by their first grid point
+     */
+    std::vector<Spot> find_spots(const double* c);
+
+    /**
+     * @brief      Locate the spiral tips
+     *
+     * @param[in]  u     first field (column-major, width x height)
+     * @param[in]  v     second field (column-major, width x height)
+     *
+     * @return     tips ordered by row
+     */
+    std::vector<Tip> find_tips(const double* u, const double* v) const;
+
+    /**
+     * @brief      Write the feature tables to the file
+     */
+    void write() const;
+
+    /**
+     * @brief      Get a description of the features
+     */
+    std::string get_description() const;
+
+    /**
+     * @brief      Get the number of frames of which the features were extracted
+     */
+    inline unsigned int get_nr_frames() const {
+        return this->frames.size();
+    }
+
+    /**
+     * @brief      Get the file the feature tables are written to
+     */
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+
+private:
+    /**
+     * @brief      Find the root of a grid point, compressing the path
+     *
+     * @param[in]  i     grid point
+     */
+    unsigned int find(unsigned int i);
+
+    /**
+     * @brief      Merge the components of two grid points
+     *
+     * @param[in]  i     first grid point
+     * @param[in]  j     second grid point
+     */
+    void unite(unsigned int i, unsigned int j);
+};
@@ -0,0 +1,141 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _n    length of the transform
+ */
+FFT::FFT(unsigned int _n) : n(_n) {
+    if(this->n == 0) {
+        throw std::runtime_error("Invalid length of the Fourier transform");
+    }
+
+    // Bluestein's algorithm requires a convolution of length 2n - 1
+    const bool power_of_two = (this->n & (this->n - 1)) == 0;
+    this->m = 1;
+    while(this->m < (power_of_two ? this->n : 2 * this->n - 1)) {
+        this->m *= 2;
+    }
+
+    this->twiddles.resize(this->m / 2);
+    for(unsigned int k=0; k<this->m/2; k++) {
+        this->twiddles[k] = std::polar(1.0, -2.0 * pi * k / this->m);
+    }
+
+    unsigned int bits = 0;
+    while((1u << bits) < this->m) {
+        bits++;
+    }
+    this->bitrev.resize(this->m);
+    for(unsigned int k=0; k<this->m; k++) {
+        unsigned int r = 0;
+        for(unsigned int b=0; b<bits; b++) {
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        }
+        this->bitrev[k] = r;
+    }
+
+    if(power_of_two) {
+        return;
+    }
+
+    // k^2 is reduced modulo 2n to retain the accuracy of the phase
+    this->chirp.resize(this->n);
+    for(unsigned int k=0; k<this->n; k++) {
+        const unsigned long long k2 = ((unsigned long long)k * k) % (2ull * this->n);
+        this->chirp[k] = std::polar(1.0, -pi * (double)k2 / this->n);
+    }
+
+    this->kernel.assign(this->m, 0.0);
+    this->kernel[0] = std::conj(this->chirp[0]);
+    for(unsigned int k=1; k<this->n; k++) {
+        this->kernel[k] = std::conj(this->chirp[k]);
+        this->kernel[this->m - k] = std::conj(this->chirp[k]);
+    }
+    this->radix2(this->kernel.data(), false);
+}
+
+/**
+ * @brief      Forward transform (without normalization) in place
+ *
+ * @param      data  values (length n)
+ * @param      work  work space (length get_work_size())
+ */
+void FFT::forward(std::complex<double>* data, std::complex<double>* work) const {
+    if(this->m == this->n) {
+        this->radix2(data, false);
+        return;
+    }
+
+    for(unsigned int k=0; k<this->n; k++) {
+        work[k] = data[k] * this->chirp[k];
+    }
+    std::fill(work + this->n, work + this->m, 0.0);
+
+    // convolution with the kernel
+    this->radix2(work, false);
+    for(unsigned int k=0; k<this->m; k++) {
+        work[k] *= this->kernel[k];
+    }
+    this->radix2(work, true);
+
+    const double norm = 1.0 / this->m;
+    for(unsigned int k=0; k<this->n; k++) {
+        data[k] = work[k] * this->chirp[k] * norm;
+    }
+}
+
+/**
+ * @brief      Radix-2 transform of length m in place
+ *
+ * @param      data     values (length m)
+ * @param[in]  inverse  whether to perform the inverse transform (without normalization)
+ */
+void FFT::radix2(std::complex<double>* data, bool inverse) const {
+    for(unsigned int k=0; k<this->m; k++) {
+        if(k < this->bitrev[k]) {
+            std::swap(data[k], data[this->bitrev[k]]);
+        }
+    }
+
+    for(unsigned int len=2; len<=this->m; len*=2) {
+        const unsigned int half = len / 2;
+        const unsigned int step = this->m / len;
+        for(unsigned int start=0; start<this->m; start+=len) {
+            for(unsigned int k=0; k<half; k++) {
+                const std::complex<double> w = inverse ? std::conj(this->twiddles[k * step]) : this->twiddles[k * step];
+                const std::complex<double> u = data[start + k];
+                const std::complex<double> v = data[start + k + half] * w;
+                data[start + k] = u + v;
+                data[start + k + half] = u - v;
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <complex>
+#include <vector>
+
+/**
+ * @brief      Discrete Fourier transform of a fixed length
+ *
+ * Lengths that are a power of two are transformed by an iterative radix-2
+ * algorithm. Other lengths are handled by Bluestein's algorithm, which
+ * expresses the transform as a convolution that is evaluated by radix-2
+ * transforms of at least twice the length. The twiddle factors are computed
+ * once, such that a single object can be used by many threads at the same
+ * time, each providing its own work space.
+ */
+class FFT {
+private:
+    unsigned int n;         //!< length of the transform
+    unsigned int m;         //!< length of the radix-2 transforms
+
+    std::vector<std::complex<double>> twiddles;     //!< exp(-2 pi i k / m) for k < m/2
+    std::vector<unsigned int> bitrev;               //!< bit-reversal permutation of length m
+
+    std::vector<std::complex<double>> chirp;        //!< exp(-i pi k^2 / n) (Bluestein only)
+    std::vector<std::complex<double>> kernel;       //!< transformed convolution kernel (Bluestein only)
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _n    length of the transform
+     */
+    FFT(unsigned int _n);
+
+    /**
+     * @brief      Forward transform (without normalization) in place
+     *
+     * @param      data  values (length n)
+     * @param      work  work space (length get_work_size())
+     */
+    void forward(std::complex<double>* data, std::complex<double>* work) const;
+
+    /**
+     * @brief      Get the length of the work space required by forward()
+     */
+    inline unsigned int get_work_size() const {
+        return this->m == this->n ? 0 : this->m;
+    }
+
+    /**
+     * @brief      Get the length of the transform
+     */
+    inline unsigned int get_size() const {
+        return this->n;
+    }
+
+private:
+    /**
+     * @brief      Radix-2 transform of length m in place
+     *
+     * @param      data     values (length m)
+     * @param[in]  inverse  whether to perform the inverse transform (without normalization)
+     */
+    void radix2(std::complex<double>* data, bool inverse) const;
+};
@@ -0,0 +1,441 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "field_analysis.h"
+#include "output_metadata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec           specification of the analysis
+ * @param[in]  species_names  names of all species
+ * @param[in]  _width         width of the system
+ * @param[in]  _height        height of the system
+ * @param[in]  _dx            grid spacing
+ * @param[in]  _filename      file to write the time series to
+ */
+FieldAnalysis::FieldAnalysis(const std::string& spec, const std::vector<std::string>& species_names,
+                             unsigned int _width, unsigned int _height, double _dx, const std::string& _filename) :
+    width(_width),
+    height(_height),
+    dx(_dx),
+    filename(_filename),
+    names(species_names),
+    fft_x(_width),
+    fft_y(_height) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid analysis specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "fields" && key != "bins" && key != "range" && key != "spectrum" && key != "every") {
+            throw std::runtime_error("Invalid analysis specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    auto split_list = [](const std::string& list) {
+        std::vector<std::string> items;
+        boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+        for(std::string& item : items) {
+            boost::trim(item);
+        }
+        return items;
+    };
+
+    // species are given by name or by index
+    auto find_species = [&](const std::string& name) {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            if(this->names[s] == name) {
+                return s;
+            }
+        }
+        if(!name.empty() && name.find_first_not_of("0123456789") == std::string::npos &&
+           std::stoul(name) < this->names.size()) {
+            return (unsigned int)std::stoul(name);
+        }
+        throw std::runtime_error("Invalid analysis specification: unknown species " + name);
+    };
+
+    if(params.count("fields") > 0) {
+        for(const std::string& name : split_list(params["fields"])) {
+            this->fields.push_back(find_species(name));
+        }
+    } else {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            this->fields.push_back(s);
+        }
+    }
+
+    if(params.count("bins") > 0) {
+        this->bins = boost::lexical_cast<unsigned int>(params["bins"]);
+    }
+    if(params.count("spectrum") > 0) {
+        this->spectrum = boost::lexical_cast<bool>(params["spectrum"]);
+    }
+    if(params.count("every") > 0) {
+        this->every = boost::lexical_cast<unsigned int>(params["every"]);
+        if(this->every == 0) {
+            throw std::runtime_error("Invalid analysis specification: every has to be positive");
+        }
+    }
+
+    // the last range given applies to the remaining species
+    std::vector<std::string> ranges;
+    if(params.count("range") > 0) {
+        ranges = split_list(params["range"]);
+    }
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        const std::string range = ranges.empty() ? "auto" : ranges[std::min<size_t>(f, ranges.size() - 1)];
+        this->autorange.push_back(range == "auto");
+        this->range_lo.push_back(0.0);
+        this->range_hi.push_back(0.0);
+        if(range != "auto") {
+            const size_t colon = range.find(':');
+            if(colon == std::string::npos) {
+                throw std::runtime_error("Invalid analysis range: " + range + " (use lo:hi or auto)");
+            }
+            this->range_lo[f] = boost::lexical_cast<double>(range.substr(0, colon));
+            this->range_hi[f] = boost::lexical_cast<double>(range.substr(colon + 1));
+            if(!(this->range_hi[f] > this->range_lo[f])) {
+                throw std::runtime_error("Invalid analysis range: " + range);
+            }
+        }
+    }
+
+    // shells of the spectrum up to the Nyquist wavenumber
+    const unsigned int L = std::max(this->width, this->height);
+    this->dk = 2.0 * pi / (L * this->dx);
+    this->nshells = L / 2 + 1;
+    this->shell_count.assign(this->nshells, 0);
+    if(!this->spectrum) {
+        return;
+    }
+
+    this->shell.resize((size_t)this->width * this->height);
+    for(unsigned int q=0; q<this->height; q++) {
+        const double ky = (double)(q <= this->height / 2 ? (int)q : (int)q - (int)this->height) / this->height;
+        for(unsigned int p=0; p<this->width; p++) {
+            const double kx = (double)(p <= this->width / 2 ? (int)p : (int)p - (int)this->width) / this->width;
+            const unsigned int s = (unsigned int)std::lround(std::sqrt(kx * kx + ky * ky) * L);
+            this->shell[(size_t)q * this->width + p] = std::min(s, this->nshells);
+            if(s < this->nshells) {
+                this->shell_count[s]++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Analyze a frame if it is due
+ *
+ * @param[in]  frame  frame number
+ * @param[in]  t      time
+ * @param[in]  c      concentrations of all species (column-major, width x height)
+ */
+void FieldAnalysis::analyze(unsigned int frame, double t, const std::vector<const double*>& c) {
+    if(frame % this->every != 0) {
+        return;
+    }
+
+    std::vector<Sample> frame_samples(this->fields.size());
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        this->compute_statistics(c[this->fields[f]], f, frame_samples[f]);
+        if(this->spectrum) {
+            this->compute_spectrum(c[this->fields[f]], frame_samples[f]);
+        }
+    }
+
+    this->frames.push_back(frame);
+    this->times.push_back(t);
+    this->samples.push_back(std::move(frame_samples));
+}
+
+/**
+ * @brief      Write the time series to the file
+ */
+void FieldAnalysis::write() const {
+    auto array = [](const std::vector<double>& values) {
+        std::ostringstream ss;
+        ss << "[";
+        for(size_t i=0; i<values.size(); i++) {
+            ss << (i == 0 ? "" : ", ") << OutputMetadata::encode(values[i]);
+        }
+        ss << "]";
+        return ss.str();
+    };
+
+    OutputMetadata series;
+    series.set("width", this->width);
+    series.set("height", this->height);
+    series.set("dx", this->dx);
+    series.set("every", this->every);
+    series.set("bins", this->bins);
+
+    std::vector<std::string> selected;
+    for(unsigned int s : this->fields) {
+        selected.push_back(this->names[s]);
+    }
+    series.set("fields", selected);
+
+    if(this->spectrum) {
+        series.set("k", this->get_wavenumbers());
+    }
+
+    series.set("frame", std::vector<double>(this->frames.begin(), this->frames.end()));
+    series.set("t", this->times);
+
+    // one object per species holding a time series per quantity
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        std::vector<double> mean, variance, min, max, k_peak, wavelength;
+        std::ostringstream ranges, histograms, spectra;
+        for(size_t i=0; i<this->samples.size(); i++) {
+            const Sample& sample = this->samples[i][f];
+            mean.push_back(sample.mean);
+            variance.push_back(sample.variance);
+            min.push_back(sample.min);
+            max.push_back(sample.max);
+            k_peak.push_back(sample.k_peak);
+            wavelength.push_back(2.0 * pi / sample.k_peak);
+            ranges << (i == 0 ? "" : ", ") << array({sample.lo, sample.hi});
+            histograms << (i == 0 ? "" : ", ") << array(sample.histogram);
+            spectra << (i == 0 ? "" : ", ") << array(sample.spectrum);
+        }
+
+        std::ostringstream obj;
+        obj << "{\"mean\": " << array(mean) << ", \"variance\": " << array(variance)
+            << ", \"min\": " << array(min) << ", \"max\": " << array(max);
+        if(this->bins > 0) {
+            obj << ", \"histogram_range\": [" << ranges.str() << "], \"histogram\": [" << histograms.str() << "]";
+        }
+        if(this->spectrum) {
+            obj << ", \"spectrum\": [" << spectra.str() << "], \"k_peak\": " << array(k_peak)
+                << ", \"wavelength\": " << array(wavelength);
+        }
+        obj << "}";
+        series.set_raw(this->names[this->fields[f]], obj.str());
+    }
+
+    series.write(this->filename);
+}
+
+/**
+ * @brief      Get the wavenumber at the center of every shell of the spectrum
+ */
+std::vector<double> FieldAnalysis::get_wavenumbers() const {
+    std::vector<double> k(this->nshells);
+    for(unsigned int s=0; s<this->nshells; s++) {
+        k[s] = s * this->dk;
+    }
+    return k;
+}
+
+/**
+ * @brief      Get a description of the analysis
+ */
+std::string FieldAnalysis::get_description() const {
+    std::ostringstream ss;
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        ss << (f == 0 ? "" : ", ") << this->names[this->fields[f]];
+    }
+    ss << " (moments";
+    if(this->bins > 0) {
+        ss << ", histograms of " << this->bins << " bins";
+    }
+    if(this->spectrum) {
+        ss << ", power spectra of " << this->nshells << " shells";
+    }
+    ss << ")";
+    if(this->every > 1) {
+        ss << " every " << this->every << " frames";
+    }
+    ss << " to " << this->filename;
+    return ss.str();
+}
+
+/**
+ * @brief      Mean, variance, extrema and histogram of a single field
+ *
+ * @param[in]  c       concentration (column-major, width x height)
+ * @param[in]  f       index of the species in the selection
+ * @param      sample  The sample
+ */
+void FieldAnalysis::compute_statistics(const double* c, unsigned int f, Sample& sample) const {
+    const long long n = (long long)this->width * this->height;
+
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    #pragma omp parallel for schedule(static) reduction(+:sum) reduction(min:min) reduction(max:max)
+    for(long long i=0; i<n; i++) {
+        sum += c[i];
+        min = std::min(min, c[i]);
+        max = std::max(max, c[i]);
+    }
+    sample.mean = sum / n;
+    sample.min = min;
+    sample.max = max;
+
+    // the variance is evaluated around the mean to avoid cancellation
+    const double mean = sample.mean;
+    double sumsq = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:sumsq)
+    for(long long i=0; i<n; i++) {
+        sumsq += (c[i] - mean) * (c[i] - mean);
+    }
+    sample.variance = sumsq / n;
+
+    if(this->bins == 0) {
+        return;
+    }
+
+    sample.lo = this->autorange[f] ? min : this->range_lo[f];
+    sample.hi = this->autorange[f] ? max : this->range_hi[f];
+    const double scale = sample.hi > sample.lo ? this->bins / (sample.hi - sample.lo) : 0.0;
+
+    // values outside of the range are counted in the outer bins
+    std::vector<long long> counts(this->bins, 0);
+    #pragma omp parallel
+    {
+        std::vector<long long> local(this->bins, 0);
+        #pragma omp for schedule(static)
+        for(long long i=0; i<n; i++) {
+            const double x = (c[i] - sample.lo) * scale;
+            const int b = x < 0.0 ? 0 : std::min((int)x, (int)this->bins - 1);
+            local[b]++;
+        }
+        #pragma omp critical
+        for(unsigned int b=0; b<this->bins; b++) {
+            counts[b] += local[b];
+        }
+    }
+
+    sample.histogram.resize(this->bins);
+    for(unsigned int b=0; b<this->bins; b++) {
+        sample.histogram[b] = (double)counts[b] / n;
+    }
+}
+
+/**
+ * @brief      Radially averaged power spectrum and dominant wavenumber of a single field
+ *
+ * The spectrum is the structure factor S(k) = <|F(k)|^2> / N, averaged over
+ * the wave vectors in a shell, with F the discrete Fourier transform of the
+ * fluctuations around the mean and N the number of grid points.
+ *
+ * @param[in]  c       concentration (column-major, width x height)
+ * @param      sample  The sample (holding the mean)
+ */
+void FieldAnalysis::compute_spectrum(const double* c, Sample& sample) const {
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+    const size_t n = (size_t)W * H;
+    std::vector<std::complex<double>> data(n);
+
+    // transform along the width, for which the values are contiguous
+    #pragma omp parallel
+    {
+        std::vector<std::complex<double>> work(this->fft_x.get_work_size());
+        #pragma omp for schedule(static)
+        for(unsigned int q=0; q<H; q++) {
+            std::complex<double>* row = &data[(size_t)q * W];
+            for(unsigned int p=0; p<W; p++) {
+                row[p] = c[(size_t)q * W + p] - sample.mean;
+            }
+            this->fft_x.forward(row, work.data());
+        }
+    }
+
+    // transform along the height and accumulate the power per shell
+    std::vector<double> power(this->nshells, 0.0);
+    #pragma omp parallel
+    {
+        std::vector<std::complex<double>> column(H);
+        std::vector<std::complex<double>> work(this->fft_y.get_work_size());
+        std::vector<double> local(this->nshells + 1, 0.0);
+        #pragma omp for schedule(static)
+        for(unsigned int p=0; p<W; p++) {
+            for(unsigned int q=0; q<H; q++) {
+                column[q] = data[(size_t)q * W + p];
+            }
+            this->fft_y.forward(column.data(), work.data());
+            for(unsigned int q=0; q<H; q++) {
+                local[this->shell[(size_t)q * W + p]] += std::norm(column[q]);
+            }
+        }
+        #pragma omp critical
+        for(unsigned int s=0; s<this->nshells; s++) {
+            power[s] += local[s];
+        }
+    }
+
+    sample.spectrum.resize(this->nshells);
+    for(unsigned int s=0; s<this->nshells; s++) {
+        sample.spectrum[s] = this->shell_count[s] > 0 ? power[s] / (this->shell_count[s] * (double)n) : 0.0;
+    }
+
+    // maximum excluding k = 0, refined by a parabola through the neighbouring shells
+    unsigned int peak = 0;
+    for(unsigned int s=1; s<this->nshells; s++) {
+        if(sample.spectrum[s] > (peak == 0 ? 0.0 : sample.spectrum[peak])) {
+            peak = s;
+        }
+    }
+    if(peak == 0) {
+        sample.k_peak = 0.0;
+        return;
+    }
+
+    double offset = 0.0;
+    if(peak > 1 && peak + 1 < this->nshells) {
+        const double ym = sample.spectrum[peak - 1];
+        const double y0 = sample.spectrum[peak];
+        const double yp = sample.spectrum[peak + 1];
+        const double denom = ym - 2.0 * y0 + yp;
+        if(denom < 0.0) {
+            offset = std::max(-0.5, std::min(0.5, 0.5 * (ym - yp) / denom));
+        }
+    }
+    sample.k_peak = (peak + offset) * this->dk;
+}
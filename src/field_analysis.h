@@ -0,0 +1,171 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fft.h"
+
+/**
+ * @brief      Computes statistics and power spectra of the fields while integrating
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     fields=A,B       species that are analyzed by name or index (default: all)
+ *     bins=n           number of bins of the histograms (default: 32, 0 = none)
+ *     range=lo:hi      range of the histograms per species (default: auto)
+ *     spectrum=0       do not compute the power spectra (default: 1)
+ *     every=n          analyze every n-th frame (default: 1)
+ *
+ * For every analyzed frame, the mean, variance, minimum and maximum of the
+ * species are computed, together with a histogram and the radially averaged
+ * power spectrum (structure factor) of the fluctuations around the mean. The
+ * spectrum is binned in shells of width 2 pi / (L dx), with L the larger
+ * dimension of the system, up to the Nyquist wavenumber pi / dx. The
+ * dominant wavenumber is the location of the maximum of the spectrum
+ * (excluding k = 0), refined by a parabola through the neighbouring shells.
+ * The results are kept in memory and written as a JSON time series.
+ */
+class FieldAnalysis {
+public:
+    /**
+     * @brief      Analysis of a single species at a single frame
+     */
+    struct Sample {
+        double mean = 0.0;          //!< mean concentration
+        double variance = 0.0;      //!< variance of the concentration
+        double min = 0.0;           //!< minimum concentration
+        double max = 0.0;           //!< maximum concentration
+        double lo = 0.0;            //!< lower bound of the histogram
+        double hi = 0.0;            //!< upper bound of the histogram
+        std::vector<double> histogram;  //!< fraction of grid points per bin
+        std::vector<double> spectrum;   //!< radially averaged power spectrum per shell
+        double k_peak = 0.0;        //!< dominant wavenumber
+    };
+
+private:
+    unsigned int width;                     //!< width of the system
+    unsigned int height;                    //!< height of the system
+    double dx;                              //!< grid spacing
+    std::string filename;                   //!< output file
+    std::vector<std::string> names;         //!< names of all species
+
+    std::vector<unsigned int> fields;       //!< analyzed species
+    unsigned int bins = 32;                 //!< number of bins of the histograms
+    std::vector<bool> autorange;            //!< whether the histogram range follows the frame per species
+    std::vector<double> range_lo;           //!< lower bound of the histogram per species
+    std::vector<double> range_hi;           //!< upper bound of the histogram per species
+    bool spectrum = true;                   //!< whether to compute the power spectra
+    unsigned int every = 1;                 //!< number of frames between analyses
+
+    FFT fft_x;                              //!< transform along the width
+    FFT fft_y;                              //!< transform along the height
+    double dk;                              //!< width of a shell of the spectrum
+    unsigned int nshells;                   //!< number of shells of the spectrum
+    std::vector<unsigned int> shell;        //!< shell per wave vector (nshells = outside the Nyquist circle)
+    std::vector<unsigned int> shell_count;  //!< number of wave vectors per shell
+
+    std::vector<unsigned int> frames;               //!< analyzed frames
+    std::vector<double> times;                      //!< time per analyzed frame
+    std::vector<std::vector<Sample>> samples;       //!< analysis per analyzed frame and species
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec           specification of the analysis
+     * @param[in]  species_names  names of all species
+     * @param[in]  _width         width of the system
+     * @param[in]  _height        height of the system
+     * @param[in]  _dx            grid spacing
+     * @param[in]  _filename      file to write the time series to
+     */
+    FieldAnalysis(const std::string& spec, const std::vector<std::string>& species_names,
+                  unsigned int _width, unsigned int _height, double _dx, const std::string& _filename);
+
+    /**
+     * @brief      Analyze a frame if it is due
+     *
+     * @param[in]  frame  frame number
+     * @param[in]  t      time
+     * @param[in]  c      concentrations of all species (column-major, width x height)
+     */
+    void analyze(unsigned int frame, double t, const std::vector<const double*>& c);
+
+    /**
+     * @brief      Write the time series to the file
+     */
+    void write() const;
+
+    /**
+     * @brief      Get a description of the analysis
+     */
+    std::string get_description() const;
+
+    /**
+     * @brief      Get the number of analyzed frames
+     */
+    inline unsigned int get_nr_frames() const {
+        return this->frames.size();
+    }
+
+    /**
+     * @brief      Get the analysis of a species at an analyzed frame
+     *
+     * @param[in]  i     index of the analyzed frame
+     * @param[in]  f     index of the species in the selection
+     */
+    inline const Sample& get_sample(unsigned int i, unsigned int f) const {
+        return this->samples[i][f];
+    }
+
+    /**
+     * @brief      Get the wavenumber at the center of every shell of the spectrum
+     */
+    std::vector<double> get_wavenumbers() const;
+
+    /**
+     * @brief      Get the file the time series is written to
+     */
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+
+private:
+    /**
+     * @brief      Mean, variance, extrema and histogram of a single field
+     *
+     * @param[in]  c       concentration (column-major, width x height)
+     * @param[in]  f       index of the species in the selection
+     * @param      sample  The sample
+     */
+    void compute_statistics(const double* c, unsigned int f, Sample& sample) const;
+
+    /**
+     * @brief      Radially averaged power spectrum and dominant wavenumber of a single field
+     *
+     * @param[in]  c       concentration (column-major, width x height)
+     * @param      sample  The sample (holding the mean)
+     */
+    void compute_spectrum(const double* c, Sample& sample) const;
+};
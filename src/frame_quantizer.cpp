@@ -0,0 +1,222 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "frame_quantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object
+ *
+ * @param[in]  spec  specification of the quantization
+ */
+FrameQuantizer::FrameQuantizer(const std::string& spec) :
+    description(spec) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid quantization: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "bits" && key != "range" && key != "error") {
+            throw std::runtime_error("Invalid quantization: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    if(params.count("bits") > 0) {
+        this->bits = boost::lexical_cast<unsigned int>(params["bits"]);
+        if(this->bits != 8 && this->bits != 16) {
+            throw std::runtime_error("Invalid quantization: codes have 8 or 16 bits");
+        }
+    }
+
+    if(params.count("error") > 0) {
+        this->error = boost::lexical_cast<double>(params["error"]);
+        if(!(this->error > 0.0)) {
+            throw std::runtime_error("Invalid quantization: the error has to be positive");
+        }
+    }
+
+    if(params.count("range") > 0 && params["range"] != "frame") {
+        std::vector<std::string> ends;
+        boost::split(ends, params["range"], boost::is_any_of(":"), boost::token_compress_on);
+        if(ends.size() != 2) {
+            throw std::runtime_error("Invalid quantization: the range is either frame or min:max");
+        }
+        this->fixed = true;
+        this->lo = boost::lexical_cast<double>(boost::trim_copy(ends[0]));
+        this->hi = boost::lexical_cast<double>(boost::trim_copy(ends[1]));
+        if(!(this->hi > this->lo) || !std::isfinite(this->hi - this->lo)) {
+            throw std::runtime_error("Invalid quantization: empty range " + params["range"]);
+        }
+
+        const double step = (this->hi - this->lo) / ((1u << this->bits) - 1);
+        if(this->error > 0.0 && 0.5 * step > this->error) {
+            throw std::runtime_error("Invalid quantization: " + std::to_string(this->bits) + "-bit codes over " +
+                                     params["range"] + " cannot meet an error of " + params["error"]);
+        }
+    }
+}
+
+/**
+ * @brief      Determine the mapping of a field onto the codes
+ *
+ * @param[in]  field  values of the field
+ * @param[in]  n      number of values
+ *
+ * @return     offset, step and error bound of the field
+ */
+FrameQuantizer::Range FrameQuantizer::analyse(const double* field, size_t n) const {
+    const double levels = (1u << this->bits) - 1;
+
+    double fmin = this->lo;
+    double fmax = this->hi;
+    if(!this->fixed) {
+        // values that are not a number are skipped here and rejected by encode()
+        fmin = std::numeric_limits<double>::infinity();
+        fmax = -std::numeric_limits<double>::infinity();
+        #pragma omp parallel for simd reduction(min:fmin) reduction(max:fmax)
+        for(size_t k=0; k<n; k++) {
+            fmin = std::min(fmin, field[k]);
+            fmax = std::max(fmax, field[k]);
+        }
+        if(fmin > fmax) {
+            fmin = fmax = 0.0;
+        }
+    }
+
+    Range range;
+    range.offset = fmin;
+    range.step = (fmax - fmin) / levels;
+
+    // half a step, widened by the rounding of the reconstruction
+    const double rounding = 4.0 * std::numeric_limits<double>::epsilon() * std::max(std::fabs(fmin), std::fabs(fmax));
+    range.bound = this->error > 0.0 ? this->error : 0.5 * range.step + rounding;
+    range.quantize = std::isfinite(range.step) && 0.5 * range.step <= range.bound;
+    if(!range.quantize) {
+        range.offset = 0.0;
+        range.step = 0.0;
+    }
+
+    return range;
+}
+
+/**
+ * @brief      Quantize a set of values
+ *
+ * @param[in]  values  values to quantize
+ * @param[in]  n       number of values
+ * @param[in]  range   mapping of the field the values belong to
+ * @param      codes   output (n codes of get_code_size() bytes)
+ *
+ * @return     whether all values are within the error bound
+ */
+bool FrameQuantizer::encode(const double* values, size_t n, const Range& range, unsigned char* codes) const {
+    if(!range.quantize) {
+        return false;
+    }
+
+    if(this->bits == 8) {
+        return this->encode_codes(values, n, range, (uint8_t*) codes);
+    }
+
+    std::vector<uint16_t> buffer(n);
+    const bool success = this->encode_codes(values, n, range, buffer.data());
+    std::memcpy(codes, buffer.data(), n * sizeof(uint16_t));
+    return success;
+}
+
+/**
+ * @brief      Restore a set of quantized values
+ *
+ * @param[in]  codes   codes of the values
+ * @param[in]  n       number of values
+ * @param[in]  bits    size of a code in bits
+ * @param[in]  offset  value of code 0
+ * @param[in]  step    difference between consecutive codes
+ * @param      values  output
+ */
+void FrameQuantizer::decode(const unsigned char* codes, size_t n, unsigned int bits,
+                            double offset, double step, double* values) {
+    if(bits == 8) {
+        #pragma omp simd
+        for(size_t k=0; k<n; k++) {
+            values[k] = offset + codes[k] * step;
+        }
+        return;
+    }
+
+    std::vector<uint16_t> buffer(n);
+    std::memcpy(buffer.data(), codes, n * sizeof(uint16_t));
+    #pragma omp simd
+    for(size_t k=0; k<n; k++) {
+        values[k] = offset + buffer[k] * step;
+    }
+}
+
+/**
+ * @brief      Quantize a set of values to codes of a given type
+ *
+ * @param[in]  values  values to quantize
+ * @param[in]  n       number of values
+ * @param[in]  range   mapping of the field the values belong to
+ * @param      codes   output
+ *
+ * @return     whether all values are within the error bound
+ */
+template<typename T>
+bool FrameQuantizer::encode_codes(const double* values, size_t n, const Range& range, T* codes) const {
+    const double levels = (1u << this->bits) - 1;
+    const double inv = range.step > 0.0 ? 1.0 / range.step : 0.0;
+
+    // branch-free, such that the loop vectorizes; values outside of the
+    // range are clamped (fmax maps NaN onto 0) and caught by the error check
+    size_t rejected = 0;
+    #pragma omp simd reduction(+:rejected)
+    for(size_t k=0; k<n; k++) {
+        const double q = std::fmin(std::fmax((values[k] - range.offset) * inv, 0.0), levels);
+        const T code = (T)(q + 0.5);
+        codes[k] = code;
+        rejected += !(std::fabs(values[k] - (range.offset + code * range.step)) <= range.bound);
+    }
+
+    return rejected == 0;
+}
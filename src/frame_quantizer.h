@@ -0,0 +1,144 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief      Error-bounded quantization of the chunks of the output
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     bits=8          size of a code (8 or 16 bits, default: 8)
+ *     range=frame     map the minimum and maximum of every field of every
+ *                     frame onto the codes (default), or a fixed range,
+ *                     e.g. range=0:1
+ *     error=1e-3      maximum absolute error (default: half a step)
+ *
+ * A value v is stored as round((v - offset) / step), with the offset and the
+ * step of every field of every frame stored in the index of the chunked
+ * file. Chunks holding values that cannot be represented within the error
+ * (outside of a fixed range, not finite, or a per-frame range that is too
+ * wide for the error) are stored as doubles instead, such that the error
+ * is guaranteed.
+ */
+class FrameQuantizer {
+public:
+    /**
+     * @brief      Mapping of the values of a field onto the codes
+     */
+    struct Range {
+        double offset;      //!< value of code 0
+        double step;        //!< difference between consecutive codes
+        double bound;       //!< maximum absolute error of a value
+        bool quantize;      //!< whether the field can be quantized at all
+    };
+
+private:
+    unsigned int bits = 8;      //!< size of a code in bits
+    bool fixed = false;         //!< whether the range is fixed
+    double lo = 0.0;            //!< lower end of a fixed range
+    double hi = 0.0;            //!< upper end of a fixed range
+    double error = 0.0;         //!< requested maximum absolute error (0 = half a step)
+    std::string description;    //!< specification of the quantization
+
+public:
+    /**
+     * @brief      Constructs the object
+     *
+     * @param[in]  spec  specification of the quantization
+     */
+    FrameQuantizer(const std::string& spec);
+
+    /**
+     * @brief      Determine the mapping of a field onto the codes
+     *
+     * @param[in]  field  values of the field
+     * @param[in]  n      number of values
+     *
+     * @return     offset, step and error bound of the field
+     */
+    Range analyse(const double* field, size_t n) const;
+
+    /**
+     * @brief      Quantize a set of values
+     *
+     * @param[in]  values  values to quantize
+     * @param[in]  n       number of values
+     * @param[in]  range   mapping of the field the values belong to
+     * @param      codes   output (n codes of get_code_size() bytes)
+     *
+     * @return     whether all values are within the error bound
+     */
+    bool encode(const double* values, size_t n, const Range& range, unsigned char* codes) const;
+
+    /**
+     * @brief      Restore a set of quantized values
+     *
+     * @param[in]  codes   codes of the values
+     * @param[in]  n       number of values
+     * @param[in]  bits    size of a code in bits
+     * @param[in]  offset  value of code 0
+     * @param[in]  step    difference between consecutive codes
+     * @param      values  output
+     */
+    static void decode(const unsigned char* codes, size_t n, unsigned int bits,
+                       double offset, double step, double* values);
+
+    /**
+     * @brief      Get the size of a code in bits
+     */
+    inline unsigned int get_bits() const {
+        return this->bits;
+    }
+
+    /**
+     * @brief      Get the size of a code in bytes
+     */
+    inline unsigned int get_code_size() const {
+        return this->bits / 8;
+    }
+
+    /**
+     * @brief      Get the specification of the quantization
+     */
+    inline const std::string& get_description() const {
+        return this->description;
+    }
+
+private:
+    /**
+     * @brief      Quantize a set of values to codes of a given type
+     *
+     * @param[in]  values  values to quantize
+     * @param[in]  n       number of values
+     * @param[in]  range   mapping of the field the values belong to
+     * @param      codes   output
+     *
+     * @return     whether all values are within the error bound
+     */
+    template<typename T>
+    bool encode_codes(const double* values, size_t n, const Range& range, T* codes) const;
+};
@@ -0,0 +1,339 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "frame_reader.h"
+#include "frame_writer.h"
+#include "frame_quantizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+/**
+ * @brief      Opens the file and reads its header (and chunk index)
+ *
+ * @param[in]  filename  The filename
+ */
+FrameReader::FrameReader(const std::string& filename) :
+    in(filename, std::ios::in | std::ios::binary) {
+
+    if(!this->in.is_open()) {
+        throw std::runtime_error("Cannot open " + filename + " for reading");
+    }
+
+    char magic[8] = {};
+    this->in.read(magic, sizeof(magic));
+    if(this->in && std::memcmp(magic, FrameWriter::CHUNKED_MAGIC, sizeof(magic)) == 0) {
+        this->read_chunked_header();
+        return;
+    }
+
+    // contiguous layout: width, height and number of frames minus one
+    this->in.clear();
+    this->in.seekg(0, std::ios::end);
+    const uint64_t filesize = this->in.tellg();
+    this->in.seekg(0);
+
+    unsigned int header[3];
+    if(!this->in.read((char*) header, sizeof(header))) {
+        throw std::runtime_error(filename + " is not a Turing output file");
+    }
+    this->width = header[0];
+    this->height = header[1];
+    this->nframes = header[2] + 1;
+
+    // the number of fields follows from the size of the file, as every
+    // frame of a contiguous file holds the same fields (see FrameWriter)
+    const uint64_t framesize = (uint64_t)this->nframes * this->width * this->height * sizeof(double);
+    if(framesize == 0 || (filesize - sizeof(header)) % framesize != 0) {
+        throw std::runtime_error(filename + " does not match its header (frames holding different fields "
+                                 "require the chunked layout)");
+    }
+    this->frame_fields.assign(this->nframes, (filesize - sizeof(header)) / framesize);
+}
+
+/**
+ * @brief      Get the number of fields of every frame
+ *
+ * Throws when the frames hold different numbers of fields, which only
+ * chunked files written with different cadences per species do.
+ */
+unsigned int FrameReader::get_nr_fields() const {
+    if(this->frame_fields.empty()) {
+        return 0;
+    }
+    if(std::adjacent_find(this->frame_fields.begin(), this->frame_fields.end(),
+                          std::not_equal_to<uint32_t>()) != this->frame_fields.end()) {
+        throw std::runtime_error("The frames hold different numbers of fields; use get_nr_fields(frame)");
+    }
+    return this->frame_fields.front();
+}
+
+/**
+ * @brief      Get the number of fields of a single frame
+ *
+ * @param[in]  frame  index of the frame
+ */
+unsigned int FrameReader::get_nr_fields(unsigned int frame) const {
+    if(frame >= this->nframes) {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " out of range (" +
+                                 std::to_string(this->nframes) + " frames)");
+    }
+    return this->frame_fields[frame];
+}
+
+/**
+ * @brief      Read a rectangle of a single field of a single frame
+ *
+ * @param[in]  frame  index of the frame
+ * @param[in]  field  index of the field
+ * @param[in]  x0     first column
+ * @param[in]  y0     first row
+ * @param[in]  w      number of columns
+ * @param[in]  h      number of rows
+ * @param      out    output (column-major, w x h)
+ */
+void FrameReader::read(unsigned int frame, unsigned int field,
+                       unsigned int x0, unsigned int y0, unsigned int w, unsigned int h, double* out) {
+    if(frame >= this->nframes) {
+        throw std::runtime_error("Frame " + std::to_string(frame) + " out of range (" +
+                                 std::to_string(this->nframes) + " frames)");
+    }
+    if(x0 + w > this->width || y0 + h > this->height) {
+        throw std::runtime_error("Region exceeds the " + std::to_string(this->width) + "x" +
+                                 std::to_string(this->height) + " frame");
+    }
+
+    // frames written at different cadences per species hold different fields
+    if(field >= this->frame_fields[frame]) {
+        throw std::runtime_error("Field " + std::to_string(field) + " out of range (frame " + std::to_string(frame) +
+                                 " holds " + std::to_string(this->frame_fields[frame]) + " fields)");
+    }
+
+    if(!this->chunked) {
+
+        const uint64_t plane = (uint64_t)this->width * this->height;
+        const uint64_t base = 3 * sizeof(unsigned int) +
+                              ((uint64_t)frame * this->frame_fields[frame] + field) * plane * sizeof(double);
+
+        // the rows of a column are stored consecutively
+        for(unsigned int j=0; j<h; j++) {
+            this->in.seekg(base + ((uint64_t)(y0 + j) * this->width + x0) * sizeof(double));
+            this->in.read((char*) (out + (size_t)j * w), w * sizeof(double));
+            this->bytes_read += w * sizeof(double);
+        }
+        if(!this->in) {
+            throw std::runtime_error("Unexpected end of file");
+        }
+        return;
+    }
+
+    const unsigned int C = this->chunk_size;
+    const unsigned int tiles_i = (this->width + C - 1) / C;
+    const unsigned int tiles_j = (this->height + C - 1) / C;
+
+    if(w == 0 || h == 0) {
+        return;
+    }
+
+    const uint64_t first = this->frame_start[frame] + (uint64_t)field * tiles_i * tiles_j;
+    const uint64_t field_index = first / ((uint64_t)tiles_i * tiles_j);
+    for(unsigned int tj = y0 / C; tj <= (y0 + h - 1) / C; tj++) {
+        for(unsigned int ti = x0 / C; ti <= (x0 + w - 1) / C; ti++) {
+            const unsigned int i0 = ti * C;
+            const unsigned int j0 = tj * C;
+            const unsigned int tw = std::min(C, this->width - i0);
+            const unsigned int th = std::min(C, this->height - j0);
+            const std::vector<double> tile = this->read_chunk(first + tj * tiles_i + ti, (size_t)tw * th,
+                                                           field_index);
+
+            // copy the overlap between the tile and the region
+            const unsigned int ib = std::max(i0, x0);
+            const unsigned int ie = std::min(i0 + tw, x0 + w);
+            const unsigned int jb = std::max(j0, y0);
+            const unsigned int je = std::min(j0 + th, y0 + h);
+            for(unsigned int j=jb; j<je; j++) {
+                std::copy(&tile[(size_t)(j - j0) * tw + (ib - i0)],
+                          &tile[(size_t)(j - j0) * tw + (ie - i0)],
+                          out + (size_t)(j - y0) * w + (ib - x0));
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Read a rectangle of a single field over a range of frames
+ *
+ * @param[in]  field        index of the field
+ * @param[in]  frame_begin  first frame
+ * @param[in]  frame_end    one past the last frame
+ * @param[in]  x0           first column
+ * @param[in]  y0           first row
+ * @param[in]  w            number of columns
+ * @param[in]  h            number of rows
+ *
+ * @return     the rectangles of all frames, one after the other
+ */
+std::vector<double> FrameReader::read_region(unsigned int field, unsigned int frame_begin, unsigned int frame_end,
+                                             unsigned int x0, unsigned int y0, unsigned int w, unsigned int h) {
+    if(frame_end < frame_begin) {
+        throw std::runtime_error("Invalid frame range");
+    }
+
+    const size_t n = (size_t)w * h;
+    std::vector<double> region(n * (frame_end - frame_begin));
+    for(unsigned int f=frame_begin; f<frame_end; f++) {
+        this->read(f, field, x0, y0, w, h, &region[(f - frame_begin) * n]);
+    }
+
+    return region;
+}
+
+/**
+ * @brief      Read the header and chunk index of a chunked file
+ */
+void FrameReader::read_chunked_header() {
+    uint32_t header[6];
+    uint64_t index_offset = 0;
+    this->in.read((char*) header, sizeof(header));
+    this->in.read((char*) &index_offset, sizeof(uint64_t));
+    if(!this->in || (header[0] != FrameWriter::CHUNKED_VERSION && header[0] != FrameWriter::QUANTIZED_VERSION)) {
+        throw std::runtime_error("Unsupported version of the chunked layout");
+    }
+
+    this->chunked = true;
+    this->width = header[1];
+    this->height = header[2];
+    this->chunk_size = header[3];
+    this->compression = header[4];
+    this->nframes = header[5];
+
+    if(this->chunk_size == 0 || index_offset == 0) {
+        throw std::runtime_error("Incomplete chunked file (was the writer closed?)");
+    }
+#ifndef HAS_ZLIB
+    if(this->compression != 0) {
+        throw std::runtime_error("Turing was compiled without zlib; compressed chunks cannot be read");
+    }
+#endif
+
+    const uint64_t tiles = (uint64_t)((this->width + this->chunk_size - 1) / this->chunk_size) *
+                           ((this->height + this->chunk_size - 1) / this->chunk_size);
+
+    this->in.seekg(index_offset);
+    this->frame_fields.resize(this->nframes);
+    this->in.read((char*) this->frame_fields.data(), this->frame_fields.size() * sizeof(uint32_t));
+
+    uint64_t nchunks = 0;
+    for(unsigned int f=0; f<this->nframes; f++) {
+        this->frame_start.push_back(nchunks);
+        nchunks += this->frame_fields[f] * tiles;
+    }
+
+    // quantized files store the mapping onto the codes of every field
+    if(header[0] == FrameWriter::QUANTIZED_VERSION) {
+        uint32_t nbits = 0;
+        this->in.read((char*) &nbits, sizeof(uint32_t));
+        if(nbits != 8 && nbits != 16) {
+            throw std::runtime_error("Corrupt quantization in the chunk index");
+        }
+        this->bits = nbits;
+
+        const uint64_t nr_fields = nchunks / tiles;
+        std::vector<double> mapping(2 * nr_fields);
+        this->in.read((char*) mapping.data(), mapping.size() * sizeof(double));
+        for(uint64_t k=0; k<nr_fields; k++) {
+            this->field_offsets.push_back(mapping[2*k]);
+            this->field_steps.push_back(mapping[2*k+1]);
+        }
+    }
+
+    std::vector<uint64_t> index(2 * nchunks);
+    this->in.read((char*) index.data(), index.size() * sizeof(uint64_t));
+    if(!this->in) {
+        throw std::runtime_error("Corrupt chunk index");
+    }
+    for(uint64_t k=0; k<nchunks; k++) {
+        this->chunk_offsets.push_back(index[2*k]);
+        this->chunk_sizes.push_back(index[2*k+1]);
+    }
+}
+
+/**
+ * @brief      Read and decode a single chunk
+ *
+ * @param[in]  index  index of the chunk
+ * @param[in]  n      number of values in the chunk
+ * @param[in]  field  index of the field over all frames (for the quantization)
+ *
+ * @return     values of the chunk (column-major)
+ */
+std::vector<double> FrameReader::read_chunk(uint64_t index, size_t n, uint64_t field) {
+    std::vector<unsigned char> raw(this->chunk_sizes[index]);
+    this->in.seekg(this->chunk_offsets[index]);
+    this->in.read((char*) raw.data(), raw.size());
+    if(!this->in) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    this->bytes_read += raw.size();
+
+    // quantized chunks are recognized by their size, as chunks that could
+    // not be quantized hold doubles
+    std::vector<unsigned char> values;
+    if(this->compression == 0) {
+        values = std::move(raw);
+    } else {
+#ifdef HAS_ZLIB
+        std::vector<unsigned char> shuffled(n * sizeof(double));
+        uLongf size = shuffled.size();
+        if(uncompress(shuffled.data(), &size, raw.data(), raw.size()) != Z_OK) {
+            throw std::runtime_error("Corrupt compressed chunk");
+        }
+
+        const unsigned int value_size = size / n;
+        values.resize(size);
+        if(size == n * value_size) {
+            for(size_t v=0; v<n; v++) {
+                for(unsigned int s=0; s<value_size; s++) {
+                    values[v * value_size + s] = shuffled[s * n + v];
+                }
+            }
+        }
+#endif
+    }
+
+    std::vector<double> tile(n);
+    if(values.size() == n * sizeof(double)) {
+        std::memcpy(tile.data(), values.data(), values.size());
+    } else if(this->bits > 0 && values.size() == n * (this->bits / 8)) {
+        FrameQuantizer::decode(values.data(), n, this->bits, this->field_offsets[field], this->field_steps[field],
+                               tile.data());
+    } else {
+        throw std::runtime_error("Corrupt chunk");
+    }
+
+    return tile;
+}
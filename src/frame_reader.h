@@ -0,0 +1,160 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief      Reads regions of frames from a binary output file
+ *
+ * Both the contiguous layout and the chunked layout written by FrameWriter
+ * are supported. For chunked files only the chunks overlapping with the
+ * requested region are read (and decompressed); for contiguous files only
+ * the requested part of every column is read.
+ */
+class FrameReader {
+private:
+    std::ifstream in;               //!< input file
+    unsigned int width = 0;         //!< width of the frames
+    unsigned int height = 0;        //!< height of the frames
+    unsigned int nframes = 0;       //!< number of frames (including the initial frame)
+
+    bool chunked = false;           //!< whether the file uses the chunked layout
+    unsigned int chunk_size = 0;    //!< edge length of a chunk
+    unsigned int compression = 0;   //!< compression of the chunks (0 = none, 1 = shuffle + zlib)
+    unsigned int bits = 0;          //!< size of the codes of quantized chunks (0 = not quantized)
+
+    std::vector<uint32_t> frame_fields;     //!< number of fields of every frame
+    std::vector<uint64_t> frame_start;      //!< index of the first chunk of every frame
+    std::vector<uint64_t> chunk_offsets;    //!< position of every chunk in the file
+    std::vector<uint64_t> chunk_sizes;      //!< size of every chunk in bytes
+    std::vector<double> field_offsets;      //!< value of code 0 of every field of every frame (quantized files)
+    std::vector<double> field_steps;        //!< step between the codes of every field of every frame (quantized files)
+
+    uint64_t bytes_read = 0;        //!< number of bytes read from the file (excluding the header)
+
+public:
+    /**
+     * @brief      Opens the file and reads its header (and chunk index)
+     *
+     * @param[in]  filename  The filename
+     */
+    FrameReader(const std::string& filename);
+
+    /**
+     * @brief      Read a rectangle of a single field of a single frame
+     *
+     * @param[in]  frame  index of the frame
+     * @param[in]  field  index of the field
+     * @param[in]  x0     first column
+     * @param[in]  y0     first row
+     * @param[in]  w      number of columns
+     * @param[in]  h      number of rows
+     * @param      out    output (column-major, w x h)
+     */
+    void read(unsigned int frame, unsigned int field,
+              unsigned int x0, unsigned int y0, unsigned int w, unsigned int h, double* out);
+
+    /**
+     * @brief      Read a rectangle of a single field over a range of frames
+     *
+     * @param[in]  field        index of the field
+     * @param[in]  frame_begin  first frame
+     * @param[in]  frame_end    one past the last frame
+     * @param[in]  x0           first column
+     * @param[in]  y0           first row
+     * @param[in]  w            number of columns
+     * @param[in]  h            number of rows
+     *
+     * @return     the rectangles of all frames, one after the other
+     */
+    std::vector<double> read_region(unsigned int field, unsigned int frame_begin, unsigned int frame_end,
+                                    unsigned int x0, unsigned int y0, unsigned int w, unsigned int h);
+
+    inline unsigned int get_width() const {
+        return this->width;
+    }
+
+    inline unsigned int get_height() const {
+        return this->height;
+    }
+
+    inline unsigned int get_nr_frames() const {
+        return this->nframes;
+    }
+
+    /**
+     * @brief      Get the number of fields of every frame
+     *
+     * Throws when the frames hold different numbers of fields, which only
+     * chunked files written with different cadences per species do.
+     */
+    unsigned int get_nr_fields() const;
+
+    /**
+     * @brief      Get the number of fields of a single frame
+     *
+     * The species held by the frame are listed in output_index of the
+     * metadata.
+     *
+     * @param[in]  frame  index of the frame
+     */
+    unsigned int get_nr_fields(unsigned int frame) const;
+
+    inline bool is_chunked() const {
+        return this->chunked;
+    }
+
+    /**
+     * @brief      Get the size of the codes of quantized chunks in bits (0 = not quantized)
+     */
+    inline unsigned int get_quantization_bits() const {
+        return this->bits;
+    }
+
+    /**
+     * @brief      Get the number of bytes read so far (excluding header and index)
+     */
+    inline uint64_t get_bytes_read() const {
+        return this->bytes_read;
+    }
+
+private:
+    /**
+     * @brief      Read the header and chunk index of a chunked file
+     */
+    void read_chunked_header();
+
+    /**
+     * @brief      Read and decode a single chunk
+     *
+     * @param[in]  index  index of the chunk
+     * @param[in]  n      number of values in the chunk
+     * @param[in]  field  index of the field over all frames (for the quantization)
+     *
+     * @return     values of the chunk (column-major)
+     */
+    std::vector<double> read_chunk(uint64_t index, size_t n, uint64_t field);
+};
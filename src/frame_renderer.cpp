@@ -0,0 +1,528 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "frame_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+#ifdef HAS_PNG
+#include <png.h>
+#endif
+
+/**
+ * @brief      Constructs the object and starts the output threads
+ *
+ * @param[in]  spec           specification of the rendering
+ * @param[in]  species_names  names of all species
+ * @param[in]  _width         width of the system
+ * @param[in]  _height        height of the system
+ */
+FrameRenderer::FrameRenderer(const std::string& spec, const std::vector<std::string>& species_names,
+                             unsigned int _width, unsigned int _height) :
+    width(_width),
+    height(_height),
+    names(species_names) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid render specification: " + piece);
+        }
+        params.emplace(boost::trim_copy(vars[0]), boost::trim_copy(vars[1]));
+    }
+
+    auto split_list = [](const std::string& list) {
+        std::vector<std::string> items;
+        boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+        for(std::string& item : items) {
+            boost::trim(item);
+        }
+        return items;
+    };
+
+    for(const auto& param : params) {
+        const std::string& key = param.first;
+        const std::string& value = param.second;
+        if(key == "format") {
+            if(value == "png") {
+                this->format = FORMAT_PNG;
+            } else if(value == "y4m") {
+                this->format = FORMAT_Y4M;
+            } else if(value == "rgb") {
+                this->format = FORMAT_RGB;
+            } else {
+                throw std::runtime_error("Invalid render format: " + value + " (choose png, y4m or rgb)");
+            }
+        } else if(key == "prefix") {
+            this->prefix = value;
+        } else if(key == "scale") {
+            this->scale = boost::lexical_cast<unsigned int>(value);
+        } else if(key == "fps") {
+            this->fps = boost::lexical_cast<unsigned int>(value);
+        } else if(key == "threads") {
+            this->nthreads = boost::lexical_cast<unsigned int>(value);
+        } else if(key != "fields" && key != "cmap" && key != "range") {
+            throw std::runtime_error("Invalid render specification: unknown key " + key);
+        }
+    }
+
+    if(this->scale == 0 || this->fps == 0 || this->nthreads == 0) {
+        throw std::runtime_error("Invalid render specification: scale, fps and threads have to be positive");
+    }
+
+#ifndef HAS_PNG
+    if(this->format == FORMAT_PNG) {
+        throw std::runtime_error("Turing was compiled without libpng; use format=y4m or format=rgb");
+    }
+#endif
+
+    // species are given by name or by index; by default the first two are shown
+    std::vector<std::string> fields = {this->names[0]};
+    if(this->names.size() > 1) {
+        fields.push_back(this->names[1]);
+    }
+    if(params.count("fields") > 0) {
+        fields = split_list(params["fields"]);
+    }
+
+    std::vector<std::string> cmaps = {"viridis", "PiYG"};
+    if(params.count("cmap") > 0) {
+        cmaps = split_list(params["cmap"]);
+    }
+
+    std::vector<std::string> ranges;
+    if(params.count("range") > 0) {
+        ranges = split_list(params["range"]);
+    }
+
+    for(unsigned int f=0; f<fields.size(); f++) {
+        Panel panel;
+
+        const auto got = std::find(this->names.begin(), this->names.end(), fields[f]);
+        if(got != this->names.end()) {
+            panel.species = got - this->names.begin();
+        } else if(!fields[f].empty() && fields[f].find_first_not_of("0123456789") == std::string::npos &&
+                  std::stoul(fields[f]) < this->names.size()) {
+            panel.species = std::stoul(fields[f]);
+        } else {
+            throw std::runtime_error("Invalid render specification: unknown species " + fields[f]);
+        }
+
+        // the last colormap and range given apply to the remaining species
+        panel.lut = make_colormap(cmaps[std::min<size_t>(f, cmaps.size() - 1)]);
+
+        const std::string range = ranges.empty() ? "auto" : ranges[std::min<size_t>(f, ranges.size() - 1)];
+        panel.autorange = (range == "auto");
+        panel.vmin = 0.0;
+        panel.vmax = 1.0;
+        if(!panel.autorange) {
+            const size_t colon = range.find(':');
+            if(colon == std::string::npos) {
+                throw std::runtime_error("Invalid render range: " + range + " (use vmin:vmax or auto)");
+            }
+            panel.vmin = boost::lexical_cast<double>(range.substr(0, colon));
+            panel.vmax = boost::lexical_cast<double>(range.substr(colon + 1));
+        }
+
+        this->panels.push_back(panel);
+    }
+
+    this->image_width = this->panels.size() * this->width * this->scale + (this->panels.size() - 1) * GAP;
+    this->image_height = this->height * this->scale;
+
+    for(unsigned int i=0; i<this->nthreads; i++) {
+        this->workers.emplace_back(&FrameRenderer::work, this);
+    }
+}
+
+/**
+ * @brief      Destroys the object, waiting for the output threads
+ */
+FrameRenderer::~FrameRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+    }
+    this->cv.notify_all();
+
+    for(std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief      Hand a frame to the output threads
+ *
+ * @param[in]  frame  frame number
+ * @param[in]  c      concentrations of all species (column-major, width x height)
+ */
+void FrameRenderer::push(unsigned int frame, const std::vector<const double*>& c) {
+    // copy the frame before waiting, such that the computation can proceed
+    Job job;
+    job.frame = frame;
+    const size_t n = (size_t)this->width * this->height;
+    for(const Panel& panel : this->panels) {
+        job.data.emplace_back(c[panel.species], c[panel.species] + n);
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cv.wait(lock, [this]() {
+        return this->queue.size() < 2 * this->nthreads || this->error;
+    });
+
+    // the error is reported by finish()
+    if(this->error) {
+        return;
+    }
+
+    job.sequence = this->nr_pushed++;
+    this->queue.push_back(std::move(job));
+    lock.unlock();
+    this->cv.notify_all();
+}
+
+/**
+ * @brief      Wait until all frames are written and stop the output threads
+ */
+void FrameRenderer::finish() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+    }
+    this->cv.notify_all();
+
+    for(std::thread& worker : this->workers) {
+        worker.join();
+    }
+    this->workers.clear();
+
+    if(this->writes_to_stdout()) {
+        std::fflush(stdout);
+    }
+
+    if(this->error) {
+        std::exception_ptr e = this->error;
+        this->error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+/**
+ * @brief      Get the number of frames waiting to be rendered
+ */
+size_t FrameRenderer::get_backlog() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->queue.size();
+}
+
+/**
+ * @brief      Whether a specification streams the images to stdout
+ *
+ * @param[in]  spec  specification of the rendering
+ */
+bool FrameRenderer::writes_to_stdout(const std::string& spec) {
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+    for(const std::string& piece : pieces) {
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() == 2 && boost::trim_copy(vars[0]) == "format") {
+            return boost::trim_copy(vars[1]) != "png";
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief      Get a description of the rendering
+ */
+std::string FrameRenderer::get_description() const {
+    std::ostringstream ss;
+    for(unsigned int p=0; p<this->panels.size(); p++) {
+        ss << (p == 0 ? "" : ", ") << this->names[this->panels[p].species];
+    }
+    ss << " as " << this->image_width << "x" << this->image_height;
+    switch(this->format) {
+        case FORMAT_PNG:
+            ss << " PNG images (" << this->prefix << "0000.png, ...)";
+        break;
+        case FORMAT_Y4M:
+            ss << " Y4M stream to stdout";
+        break;
+        case FORMAT_RGB:
+            ss << " rgb24 stream to stdout";
+        break;
+    }
+    ss << " using " << this->nthreads << " output thread" << (this->nthreads > 1 ? "s" : "");
+    return ss.str();
+}
+
+/**
+ * @brief      Main loop of an output thread
+ */
+void FrameRenderer::work() {
+    std::vector<unsigned char> rgb;
+
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->cv.wait(lock, [this]() {
+                return !this->queue.empty() || this->done;
+            });
+            if(this->queue.empty()) {
+                return;
+            }
+            job = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        this->cv.notify_all();
+
+        std::exception_ptr failure;
+        try {
+            this->render(job, rgb);
+            if(this->format == FORMAT_PNG) {
+                char number[16];
+                std::snprintf(number, sizeof(number), "%04u", job.frame);
+                this->write_png(this->prefix + number + ".png", rgb);
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        // streams are written in the order in which the frames were pushed
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if(this->format != FORMAT_PNG) {
+            this->cv.wait(lock, [&]() {
+                return this->nr_written == job.sequence;
+            });
+            if(!failure && !this->error) {
+                try {
+                    this->write_stream(rgb, job.sequence == 0);
+                } catch(...) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if(failure && !this->error) {
+            this->error = failure;
+        }
+        this->nr_written++;
+        lock.unlock();
+        this->cv.notify_all();
+    }
+}
+
+/**
+ * @brief      Map the concentrations of a frame onto colours
+ *
+ * @param[in]  job   The frame
+ * @param      rgb   rgb24 image
+ */
+void FrameRenderer::render(const Job& job, std::vector<unsigned char>& rgb) const {
+    const unsigned int W = this->width;
+    const unsigned int H = this->height;
+    const unsigned int s = this->scale;
+    const size_t stride = (size_t)this->image_width * 3;
+
+    // the gaps between the panels are white
+    rgb.assign(stride * this->image_height, 255);
+
+    for(unsigned int p=0; p<this->panels.size(); p++) {
+        const Panel& panel = this->panels[p];
+        const std::vector<double>& c = job.data[p];
+
+        double vmin = panel.vmin;
+        double vmax = panel.vmax;
+        if(panel.autorange) {
+            const auto extent = std::minmax_element(c.begin(), c.end());
+            vmin = *extent.first;
+            vmax = *extent.second;
+        }
+        const double norm = vmax > vmin ? 255.0 / (vmax - vmin) : 0.0;
+
+        const size_t x0 = (size_t)p * (W * s + GAP) * 3;
+        for(unsigned int j=0; j<H; j++) {
+            // the first grid row is at the bottom of the image
+            unsigned char* row = &rgb[(size_t)(H - 1 - j) * s * stride + x0];
+            const double* src = &c[(size_t)j * W];
+            for(unsigned int i=0; i<W; i++) {
+                const double x = (src[i] - vmin) * norm + 0.5;
+                const unsigned int idx = x > 0.0 ? (unsigned int)std::min(x, 255.0) : 0;
+                const unsigned char* color = &panel.lut[idx * 3];
+                for(unsigned int k=0; k<s; k++) {
+                    row[(i * s + k) * 3 + 0] = color[0];
+                    row[(i * s + k) * 3 + 1] = color[1];
+                    row[(i * s + k) * 3 + 2] = color[2];
+                }
+            }
+            for(unsigned int k=1; k<s; k++) {
+                std::copy(row, row + (size_t)W * s * 3, row + k * stride);
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Write an image to a PNG file
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  rgb       rgb24 image
+ */
+void FrameRenderer::write_png(const std::string& filename, const std::vector<unsigned char>& rgb) const {
+#ifdef HAS_PNG
+    FILE* fp = std::fopen(filename.c_str(), "wb");
+    if(fp == nullptr) {
+        throw std::runtime_error("Cannot open " + filename + " for writing");
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if(png == nullptr || info == nullptr || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        std::fclose(fp);
+        throw std::runtime_error("Cannot encode " + filename);
+    }
+
+    png_init_io(png, fp);
+
+    // colormapped fields are smooth, such that fast compression suffices
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, this->image_width, this->image_height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for(unsigned int r=0; r<this->image_height; r++) {
+        png_write_row(png, &rgb[(size_t)r * this->image_width * 3]);
+    }
+    png_write_end(png, nullptr);
+
+    png_destroy_write_struct(&png, &info);
+    std::fclose(fp);
+#else
+    throw std::runtime_error("Cannot write " + filename + ": Turing was compiled without libpng");
+#endif
+}
+
+/**
+ * @brief      Write an image to stdout
+ *
+ * @param[in]  rgb     rgb24 image
+ * @param[in]  header  whether to precede the image by the header of the stream
+ */
+void FrameRenderer::write_stream(const std::vector<unsigned char>& rgb, bool header) const {
+    if(this->format == FORMAT_RGB) {
+        std::fwrite(rgb.data(), 1, rgb.size(), stdout);
+        return;
+    }
+
+    if(header) {
+        std::fprintf(stdout, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+                     this->image_width, this->image_height, this->fps);
+    }
+
+    // ITU-R BT.601 with the limited (studio) range that players assume
+    const size_t n = (size_t)this->image_width * this->image_height;
+    std::vector<unsigned char> yuv(3 * n);
+    for(size_t k=0; k<n; k++) {
+        const double r = rgb[3 * k + 0] / 255.0;
+        const double g = rgb[3 * k + 1] / 255.0;
+        const double b = rgb[3 * k + 2] / 255.0;
+        yuv[k]         = (unsigned char)std::lround(16.0 + 65.481 * r + 128.553 * g + 24.966 * b);
+        yuv[n + k]     = (unsigned char)std::lround(128.0 - 37.797 * r - 74.203 * g + 112.0 * b);
+        yuv[2 * n + k] = (unsigned char)std::lround(128.0 + 112.0 * r - 93.786 * g - 18.214 * b);
+    }
+
+    std::fputs("FRAME\n", stdout);
+    std::fwrite(yuv.data(), 1, yuv.size(), stdout);
+}
+
+/**
+ * @brief      Build the lookup table of a colormap
+ *
+ * @param[in]  name  name of the colormap
+ *
+ * @return     256 rgb entries
+ */
+std::vector<unsigned char> FrameRenderer::make_colormap(const std::string& name) {
+    std::vector<unsigned char> lut(256 * 3);
+
+    auto store = [&](unsigned int k, double r, double g, double b) {
+        lut[3 * k + 0] = (unsigned char)std::lround(255.0 * std::min(1.0, std::max(0.0, r)));
+        lut[3 * k + 1] = (unsigned char)std::lround(255.0 * std::min(1.0, std::max(0.0, g)));
+        lut[3 * k + 2] = (unsigned char)std::lround(255.0 * std::min(1.0, std::max(0.0, b)));
+    };
+
+    // linear interpolation between equidistant colours, as matplotlib does
+    auto interpolate = [&](const unsigned int* colors, unsigned int n) {
+        for(unsigned int k=0; k<256; k++) {
+            const double x = k / 255.0 * (n - 1);
+            const unsigned int m = std::min(n - 2, (unsigned int)x);
+            const double w = x - m;
+            double rgb[3];
+            for(unsigned int d=0; d<3; d++) {
+                const double lo = ((colors[m] >> (16 - 8 * d)) & 0xff) / 255.0;
+                const double hi = ((colors[m + 1] >> (16 - 8 * d)) & 0xff) / 255.0;
+                rgb[d] = lo + w * (hi - lo);
+            }
+            store(k, rgb[0], rgb[1], rgb[2]);
+        }
+    };
+
+    if(name == "viridis") {
+        // matplotlib's viridis sampled at 0, 0.1, ..., 1
+        static const unsigned int colors[11] = {
+            0x440154, 0x482475, 0x414487, 0x355f8d, 0x2a788e, 0x21918c,
+            0x22a884, 0x44bf70, 0x7ad151, 0xbddf26, 0xfde725
+        };
+        interpolate(colors, 11);
+    } else if(name == "PiYG") {
+        // the ColorBrewer colours from which matplotlib builds PiYG
+        static const unsigned int colors[11] = {
+            0x8e0152, 0xc51b7d, 0xde77ae, 0xf1b6da, 0xfde0ef, 0xf7f7f7,
+            0xe6f5d0, 0xb8e186, 0x7fbc41, 0x4d9221, 0x276419
+        };
+        interpolate(colors, 11);
+    } else if(name == "gray") {
+        for(unsigned int k=0; k<256; k++) {
+            store(k, k / 255.0, k / 255.0, k / 255.0);
+        }
+    } else {
+        throw std::runtime_error("Invalid colormap: " + name + " (choose viridis, PiYG or gray)");
+    }
+
+    return lut;
+}
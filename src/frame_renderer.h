@@ -0,0 +1,208 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief      Renders frames to images while the integration proceeds
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     format=png           png (one file per frame), y4m or rgb (stream to stdout)
+ *     prefix=img/          prefix of the png files, which are named <prefix>0000.png
+ *     fields=A,B           species shown side by side, by name or index (default: first two)
+ *     cmap=viridis,PiYG    colormap per species (viridis, PiYG or gray)
+ *     range=0:1,auto       fixed vmin:vmax per species, or auto for the extent of every frame
+ *     scale=2              enlarge every grid point to scale x scale pixels
+ *     fps=25               frame rate of a y4m stream
+ *     threads=2            number of frames that are rendered and encoded concurrently
+ *
+ * Frames are copied into a bounded queue that is processed by a set of
+ * output threads, such that rendering overlaps with the computation. The
+ * first grid row is shown at the bottom of the image.
+ */
+class FrameRenderer {
+private:
+    enum Format {
+        FORMAT_PNG,     //!< one PNG file per frame
+        FORMAT_Y4M,     //!< YUV4MPEG2 stream (4:4:4) to stdout
+        FORMAT_RGB      //!< raw rgb24 stream to stdout
+    };
+
+    /**
+     * @brief      Species shown in the image
+     */
+    struct Panel {
+        unsigned int species;               //!< index of the species
+        std::vector<unsigned char> lut;     //!< colormap (256 rgb entries)
+        bool autorange;                     //!< whether the range follows every frame
+        double vmin;                        //!< value at the start of the colormap
+        double vmax;                        //!< value at the end of the colormap
+    };
+
+    /**
+     * @brief      Frame waiting to be rendered
+     */
+    struct Job {
+        unsigned int sequence;                  //!< position in the output
+        unsigned int frame;                     //!< frame number
+        std::vector<std::vector<double>> data;  //!< concentrations per panel
+    };
+
+    static const unsigned int GAP = 4;  //!< number of pixels between panels
+
+    unsigned int width;                 //!< width of the system
+    unsigned int height;                //!< height of the system
+    Format format = FORMAT_PNG;         //!< output format
+    std::string prefix;                 //!< prefix of the png files
+    std::vector<std::string> names;     //!< names of all species
+    std::vector<Panel> panels;          //!< species shown side by side
+    unsigned int scale = 1;             //!< pixels per grid point along each direction
+    unsigned int fps = 25;              //!< frame rate of a y4m stream
+    unsigned int nthreads = 2;          //!< number of output threads
+
+    unsigned int image_width;           //!< width of the image in pixels
+    unsigned int image_height;          //!< height of the image in pixels
+
+    std::vector<std::thread> workers;   //!< output threads
+    std::deque<Job> queue;              //!< frames waiting to be rendered
+    std::mutex mutex;                   //!< guards the queue and the stream
+    std::condition_variable cv;         //!< signals changes of the queue and the stream
+    unsigned int nr_pushed = 0;         //!< number of frames handed to the renderer
+    unsigned int nr_written = 0;        //!< number of frames written
+    bool done = false;                  //!< whether no more frames will be pushed
+    std::exception_ptr error;           //!< first error raised by an output thread
+
+public:
+    /**
+     * @brief      Constructs the object and starts the output threads
+     *
+     * @param[in]  spec           specification of the rendering
+     * @param[in]  species_names  names of all species
+     * @param[in]  _width         width of the system
+     * @param[in]  _height        height of the system
+     */
+    FrameRenderer(const std::string& spec, const std::vector<std::string>& species_names,
+                  unsigned int _width, unsigned int _height);
+
+    /**
+     * @brief      Destroys the object, waiting for the output threads
+     */
+    ~FrameRenderer();
+
+    /**
+     * @brief      Hand a frame to the output threads
+     *
+     * Blocks while the queue is full.
+     *
+     * @param[in]  frame  frame number
+     * @param[in]  c      concentrations of all species (column-major, width x height)
+     */
+    void push(unsigned int frame, const std::vector<const double*>& c);
+
+    /**
+     * @brief      Wait until all frames are written and stop the output threads
+     *
+     * Rethrows the first error raised while rendering.
+     */
+    void finish();
+
+    /**
+     * @brief      Whether the images are streamed to stdout
+     */
+    inline bool writes_to_stdout() const {
+        return this->format != FORMAT_PNG;
+    }
+
+    /**
+     * @brief      Whether a specification streams the images to stdout
+     *
+     * This is known before the renderer is constructed, such that messages
+     * can be redirected to stderr from the start.
+     *
+     * @param[in]  spec  specification of the rendering
+     */
+    static bool writes_to_stdout(const std::string& spec);
+
+    /**
+     * @brief      Get the number of frames written
+     */
+    inline unsigned int get_nr_frames() const {
+        return this->nr_written;
+    }
+
+    /**
+     * @brief      Get the number of frames waiting to be rendered
+     */
+    size_t get_backlog();
+
+    /**
+     * @brief      Get a description of the rendering
+     */
+    std::string get_description() const;
+
+private:
+    /**
+     * @brief      Main loop of an output thread
+     */
+    void work();
+
+    /**
+     * @brief      Map the concentrations of a frame onto colours
+     *
+     * @param[in]  job   The frame
+     * @param      rgb   rgb24 image
+     */
+    void render(const Job& job, std::vector<unsigned char>& rgb) const;
+
+    /**
+     * @brief      Write an image to a PNG file
+     *
+     * @param[in]  filename  The filename
+     * @param[in]  rgb       rgb24 image
+     */
+    void write_png(const std::string& filename, const std::vector<unsigned char>& rgb) const;
+
+    /**
+     * @brief      Write an image to stdout
+     *
+     * @param[in]  rgb     rgb24 image
+     * @param[in]  header  whether to precede the image by the header of the stream
+     */
+    void write_stream(const std::vector<unsigned char>& rgb, bool header) const;
+
+    /**
+     * @brief      Build the lookup table of a colormap
+     *
+     * @param[in]  name  name of the colormap
+     *
+     * @return     256 rgb entries
+     */
+    static std::vector<unsigned char> make_colormap(const std::string& name);
+};
@@ -0,0 +1,320 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "frame_writer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+const char FrameWriter::CHUNKED_MAGIC[8] = {'T', 'U', 'R', 'I', 'N', 'G', 'C', 'K'};
+
+/**
+ * @brief      Constructs the object and writes the header
+ *
+ * @param[in]  filename       The filename
+ * @param[in]  _width         width of the frames
+ * @param[in]  _height        height of the frames
+ * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+ * @param[in]  _compression   zlib compression level of the chunks (0 = uncompressed)
+ * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+ */
+FrameWriter::FrameWriter(const std::string& filename, unsigned int _width, unsigned int _height,
+                         unsigned int _chunk_size, int _compression, const std::string& _quantization) :
+    out(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+    width(_width),
+    height(_height),
+    chunk_size(_chunk_size),
+    compression(_compression) {
+
+    if(!this->out.is_open()) {
+        throw std::runtime_error("Cannot open " + filename + " for writing");
+    }
+
+    if(this->compression < 0 || this->compression > 9) {
+        throw std::runtime_error("Invalid compression level: " + std::to_string(this->compression) + " (choose 0-9)");
+    }
+    if(this->compression > 0 && this->chunk_size == 0) {
+        throw std::runtime_error("Compression requires a chunked layout");
+    }
+    if(!_quantization.empty()) {
+        if(this->chunk_size == 0) {
+            throw std::runtime_error("Quantization requires a chunked layout");
+        }
+        this->quantizer = std::make_unique<FrameQuantizer>(_quantization);
+    }
+#ifndef HAS_ZLIB
+    if(this->compression > 0) {
+        throw std::runtime_error("Turing was compiled without zlib; chunks cannot be compressed");
+    }
+#endif
+
+    if(this->chunk_size > 0) {
+        // the number of frames and the offset of the index are filled in when closing
+        const char zeros[CHUNKED_HEADER_SIZE] = {};
+        this->out.write(zeros, CHUNKED_HEADER_SIZE);
+        this->position = CHUNKED_HEADER_SIZE;
+        return;
+    }
+
+    // store width and height
+    this->out.write((char*) (&this->width), sizeof(unsigned int) );
+    this->out.write((char*) (&this->height), sizeof(unsigned int) );
+
+    // placeholder for the number of frames
+    const unsigned int zero = 0;
+    this->out.write((char*) (&zero), sizeof(unsigned int) );
+}
+
+/**
+ * @brief      Destroys the object, closing the file if still open
+ */
+FrameWriter::~FrameWriter() {
+    if(this->out.is_open()) {
+        this->close();
+    }
+}
+
+/**
+ * @brief      Write a single frame
+ *
+ * @param[in]  a     Concentration matrix A
+ * @param[in]  b     Concentration matrix B
+ */
+void FrameWriter::write_frame(const MatrixXXd& a, const MatrixXXd& b) {
+    if(this->chunk_size > 0) {
+        this->write_frame(a.data(), b.data(), a.size());
+        return;
+    }
+
+    this->out.write((char*) a.data(), a.rows() * a.cols() * sizeof(typename MatrixXXd::Scalar) );
+    this->out.write((char*) b.data(), b.rows() * b.cols() * sizeof(typename MatrixXXd::Scalar) );
+    this->nframes++;
+}
+
+/**
+ * @brief      Write a single frame from contiguous storage
+ *
+ * @param[in]  a     Concentration of A
+ * @param[in]  b     Concentration of B
+ * @param[in]  n     number of values per compound
+ */
+void FrameWriter::write_frame(const double* a, const double* b, size_t n) {
+    if(this->chunk_size > 0) {
+        this->write_frame(std::vector<const double*>{a, b}, n);
+        return;
+    }
+
+    this->out.write((const char*) a, n * sizeof(double) );
+    this->out.write((const char*) b, n * sizeof(double) );
+    this->nframes++;
+}
+
+/**
+ * @brief      Write a single frame holding an arbitrary number of species
+ *
+ * @param[in]  fields  concentrations per species
+ * @param[in]  n       number of values per species
+ */
+void FrameWriter::write_frame(const std::vector<const double*>& fields, size_t n) {
+    if(this->chunk_size > 0) {
+        for(const double* field : fields) {
+            this->write_chunks(field);
+        }
+        this->frame_fields.push_back(fields.size());
+        this->nframes++;
+        return;
+    }
+
+    // the header of the contiguous layout cannot describe frames with different fields
+    if(!this->frame_fields.empty() && fields.size() != this->frame_fields.front()) {
+        throw std::runtime_error("Frames of a contiguous file need to hold the same number of fields (" +
+                                 std::to_string(this->frame_fields.front()) + ", got " +
+                                 std::to_string(fields.size()) + "); use a chunked layout");
+    }
+    this->frame_fields.push_back(fields.size());
+
+    for(const double* field : fields) {
+        this->out.write((const char*) field, n * sizeof(double) );
+    }
+    this->nframes++;
+}
+
+/**
+ * @brief      Store the number of frames in the header and close the file
+ */
+void FrameWriter::close() {
+    if(this->chunk_size > 0) {
+        // the index follows the chunks
+        const uint64_t index_offset = this->position;
+        this->out.write((const char*) this->frame_fields.data(), this->frame_fields.size() * sizeof(uint32_t));
+        if(this->quantizer) {
+            const uint32_t bits = this->quantizer->get_bits();
+            this->out.write((const char*) &bits, sizeof(uint32_t));
+            for(unsigned int k=0; k<this->field_offsets.size(); k++) {
+                this->out.write((const char*) &this->field_offsets[k], sizeof(double));
+                this->out.write((const char*) &this->field_steps[k], sizeof(double));
+            }
+        }
+        for(unsigned int k=0; k<this->chunk_offsets.size(); k++) {
+            this->out.write((const char*) &this->chunk_offsets[k], sizeof(uint64_t));
+            this->out.write((const char*) &this->chunk_sizes[k], sizeof(uint64_t));
+        }
+
+        const uint32_t header[6] = {this->quantizer ? QUANTIZED_VERSION : CHUNKED_VERSION, this->width, this->height, this->chunk_size,
+                                    this->compression > 0 ? 1u : 0u, this->nframes};
+        this->out.seekp(0);
+        this->out.write(CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+        this->out.write((const char*) header, sizeof(header));
+        this->out.write((const char*) &index_offset, sizeof(uint64_t));
+        this->out.close();
+        return;
+    }
+
+    // the header stores the number of frames excluding the initial frame
+    const unsigned int steps = this->nframes > 0 ? this->nframes - 1 : 0;
+    this->out.seekp(2 * sizeof(unsigned int));
+    this->out.write((char*) (&steps), sizeof(unsigned int) );
+    this->out.close();
+}
+
+/**
+ * @brief      Write a field as a set of chunks
+ *
+ * @param[in]  field  concentrations (column-major, width x height)
+ */
+void FrameWriter::write_chunks(const double* field) {
+    const unsigned int C = this->chunk_size;
+    const unsigned int tiles_i = (this->width + C - 1) / C;
+    const unsigned int tiles_j = (this->height + C - 1) / C;
+    const unsigned int ntiles = tiles_i * tiles_j;
+
+    // the mapping onto the codes is shared by all chunks of the field
+    FrameQuantizer::Range range = {0.0, 0.0, 0.0, false};
+    if(this->quantizer) {
+        range = this->quantizer->analyse(field, (size_t)this->width * this->height);
+        this->field_offsets.push_back(range.offset);
+        this->field_steps.push_back(range.step);
+    }
+
+    // tiles are gathered (quantized and compressed) in parallel and written in order
+    std::vector<std::vector<unsigned char>> chunks(ntiles);
+    uint64_t raw = 0;
+    unsigned int failed = 0;
+    std::string error;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:raw,failed)
+    for(unsigned int k=0; k<ntiles; k++) {
+        const unsigned int i0 = (k % tiles_i) * C;
+        const unsigned int j0 = (k / tiles_i) * C;
+        const unsigned int tw = std::min(C, this->width - i0);
+        const unsigned int th = std::min(C, this->height - j0);
+        const size_t n = (size_t)tw * th;
+
+        std::vector<double> tile(n);
+        for(unsigned int j=0; j<th; j++) {
+            std::copy(field + (size_t)(j0 + j) * this->width + i0,
+                      field + (size_t)(j0 + j) * this->width + i0 + tw,
+                      &tile[(size_t)j * tw]);
+        }
+
+        // exceptions cannot leave the parallel loop; the first error is raised after it
+        try {
+            if(!this->encode_chunk(tile, n, range, chunks[k]) && this->quantizer) {
+                raw++;
+            }
+        } catch(const std::runtime_error& e) {
+            failed++;
+            #pragma omp critical
+            if(error.empty()) {
+                error = e.what();
+            }
+        }
+    }
+    if(failed > 0) {
+        throw std::runtime_error(error);
+    }
+    this->nr_raw_chunks += raw;
+
+    for(const auto& chunk : chunks) {
+        this->out.write((const char*) chunk.data(), chunk.size());
+        this->chunk_offsets.push_back(this->position);
+        this->chunk_sizes.push_back(chunk.size());
+        this->position += chunk.size();
+    }
+}
+
+/**
+ * @brief      Encode the values of a tile as a chunk
+ *
+ * @param[in]  tile   values of the tile
+ * @param[in]  n      number of values
+ * @param[in]  range  mapping of the field onto the codes (when quantizing)
+ * @param      chunk  output
+ *
+ * @return     whether the values were quantized
+ *
+ * Throws a runtime_error when a chunk cannot be compressed.
+ */
+bool FrameWriter::encode_chunk(const std::vector<double>& tile, size_t n, const FrameQuantizer::Range& range,
+                               std::vector<unsigned char>& chunk) const {
+    // codes, or doubles when the values cannot be quantized within the error bound
+    std::vector<unsigned char> values;
+    unsigned int value_size = sizeof(double);
+    bool quantized = false;
+    if(this->quantizer) {
+        value_size = this->quantizer->get_code_size();
+        values.resize(n * value_size);
+        quantized = this->quantizer->encode(tile.data(), n, range, values.data());
+    }
+    if(!quantized) {
+        value_size = sizeof(double);
+        values.assign((const unsigned char*) tile.data(), (const unsigned char*) tile.data() + n * sizeof(double));
+    }
+
+    if(this->compression == 0) {
+        chunk = std::move(values);
+        return quantized;
+    }
+
+#ifdef HAS_ZLIB
+    // neighbouring values share their leading bytes, which deflate well once grouped
+    std::vector<unsigned char> shuffled(n * value_size);
+    for(size_t v=0; v<n; v++) {
+        for(unsigned int s=0; s<value_size; s++) {
+            shuffled[s * n + v] = values[v * value_size + s];
+        }
+    }
+
+    uLongf size = compressBound(shuffled.size());
+    chunk.resize(size);
+    const int status = compress2(chunk.data(), &size, shuffled.data(), shuffled.size(), this->compression);
+    if(status != Z_OK) {
+        throw std::runtime_error("Cannot compress a chunk (zlib error " + std::to_string(status) + ")");
+    }
+    chunk.resize(size);
+#endif
+
+    return quantized;
+}
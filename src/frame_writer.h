@@ -0,0 +1,178 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_quantizer.h"
+
+/**
+ * @brief      Writes frames to the binary output file
+ *
+ * By default, the file starts with the width, height and number of frames
+ * (excluding the initial frame) as unsigned integers, followed by the
+ * frames. Each frame holds the concentrations of A and B (or of all species,
+ * see the metadata) as column-major doubles. The number of frames is filled
+ * in when the writer is closed.
+ *
+ * With a chunk size, every field is instead split into square tiles (chunks)
+ * that are stored independently, optionally compressed, such that a region
+ * can be read without reading the full frames (see FrameReader). The file
+ * then consists of:
+ *
+ *     char[8]    "TURINGCK"
+ *     uint32     version, width, height, chunk size, compression, number of frames
+ *     uint64     offset of the index
+ *     ...        chunks, ordered by frame, field, tile row and tile column
+ *     uint32     number of fields per frame
+ *     uint64     offset and size of every chunk
+ *
+ * A chunk holds the values of its tile in column-major order. Compressed
+ * chunks are byte-shuffled (all first bytes, then all second bytes, ...)
+ * and deflated with zlib.
+ *
+ * Quantized files (version 2) store codes instead of doubles (see
+ * FrameQuantizer). Their index holds the size of a code in bits after the
+ * number of fields per frame, followed by the offset and step (doubles) of
+ * every field of every frame, before the offsets and sizes of the chunks.
+ * Chunks that could not be quantized within the error bound hold doubles,
+ * which follows from their (uncompressed) size.
+ */
+class FrameWriter {
+public:
+    static const char CHUNKED_MAGIC[8];                 //!< first bytes of a chunked file
+    static const uint32_t CHUNKED_VERSION = 1;          //!< version of the chunked layout
+    static const uint32_t QUANTIZED_VERSION = 2;        //!< version of the chunked layout with quantized chunks
+    static const uint32_t CHUNKED_HEADER_SIZE = 40;     //!< size of the header of a chunked file
+
+private:
+    std::ofstream out;          //!< output file
+    unsigned int width;         //!< width of the frames
+    unsigned int height;        //!< height of the frames
+    unsigned int nframes = 0;   //!< number of frames written
+
+    unsigned int chunk_size;    //!< edge length of a chunk (0 = contiguous frames)
+    int compression;            //!< zlib compression level (0 = uncompressed)
+
+    std::vector<uint32_t> frame_fields;     //!< number of fields per frame (the same for all frames of a contiguous file)
+    std::vector<uint64_t> chunk_offsets;    //!< position of every chunk in the file
+    std::vector<uint64_t> chunk_sizes;      //!< size of every chunk in bytes
+    uint64_t position = 0;                  //!< current position in the file
+
+    std::unique_ptr<FrameQuantizer> quantizer;  //!< quantization of the chunks (optional)
+    std::vector<double> field_offsets;          //!< value of code 0 of every quantized field
+    std::vector<double> field_steps;            //!< step between the codes of every quantized field
+    uint64_t nr_raw_chunks = 0;                 //!< number of chunks stored as doubles despite quantization
+
+public:
+    /**
+     * @brief      Constructs the object and writes the header
+     *
+     * @param[in]  filename       The filename
+     * @param[in]  _width         width of the frames
+     * @param[in]  _height        height of the frames
+     * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  _compression   zlib compression level of the chunks (0 = uncompressed)
+     * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    FrameWriter(const std::string& filename, unsigned int _width, unsigned int _height,
+                unsigned int _chunk_size = 0, int _compression = 0, const std::string& _quantization = "");
+
+    /**
+     * @brief      Destroys the object, closing the file if still open
+     */
+    ~FrameWriter();
+
+    /**
+     * @brief      Write a single frame
+     *
+     * @param[in]  a     Concentration matrix A
+     * @param[in]  b     Concentration matrix B
+     */
+    void write_frame(const MatrixXXd& a, const MatrixXXd& b);
+
+    /**
+     * @brief      Write a single frame from contiguous storage
+     *
+     * @param[in]  a     Concentration of A
+     * @param[in]  b     Concentration of B
+     * @param[in]  n     number of values per compound
+     */
+    void write_frame(const double* a, const double* b, size_t n);
+
+    /**
+     * @brief      Write a single frame holding an arbitrary number of species
+     *
+     * @param[in]  fields  concentrations per species
+     * @param[in]  n       number of values per species
+     */
+    void write_frame(const std::vector<const double*>& fields, size_t n);
+
+    /**
+     * @brief      Store the number of frames in the header and close the file
+     */
+    void close();
+
+    /**
+     * @brief      Get the number of frames written
+     */
+    inline unsigned int get_nr_frames() const {
+        return this->nframes;
+    }
+
+    /**
+     * @brief      Get the number of chunks that were stored as doubles despite quantization
+     */
+    inline uint64_t get_nr_raw_chunks() const {
+        return this->nr_raw_chunks;
+    }
+
+private:
+    /**
+     * @brief      Write a field as a set of chunks
+     *
+     * @param[in]  field  concentrations (column-major, width x height)
+     */
+    void write_chunks(const double* field);
+
+    /**
+     * @brief      Encode the values of a tile as a chunk
+     *
+     * @param[in]  tile   values of the tile
+     * @param[in]  n      number of values
+     * @param[in]  range  mapping of the field onto the codes (when quantizing)
+     * @param      chunk  output
+     *
+     * @return     whether the values were quantized
+     *
+     * Throws a runtime_error when a chunk cannot be compressed.
+     */
+    bool encode_chunk(const std::vector<double>& tile, size_t n, const FrameQuantizer::Range& range,
+                      std::vector<unsigned char>& chunk) const;
+};
@@ -0,0 +1,688 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "job_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <omp.h>
+#include <tclap/CmdLine.h>
+
+#include "config.h"
+#include "output_metadata.h"
+#include "reaction_system.h"
+
+namespace {
+
+std::atomic<bool> shutdown_requested(false);    //!< set by SIGINT, SIGTERM or a SHUTDOWN command
+std::mutex log_mtx;                             //!< serializes the log of the server
+
+/**
+ * @brief      Request a shutdown of the server
+ *
+ * @param[in]  signum  The signal
+ */
+void request_shutdown(int signum) {
+    shutdown_requested = true;
+}
+
+/**
+ * @brief      Write a line to the log of the server
+ *
+ * @param[in]  msg   The message
+ */
+void log(const std::string& msg) {
+    std::lock_guard<std::mutex> lock(log_mtx);
+    std::clog << msg << std::endl;
+}
+
+/**
+ * @brief      Discards the output of the jobs
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        return n;
+    }
+};
+
+/**
+ * @brief      Write a complete message to a socket
+ *
+ * @param[in]  fd    The socket
+ * @param[in]  msg   The message
+ */
+void send_all(int fd, const std::string& msg) {
+    size_t pos = 0;
+    while(pos < msg.size()) {
+        const ssize_t n = ::send(fd, msg.data() + pos, msg.size() - pos, MSG_NOSIGNAL);
+        if(n <= 0) {
+            return;     // the client has gone, the job has finished regardless
+        }
+        pos += n;
+    }
+}
+
+/**
+ * @brief      Write a file by renaming a temporary file, such that readers never see a partial file
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  content   The content
+ */
+void write_atomically(const std::string& filename, const std::string& content) {
+    const std::string tmp = filename + ".tmp";
+    {
+        std::ofstream out(tmp);
+        out << content;
+        if(!out) {
+            throw std::runtime_error("Cannot write " + tmp);
+        }
+    }
+    std::filesystem::rename(tmp, filename);
+}
+
+} // namespace
+
+/**
+ * @brief      Encode the report as a single line of JSON
+ *
+ * @return     JSON representation
+ */
+std::string JobServer::Report::to_json() const {
+    std::ostringstream out;
+    out << "{\"job\": " << this->id
+        << ", \"status\": " << (this->exit_code == 0 ? "\"ok\"" : "\"failed\"")
+        << ", \"exit_code\": " << this->exit_code
+        << ", \"threads\": " << this->threads
+        << ", \"queued_seconds\": " << OutputMetadata::encode(this->queued)
+        << ", \"run_seconds\": " << OutputMetadata::encode(this->runtime)
+        << ", \"error\": " << OutputMetadata::encode(this->error) << "}";
+    return out.str();
+}
+
+/**
+ * @brief      Constructs the object and starts the worker threads
+ *
+ * @param[in]  _runner            runs a single job
+ * @param[in]  _cores             number of cores shared by the jobs
+ * @param[in]  _memory            memory shared by the jobs in bytes (0 = unlimited)
+ * @param[in]  _cells_per_thread  grid points per OpenMP thread of a job
+ */
+JobServer::JobServer(const Runner& _runner, unsigned int _cores, size_t _memory, size_t _cells_per_thread) :
+    runner(_runner),
+    cores(std::max(1u, _cores)),
+    memory(_memory),
+    cells_per_thread(std::max((size_t)1, _cells_per_thread)),
+    free_cores(std::max(1u, _cores)),
+    used_memory(0),
+    running(0),
+    completed(0),
+    next_id(1),
+    stopping(false) {
+
+    // as many workers as cores, such that single-threaded jobs can fill the machine
+    for(unsigned int i=0; i<this->cores; i++) {
+        this->workers.emplace_back(&JobServer::work, this);
+    }
+}
+
+/**
+ * @brief      Finishes the queued jobs and stops the worker threads
+ */
+JobServer::~JobServer() {
+    this->stop();
+}
+
+/**
+ * @brief      Submit a job
+ *
+ * @param[in]  args  command line without the program name
+ * @param[in]  done  receives the report once the job has finished
+ *
+ * @return     job number
+ */
+unsigned int JobServer::submit(const std::vector<std::string>& args, const Callback& done) {
+    Job job;
+    job.args.push_back("turing");
+    job.args.insert(job.args.end(), args.begin(), args.end());
+    job.done = done;
+    this->estimate(job);
+
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        if(this->stopping) {
+            throw std::runtime_error("The server is shutting down");
+        }
+        job.id = this->next_id++;
+        job.submitted = std::chrono::steady_clock::now();
+        this->queue.push_back(job);
+    }
+    this->cv.notify_all();
+
+    return job.id;
+}
+
+/**
+ * @brief      Get the state of the server as a single line of JSON
+ *
+ * @return     JSON representation
+ */
+std::string JobServer::status() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    std::ostringstream out;
+    out << "{\"running\": " << this->running
+        << ", \"queued\": " << this->queue.size()
+        << ", \"completed\": " << this->completed
+        << ", \"cores\": " << this->cores
+        << ", \"free_cores\": " << this->free_cores
+        << ", \"used_memory\": " << this->used_memory << "}";
+    return out.str();
+}
+
+/**
+ * @brief      Stop accepting jobs, finish the queued jobs and stop the worker threads
+ */
+void JobServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->stopping = true;
+    }
+    this->cv.notify_all();
+
+    for(std::thread& worker : this->workers) {
+        if(worker.joinable()) {
+            worker.join();
+        }
+    }
+    this->workers.clear();
+}
+
+/**
+ * @brief      Split a line into arguments at whitespace, honouring quotes and backslashes
+ *
+ * @param[in]  line  The line
+ *
+ * @return     arguments
+ */
+std::vector<std::string> JobServer::split_arguments(const std::string& line) {
+    std::vector<std::string> args;
+    std::string arg;
+    bool in_arg = false;
+    char quote = 0;
+
+    for(size_t i=0; i<line.size(); i++) {
+        const char c = line[i];
+        if(quote != 0) {
+            if(c == quote) {
+                quote = 0;
+            } else if(c == '\\' && quote == '"' && i + 1 < line.size()) {
+                arg += line[++i];
+            } else {
+                arg += c;
+            }
+        } else if(c == '\'' || c == '"') {
+            quote = c;
+            in_arg = true;
+        } else if(c == '\\' && i + 1 < line.size()) {
+            arg += line[++i];
+            in_arg = true;
+        } else if(std::isspace((unsigned char)c)) {
+            if(in_arg) {
+                args.push_back(arg);
+                arg.clear();
+                in_arg = false;
+            }
+        } else {
+            arg += c;
+            in_arg = true;
+        }
+    }
+
+    if(quote != 0) {
+        throw std::runtime_error("Unterminated quote in: " + line);
+    }
+    if(in_arg) {
+        args.push_back(arg);
+    }
+
+    return args;
+}
+
+/**
+ * @brief      Admit and run jobs until the server stops
+ */
+void JobServer::work() {
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mtx);
+
+            // first come, first served: a large job is not overtaken by smaller ones
+            this->cv.wait(lock, [this]() {
+                if(this->queue.empty()) {
+                    return this->stopping;
+                }
+                const Job& next = this->queue.front();
+                return next.threads <= this->free_cores &&
+                       (this->memory == 0 || this->running == 0 || this->used_memory + next.bytes <= this->memory);
+            });
+            if(this->queue.empty()) {
+                return;
+            }
+
+            job = std::move(this->queue.front());
+            this->queue.pop_front();
+            this->free_cores -= job.threads;
+            this->used_memory += job.bytes;
+            this->running++;
+        }
+
+        Report report;
+        report.id = job.id;
+        report.threads = job.threads;
+        const auto start = std::chrono::steady_clock::now();
+        report.queued = std::chrono::duration<double>(start - job.submitted).count();
+
+        // the team of this thread is kept alive by OpenMP in between the jobs
+        omp_set_num_threads(job.threads);
+
+        // every job starts from the same random numbers as a separate process
+        ReactionSystem::reset_random();
+
+        std::ostringstream err;
+        try {
+            report.exit_code = this->runner(job.args, err);
+        } catch(const std::exception& e) {
+            err << "error: " << e.what() << std::endl;
+            report.exit_code = -1;
+        }
+        report.error = err.str();
+        while(!report.error.empty() && std::isspace((unsigned char)report.error.back())) {
+            report.error.pop_back();
+        }
+        report.runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->free_cores += job.threads;
+            this->used_memory -= job.bytes;
+            this->running--;
+            this->completed++;
+        }
+        this->cv.notify_all();
+
+        std::ostringstream msg;
+        msg << "Job " << report.id << (report.exit_code == 0 ? " finished" : " failed") << " in "
+            << report.runtime << " seconds on " << report.threads << " threads (queued for "
+            << report.queued << " seconds).";
+        log(msg.str());
+
+        try {
+            job.done(report);
+        } catch(const std::exception& e) {
+            log("Cannot report job " + std::to_string(report.id) + ": " + e.what());
+        }
+    }
+}
+
+/**
+ * @brief      Estimate the threads and memory of a job from its grid size
+ *
+ * @param      job   The job
+ */
+void JobServer::estimate(Job& job) const {
+    size_t width = 1, height = 1, depth = 1, steps = 1, nr_species = 2;
+    for(size_t i=1; i+1<job.args.size(); i++) {
+        const std::string& key = job.args[i];
+        const std::string& value = job.args[i+1];
+        try {
+            if(key == "--width") {
+                width = std::stoul(value);
+            } else if(key == "--height") {
+                height = std::stoul(value);
+            } else if(key == "--depth") {
+                depth = std::stoul(value);
+            } else if(key == "--steps") {
+                steps = std::stoul(value);
+            } else if(key == "--diffusion") {
+                nr_species = std::count(value.begin(), value.end(), ',') + 1;
+            }
+        } catch(const std::exception&) {
+            // the job itself reports the invalid value
+        }
+    }
+
+    const size_t cells = std::max((size_t)1, width * height * std::max((size_t)1, depth));
+    const size_t threads = (cells + this->cells_per_thread - 1) / this->cells_per_thread;
+    job.threads = (unsigned int)std::min((size_t)this->cores, std::max((size_t)1, threads));
+
+    // all frames are kept until the end of the integration, plus the working buffers
+    job.bytes = cells * nr_species * sizeof(double) * (steps + 4);
+}
+
+/**
+ * @brief      Accept jobs on a Unix domain socket until a shutdown is requested
+ *
+ * @param[in]  path  path of the socket
+ * @param      quit  set on a shutdown request
+ */
+void JobServer::serve_socket(const std::string& path, std::atomic<bool>& quit) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // remove the socket of a previous server, but nothing else
+    struct stat st;
+    if(::stat(path.c_str(), &st) == 0) {
+        if(!S_ISSOCK(st.st_mode)) {
+            throw std::runtime_error(path + " exists and is not a socket");
+        }
+        ::unlink(path.c_str());
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        throw std::runtime_error("Cannot create socket: " + std::string(std::strerror(errno)));
+    }
+    if(::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Cannot listen on " + path + ": " + reason);
+    }
+    log("Listening on " + path + ".");
+
+    std::mutex conn_mtx;
+    std::condition_variable conn_cv;
+    unsigned int connections = 0;
+
+    while(!quit) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if(::poll(&pfd, 1, 200) <= 0) {
+            continue;   // timeout or interrupted by a signal
+        }
+        const int client = ::accept(fd, nullptr, nullptr);
+        if(client < 0) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(conn_mtx);
+            connections++;
+        }
+
+        // every connection waits for its own job
+        std::thread([this, client, &quit, &conn_mtx, &conn_cv, &connections]() {
+            struct timeval timeout = {10, 0};
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            std::string line;
+            char buffer[4096];
+            while(line.find('\n') == std::string::npos && line.size() < 65536) {
+                const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+                if(n <= 0) {
+                    break;
+                }
+                line.append(buffer, n);
+            }
+            line = line.substr(0, line.find('\n'));
+            while(!line.empty() && std::isspace((unsigned char)line.back())) {
+                line.pop_back();
+            }
+
+            try {
+                if(line == "SHUTDOWN") {
+                    quit = true;
+                    send_all(client, "{\"status\": \"shutting down\"}\n");
+                } else if(line == "STATUS") {
+                    send_all(client, this->status() + "\n");
+                } else if(!line.empty()) {
+                    std::promise<Report> promise;
+                    std::future<Report> future = promise.get_future();
+                    this->submit(split_arguments(line), [&promise](const Report& report) {
+                        promise.set_value(report);
+                    });
+                    send_all(client, future.get().to_json() + "\n");
+                }
+            } catch(const std::exception& e) {
+                send_all(client, "{\"status\": \"rejected\", \"error\": " + OutputMetadata::encode(std::string(e.what())) + "}\n");
+            }
+            ::close(client);
+
+            std::lock_guard<std::mutex> lock(conn_mtx);
+            connections--;
+            conn_cv.notify_all();
+        }).detach();
+    }
+
+    ::close(fd);
+
+    // the clients of the running and queued jobs still receive their reports
+    std::unique_lock<std::mutex> lock(conn_mtx);
+    conn_cv.wait(lock, [&connections]() { return connections == 0; });
+    ::unlink(path.c_str());
+}
+
+/**
+ * @brief      Claim jobs from a spool directory until a shutdown is requested
+ *
+ * A job <name>.job is claimed by renaming it to <name>.job.running, such
+ * that several servers can share a directory. Once the job has finished,
+ * its report is written to <name>.report.json and the job is renamed to
+ * <name>.job.done or <name>.job.failed.
+ *
+ * @param[in]  dir   spool directory
+ * @param      quit  set on a shutdown request
+ */
+void JobServer::serve_spool(const std::string& dir, std::atomic<bool>& quit) {
+    namespace fs = std::filesystem;
+    if(!fs::is_directory(dir)) {
+        throw std::runtime_error("Spool directory does not exist: " + dir);
+    }
+    log("Watching " + dir + " for jobs.");
+
+    while(!quit) {
+        std::vector<fs::path> files;
+        for(const fs::directory_entry& entry : fs::directory_iterator(dir)) {
+            if(entry.is_regular_file() && entry.path().extension() == ".job") {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        for(const fs::path& file : files) {
+            fs::path claimed = file;
+            claimed += ".running";
+            std::error_code ec;
+            fs::rename(file, claimed, ec);
+            if(ec) {
+                continue;   // claimed by another server
+            }
+
+            const fs::path stem = fs::path(file).replace_extension("");
+            auto done = [claimed, stem](const Report& report) {
+                write_atomically(stem.string() + ".report.json", report.to_json() + "\n");
+                fs::rename(claimed, stem.string() + (report.exit_code == 0 ? ".job.done" : ".job.failed"));
+            };
+
+            try {
+                std::ifstream in(claimed);
+                std::stringstream content;
+                content << in.rdbuf();
+                this->submit(split_arguments(content.str()), done);
+            } catch(const std::exception& e) {
+                Report report;
+                report.error = std::string("error: ") + e.what();
+                done(report);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
+/**
+ * @brief      Entry point of turing serve
+ *
+ * @param[in]  args    command line, starting with "serve"
+ * @param[in]  runner  runs a single job
+ *
+ * @return     exit code
+ */
+int JobServer::main(const std::vector<std::string>& args, const Runner& runner) {
+    try {
+        TCLAP::CmdLine cmd("Run Turing simulations submitted to a local job server.", ' ', PROGRAM_VERSION);
+
+        TCLAP::ValueArg<std::string> arg_socket("","socket","Unix domain socket accepting one job per connection", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_spool("","spool","directory that is watched for <name>.job files", false, "", "string");
+        TCLAP::ValueArg<int> arg_cores("","cores","number of cores shared by the jobs (default: all)", false, omp_get_max_threads(), "int");
+        TCLAP::ValueArg<int> arg_memory("","memory","estimated memory shared by the jobs in MiB (0 = unlimited)", false, 0, "int");
+        TCLAP::ValueArg<int> arg_cells("","cells-per-thread","grid points per OpenMP thread of a job", false, 65536, "int");
+        TCLAP::SwitchArg arg_verbose("","verbose","show the output of the jobs", false);
+        cmd.add(arg_socket);
+        cmd.add(arg_spool);
+        cmd.add(arg_cores);
+        cmd.add(arg_memory);
+        cmd.add(arg_cells);
+        cmd.add(arg_verbose);
+
+        std::vector<std::string> cmdargs(args);
+        cmdargs[0] = "turing serve";
+        cmd.parse(cmdargs);
+
+        if(arg_socket.getValue().empty() && arg_spool.getValue().empty()) {
+            throw std::runtime_error("Specify a socket (--socket) and/or a spool directory (--spool)");
+        }
+        if(arg_cores.getValue() < 1) {
+            throw std::runtime_error("Invalid number of cores: " + std::to_string(arg_cores.getValue()));
+        }
+        if(arg_memory.getValue() < 0) {
+            throw std::runtime_error("Invalid memory budget: " + std::to_string(arg_memory.getValue()));
+        }
+        if(arg_cells.getValue() < 1) {
+            throw std::runtime_error("Invalid number of grid points per thread: " + std::to_string(arg_cells.getValue()));
+        }
+        const size_t memory = (size_t)arg_memory.getValue() * 1024 * 1024;
+
+#ifdef __GLIBC__
+        // keep the fields of finished jobs in the heap of their worker, such
+        // that the next job recycles them instead of faulting in fresh pages
+        mallopt(M_MMAP_THRESHOLD, 32 * 1024 * 1024);
+        mallopt(M_TRIM_THRESHOLD, (int)std::min(memory > 0 ? memory : (size_t)1 << 30, (size_t)INT_MAX));
+#endif
+
+        // the jobs report their errors to the client, the server logs to std::clog
+        NullBuffer null_buffer;
+        std::streambuf* cout_buffer = std::cout.rdbuf();
+        std::streambuf* cerr_buffer = std::cerr.rdbuf();
+        if(!arg_verbose.getValue()) {
+            std::cout.rdbuf(&null_buffer);
+            std::cerr.rdbuf(&null_buffer);
+        }
+
+        shutdown_requested = false;
+        std::signal(SIGINT, request_shutdown);
+        std::signal(SIGTERM, request_shutdown);
+
+        JobServer server(runner, arg_cores.getValue(), memory, arg_cells.getValue());
+        std::ostringstream msg;
+        msg << "Turing " << PROGRAM_VERSION << " serving jobs on " << arg_cores.getValue() << " cores.";
+        log(msg.str());
+
+        std::exception_ptr error;
+        std::thread spool;
+        if(!arg_spool.getValue().empty()) {
+            spool = std::thread([&]() {
+                try {
+                    server.serve_spool(arg_spool.getValue(), shutdown_requested);
+                } catch(...) {
+                    error = std::current_exception();
+                    shutdown_requested = true;
+                }
+            });
+        }
+
+        try {
+            if(!arg_socket.getValue().empty()) {
+                server.serve_socket(arg_socket.getValue(), shutdown_requested);
+            } else {
+                while(!shutdown_requested) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                }
+            }
+        } catch(...) {
+            error = std::current_exception();
+            shutdown_requested = true;
+        }
+        if(spool.joinable()) {
+            spool.join();
+        }
+
+        log("Shutting down, finishing the remaining jobs.");
+        server.stop();
+
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        std::cout.rdbuf(cout_buffer);
+        std::cerr.rdbuf(cerr_buffer);
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+        return 0;
+
+    } catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() <<
+                     " for arg " << e.argId() << std::endl;
+        return -1;
+    } catch (std::exception &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,196 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief      Runs simulations submitted by local clients on a warm pool of threads
+ *
+ * A job is a command line of turing without the program name. Jobs arrive
+ * through a Unix domain socket, as a single line per connection which is
+ * answered with a one-line JSON report once the job has finished, or as
+ * files <name>.job in a spool directory, which are answered with a file
+ * <name>.report.json. A connection may also send STATUS or SHUTDOWN.
+ *
+ * The worker threads live as long as the server, such that their OpenMP
+ * teams and heap arenas are reused by every job they run. Every job is
+ * assigned a number of OpenMP threads based on its grid size and is
+ * admitted, in the order of submission, once that many cores (and, when a
+ * budget is set, its estimated memory) are available.
+ */
+class JobServer {
+public:
+    /**
+     * @brief      Runs a single job and returns its exit code, writing any errors to the stream
+     */
+    typedef std::function<int(const std::vector<std::string>&, std::ostream&)> Runner;
+
+    /**
+     * @brief      Outcome of a job
+     */
+    struct Report {
+        unsigned int id = 0;        //!< job number
+        int exit_code = -1;         //!< exit code of the simulation
+        unsigned int threads = 0;   //!< OpenMP threads assigned to the job
+        double queued = 0.0;        //!< seconds spent waiting for admission
+        double runtime = 0.0;       //!< seconds spent running
+        std::string error;          //!< error messages of the simulation
+
+        /**
+         * @brief      Encode the report as a single line of JSON
+         *
+         * @return     JSON representation
+         */
+        std::string to_json() const;
+    };
+
+    /**
+     * @brief      Receives the report of a finished job (on the worker thread)
+     */
+    typedef std::function<void(const Report&)> Callback;
+
+private:
+    /**
+     * @brief      Submitted job
+     */
+    struct Job {
+        unsigned int id;                                        //!< job number
+        std::vector<std::string> args;                          //!< command line, starting with the program name
+        unsigned int threads;                                   //!< OpenMP threads
+        size_t bytes;                                           //!< estimated memory
+        std::chrono::steady_clock::time_point submitted;        //!< time of submission
+        Callback done;                                          //!< receives the report
+    };
+
+    Runner runner;                      //!< runs a single job
+    unsigned int cores;                 //!< number of cores shared by the jobs
+    size_t memory;                      //!< memory shared by the jobs in bytes (0 = unlimited)
+    size_t cells_per_thread;            //!< grid points per OpenMP thread of a job
+
+    std::vector<std::thread> workers;   //!< warm pool of worker threads
+    std::deque<Job> queue;              //!< jobs waiting for admission
+    std::mutex mtx;                     //!< guards the queue and the resources
+    std::condition_variable cv;         //!< signals submissions and released resources
+    unsigned int free_cores;            //!< cores not used by running jobs
+    size_t used_memory;                 //!< estimated memory of the running jobs
+    unsigned int running;               //!< number of running jobs
+    unsigned int completed;             //!< number of finished jobs
+    unsigned int next_id;               //!< number of the next job
+    bool stopping;                      //!< no more jobs are accepted
+
+public:
+    /**
+     * @brief      Constructs the object and starts the worker threads
+     *
+     * @param[in]  _runner            runs a single job
+     * @param[in]  _cores             number of cores shared by the jobs
+     * @param[in]  _memory            memory shared by the jobs in bytes (0 = unlimited)
+     * @param[in]  _cells_per_thread  grid points per OpenMP thread of a job
+     */
+    JobServer(const Runner& _runner, unsigned int _cores, size_t _memory, size_t _cells_per_thread);
+
+    /**
+     * @brief      Finishes the queued jobs and stops the worker threads
+     */
+    ~JobServer();
+
+    /**
+     * @brief      Submit a job
+     *
+     * @param[in]  args  command line without the program name
+     * @param[in]  done  receives the report once the job has finished
+     *
+     * @return     job number
+     */
+    unsigned int submit(const std::vector<std::string>& args, const Callback& done);
+
+    /**
+     * @brief      Get the state of the server as a single line of JSON
+     *
+     * @return     JSON representation
+     */
+    std::string status();
+
+    /**
+     * @brief      Stop accepting jobs, finish the queued jobs and stop the worker threads
+     */
+    void stop();
+
+    /**
+     * @brief      Split a line into arguments at whitespace, honouring quotes and backslashes
+     *
+     * @param[in]  line  The line
+     *
+     * @return     arguments
+     */
+    static std::vector<std::string> split_arguments(const std::string& line);
+
+    /**
+     * @brief      Entry point of turing serve
+     *
+     * @param[in]  args    command line, starting with "serve"
+     * @param[in]  runner  runs a single job
+     *
+     * @return     exit code
+     */
+    static int main(const std::vector<std::string>& args, const Runner& runner);
+
+private:
+    /**
+     * @brief      Admit and run jobs until the server stops
+     */
+    void work();
+
+    /**
+     * @brief      Estimate the threads and memory of a job from its grid size
+     *
+     * @param      job   The job
+     */
+    void estimate(Job& job) const;
+
+    /**
+     * @brief      Accept jobs on a Unix domain socket until a shutdown is requested
+     *
+     * @param[in]  path  path of the socket
+     * @param      quit  set on a shutdown request
+     */
+    void serve_socket(const std::string& path, std::atomic<bool>& quit);
+
+    /**
+     * @brief      Claim jobs from a spool directory until a shutdown is requested
+     *
+     * @param[in]  dir   spool directory
+     * @param      quit  set on a shutdown request
+     */
+    void serve_spool(const std::string& dir, std::atomic<bool>& quit);
+};
@@ -0,0 +1,276 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "laplacian.h"
+
+/**
+ * @brief      Calculate Laplacian on a block using periodic boundary conditions
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block_pbc(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                         unsigned int i0, unsigned int i1,
+                         unsigned int j0, unsigned int j1) {
+    const unsigned int rows = c.rows();
+    const unsigned int cols = c.cols();
+
+    const double idx2 = 1.0 / (dx * dx);
+
+    // data is stored column-major; loop over the columns and let the
+    // inner loop run over contiguous memory
+    for(unsigned int j=j0; j<j1; j++) {
+        const unsigned int jl = (j == 0) ? cols - 1 : j - 1;
+        const unsigned int jr = (j == cols - 1) ? 0 : j + 1;
+
+        const double* cc = &c(0, j);
+        const double* cl = &c(0, jl);
+        const double* cr = &c(0, jr);
+        double* d = &delta_c(0, j);
+
+        unsigned int ib = i0;
+        unsigned int ie = i1;
+
+        // rows at the edge of the system wrap around
+        if(ib == 0) {
+            const unsigned int iu = rows - 1;
+            const unsigned int id = (rows > 1) ? 1 : 0;
+            d[0] = (-4.0 * cc[0] + cc[iu] + cc[id] + cl[0] + cr[0]) * idx2;
+            ib = 1;
+        }
+        if(ie == rows && ib < ie) {
+            const unsigned int i = rows - 1;
+            d[i] = (-4.0 * cc[i] + cc[i-1] + cc[0] + cl[i] + cr[i]) * idx2;
+            ie = rows - 1;
+        }
+
+        for(unsigned int i=ib; i<ie; i++) {
+            d[i] = (-4.0 * cc[i] + cc[i-1] + cc[i+1] + cl[i] + cr[i]) * idx2;
+        }
+    }
+}
+
+/**
+ * @brief      Calculate Laplacian on a block using zero-flux boundaries
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block_zeroflux(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                              unsigned int i0, unsigned int i1,
+                              unsigned int j0, unsigned int j1) {
+    const unsigned int rows = c.rows();
+    const unsigned int cols = c.cols();
+
+    const double idx2 = 1.0 / (dx * dx);
+
+    for(unsigned int j=j0; j<j1; j++) {
+        const bool first = (j == 0);
+        const bool last = (j == cols - 1);
+
+        const double* cc = &c(0, j);
+        const double* cl = first ? cc : &c(0, j-1);
+        const double* cr = last ? cc : &c(0, j+1);
+        double* d = &delta_c(0, j);
+
+        // second derivative along the columns; at the edges only the flux
+        // towards the interior remains
+        auto ddy = [&](unsigned int i) {
+            if(first && last) {
+                return 0.0;
+            } else if(first) {
+                return cr[i] - cc[i];
+            } else if(last) {
+                return cl[i] - cc[i];
+            } else {
+                return (-2.0 * cc[i] + cl[i] + cr[i]);
+            }
+        };
+
+        unsigned int ib = i0;
+        unsigned int ie = i1;
+
+        if(ib == 0) {
+            const double ddx = (rows > 1) ? cc[1] - cc[0] : 0.0;
+            d[0] = (ddx + ddy(0)) * idx2;
+            ib = 1;
+        }
+        if(ie == rows && ib < ie) {
+            const unsigned int i = rows - 1;
+            const double ddx = cc[i-1] - cc[i];
+            d[i] = (ddx + ddy(i)) * idx2;
+            ie = rows - 1;
+        }
+
+        for(unsigned int i=ib; i<ie; i++) {
+            const double ddx = (-2.0 * cc[i] + cc[i-1] + cc[i+1]);
+            d[i] = (ddx + ddy(i)) * idx2;
+        }
+    }
+}
+
+/**
+ * @brief      Index of a neighbour, taking the boundary conditions into account
+ *
+ * @param[in]  i     index of the neighbour (may lie outside of the system)
+ * @param[in]  n     number of grid points along the axis
+ * @param[in]  pbc   whether to use periodic boundary conditions
+ *
+ * @return     index inside the system
+ */
+static inline unsigned int neighbour_index(int i, int n, bool pbc) {
+    if(pbc) {
+        return ((i % n) + n) % n;
+    }
+
+    // mirror in the cell faces at the edges
+    while(i < 0 || i >= n) {
+        i = (i < 0) ? -i - 1 : 2 * n - i - 1;
+    }
+    return i;
+}
+
+/**
+ * @brief      Calculate Laplacian on a block using the isotropic nine-point stencil
+ *
+ * The weights are 2/3 for the nearest neighbours, 1/6 for the diagonal
+ * neighbours and -10/3 for the center, for which the leading error term is
+ * proportional to the biharmonic operator and hence rotationally invariant.
+ *
+ * See: Patra, M. & Karttunen, M. Numer. Methods Partial Differ. Equ. 22 (2006) 936-953
+ */
+static void laplacian_block_9point(MatrixXXd& delta_c, const MatrixXXd& c, double dx, bool pbc,
+                                   unsigned int i0, unsigned int i1,
+                                   unsigned int j0, unsigned int j1) {
+    const int rows = c.rows();
+    const int cols = c.cols();
+
+    const double idx2 = 1.0 / (dx * dx);
+    const double w1 = 2.0 / 3.0 * idx2;
+    const double w2 = 1.0 / 6.0 * idx2;
+    const double w0 = -10.0 / 3.0 * idx2;
+
+    for(int j=j0; j<(int)j1; j++) {
+        const double* cc = &c(0, j);
+        const double* cl = &c(0, neighbour_index(j-1, cols, pbc));
+        const double* cr = &c(0, neighbour_index(j+1, cols, pbc));
+        double* d = &delta_c(0, j);
+
+        auto cell = [&](int i, int iu, int id) {
+            d[i] = w0 * cc[i] + w1 * (cc[iu] + cc[id] + cl[i] + cr[i]) +
+                   w2 * (cl[iu] + cl[id] + cr[iu] + cr[id]);
+        };
+
+        for(int i=i0; i<(int)i1; i++) {
+            if(i >= 1 && i < rows - 1) {
+                cell(i, i-1, i+1);
+            } else {
+                cell(i, neighbour_index(i-1, rows, pbc), neighbour_index(i+1, rows, pbc));
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate Laplacian on a block using the fourth-order thirteen-point stencil
+ *
+ * Along every axis the weights are -1/12, 4/3, -5/2, 4/3, -1/12. Of the
+ * thirteen points within a distance of two cells, fourth-order accuracy
+ * requires the weights of the diagonal neighbours to vanish.
+ */
+static void laplacian_block_13point(MatrixXXd& delta_c, const MatrixXXd& c, double dx, bool pbc,
+                                    unsigned int i0, unsigned int i1,
+                                    unsigned int j0, unsigned int j1) {
+    const int rows = c.rows();
+    const int cols = c.cols();
+
+    const double idx2 = 1.0 / (dx * dx);
+    const double w1 = 4.0 / 3.0 * idx2;
+    const double w2 = -1.0 / 12.0 * idx2;
+    const double w0 = -5.0 * idx2;
+
+    for(int j=j0; j<(int)j1; j++) {
+        const double* cc = &c(0, j);
+        const double* cl = &c(0, neighbour_index(j-1, cols, pbc));
+        const double* cr = &c(0, neighbour_index(j+1, cols, pbc));
+        const double* cll = &c(0, neighbour_index(j-2, cols, pbc));
+        const double* crr = &c(0, neighbour_index(j+2, cols, pbc));
+        double* d = &delta_c(0, j);
+
+        auto cell = [&](int i, int iuu, int iu, int id, int idd) {
+            d[i] = w0 * cc[i] + w1 * (cc[iu] + cc[id] + cl[i] + cr[i]) +
+                   w2 * (cc[iuu] + cc[idd] + cll[i] + crr[i]);
+        };
+
+        for(int i=i0; i<(int)i1; i++) {
+            if(i >= 2 && i < rows - 2) {
+                cell(i, i-2, i-1, i+1, i+2);
+            } else {
+                cell(i, neighbour_index(i-2, rows, pbc), neighbour_index(i-1, rows, pbc),
+                     neighbour_index(i+1, rows, pbc), neighbour_index(i+2, rows, pbc));
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Calculate Laplacian on a block using any of the stencils
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  stencil  finite difference stencil
+ * @param[in]  pbc      whether to use periodic boundary conditions
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                     LaplacianStencil stencil, bool pbc,
+                     unsigned int i0, unsigned int i1,
+                     unsigned int j0, unsigned int j1) {
+    switch(stencil) {
+        case STENCIL_5POINT:
+            if(pbc) {
+                laplacian_block_pbc(delta_c, c, dx, i0, i1, j0, j1);
+            } else {
+                laplacian_block_zeroflux(delta_c, c, dx, i0, i1, j0, j1);
+            }
+            break;
+        case STENCIL_9POINT:
+            laplacian_block_9point(delta_c, c, dx, pbc, i0, i1, j0, j1);
+            break;
+        case STENCIL_13POINT:
+            laplacian_block_13point(delta_c, c, dx, pbc, i0, i1, j0, j1);
+            break;
+    }
+}
@@ -0,0 +1,95 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+/*
+ * Finite difference Laplacians evaluated on a rectangular block of the grid.
+ *
+ * The block spans rows [i0,i1) and columns [j0,j1). Values outside of the
+ * block are read from the full matrix, such that a grid can be processed
+ * block-by-block (e.g. per thread or per tile). Only the block of delta_c is
+ * written to.
+ */
+
+/**
+ * @brief      Finite difference stencils for the Laplacian
+ */
+enum LaplacianStencil {
+    STENCIL_5POINT = 5,     //!< second-order, five-point
+    STENCIL_9POINT = 9,     //!< second-order, isotropic nine-point (Patra-Karttunen)
+    STENCIL_13POINT = 13    //!< fourth-order, thirteen-point
+};
+
+/**
+ * @brief      Calculate Laplacian on a block using periodic boundary conditions
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block_pbc(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                         unsigned int i0, unsigned int i1,
+                         unsigned int j0, unsigned int j1);
+
+/**
+ * @brief      Calculate Laplacian on a block using zero-flux boundaries
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block_zeroflux(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                              unsigned int i0, unsigned int i1,
+                              unsigned int j0, unsigned int j1);
+
+/**
+ * @brief      Calculate Laplacian on a block using any of the stencils
+ *
+ * For zero-flux boundaries, the concentrations are mirrored in the cell
+ * faces at the edge of the system, which for the five-point stencil is
+ * identical to laplacian_block_zeroflux().
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param[in]  c        Current concentration matrix
+ * @param[in]  dx       size of the space interval
+ * @param[in]  stencil  finite difference stencil
+ * @param[in]  pbc      whether to use periodic boundary conditions
+ * @param[in]  i0       first row of the block
+ * @param[in]  i1       last row (exclusive) of the block
+ * @param[in]  j0       first column of the block
+ * @param[in]  j1       last column (exclusive) of the block
+ */
+void laplacian_block(MatrixXXd& delta_c, const MatrixXXd& c, double dx,
+                     LaplacianStencil stencil, bool pbc,
+                     unsigned int i0, unsigned int i1,
+                     unsigned int j0, unsigned int j1);
@@ -25,51 +25,136 @@
 
 #include "config.h"
 #include "two_dim_rd.h"
-#include "reaction_fitzhugh_nagumo.h"
-#include "reaction_gray_scott.h"
-#include "reaction_lotka_volterra.h"
-#include "reaction_gierer_meinhardt.h"
-#include "reaction_brusselator.h"
-#include "reaction_barkley.h"
+#include "amr_rd.h"
+#include "three_dim_rd.h"
+#include "n_species_rd.h"
+#include "reaction_registry.h"
+#include "job_server.h"
 
-int main(int argc, char* argv[]) {
+/**
+ * @brief      Perform a single simulation
+ *
+ * @param[in]  args    command line arguments, starting with the program name
+ * @param[in]  served  whether the simulation runs as a job of a JobServer
+ * @param      err     stream receiving the error messages
+ *
+ * @return     exit code
+ */
+static int run_simulation(std::vector<std::string> args, bool served, std::ostream& err) {
     try {
         TCLAP::CmdLine cmd("Perform Turing simulation.", ' ', PROGRAM_VERSION);
+        cmd.setExceptionHandling(!served);
 
         // input filename
-        TCLAP::ValueArg<double> arg_da("","Da","Diffusion coefficicient of compound A", true, 1, "double");
-        TCLAP::ValueArg<double> arg_db("","Db","Diffusion coefficicient of compound B", true, 100, "double");
+        TCLAP::ValueArg<double> arg_da("","Da","Diffusion coefficicient of compound A (required unless --diffusion is given)", false, 1, "double");
+        TCLAP::ValueArg<double> arg_db("","Db","Diffusion coefficicient of compound B (required unless --diffusion is given)", false, 100, "double");
+        TCLAP::ValueArg<std::string> arg_diffusion_field("","diffusion-field","spatially varying or anisotropic medium, e.g. \"layers;n=4;low=0.2;high=1\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_mask("","mask","irregular domain given by a PGM image, e.g. \"path=shape.pgm;threshold=0.5\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_diffusion("","diffusion","comma-separated diffusion coefficients per species (instead of Da and Db)", false, "", "string");
         TCLAP::ValueArg<double> arg_dx("","dx","size of the space interval", true, 1.0, "double");
         TCLAP::ValueArg<double> arg_dt("","dt","size of the time interval", true, 0.001, "double");
         TCLAP::ValueArg<int> arg_width("","width","width of the system", true, 100, "int");
         TCLAP::ValueArg<int> arg_height("","height","height of the system", true, 100, "int");
+        TCLAP::ValueArg<int> arg_depth("","depth","depth of the system (1 = two-dimensional)", false, 1, "int");
         TCLAP::ValueArg<int> arg_steps("","steps","number of steps to integrate", true, 150, "int");
         TCLAP::ValueArg<int> arg_tsteps("","tsteps","number of steps when output should be written", true, 100, "int");
         TCLAP::ValueArg<std::string> arg_outfile("","outfile","file to write output to", true, "results.dat", "string");
+        TCLAP::ValueArg<std::string> arg_render("","render","render frames while integrating, e.g. \"format=png;range=0:1,0:1\" or \"format=y4m\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_output_spec("","output-spec","fields, region, downsampling and cadence of the output, e.g. \"fields=A;stride=4;filter=box\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_analysis("","analysis","statistics, histograms and power spectra of the frames, e.g. \"fields=A;bins=64\" (written to <outfile>.analysis.json)", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_features("","features","spots and spiral tips per frame, e.g. \"spots=A>0.5\" or \"tips=A:0.5,B:0.3\" (written to <outfile>.features.json)", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_probes("","probes","time series at points and transects, e.g. \"points=32:32;lines=0:32-63:32;every=10\" (written to <outfile>.probes.bin)", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_continuation("","continuation","scan a parameter starting every case from the previous steady state, e.g. \"param=f;from=0.02;to=0.07;n=26;backward=1\" (written to <outfile>.continuation.json)", false, "", "string");
+        TCLAP::MultiArg<std::string> arg_branch("","branch","parameters of a branch that continues after the shared frames (can be given multiple times)", false, "string");
+        TCLAP::ValueArg<int> arg_branch_frame("","branch-frame","number of frames shared by the branches", false, 0, "int");
+        TCLAP::ValueArg<std::string> arg_spin_up("","spin-up","spin up the pattern on coarser grids until its wavelength is stable, e.g. \"levels=2;tol=0.02\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_split_reaction("","split-reaction","split every time step into reaction and diffusion and sub-cycle the reaction terms per grid point, e.g. \"method=rk23;rtol=1e-3\"", false, "", "string");
+        TCLAP::ValueArg<std::string> arg_metrics("","metrics","status file rewritten while integrating (Prometheus text format for .prom, JSON otherwise)", false, "", "string");
+        TCLAP::ValueArg<double> arg_metrics_interval("","metrics-interval","seconds between two updates of the status file", false, 10.0, "double");
+        TCLAP::SwitchArg arg_no_progress("", "no-progress", "do not show a progress bar", false);
+        TCLAP::ValueArg<int> arg_chunk_size("","chunk-size","store the output as square chunks of this size for fast region reads (0 = contiguous frames)", false, 0, "int");
+        TCLAP::ValueArg<int> arg_compress("","compress","zlib compression level of the chunks (0-9, 0 = uncompressed)", false, 0, "int");
+        TCLAP::ValueArg<std::string> arg_quantize("","quantize","quantize the chunks for visualization, e.g. \"bits=8;range=frame;error=1e-3\"", false, "", "string");
         TCLAP::ValueArg<std::string> arg_reaction("","reaction","which reaction system to employ", true, "lotka-volterra", "string");
+        TCLAP::MultiArg<std::string> arg_plugins("","reaction-plugin","shared library providing a reaction system (can be given multiple times)", false, "string");
         TCLAP::ValueArg<std::string> arg_params("","parameters","model parameters to use", true, "alpha=1;beta=2;gamma=3;delta=4", "string");
         TCLAP::SwitchArg arg_pbc("", "pbc", "periodic boundary conditions", false);
+        TCLAP::ValueArg<int> arg_stencil("","stencil","stencil of the Laplacian: 5 (second order), 9 (isotropic) or 13 (fourth order)", false, 5, "int");
+        TCLAP::ValueArg<double> arg_steady_tol("","steady-tol","stop when max|dc/dt| stays below this tolerance (0 = disabled)", false, 0.0, "double");
+        TCLAP::ValueArg<int> arg_steady_frames("","steady-frames","number of consecutive frames required for a steady state", false, 3, "int");
+        TCLAP::SwitchArg arg_periodic("", "periodic", "also detect periodic (oscillating) steady states", false);
+        TCLAP::ValueArg<int> arg_tile_size("","tile-size","skip tiles of this size that are at rest (0 = disabled)", false, 0, "int");
+        TCLAP::ValueArg<double> arg_tile_tol("","tile-tol","max|dc| per time step below which a tile is at rest", false, 1e-10, "double");
+        TCLAP::ValueArg<double> arg_periodic_tol("","periodic-tol","relative tolerance on period and amplitude of periodic states", false, 1e-3, "double");
+        TCLAP::ValueArg<int> arg_amr_levels("","amr-levels","number of adaptive refinement levels (0 = uniform grid)", false, 0, "int");
+        TCLAP::ValueArg<int> arg_amr_block("","amr-block","number of cells along the edge of an adaptive block", false, 16, "int");
+        TCLAP::ValueArg<double> arg_amr_tol("","amr-tol","refine blocks where a jump between cells exceeds this value", false, 0.05, "double");
+        TCLAP::SwitchArg arg_amr_subcycle("", "amr-subcycle", "let coarser levels take larger time steps", false);
+        TCLAP::ValueArg<int> arg_amr_regrid("","amr-regrid","number of time steps between regrids", false, 100, "int");
 
         cmd.add(arg_da);
         cmd.add(arg_db);
+        cmd.add(arg_diffusion);
+        cmd.add(arg_diffusion_field);
+        cmd.add(arg_mask);
         cmd.add(arg_dx);
         cmd.add(arg_dt);
         cmd.add(arg_width);
         cmd.add(arg_height);
+        cmd.add(arg_depth);
         cmd.add(arg_steps);
         cmd.add(arg_tsteps);
         cmd.add(arg_outfile);
+        cmd.add(arg_output_spec);
+        cmd.add(arg_render);
+        cmd.add(arg_analysis);
+        cmd.add(arg_features);
+        cmd.add(arg_probes);
+        cmd.add(arg_continuation);
+        cmd.add(arg_branch);
+        cmd.add(arg_branch_frame);
+        cmd.add(arg_spin_up);
+        cmd.add(arg_split_reaction);
+        cmd.add(arg_metrics);
+        cmd.add(arg_metrics_interval);
+        cmd.add(arg_no_progress);
+        cmd.add(arg_chunk_size);
+        cmd.add(arg_compress);
+        cmd.add(arg_quantize);
         cmd.add(arg_reaction);
+        cmd.add(arg_plugins);
         cmd.add(arg_params);
         cmd.add(arg_pbc);
+        cmd.add(arg_stencil);
+        cmd.add(arg_steady_tol);
+        cmd.add(arg_steady_frames);
+        cmd.add(arg_periodic);
+        cmd.add(arg_periodic_tol);
+        cmd.add(arg_tile_size);
+        cmd.add(arg_tile_tol);
+        cmd.add(arg_amr_levels);
+        cmd.add(arg_amr_block);
+        cmd.add(arg_amr_tol);
+        cmd.add(arg_amr_subcycle);
+        cmd.add(arg_amr_regrid);
+
+        cmd.parse(args);
 
-        cmd.parse(argc, argv);
+        // the diffusion coefficients are given either per compound or as a list
+        if(arg_diffusion.getValue().empty()) {
+            if(!arg_da.isSet() || !arg_db.isSet()) {
+                throw std::runtime_error("The diffusion coefficients are required (--Da and --Db, or --diffusion)");
+            }
+        } else if(arg_da.isSet() || arg_db.isSet()) {
+            throw std::runtime_error("--diffusion replaces --Da and --Db; give either the list or both coefficients");
+        }
 
         const double Da = arg_da.getValue();
         const double Db = arg_db.getValue();
 
         const unsigned int width = arg_width.getValue();
         const unsigned int height = arg_height.getValue();
+        const unsigned int depth = arg_depth.getValue();
         const double dx = arg_dx.getValue();
         const double dt = arg_dt.getValue();
         const unsigned int steps = arg_steps.getValue();
@@ -79,6 +164,19 @@ int main(int argc, char* argv[]) {
         const std::string reaction = arg_reaction.getValue();
         const std::string params = arg_params.getValue();
 
+        // the output of served jobs is discarded, hence the switch is left alone
+        if(!served) {
+            tq::enabled() = !arg_no_progress.getValue();
+        }
+
+        // keep stdout free for a stream of rendered frames
+        if(!arg_render.getValue().empty() && FrameRenderer::writes_to_stdout(arg_render.getValue())) {
+            if(served) {
+                throw std::runtime_error("Jobs of the server cannot stream rendered frames to stdout");
+            }
+            std::cout.rdbuf(std::cerr.rdbuf());
+        }
+
         std::cout << "-----------------------------------------" << std::endl;
         std::cout << "Starting program: Turing version " << PROGRAM_VERSION << std::endl;
         std::cout << "Author: Ivo Filot <ivo@ivofilot.nl>" << std::endl;
@@ -86,49 +184,544 @@ int main(int argc, char* argv[]) {
 
         // construct object and perform time-integration
         auto start = std::chrono::system_clock::now();
-        TwoDimRD tdrd(Da, Db, width, height, dx, dt, steps, tsteps);
 
         // choose which reaction model
-        if(reaction == "lotka-volterra") {
-            std::cout << "Loading reaction model: Lotka-Volterra" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionLotkaVolterra()));
-        } else if(reaction == "gierer-meinhardt") {
-            std::cout << "Loading reaction model: Gierer-Meinhardt" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionGiererMeinhardt()));
-        } else if(reaction == "gray-scott") {
-            std::cout << "Loading reaction model: Gray-Scott" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionGrayScott()));
-        } else if(reaction == "fitzhugh-nagumo") {
-            std::cout << "Loading reaction model: Fitzhugh-Nagumo" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionFitzhughNagumo()));
-        } else if(reaction == "brusselator") {
-            std::cout << "Loading reaction model: Brusselator" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionBrusselator()));
-        } else if(reaction == "barkley") {
-            std::cout << "Loading reaction model: Barkley" << std::endl;
-            tdrd.set_reaction(dynamic_cast<ReactionSystem*>(new ReactionBarkley()));
-        } else {
+        ReactionRegistry registry;
+        for(const std::string& path : arg_plugins.getValue()) {
+            const std::string name = registry.load_plugin(path);
+            std::cout << "Loaded reaction plugin " << path << " as " << name << std::endl;
+        }
+
+        if(!registry.has(reaction)) {
             std::cout << "Invalid reaction encountered, please choose one among the following:" << std::endl;
-            std::cout << "    gierer-meinhardt" << std::endl;
-            std::cout << "    lotka-volterra" << std::endl;
-            std::cout << "    gray-scott" << std::endl;
-            std::cout << "    fitzhugh-nagumo" << std::endl;
-            std::cout << "    brusselator" << std::endl;
-            std::cout << "    barkley" << std::endl;
+            for(const std::string& name : registry.get_names()) {
+                std::cout << "    " << name << std::endl;
+            }
             std::cout << "Note that the input is case-sensitive." << std::endl;
+            return -1;
         }
 
+        std::cout << "Loading reaction model: " << registry.get_description(reaction) << std::endl;
+        std::unique_ptr<ReactionSystem> reaction_owner(registry.create(reaction));
+        ReactionSystem* reaction_system = reaction_owner.get();
+
         if(arg_pbc.getValue()) {
             std::cout << "Enabling periodic boundary conditions." << std::endl;
         } else {
             std::cout << "Using zero-flux boundary conditions." << std::endl;
         }
 
+        // stencil of the Laplacian
+        const int stencil_points = arg_stencil.getValue();
+        if(stencil_points != STENCIL_5POINT && stencil_points != STENCIL_9POINT && stencil_points != STENCIL_13POINT) {
+            throw std::runtime_error("Invalid stencil: " + std::to_string(stencil_points) + " (choose 5, 9 or 13)");
+        }
+        const LaplacianStencil stencil = (LaplacianStencil)stencil_points;
+        if(stencil != STENCIL_5POINT) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("The 9- and 13-point stencils are only available on a uniform two-dimensional grid");
+            }
+            if(stencil == STENCIL_13POINT && arg_tile_size.getValue() == 1) {
+                throw std::runtime_error("The 13-point stencil requires tiles of at least 2x2");
+            }
+            std::cout << "Using the " << stencil_points << "-point stencil for the Laplacian." << std::endl;
+        }
+
+        if(!arg_diffusion_field.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Diffusion fields are only available on a uniform two-dimensional grid");
+            }
+            if(stencil != STENCIL_5POINT) {
+                throw std::runtime_error("Diffusion fields use their own flux-form stencil and cannot be combined with --stencil");
+            }
+        }
+
+        if((arg_steady_tol.getValue() > 0.0 || arg_periodic.getValue()) && arg_amr_levels.getValue() > 0) {
+            throw std::runtime_error("Steady-state detection (--steady-tol or --periodic) is not available with "
+                                     "adaptive refinement, which always integrates all frames");
+        }
+
+        if(arg_tile_size.getValue() > 0 && arg_amr_levels.getValue() > 0) {
+            throw std::runtime_error("Adaptive refinement uses its own blocks and cannot be combined with --tile-size");
+        }
+
+        if(!arg_mask.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Masked domains are only available on a uniform two-dimensional grid");
+            }
+            if(stencil != STENCIL_5POINT || !arg_diffusion_field.getValue().empty() || arg_tile_size.getValue() > 0) {
+                throw std::runtime_error("Masked domains use the five-point stencil and cannot be combined with "
+                                         "--stencil, --diffusion-field or --tile-size");
+            }
+        }
+
+        if(!arg_output_spec.getValue().empty() && depth > 1) {
+            throw std::runtime_error("Output specifications are only available in two dimensions");
+        }
+        if(!arg_render.getValue().empty() && depth > 1) {
+            throw std::runtime_error("Rendering is only available in two dimensions");
+        }
+        if(!arg_analysis.getValue().empty() && depth > 1) {
+            throw std::runtime_error("The analysis of the frames is only available in two dimensions");
+        }
+        if(!arg_features.getValue().empty() && depth > 1) {
+            throw std::runtime_error("Feature extraction is only available in two dimensions");
+        }
+        if(!arg_probes.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Probes are only available on a uniform two-dimensional grid");
+            }
+            if(!arg_continuation.getValue().empty() || !arg_branch.getValue().empty()) {
+                throw std::runtime_error("Probes record a single time series and cannot be combined with "
+                                         "--continuation or --branch");
+            }
+        }
+        if(!arg_branch.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Branches are only available on a uniform two-dimensional grid");
+            }
+            if(arg_branch_frame.getValue() < 0 || arg_branch_frame.getValue() >= (int)steps) {
+                throw std::runtime_error("Invalid branch frame: " + std::to_string(arg_branch_frame.getValue()) +
+                                         " (has to be smaller than the number of frames)");
+            }
+            if(!arg_continuation.getValue().empty() || !arg_output_spec.getValue().empty() ||
+               !arg_render.getValue().empty() || !arg_analysis.getValue().empty() ||
+               !arg_features.getValue().empty()) {
+                throw std::runtime_error("Branches write their own files and cannot be combined with --continuation, "
+                                         "--output-spec, --render, --analysis or --features");
+            }
+        }
+        if(!arg_continuation.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Continuation scans are only available on a uniform two-dimensional grid");
+            }
+            if(arg_steady_tol.getValue() <= 0.0 && !arg_periodic.getValue()) {
+                throw std::runtime_error("Continuation scans require steady-state detection (--steady-tol or --periodic)");
+            }
+            if(!arg_output_spec.getValue().empty() || !arg_render.getValue().empty() ||
+               !arg_analysis.getValue().empty() || !arg_features.getValue().empty()) {
+                throw std::runtime_error("Continuation scans store one frame per case and cannot be combined with "
+                                         "--output-spec, --render, --analysis or --features");
+            }
+        }
+        if(!arg_spin_up.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("The spin-up is only available on a uniform two-dimensional grid");
+            }
+            if(!arg_diffusion_field.getValue().empty() || !arg_mask.getValue().empty() ||
+               !arg_continuation.getValue().empty() || !arg_branch.getValue().empty()) {
+                throw std::runtime_error("The spin-up coarsens a uniform medium and cannot be combined with "
+                                         "--diffusion-field, --mask, --continuation or --branch");
+            }
+        }
+        if(!arg_split_reaction.getValue().empty()) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0) {
+                throw std::runtime_error("Sub-cycling of the reaction terms is only available on a uniform two-dimensional grid");
+            }
+            if(!arg_mask.getValue().empty() || arg_tile_size.getValue() > 0) {
+                throw std::runtime_error("Sub-cycling of the reaction terms updates the full grid and cannot be combined with "
+                                         "--mask or --tile-size");
+            }
+        }
+
+        // optional chunked layout of the output
+        if(arg_chunk_size.getValue() < 0) {
+            throw std::runtime_error("Invalid chunk size: " + std::to_string(arg_chunk_size.getValue()));
+        }
+        const unsigned int chunk_size = arg_chunk_size.getValue();
+        const int compression = arg_compress.getValue();
+        if(compression < 0 || compression > 9) {
+            throw std::runtime_error("Invalid compression level: " + std::to_string(compression) + " (choose 0-9)");
+        }
+        if(compression > 0 && chunk_size == 0) {
+            throw std::runtime_error("Compression requires a chunked layout (--chunk-size)");
+        }
+        if(chunk_size > 0) {
+            std::cout << "Storing the output as chunks of " << chunk_size << "x" << chunk_size;
+            if(compression > 0) {
+                std::cout << " (compression level " << compression << ")";
+            }
+            std::cout << "." << std::endl;
+        }
+        const std::string quantization = arg_quantize.getValue();
+        if(!quantization.empty()) {
+            if(chunk_size == 0) {
+                throw std::runtime_error("Quantization requires a chunked layout (--chunk-size)");
+            }
+            const FrameQuantizer quantizer(quantization);
+            std::cout << "Quantizing the chunks to " << quantizer.get_bits() << "-bit codes ("
+                      << quantizer.get_description() << ")." << std::endl;
+        }
+
+        // optional selection and reduction of the output, created once the species are known
+        auto make_output_spec = [&]() {
+            OutputSpec* spec = new OutputSpec(arg_output_spec.getValue(), reaction_system->get_species_names(),
+                                              width, height);
+            if(spec->has_mixed_cadence() && chunk_size == 0) {
+                delete spec;
+                throw std::runtime_error("Writing the species at different cadences (every) requires a chunked "
+                                         "layout (--chunk-size)");
+            }
+            const size_t full = (size_t)width * height * reaction_system->get_nr_species() * sizeof(double);
+            std::cout << "Writing " << spec->get_description() << " (" << spec->get_frame_bytes()
+                      << " instead of " << full << " bytes per frame)." << std::endl;
+            return spec;
+        };
+
+        // optional rendering of the frames, which starts the output threads
+        auto make_renderer = [&]() {
+            FrameRenderer* renderer = new FrameRenderer(arg_render.getValue(), reaction_system->get_species_names(),
+                                                        width, height);
+            std::cout << "Rendering " << renderer->get_description() << "." << std::endl;
+            return renderer;
+        };
+
+        // optional statistics and power spectra of the frames
+        auto make_analysis = [&]() {
+            FieldAnalysis* analysis = new FieldAnalysis(arg_analysis.getValue(), reaction_system->get_species_names(),
+                                                        width, height, dx, outfile + ".analysis.json");
+            std::cout << "Analyzing " << analysis->get_description() << "." << std::endl;
+            return analysis;
+        };
+
+        // optional spots and spiral tips of the frames
+        auto make_features = [&]() {
+            FeatureExtractor* features = new FeatureExtractor(arg_features.getValue(), reaction_system->get_species_names(),
+                                                              width, height, dx, arg_pbc.getValue(),
+                                                              outfile + ".features.json");
+            std::cout << "Extracting " << features->get_description() << "." << std::endl;
+            return features;
+        };
+
+        // optional status file, rewritten while integrating
+        auto make_metrics = [&](unsigned long long steps_requested) {
+            MetricsExporter* metrics = new MetricsExporter(arg_metrics.getValue(), arg_metrics_interval.getValue(),
+                                                           (double)width * height * depth, steps_requested);
+            std::cout << "Writing metrics to " << metrics->get_filename() << " every "
+                      << arg_metrics_interval.getValue() << " seconds." << std::endl;
+            return metrics;
+        };
+
         std::cout << "Executing using " << omp_get_max_threads() << " threads." << std::endl;
 
+        // diffusion coefficients per species
+        const unsigned int nr_species = reaction_system->get_nr_species();
+        std::vector<double> diffusion = {Da, Db};
+        if(!arg_diffusion.getValue().empty()) {
+            std::vector<std::string> pieces;
+            boost::split(pieces, arg_diffusion.getValue(), boost::is_any_of(","), boost::token_compress_on);
+            diffusion.clear();
+            for(const std::string& piece : pieces) {
+                diffusion.push_back(boost::lexical_cast<double>(boost::trim_copy(piece)));
+            }
+        }
+        if(diffusion.size() != nr_species) {
+            throw std::runtime_error("Reaction system has " + std::to_string(nr_species) + " species, but " +
+                                     std::to_string(diffusion.size()) + " diffusion coefficients were given");
+        }
+
+        if(nr_species != 2) {
+            if(depth > 1 || arg_amr_levels.getValue() > 0 || arg_tile_size.getValue() > 0) {
+                throw std::runtime_error("Systems with more than two species are only available on a uniform two-dimensional grid");
+            }
+            if(!arg_continuation.getValue().empty()) {
+                throw std::runtime_error("Continuation scans are only available for systems with two species");
+            }
+            if(!arg_branch.getValue().empty()) {
+                throw std::runtime_error("Branches are only available for systems with two species");
+            }
+            if(!arg_mask.getValue().empty()) {
+                throw std::runtime_error("Masked domains are only available for systems with two species");
+            }
+            if(!arg_probes.getValue().empty()) {
+                throw std::runtime_error("Probes are only available for systems with two species");
+            }
+            if(!arg_spin_up.getValue().empty()) {
+                throw std::runtime_error("The spin-up is only available for systems with two species");
+            }
+            if(!arg_split_reaction.getValue().empty()) {
+                throw std::runtime_error("Sub-cycling of the reaction terms is only available for systems with two species");
+            }
+
+            // integrate, write frames and metadata for any number of species
+            auto run = [&](auto& rd) {
+                rd.set_reaction(reaction_owner.release());
+                rd.set_parameters(params);
+                rd.set_pbc(arg_pbc.getValue());
+                rd.set_stencil(stencil);
+                rd.set_chunking(chunk_size, compression, quantization);
+                if(!arg_diffusion_field.getValue().empty()) {
+                    rd.set_diffusion_field(new DiffusionField(arg_diffusion_field.getValue(), width, height));
+                }
+                if(!arg_output_spec.getValue().empty()) {
+                    rd.set_output_spec(make_output_spec());
+                }
+                if(!arg_render.getValue().empty()) {
+                    rd.set_renderer(make_renderer());
+                }
+                if(!arg_analysis.getValue().empty()) {
+                    rd.set_analysis(make_analysis());
+                }
+                if(!arg_features.getValue().empty()) {
+                    rd.set_features(make_features());
+                }
+
+                // optional steady-state detection
+                if(arg_steady_tol.getValue() > 0.0 || arg_periodic.getValue()) {
+                    std::cout << "Enabling steady-state detection (tolerance = " << arg_steady_tol.getValue()
+                              << ", frames = " << arg_steady_frames.getValue() << ")." << std::endl;
+                    rd.set_convergence_monitor(new ConvergenceMonitor(arg_steady_tol.getValue(),
+                                                                      arg_steady_frames.getValue(),
+                                                                      arg_periodic.getValue(),
+                                                                      arg_periodic_tol.getValue()));
+                }
+
+                if(!arg_metrics.getValue().empty()) {
+                    rd.set_metrics(make_metrics((unsigned long long)steps * tsteps));
+                }
+
+                std::cout << "Start time integration: " << steps*tsteps << " steps of dt = " << dt << std::endl;
+                rd.time_integrate();
+                auto end = std::chrono::system_clock::now();
+                std::chrono::duration<double> elapsed_seconds = end-start;
+                std::cout << "Performed time integration in " << elapsed_seconds.count() << " seconds." << std::endl;
+
+                std::cout << "Writing frames to " << outfile << "." << std::endl;
+                rd.write_state_to_file(outfile);
+                rd.write_metadata_to_file(outfile + ".json");
+            };
+
+            std::cout << "Using " << nr_species << " species." << std::endl;
+            if(nr_species == 3) {
+                NSpeciesRD<3> rd({diffusion[0], diffusion[1], diffusion[2]}, width, height, dx, dt, steps, tsteps);
+                run(rd);
+            } else if(nr_species == 4) {
+                NSpeciesRD<4> rd({diffusion[0], diffusion[1], diffusion[2], diffusion[3]}, width, height, dx, dt, steps, tsteps);
+                run(rd);
+            } else {
+                throw std::runtime_error("Unsupported number of species: " + std::to_string(nr_species));
+            }
+
+            std::cout << "Done execution" << std::endl << std::endl;
+
+            return 0;
+        }
+
+        if(depth > 1) {
+            if(arg_amr_levels.getValue() > 0 || arg_tile_size.getValue() > 0) {
+                throw std::runtime_error("Adaptive mesh refinement and tiling are only available in two dimensions");
+            }
+
+            ThreeDimRD tdrd(diffusion[0], diffusion[1], width, height, depth, dx, dt, steps, tsteps);
+            tdrd.set_reaction(reaction_owner.release());
+            tdrd.set_parameters(params);
+            tdrd.set_pbc(arg_pbc.getValue());
+            tdrd.set_chunking(chunk_size, compression, quantization);
+
+            std::cout << "Using a three-dimensional system of " << width << "x" << height << "x" << depth
+                      << "." << std::endl;
+
+            // optional steady-state detection
+            if(arg_steady_tol.getValue() > 0.0 || arg_periodic.getValue()) {
+                std::cout << "Enabling steady-state detection (tolerance = " << arg_steady_tol.getValue()
+                          << ", frames = " << arg_steady_frames.getValue() << ")." << std::endl;
+                tdrd.set_convergence_monitor(new ConvergenceMonitor(arg_steady_tol.getValue(),
+                                                                    arg_steady_frames.getValue(),
+                                                                    arg_periodic.getValue(),
+                                                                    arg_periodic_tol.getValue()));
+            }
+
+            if(!arg_metrics.getValue().empty()) {
+                tdrd.set_metrics(make_metrics((unsigned long long)steps * tsteps));
+            }
+
+            // perform time integration; frames are written while integrating
+            std::cout << "Start time integration: " << steps*tsteps << " steps of dt = " << dt << std::endl;
+            std::cout << "Writing frames to " << outfile << "." << std::endl;
+            tdrd.time_integrate(outfile);
+            auto end = std::chrono::system_clock::now();
+            std::chrono::duration<double> elapsed_seconds = end-start;
+            std::cout << "Performed time integration in " << elapsed_seconds.count() << " seconds." << std::endl;
+
+            tdrd.write_metadata_to_file(outfile + ".json");
+
+            std::cout << "Done execution" << std::endl << std::endl;
+
+            return 0;
+        }
+
+        if(arg_amr_levels.getValue() > 0) {
+            // block-structured adaptive mesh; width, height, dx and dt refer to the finest level
+            AmrRD amrrd(diffusion[0], diffusion[1], width, height, dx, dt, steps, tsteps,
+                        arg_amr_levels.getValue(), arg_amr_block.getValue());
+            amrrd.set_reaction(reaction_owner.release());
+            amrrd.set_pbc(arg_pbc.getValue());
+            amrrd.set_refinement(arg_amr_tol.getValue(), arg_amr_regrid.getValue());
+            amrrd.set_subcycle(arg_amr_subcycle.getValue());
+            amrrd.set_parameters(params);
+            amrrd.set_chunking(chunk_size, compression, quantization);
+            if(!arg_output_spec.getValue().empty()) {
+                amrrd.set_output_spec(make_output_spec());
+            }
+            if(!arg_render.getValue().empty()) {
+                amrrd.set_renderer(make_renderer());
+            }
+            if(!arg_analysis.getValue().empty()) {
+                amrrd.set_analysis(make_analysis());
+            }
+            if(!arg_features.getValue().empty()) {
+                amrrd.set_features(make_features());
+            }
+            if(!arg_metrics.getValue().empty()) {
+                amrrd.set_metrics(make_metrics((unsigned long long)steps * tsteps));
+            }
+
+            std::cout << "Using " << arg_amr_levels.getValue() << " adaptive refinement levels with blocks of "
+                      << arg_amr_block.getValue() << "x" << arg_amr_block.getValue()
+                      << " (tolerance = " << arg_amr_tol.getValue() << ")." << std::endl;
+            if(arg_amr_subcycle.getValue()) {
+                std::cout << "Enabling subcycling in time." << std::endl;
+            }
+
+            // perform time integration
+            std::cout << "Start time integration: " << steps*tsteps << " steps of dt = " << dt << std::endl;
+            amrrd.time_integrate();
+            auto end = std::chrono::system_clock::now();
+            std::chrono::duration<double> elapsed_seconds = end-start;
+            std::cout << "Performed time integration in " << elapsed_seconds.count() << " seconds." << std::endl;
+
+            // write result to file
+            std::cout << "Writing frames to " << outfile << "." << std::endl;
+            amrrd.write_state_to_file(outfile);
+            amrrd.write_metadata_to_file(outfile + ".json");
+
+            std::cout << "Done execution" << std::endl << std::endl;
+
+            return 0;
+        }
+
+        TwoDimRD tdrd(diffusion[0], diffusion[1], width, height, dx, dt, steps, tsteps);
+        tdrd.set_reaction(reaction_owner.release());
+
         // set parameters
         tdrd.set_parameters(params);
         tdrd.set_pbc(arg_pbc.getValue());
+        tdrd.set_stencil(stencil);
+        tdrd.set_chunking(chunk_size, compression, quantization);
+
+        // optional heterogeneous medium
+        if(!arg_diffusion_field.getValue().empty()) {
+            DiffusionField* field = new DiffusionField(arg_diffusion_field.getValue(), width, height);
+            std::cout << "Using diffusion field " << field->get_description()
+                      << (field->is_anisotropic() ? " (anisotropic)" : "")
+                      << ", largest eigenvalue = " << field->get_max() << "." << std::endl;
+            tdrd.set_diffusion_field(field);
+        }
+
+        // optional irregular domain
+        if(!arg_mask.getValue().empty()) {
+            DomainMask* mask = new DomainMask(arg_mask.getValue(), width, height);
+            std::cout << "Using domain mask " << mask->get_description() << " (active fraction = "
+                      << mask->get_active_fraction() << ", interior fraction = "
+                      << mask->get_interior_fraction() << ")." << std::endl;
+            tdrd.set_mask(mask);
+        }
+
+        // optional selection and reduction of the output
+        if(!arg_output_spec.getValue().empty()) {
+            tdrd.set_output_spec(make_output_spec());
+        }
+
+        // optional rendering of the frames to images
+        if(!arg_render.getValue().empty()) {
+            tdrd.set_renderer(make_renderer());
+        }
+
+        // optional statistics and power spectra of the frames
+        if(!arg_analysis.getValue().empty()) {
+            tdrd.set_analysis(make_analysis());
+        }
+
+        // optional spots and spiral tips of the frames
+        if(!arg_features.getValue().empty()) {
+            tdrd.set_features(make_features());
+        }
+
+        // optional time series at points and transects
+        if(!arg_probes.getValue().empty()) {
+            ProbeRecorder* probes = new ProbeRecorder(arg_probes.getValue(), reaction_system->get_species_names(),
+                                                      width, height, outfile);
+            std::cout << "Recording " << probes->get_description() << "." << std::endl;
+            tdrd.set_probes(probes);
+        }
+
+        // optional active-tile tracking
+        if(arg_tile_size.getValue() > 0) {
+            std::cout << "Skipping tiles of " << arg_tile_size.getValue() << "x" << arg_tile_size.getValue()
+                      << " at rest (tolerance = " << arg_tile_tol.getValue() << ")." << std::endl;
+            tdrd.set_tiling(arg_tile_size.getValue(), arg_tile_tol.getValue());
+        }
+
+        // optional coarse-to-fine spin-up of the pattern
+        if(!arg_spin_up.getValue().empty()) {
+            tdrd.set_spin_up(new MultiresSpinUp(arg_spin_up.getValue(), reaction_system->get_species_names(),
+                                                width, height));
+        }
+
+        // optional Strang splitting with sub-cycled reaction terms
+        if(!arg_split_reaction.getValue().empty()) {
+            ReactionSubcycler* subcycler = new ReactionSubcycler(arg_split_reaction.getValue());
+            std::cout << "Splitting the time steps into reaction and diffusion; the reaction terms take "
+                      << (subcycler->get_method() == ReactionSubcycler::METHOD_ROSENBROCK ? "Rosenbrock" : "RK23")
+                      << " sub-steps per grid point." << std::endl;
+            tdrd.set_subcycler(subcycler);
+        }
+
+        // optional steady-state detection
+        if(arg_steady_tol.getValue() > 0.0 || arg_periodic.getValue()) {
+            std::cout << "Enabling steady-state detection (tolerance = " << arg_steady_tol.getValue()
+                      << ", frames = " << arg_steady_frames.getValue() << ")." << std::endl;
+            if(arg_periodic.getValue()) {
+                std::cout << "Enabling detection of periodic steady states." << std::endl;
+            }
+            tdrd.set_convergence_monitor(new ConvergenceMonitor(arg_steady_tol.getValue(),
+                                                                arg_steady_frames.getValue(),
+                                                                arg_periodic.getValue(),
+                                                                arg_periodic_tol.getValue()));
+        }
+
+        // optional scan of a parameter, seeded from the previous steady state
+        if(!arg_continuation.getValue().empty()) {
+            ContinuationScan* scan = new ContinuationScan(arg_continuation.getValue(), params,
+                                                          reaction_system->get_species_names(),
+                                                          width, height, outfile + ".continuation.json");
+            std::cout << "Continuation scan of " << scan->get_description() << " (at most "
+                      << steps << " frames per case)." << std::endl;
+            tdrd.set_continuation(scan);
+        }
+
+        // optional branches that share the first frames
+        if(!arg_branch.getValue().empty()) {
+            // reject invalid parameters before any time is spent on the shared frames
+            for(const std::string& branch_params : arg_branch.getValue()) {
+                std::unique_ptr<ReactionSystem> check(registry.create(reaction));
+                check->set_parameters(branch_params);
+            }
+            std::cout << "Sharing the first " << arg_branch_frame.getValue() << " frames among "
+                      << arg_branch.getValue().size() << " branches." << std::endl;
+            tdrd.set_branches(arg_branch_frame.getValue(), arg_branch.getValue(), outfile);
+        }
+
+        // the number of frames of a continuation scan is not known in advance
+        if(!arg_metrics.getValue().empty()) {
+            unsigned long long frames = steps;
+            if(!arg_continuation.getValue().empty()) {
+                frames = 0;
+            } else if(!arg_branch.getValue().empty()) {
+                frames = arg_branch_frame.getValue() + arg_branch.getValue().size() * (steps - arg_branch_frame.getValue());
+            }
+            tdrd.set_metrics(make_metrics(frames * tsteps));
+        }
 
         // perform time integration
         std::cout << "Start time integration: " << steps*tsteps << " steps of dt = " << dt << std::endl;
@@ -138,16 +731,34 @@ int main(int argc, char* argv[]) {
         std::cout << "Performed time integration in " << elapsed_seconds.count() << " seconds." << std::endl;
 
         // write result to file
-        std::cout << "Writing " << steps << " frames to " << outfile << "." << std::endl;
+        std::cout << "Writing frames to " << outfile << "." << std::endl;
         tdrd.write_state_to_file(outfile);
+        tdrd.write_metadata_to_file(outfile + ".json");
 
         std::cout << "Done execution" << std::endl << std::endl;
 
         return 0;
 
     } catch (TCLAP::ArgException &e) {
-        std::cerr << "error: " << e.error() <<
-                     " for arg " << e.argId() << std::endl;
+        err << "error: " << e.error() <<
+               " for arg " << e.argId() << std::endl;
         return -1;
+    } catch (TCLAP::ExitException &e) {
+        return e.getExitStatus();
+    } catch (std::exception &e) {
+        err << "error: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // turing serve [options]: run simulations submitted to a local job server
+    if(argc > 1 && std::string(argv[1]) == "serve") {
+        return JobServer::main(std::vector<std::string>(argv + 1, argv + argc),
+            [](const std::vector<std::string>& args, std::ostream& err) {
+                return run_simulation(args, true, err);
+            });
     }
+
+    return run_simulation(std::vector<std::string>(argv, argv + argc), false, std::cerr);
 }
@@ -0,0 +1,228 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "metrics_exporter.h"
+#include "output_metadata.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+/**
+ * @brief      Constructs the object
+ *
+ * @param[in]  _filename         status file (.prom for the Prometheus text format, JSON otherwise)
+ * @param[in]  _interval         seconds between two updates of the file
+ * @param[in]  _cells            number of grid points updated per time step
+ * @param[in]  _steps_requested  number of time steps of the run (0 = unknown)
+ */
+MetricsExporter::MetricsExporter(const std::string& _filename, double _interval, double _cells,
+                                 unsigned long long _steps_requested) :
+    filename(_filename),
+    prometheus(boost::algorithm::ends_with(_filename, ".prom")),
+    interval(_interval),
+    cells(_cells),
+    steps_requested(_steps_requested) {
+
+    if(this->interval <= 0.0) {
+        throw std::runtime_error("The interval between two updates of the metrics has to be positive");
+    }
+}
+
+/**
+ * @brief      Destroys the object, stopping the thread
+ */
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+    }
+    this->cv.notify_all();
+
+    if(this->writer.joinable()) {
+        this->writer.join();
+    }
+}
+
+/**
+ * @brief      Add an output whose backlog is reported
+ *
+ * @param[in]  source  function returning the number of items waiting to be written
+ */
+void MetricsExporter::add_backlog_source(const std::function<size_t()>& source) {
+    this->backlog_sources.push_back(source);
+}
+
+/**
+ * @brief      Start the clock and the thread that rewrites the file
+ */
+void MetricsExporter::start() {
+    if(this->writer.joinable()) {
+        return;
+    }
+
+    this->start_time = std::chrono::steady_clock::now();
+    this->last_time = this->start_time;
+    this->write(true);
+    this->writer = std::thread(&MetricsExporter::work, this);
+}
+
+/**
+ * @brief      Stop the thread and write the final state of the run
+ */
+void MetricsExporter::finish() {
+    if(!this->writer.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+    }
+    this->cv.notify_all();
+    this->writer.join();
+
+    this->write(false);
+}
+
+/**
+ * @brief      Main loop of the thread
+ */
+void MetricsExporter::work() {
+    const auto period = std::chrono::duration<double>(this->interval);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while(!this->cv.wait_for(lock, period, [this]() { return this->stopped; })) {
+        lock.unlock();
+        try {
+            this->write(true);
+        } catch(const std::exception& e) {
+            // a status file that cannot be written does not end the run
+            std::cerr << "Cannot update " << this->filename << ": " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+/**
+ * @brief      Atomically rewrite the status file
+ *
+ * @param[in]  running  whether the run is still in progress
+ */
+void MetricsExporter::write(bool running) {
+    const auto now = std::chrono::steady_clock::now();
+    const unsigned long long nsteps = this->steps.load(std::memory_order_relaxed);
+    const double t = this->time.load(std::memory_order_relaxed);
+    const double last_norm = this->norm.load(std::memory_order_relaxed);
+
+    // the throughput is measured over the last interval, the estimated time
+    // remaining follows from the average over the run
+    const double elapsed = std::chrono::duration<double>(now - this->start_time).count();
+    const double window = std::chrono::duration<double>(now - this->last_time).count();
+    const double steps_per_second = window > 0.0 ? (double)(nsteps - this->last_steps) / window : 0.0;
+    const bool has_eta = this->steps_requested > 0 && nsteps > 0 && elapsed > 0.0;
+    const double eta = has_eta ? (double)(this->steps_requested > nsteps ? this->steps_requested - nsteps : 0) *
+                                 elapsed / (double)nsteps : 0.0;
+    this->last_time = now;
+    this->last_steps = nsteps;
+
+    size_t backlog = 0;
+    for(const auto& source : this->backlog_sources) {
+        backlog += source();
+    }
+    const size_t rss = get_rss();
+
+    const std::string tmpfile = this->filename + ".tmp";
+    if(this->prometheus) {
+        std::ofstream out(tmpfile);
+        if(!out) {
+            throw std::runtime_error("Cannot open " + tmpfile + " for writing");
+        }
+        out << std::setprecision(12);
+        auto metric = [&out](const std::string& name, const std::string& type, const std::string& help, double value) {
+            out << "# HELP turing_" << name << " " << help << "\n"
+                << "# TYPE turing_" << name << " " << type << "\n"
+                << "turing_" << name << " " << value << "\n";
+        };
+        metric("running", "gauge", "Whether the integration is in progress", running ? 1.0 : 0.0);
+        metric("steps_total", "counter", "Time steps taken", (double)nsteps);
+        metric("steps_requested", "gauge", "Time steps of the run (0 = unknown)", (double)this->steps_requested);
+        metric("simulated_time", "gauge", "Simulated time", t);
+        metric("elapsed_seconds", "gauge", "Wall time since the start of the integration", elapsed);
+        metric("steps_per_second", "gauge", "Time steps per second over the last interval", steps_per_second);
+        metric("cell_updates_per_second", "gauge", "Grid point updates per second over the last interval",
+               steps_per_second * this->cells);
+        if(has_eta) {
+            metric("eta_seconds", "gauge", "Estimated wall time remaining", eta);
+        }
+        metric("io_backlog", "gauge", "Frames and probe blocks waiting to be written", (double)backlog);
+        metric("rss_bytes", "gauge", "Resident memory of the process", (double)rss);
+        if(last_norm >= 0.0) {
+            metric("convergence_norm", "gauge", "max|dc/dt| at the end of the last frame", last_norm);
+        }
+        out.close();
+        if(!out) {
+            throw std::runtime_error("Cannot write to " + tmpfile);
+        }
+    } else {
+        OutputMetadata metadata;
+        metadata.set("status", running ? "running" : "finished");
+        metadata.set("steps", (long long)nsteps);
+        metadata.set("steps_requested", (long long)this->steps_requested);
+        metadata.set("simulated_time", t);
+        metadata.set("elapsed_seconds", elapsed);
+        metadata.set("steps_per_second", steps_per_second);
+        metadata.set("cell_updates_per_second", steps_per_second * this->cells);
+        if(has_eta) {
+            metadata.set("eta_seconds", eta);
+        }
+        metadata.set("io_backlog", (long long)backlog);
+        metadata.set("rss_bytes", (long long)rss);
+        if(last_norm >= 0.0) {
+            metadata.set("convergence_norm", last_norm);
+        }
+        metadata.write(tmpfile);
+    }
+
+    if(std::rename(tmpfile.c_str(), this->filename.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmpfile + " to " + this->filename);
+    }
+}
+
+/**
+ * @brief      Resident memory of the process in bytes (0 when unknown)
+ */
+size_t MetricsExporter::get_rss() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if(!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
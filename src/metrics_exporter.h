@@ -0,0 +1,150 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief      Periodically writes the progress of a run to a status file
+ *
+ * The file holds the number of time steps taken, the simulated time, the
+ * throughput in time steps and cell updates per second, the estimated time
+ * remaining, the number of frames and probe blocks waiting to be written
+ * (I/O backlog), the
+ * resident memory and the last convergence norm max|dc/dt|. A file ending in
+ * .prom is written in the Prometheus text format, any other file as JSON.
+ *
+ * The file is rewritten by a separate thread at a fixed interval. Every
+ * version is written to a temporary file that is renamed over the previous
+ * one, such that readers never see a partial file. The integration only
+ * stores the step count and the time in atomic variables.
+ */
+class MetricsExporter {
+private:
+    std::string filename;                   //!< status file
+    bool prometheus;                        //!< whether the Prometheus text format is used
+    double interval;                        //!< seconds between two updates of the file
+    double cells;                           //!< number of grid points updated per time step
+    unsigned long long steps_requested;     //!< number of time steps of the run (0 = unknown)
+
+    std::atomic<unsigned long long> steps{0};   //!< number of time steps taken
+    std::atomic<double> time{0.0};              //!< simulated time
+    std::atomic<double> norm{-1.0};             //!< last convergence norm (negative = unknown)
+
+    std::vector<std::function<size_t()>> backlog_sources;   //!< number of items waiting per output
+
+    std::chrono::steady_clock::time_point start_time;   //!< start of the integration
+    std::chrono::steady_clock::time_point last_time;    //!< time of the last update of the file
+    unsigned long long last_steps = 0;                  //!< number of time steps at the last update
+
+    std::thread writer;             //!< thread that rewrites the file
+    std::mutex mutex;               //!< guards the stop flag
+    std::condition_variable cv;     //!< wakes the thread when the run ends
+    bool stopped = false;           //!< whether the run has ended
+
+public:
+    /**
+     * @brief      Constructs the object
+     *
+     * @param[in]  _filename         status file (.prom for the Prometheus text format, JSON otherwise)
+     * @param[in]  _interval         seconds between two updates of the file
+     * @param[in]  _cells            number of grid points updated per time step
+     * @param[in]  _steps_requested  number of time steps of the run (0 = unknown)
+     */
+    MetricsExporter(const std::string& _filename, double _interval, double _cells,
+                    unsigned long long _steps_requested);
+
+    /**
+     * @brief      Destroys the object, stopping the thread
+     */
+    ~MetricsExporter();
+
+    /**
+     * @brief      Add an output whose backlog is reported
+     *
+     * @param[in]  source  function returning the number of items waiting to be written
+     */
+    void add_backlog_source(const std::function<size_t()>& source);
+
+    /**
+     * @brief      Start the clock and the thread that rewrites the file
+     */
+    void start();
+
+    /**
+     * @brief      Count time steps
+     *
+     * @param[in]  t     simulated time after the steps
+     * @param[in]  n     number of time steps
+     */
+    inline void progress(double t, unsigned int n = 1) {
+        this->steps.fetch_add(n, std::memory_order_relaxed);
+        this->time.store(t, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief      Set the last convergence norm
+     *
+     * @param[in]  _norm  max|dc/dt| at the end of the last frame
+     */
+    inline void set_norm(double _norm) {
+        this->norm.store(_norm, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief      Stop the thread and write the final state of the run
+     */
+    void finish();
+
+    /**
+     * @brief      Get the status file
+     */
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+
+private:
+    /**
+     * @brief      Main loop of the thread
+     */
+    void work();
+
+    /**
+     * @brief      Atomically rewrite the status file
+     *
+     * @param[in]  running  whether the run is still in progress
+     */
+    void write(bool running);
+
+    /**
+     * @brief      Resident memory of the process in bytes (0 when unknown)
+     */
+    static size_t get_rss();
+};
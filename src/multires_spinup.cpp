@@ -0,0 +1,257 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "multires_spinup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec           specification of the spin-up
+ * @param[in]  species_names  names of all species
+ * @param[in]  width          width of the requested grid
+ * @param[in]  height         height of the requested grid
+ */
+MultiresSpinUp::MultiresSpinUp(const std::string& spec, const std::vector<std::string>& species_names,
+                               unsigned int width, unsigned int height) :
+    description(spec) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid spin-up specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "levels" && key != "field" && key != "tol" && key != "checks" &&
+           key != "interval" && key != "max_time" && key != "dt_factor") {
+            throw std::runtime_error("Invalid spin-up specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    if(params.count("levels") > 0) {
+        this->levels = boost::lexical_cast<unsigned int>(params["levels"]);
+    }
+    if(params.count("field") > 0) {
+        this->field = params["field"];
+    }
+    if(params.count("tol") > 0) {
+        this->tolerance = boost::lexical_cast<double>(params["tol"]);
+    }
+    if(params.count("checks") > 0) {
+        this->checks = boost::lexical_cast<unsigned int>(params["checks"]);
+    }
+    if(params.count("interval") > 0) {
+        this->interval = boost::lexical_cast<double>(params["interval"]);
+    }
+    if(params.count("max_time") > 0) {
+        this->max_time = boost::lexical_cast<double>(params["max_time"]);
+    }
+    if(params.count("dt_factor") > 0) {
+        this->dt_factor = boost::lexical_cast<double>(params["dt_factor"]);
+    }
+
+    if(this->levels == 0 || this->levels > 8) {
+        throw std::runtime_error("Invalid spin-up specification: choose 1 to 8 levels");
+    }
+    if(!(this->tolerance > 0.0) || this->checks == 0) {
+        throw std::runtime_error("Invalid spin-up specification: tol and checks have to be positive");
+    }
+    if(this->interval < 0.0 || this->max_time < 0.0 || !(this->dt_factor >= 1.0)) {
+        throw std::runtime_error("Invalid spin-up specification: negative interval or max_time, or dt_factor below 1");
+    }
+
+    const unsigned int scale = 1u << this->levels;
+    if(width % scale != 0 || height % scale != 0 || width / scale < 4 || height / scale < 4) {
+        throw std::runtime_error("Invalid spin-up specification: the width and height have to be multiples of " +
+                                 std::to_string(scale) + " with at least 4 grid points on the coarsest level");
+    }
+
+    const bool by_name = std::find(species_names.begin(), species_names.end(), this->field) != species_names.end();
+    const bool by_index = !this->field.empty() && this->field.find_first_not_of("0123456789") == std::string::npos &&
+                          std::stoul(this->field) < species_names.size();
+    if(!by_name && !by_index) {
+        throw std::runtime_error("Invalid spin-up specification: unknown species " + this->field);
+    }
+}
+
+/**
+ * @brief      Get the time step of a level
+ *
+ * @param[in]  dt     time step of the requested grid
+ * @param[in]  level  level (0 = the requested grid)
+ * @param[in]  dx     grid spacing of the level
+ * @param[in]  D      largest diffusion coefficient
+ *
+ * @return     time step
+ */
+double MultiresSpinUp::get_time_step(double dt, unsigned int level, double dx, double D) const {
+    double dt_level = dt * std::pow(this->dt_factor, level);
+
+    // stay within the stability limit of the explicit scheme for every stencil
+    if(D > 0.0) {
+        const double limit = 0.15 * dx * dx / D;
+        dt_level = std::max(dt, std::min(dt_level, limit));
+    }
+
+    return dt_level;
+}
+
+/**
+ * @brief      Whether the last wavelengths are stable
+ *
+ * @param[in]  wavelengths  dominant wavelength per check (0 = no pattern)
+ */
+bool MultiresSpinUp::is_stable(const std::vector<double>& wavelengths) const {
+    if(wavelengths.size() <= this->checks) {
+        return false;
+    }
+
+    for(size_t i=wavelengths.size() - this->checks; i<wavelengths.size(); i++) {
+        const double previous = wavelengths[i-1];
+        if(!(previous > 0.0) || std::fabs(wavelengths[i] - previous) > this->tolerance * previous) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Interpolate a field bilinearly onto a grid that is twice as fine
+ *
+ * The grid points are the centers of the cells, such that a coarse cell
+ * covers four fine cells.
+ *
+ * @param[in]  coarse  field on the coarse grid
+ * @param      fine    field on the fine grid (resized)
+ * @param[in]  pbc     whether periodic boundary conditions are used
+ */
+void MultiresSpinUp::prolongate(const MatrixXXd& coarse, MatrixXXd& fine, bool pbc) {
+    const int rows = coarse.rows();
+    const int cols = coarse.cols();
+    fine.resize(2 * rows, 2 * cols);
+
+    // neighbouring coarse cell; beyond the edge, it wraps around (periodic)
+    // or is the edge cell itself (zero-flux)
+    auto neighbour = [pbc](int i, int n) {
+        if(pbc) {
+            return (i + n) % n;
+        }
+        return std::min(std::max(i, 0), n - 1);
+    };
+
+    // a fine cell lies a quarter of a coarse cell from the center of its coarse
+    // cell, towards the coarse neighbour that receives a weight of 1/4
+    #pragma omp parallel for schedule(static)
+    for(int J=0; J<2*cols; J++) {
+        const int j = J / 2;
+        const int jn = neighbour(J % 2 == 0 ? j - 1 : j + 1, cols);
+        for(int I=0; I<2*rows; I++) {
+            const int i = I / 2;
+            const int in = neighbour(I % 2 == 0 ? i - 1 : i + 1, rows);
+            fine(I,J) = 0.5625 * coarse(i,j) + 0.1875 * (coarse(in,j) + coarse(i,jn)) + 0.0625 * coarse(in,jn);
+        }
+    }
+}
+
+/**
+ * @brief      Record the result of a level
+ *
+ * @param[in]  level  The level
+ */
+void MultiresSpinUp::add_level(const Level& level) {
+    this->results.push_back(level);
+}
+
+/**
+ * @brief      Estimate the wall time of the spin-up on the requested grid
+ *
+ * @param[in]  seconds_per_step  wall time of a time step on the requested grid
+ * @param[in]  dt                time step on the requested grid
+ */
+void MultiresSpinUp::set_step_cost(double seconds_per_step, double dt) {
+    this->direct_seconds = seconds_per_step * std::round(this->get_time() / dt);
+}
+
+/**
+ * @brief      Add the levels and the time saved to the metadata
+ *
+ * @param      metadata  The metadata
+ */
+void MultiresSpinUp::add_metadata(OutputMetadata& metadata) const {
+    std::vector<double> widths, dts, times, wavelengths, stable;
+    for(const Level& level : this->results) {
+        widths.push_back(level.width);
+        dts.push_back(level.dt);
+        times.push_back(level.time);
+        wavelengths.push_back(level.wavelength);
+        stable.push_back(level.stable ? 1.0 : 0.0);
+    }
+
+    metadata.set("spin_up", this->description);
+    metadata.set("spin_up_widths", widths);
+    metadata.set("spin_up_dt", dts);
+    metadata.set("spin_up_times", times);
+    metadata.set("spin_up_wavelengths", wavelengths);
+    metadata.set("spin_up_stable", stable);
+    metadata.set("spin_up_time", this->get_time());
+    metadata.set("spin_up_seconds", this->get_seconds());
+    metadata.set("spin_up_direct_seconds", this->direct_seconds);
+}
+
+/**
+ * @brief      Get the total time integrated by the spin-up
+ */
+double MultiresSpinUp::get_time() const {
+    double time = 0.0;
+    for(const Level& level : this->results) {
+        time += level.time;
+    }
+    return time;
+}
+
+/**
+ * @brief      Get the total wall time of the spin-up
+ */
+double MultiresSpinUp::get_seconds() const {
+    double seconds = 0.0;
+    for(const Level& level : this->results) {
+        seconds += level.seconds;
+    }
+    return seconds;
+}
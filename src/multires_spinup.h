@@ -0,0 +1,211 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <string>
+#include <vector>
+
+#include "output_metadata.h"
+
+/**
+ * @brief      Coarse-to-fine spin-up of the pattern before the frames are integrated
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     levels=2         number of coarsening levels; the first level uses a
+ *                      grid that is 2^levels times coarser (default: 2)
+ *     field=A          species whose wavelength is followed (default: A)
+ *     tol=0.02         relative change of the wavelength between checks
+ *                      below which it is stable (default: 0.02)
+ *     checks=3         number of consecutive stable checks that end a
+ *                      level (default: 3)
+ *     interval=T       time between checks (default: one frame)
+ *     max_time=T       maximum time per level (default: the full run)
+ *     dt_factor=4      growth of the time step per level (default: 4)
+ *
+ * Starting from the initial condition of the reaction system on the
+ * coarsest grid, every level is integrated until the dominant wavelength
+ * (see FieldAnalysis) is stable, after which the state is prolongated
+ * (bilinearly) onto a grid that is twice as fine. A grid point on level l
+ * costs 4^l times less, and the time step grows by dt_factor per level, as
+ * far as the explicit scheme remains stable for diffusion. The frames are
+ * integrated on the requested grid, starting from the prolongated state and
+ * from the time reached by the spin-up.
+ */
+class MultiresSpinUp {
+public:
+    /**
+     * @brief      Result of a single level of the spin-up
+     */
+    struct Level {
+        unsigned int width = 0;     //!< width of the grid
+        unsigned int height = 0;    //!< height of the grid
+        double dx = 0.0;            //!< grid spacing
+        double dt = 0.0;            //!< time step
+        unsigned int nsteps = 0;    //!< number of time steps integrated
+        double time = 0.0;          //!< time integrated
+        double wavelength = 0.0;    //!< dominant wavelength at the end of the level
+        bool stable = false;        //!< whether the wavelength was stable
+        double seconds = 0.0;       //!< wall time of the level
+    };
+
+private:
+    std::string description;        //!< specification of the spin-up
+    unsigned int levels = 2;        //!< number of coarsening levels
+    std::string field = "A";        //!< species whose wavelength is followed
+    double tolerance = 0.02;        //!< relative change of the wavelength below which it is stable
+    unsigned int checks = 3;        //!< number of consecutive stable checks that end a level
+    double interval = 0.0;          //!< time between checks (0 = one frame)
+    double max_time = 0.0;          //!< maximum time per level (0 = the full run)
+    double dt_factor = 4.0;         //!< growth of the time step per level
+
+    std::vector<Level> results;     //!< result per level, from coarse to fine
+    double direct_seconds = 0.0;    //!< estimated wall time of the spin-up on the requested grid
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec           specification of the spin-up
+     * @param[in]  species_names  names of all species
+     * @param[in]  width          width of the requested grid
+     * @param[in]  height         height of the requested grid
+     */
+    MultiresSpinUp(const std::string& spec, const std::vector<std::string>& species_names,
+                   unsigned int width, unsigned int height);
+
+    /**
+     * @brief      Get the time step of a level
+     *
+     * @param[in]  dt     time step of the requested grid
+     * @param[in]  level  level (0 = the requested grid)
+     * @param[in]  dx     grid spacing of the level
+     * @param[in]  D      largest diffusion coefficient
+     *
+     * @return     time step
+     */
+    double get_time_step(double dt, unsigned int level, double dx, double D) const;
+
+    /**
+     * @brief      Whether the last wavelengths are stable
+     *
+     * @param[in]  wavelengths  dominant wavelength per check (0 = no pattern)
+     */
+    bool is_stable(const std::vector<double>& wavelengths) const;
+
+    /**
+     * @brief      Interpolate a field bilinearly onto a grid that is twice as fine
+     *
+     * The grid points are the centers of the cells, such that a coarse cell
+     * covers four fine cells.
+     *
+     * @param[in]  coarse  field on the coarse grid
+     * @param      fine    field on the fine grid (resized)
+     * @param[in]  pbc     whether periodic boundary conditions are used
+     */
+    static void prolongate(const MatrixXXd& coarse, MatrixXXd& fine, bool pbc);
+
+    /**
+     * @brief      Record the result of a level
+     *
+     * @param[in]  level  The level
+     */
+    void add_level(const Level& level);
+
+    /**
+     * @brief      Estimate the wall time of the spin-up on the requested grid
+     *
+     * @param[in]  seconds_per_step  wall time of a time step on the requested grid
+     * @param[in]  dt                time step on the requested grid
+     */
+    void set_step_cost(double seconds_per_step, double dt);
+
+    /**
+     * @brief      Add the levels and the time saved to the metadata
+     *
+     * @param      metadata  The metadata
+     */
+    void add_metadata(OutputMetadata& metadata) const;
+
+    /**
+     * @brief      Get the total time integrated by the spin-up
+     */
+    double get_time() const;
+
+    /**
+     * @brief      Get the total wall time of the spin-up
+     */
+    double get_seconds() const;
+
+    /**
+     * @brief      Get the number of coarsening levels
+     */
+    inline unsigned int get_levels() const {
+        return this->levels;
+    }
+
+    /**
+     * @brief      Get the species whose wavelength is followed
+     */
+    inline const std::string& get_field() const {
+        return this->field;
+    }
+
+    /**
+     * @brief      Get the time between checks (0 = one frame)
+     */
+    inline double get_interval() const {
+        return this->interval;
+    }
+
+    /**
+     * @brief      Get the maximum time per level (0 = the full run)
+     */
+    inline double get_max_time() const {
+        return this->max_time;
+    }
+
+    /**
+     * @brief      Get the result per level, from coarse to fine
+     */
+    inline const std::vector<Level>& get_results() const {
+        return this->results;
+    }
+
+    /**
+     * @brief      Get the estimated wall time of the spin-up on the requested grid
+     */
+    inline double get_direct_seconds() const {
+        return this->direct_seconds;
+    }
+
+    /**
+     * @brief      Get the specification of the spin-up
+     */
+    inline const std::string& get_description() const {
+        return this->description;
+    }
+};
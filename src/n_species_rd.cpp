@@ -0,0 +1,400 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "n_species_rd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _D       Diffusion coefficients per species
+ * @param[in]  _width   width of the system
+ * @param[in]  _height  height of the system
+ * @param[in]  _dx      size of the space interval
+ * @param[in]  _dt      size of the time interval
+ * @param[in]  _steps   number of frames
+ * @param[in]  _tsteps  number of time steps when to write a frame
+ */
+template<unsigned int N>
+NSpeciesRD<N>::NSpeciesRD(const std::array<double, N>& _D,
+                          unsigned int _width, unsigned int _height,
+                          double _dx, double _dt, unsigned int _steps, unsigned int _tsteps) :
+    D(_D),
+    width(_width),
+    height(_height),
+    dx(_dx),
+    dt(_dt),
+    steps(_steps),
+    tsteps(_tsteps) {
+
+    this->rates.fill(0.0);
+}
+
+template<unsigned int N>
+void NSpeciesRD<N>::set_reaction(ReactionSystem* _reaction_system) {
+    if(_reaction_system->get_nr_species() != N) {
+        throw std::runtime_error("Reaction system has " + std::to_string(_reaction_system->get_nr_species()) +
+                                 " species, expected " + std::to_string(N));
+    }
+
+    this->reaction_system = std::unique_ptr<ReactionSystem>(_reaction_system);
+}
+
+/**
+ * @brief      Sets the convergence monitor.
+ *
+ * @param      _convergence_monitor  The convergence monitor
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::set_convergence_monitor(ConvergenceMonitor* _convergence_monitor) {
+    this->convergence_monitor = std::unique_ptr<ConvergenceMonitor>(_convergence_monitor);
+}
+
+/**
+ * @brief      Perform time integration
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::time_integrate() {
+    this->t = 0;
+
+    // the face coefficients depend on the boundary conditions
+    if(this->diffusion_field) {
+        this->diffusion_field->prepare(this->pbc);
+    }
+
+    if(this->renderer) {
+        this->renderer->push(0, this->field_pointers(this->c));
+    }
+
+    if(this->analysis) {
+        this->analysis->analyze(0, this->t, this->field_pointers(this->c));
+    }
+
+    if(this->features) {
+        this->features->extract(0, this->t, this->field_pointers(this->c));
+    }
+
+    // only the reduced initial frame is kept
+    if(this->output_spec) {
+        this->output_spec->record(0, this->field_pointers(this->frames[0]));
+        this->frames.clear();
+    }
+
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+
+    if(this->metrics) {
+        if(this->renderer) {
+            this->metrics->add_backlog_source([this]() { return this->renderer->get_backlog(); });
+        }
+        this->metrics->start();
+    }
+
+    for(int i : tq::trange(this->steps)) {
+        for(unsigned int j=0; j<this->tsteps; j++) {
+            // the rate of change is only needed at the end of a frame
+            this->track_rates = (monitor != nullptr && j == this->tsteps - 1);
+            this->update();
+
+            if(this->metrics) {
+                this->metrics->progress(this->t);
+            }
+
+            if(monitor != nullptr && monitor->detects_periodic()) {
+                monitor->add_sample(this->t, this->sample_probes());
+            }
+        }
+
+        this->nr_frames++;
+        if(this->output_spec) {
+            this->output_spec->record(this->nr_frames, this->field_pointers(this->c));
+        } else {
+            this->frames.push_back(this->c);
+        }
+
+        if(this->renderer) {
+            this->renderer->push(this->nr_frames, this->field_pointers(this->c));
+        }
+
+        if(this->analysis) {
+            this->analysis->analyze(this->nr_frames, this->t, this->field_pointers(this->c));
+        }
+
+        if(this->features) {
+            this->features->extract(this->nr_frames, this->t, this->field_pointers(this->c));
+        }
+
+        if(monitor != nullptr) {
+            // all species after A are checked through the largest of their rates
+            const double rate_rest = *std::max_element(this->rates.begin() + 1, this->rates.end());
+            const bool steady = monitor->check_frame(this->t, this->rates[0], rate_rest);
+            if(this->metrics) {
+                this->metrics->set_norm(*std::max_element(this->rates.begin(), this->rates.end()));
+            }
+            if(steady) {
+                break;
+            }
+        }
+    }
+
+    // give newline after tqdm progress bar
+    std::cout << std::endl;
+
+    if(this->output_spec) {
+        this->output_spec->record(this->nr_frames, this->field_pointers(this->c), true);
+    }
+
+    if(this->renderer) {
+        this->renderer->finish();
+        std::cout << "Rendered " << this->renderer->get_nr_frames() << " frames." << std::endl;
+    }
+
+    if(this->analysis) {
+        this->analysis->write();
+        std::cout << "Wrote the analysis of " << this->analysis->get_nr_frames() << " frames to "
+                  << this->analysis->get_filename() << "." << std::endl;
+    }
+
+    if(this->features) {
+        this->features->write();
+        std::cout << "Wrote the features of " << this->features->get_nr_frames() << " frames to "
+                  << this->features->get_filename() << "." << std::endl;
+    }
+
+    if(monitor != nullptr && monitor->is_converged()) {
+        if(monitor->is_periodic()) {
+            std::cout << "Periodic steady state reached at t = " << monitor->get_convergence_time()
+                      << " (period T = " << monitor->get_period() << ")." << std::endl;
+        } else {
+            std::cout << "Steady state reached at t = " << monitor->get_convergence_time()
+                      << "." << std::endl;
+        }
+        std::cout << "Terminating after " << this->nr_frames << " of " << this->steps
+                  << " frames." << std::endl;
+    }
+
+    if(this->metrics) {
+        this->metrics->finish();
+    }
+}
+
+/**
+ * @brief      Write the frames to the file
+ *
+ * @param[in]  filename  The filename
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::write_state_to_file(const std::string& filename) {
+    if(this->output_spec) {
+        this->output_spec->write(filename, this->chunk_size, this->compression, this->quantization);
+        return;
+    }
+
+    FrameWriter writer(filename, this->width, this->height, this->chunk_size, this->compression,
+                       this->quantization);
+
+    for(const auto& frame : this->frames) {
+        writer.write_frame(this->field_pointers(frame), frame[0].size());
+    }
+
+    writer.close();
+}
+
+/**
+ * @brief      Write run metadata (JSON) to file
+ *
+ * @param[in]  filename  The filename
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::write_metadata_to_file(const std::string& filename) {
+    OutputMetadata metadata;
+
+    metadata.set("width", this->width);
+    metadata.set("height", this->height);
+    metadata.set("frames", this->nr_frames);
+    metadata.set("frames_requested", this->steps);
+    metadata.set("tsteps", this->tsteps);
+    metadata.set("dx", this->dx);
+    metadata.set("dt", this->dt);
+    metadata.set("D", std::vector<double>(this->D.begin(), this->D.end()));
+    metadata.set("species", N);
+    metadata.set("species_names", this->reaction_system->get_species_names());
+    metadata.set("pbc", this->pbc);
+    metadata.set("stencil", (unsigned int)this->stencil);
+    metadata.set("t_final", this->t);
+
+    if(this->diffusion_field) {
+        metadata.set("diffusion_field", this->diffusion_field->get_description());
+    }
+
+    if(this->output_spec) {
+        this->output_spec->add_metadata(metadata, this->chunk_size);
+    }
+
+    if(this->chunk_size > 0) {
+        metadata.set("layout", "chunked");
+        metadata.set("chunk_size", this->chunk_size);
+        metadata.set("compression", (unsigned int)this->compression);
+        if(!this->quantization.empty()) {
+            metadata.set("quantization", this->quantization);
+        }
+    }
+
+    const ConvergenceMonitor* monitor = this->convergence_monitor.get();
+    if(monitor != nullptr) {
+        metadata.set("converged", monitor->is_converged());
+        metadata.set("periodic", monitor->is_periodic());
+        if(monitor->is_converged()) {
+            metadata.set("convergence_time", monitor->get_convergence_time());
+        }
+        if(monitor->is_periodic()) {
+            metadata.set("period", monitor->get_period());
+        }
+        metadata.set("rates", std::vector<double>(this->rates.begin(), this->rates.end()));
+    }
+
+    metadata.write(filename);
+}
+
+/**
+ * @brief      Initialize the system
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::init() {
+    std::vector<MatrixXXd> init(N, MatrixXXd::Zero(this->width, this->height));
+    this->reaction_system->init_species(init);
+
+    for(unsigned int s=0; s<N; s++) {
+        this->c[s] = init[s];
+        this->delta[s] = MatrixXXd::Zero(this->width, this->height);
+    }
+
+    this->frames.push_back(this->c);
+}
+
+/**
+ * @brief      Perform a time-step
+ */
+template<unsigned int N>
+void NSpeciesRD<N>::update() {
+    const int rows = this->width;
+    const int cols = this->height;
+
+    #pragma omp parallel
+    {
+        // reaction terms of a single column
+        std::vector<double> buffer(N * rows);
+
+        #pragma omp for schedule(static)
+        for(int j=0; j<cols; j++) {
+            const double* cp[N];
+            double* rp[N];
+
+            for(unsigned int s=0; s<N; s++) {
+                if(this->diffusion_field) {
+                    this->diffusion_field->divergence_block(this->delta[s], this->c[s], this->dx, 0, rows, j, j+1);
+                } else {
+                    laplacian_block(this->delta[s], this->c[s], this->dx, this->stencil, this->pbc, 0, rows, j, j+1);
+                }
+                cp[s] = &this->c[s](0, j);
+                rp[s] = &buffer[s * rows];
+            }
+
+            this->reaction_system->reaction_batch(cp, rp, rows);
+
+            for(unsigned int s=0; s<N; s++) {
+                double* d = &this->delta[s](0, j);
+                const double Ds = this->D[s];
+                for(int i=0; i<rows; i++) {
+                    d[i] = d[i] * Ds + rp[s][i];
+                }
+            }
+        }
+    }
+
+    // multiply with time step and add delta term to concentrations
+    const long int n = (long int)rows * cols;
+    for(unsigned int s=0; s<N; s++) {
+        double* pc = this->c[s].data();
+        const double* pd = this->delta[s].data();
+        const double dt = this->dt;
+
+        if(this->track_rates) {
+            double max_dc = 0.0;
+
+            #pragma omp parallel for schedule(static) reduction(max:max_dc)
+            for(long int k=0; k<n; k++) {
+                const double dc = dt * pd[k];
+                pc[k] += dc;
+                max_dc = std::max(max_dc, std::fabs(dc));
+            }
+
+            this->rates[s] = max_dc / dt;
+        } else {
+            #pragma omp parallel for schedule(static)
+            for(long int k=0; k<n; k++) {
+                pc[k] += dt * pd[k];
+            }
+        }
+    }
+
+    this->t += this->dt;
+}
+
+/**
+ * @brief      Sample the first species at the probe points of the convergence monitor
+ *
+ * @return     probe values
+ */
+template<unsigned int N>
+std::vector<double> NSpeciesRD<N>::sample_probes() const {
+    const unsigned int rows = this->c[0].rows();
+    const unsigned int cols = this->c[0].cols();
+
+    return {
+        this->c[0](rows / 2, cols / 2),
+        this->c[0](rows / 4, cols / 4),
+        this->c[0](3 * rows / 4, 3 * cols / 4)
+    };
+}
+
+/**
+ * @brief      Get pointers to the concentrations of all species
+ *
+ * @param[in]  fields  concentrations per species
+ *
+ * @return     pointer per species
+ */
+template<unsigned int N>
+std::vector<const double*> NSpeciesRD<N>::field_pointers(const std::array<MatrixXXd, N>& fields) {
+    std::vector<const double*> pointers;
+    for(unsigned int s=0; s<N; s++) {
+        pointers.push_back(fields[s].data());
+    }
+    return pointers;
+}
+
+// the common numbers of species
+template class NSpeciesRD<2>;
+template class NSpeciesRD<3>;
+template class NSpeciesRD<4>;
@@ -0,0 +1,268 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "reaction_system.h"
+#include "laplacian.h"
+#include "diffusion_field.h"
+#include "convergence_monitor.h"
+#include "output_metadata.h"
+#include "output_spec.h"
+#include "frame_renderer.h"
+#include "field_analysis.h"
+#include "feature_extractor.h"
+#include "metrics_exporter.h"
+#include "frame_writer.h"
+#include "tqdm.hpp"
+
+/**
+ * @brief      Two-dimensional reaction-diffusion system with N species
+ *
+ * Every species is stored in its own matrix (structure of arrays) and has
+ * its own diffusion coefficient. The reaction terms are evaluated per
+ * column of the grid via ReactionSystem::reaction_batch(). The class is
+ * compiled for N = 2, 3 and 4.
+ */
+template<unsigned int N>
+class NSpeciesRD {
+private:
+    std::array<double, N> D;    //!< Diffusion coefficients per species
+
+    unsigned int width;     //!< width of the system
+    unsigned int height;    //!< height of the system
+    double dx;              //!< size of the space interval
+    double dt;              //!< size of the time interval
+    unsigned int steps;     //!< number of frames
+    unsigned int tsteps;    //!< number of time steps when to write a frame
+
+    std::array<MatrixXXd, N> c;         //!< concentrations per species
+    std::array<MatrixXXd, N> delta;     //!< increments per species
+
+    std::vector<std::array<MatrixXXd, N>> frames;   //!< concentrations per frame
+    unsigned int nr_frames = 0;                     //!< number of frames integrated
+
+    std::unique_ptr<OutputSpec> output_spec;    //!< Optional selection and reduction of the output
+    std::unique_ptr<FrameRenderer> renderer;    //!< Optional rendering of the frames to images
+    std::unique_ptr<FieldAnalysis> analysis;    //!< Optional statistics and spectra of the frames
+    std::unique_ptr<FeatureExtractor> features; //!< Optional spots and spiral tips of the frames
+    unsigned int chunk_size = 0;    //!< edge length of the chunks of the output (0 = contiguous frames)
+    int compression = 0;            //!< zlib compression level of the chunks
+    std::string quantization;       //!< quantization of the chunks (see FrameQuantizer, empty = none)
+
+    double t = 0.0;     //!< Total time t
+
+    std::unique_ptr<ReactionSystem> reaction_system;    //!< Pointer to reaction system
+
+    bool pbc = true;    //!< Whether to employ periodic boundary conditions
+
+    LaplacianStencil stencil = STENCIL_5POINT;  //!< finite difference stencil of the Laplacian
+
+    std::unique_ptr<DiffusionField> diffusion_field;    //!< Optional heterogeneous medium
+
+    std::unique_ptr<ConvergenceMonitor> convergence_monitor;   //!< Optional steady-state detection
+
+    std::unique_ptr<MetricsExporter> metrics;   //!< Optional status file, rewritten while integrating
+
+    bool track_rates = false;       //!< Whether update() tracks the rate of change
+    std::array<double, N> rates;    //!< max|dc/dt| per species of the last tracked time step
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _D       Diffusion coefficients per species
+     * @param[in]  _width   width of the system
+     * @param[in]  _height  height of the system
+     * @param[in]  _dx      size of the space interval
+     * @param[in]  _dt      size of the time interval
+     * @param[in]  _steps   number of frames
+     * @param[in]  _tsteps  number of time steps when to write a frame
+     */
+    NSpeciesRD(const std::array<double, N>& _D,
+               unsigned int _width, unsigned int _height,
+               double _dx, double _dt, unsigned int _steps, unsigned int _tsteps);
+
+    /**
+     * @brief      Sets the reaction.
+     *
+     * @param      _reaction_system  The reaction system
+     */
+    void set_reaction(ReactionSystem* _reaction_system);
+
+    /**
+     * @brief      Set whether system has periodic boundary conditions
+     *
+     * @param[in]  _pbc  Periodic boundary conditions
+     */
+    inline void set_pbc(bool _pbc) {
+        this->pbc = _pbc;
+    }
+
+    /**
+     * @brief      Set the finite difference stencil of the Laplacian
+     *
+     * @param[in]  _stencil  The stencil
+     */
+    inline void set_stencil(LaplacianStencil _stencil) {
+        this->stencil = _stencil;
+    }
+
+    /**
+     * @brief      Set a spatially varying (and possibly anisotropic) medium
+     *
+     * @param      _diffusion_field  The diffusion field
+     */
+    inline void set_diffusion_field(DiffusionField* _diffusion_field) {
+        this->diffusion_field = std::unique_ptr<DiffusionField>(_diffusion_field);
+    }
+
+    /**
+     * @brief      Select, crop and downsample the fields that are written
+     *
+     * @param      _output_spec  The output specification
+     */
+    inline void set_output_spec(OutputSpec* _output_spec) {
+        this->output_spec = std::unique_ptr<OutputSpec>(_output_spec);
+    }
+
+    /**
+     * @brief      Store the output as (optionally compressed) chunks
+     *
+     * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  _compression   zlib compression level of the chunks
+     * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    inline void set_chunking(unsigned int _chunk_size, int _compression, const std::string& _quantization = "") {
+        this->chunk_size = _chunk_size;
+        this->compression = _compression;
+        this->quantization = _quantization;
+    }
+
+    /**
+     * @brief      Render the frames to images while integrating
+     *
+     * @param      _renderer  The renderer
+     */
+    inline void set_renderer(FrameRenderer* _renderer) {
+        this->renderer = std::unique_ptr<FrameRenderer>(_renderer);
+    }
+
+    /**
+     * @brief      Compute statistics and power spectra of the frames while integrating
+     *
+     * @param      _analysis  The analysis
+     */
+    inline void set_analysis(FieldAnalysis* _analysis) {
+        this->analysis = std::unique_ptr<FieldAnalysis>(_analysis);
+    }
+
+    /**
+     * @brief      Extract spots and spiral tips from the frames while integrating
+     *
+     * @param      _features  The feature extractor
+     */
+    inline void set_features(FeatureExtractor* _features) {
+        this->features = std::unique_ptr<FeatureExtractor>(_features);
+    }
+
+    /**
+     * @brief      Periodically write the progress of the integration to a status file
+     *
+     * @param      _metrics  The metrics exporter
+     */
+    inline void set_metrics(MetricsExporter* _metrics) {
+        this->metrics = std::unique_ptr<MetricsExporter>(_metrics);
+    }
+
+    /**
+     * @brief      Sets the convergence monitor.
+     *
+     * The rates of the first two species are reported to the monitor.
+     *
+     * @param      _convergence_monitor  The convergence monitor
+     */
+    void set_convergence_monitor(ConvergenceMonitor* _convergence_monitor);
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    inline void set_parameters(const std::string& params) {
+        this->reaction_system->set_parameters(params);
+        this->init();
+    }
+
+    /**
+     * @brief      Perform time integration
+     */
+    void time_integrate();
+
+    /**
+     * @brief      Write the frames to the file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_state_to_file(const std::string& filename);
+
+    /**
+     * @brief      Write run metadata (JSON) to file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_metadata_to_file(const std::string& filename);
+
+private:
+    /**
+     * @brief      Initialize the system
+     */
+    void init();
+
+    /**
+     * @brief      Perform a time-step
+     */
+    void update();
+
+    /**
+     * @brief      Sample the first species at the probe points of the convergence monitor
+     *
+     * @return     probe values
+     */
+    std::vector<double> sample_probes() const;
+
+    /**
+     * @brief      Get pointers to the concentrations of all species
+     *
+     * @param[in]  fields  concentrations per species
+     *
+     * @return     pointer per species
+     */
+    static std::vector<const double*> field_pointers(const std::array<MatrixXXd, N>& fields);
+};
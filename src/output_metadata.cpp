@@ -0,0 +1,240 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "output_metadata.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief      Constructs the object.
+ */
+OutputMetadata::OutputMetadata() {
+
+}
+
+/**
+ * @brief      Set a floating point value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, double value) {
+    this->set_raw(key, encode(value));
+}
+
+/**
+ * @brief      Set an integer value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, long long value) {
+    this->set_raw(key, std::to_string(value));
+}
+
+/**
+ * @brief      Set an unsigned integer value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, unsigned int value) {
+    this->set_raw(key, std::to_string(value));
+}
+
+/**
+ * @brief      Set a boolean value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, bool value) {
+    this->set_raw(key, value ? "true" : "false");
+}
+
+/**
+ * @brief      Set a string value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, const std::string& value) {
+    this->set_raw(key, encode(value));
+}
+
+/**
+ * @brief      Set a string value
+ *
+ * @param[in]  key    The key
+ * @param[in]  value  The value
+ */
+void OutputMetadata::set(const std::string& key, const char* value) {
+    this->set_raw(key, encode(std::string(value)));
+}
+
+/**
+ * @brief      Set an array of floating point values
+ *
+ * @param[in]  key     The key
+ * @param[in]  values  The values
+ */
+void OutputMetadata::set(const std::string& key, const std::vector<double>& values) {
+    std::string json = "[";
+    for(unsigned int i=0; i<values.size(); i++) {
+        if(i != 0) {
+            json += ", ";
+        }
+        json += encode(values[i]);
+    }
+    json += "]";
+    this->set_raw(key, json);
+}
+
+/**
+ * @brief      Set an array of strings
+ *
+ * @param[in]  key     The key
+ * @param[in]  values  The values
+ */
+void OutputMetadata::set(const std::string& key, const std::vector<std::string>& values) {
+    std::string json = "[";
+    for(unsigned int i=0; i<values.size(); i++) {
+        if(i != 0) {
+            json += ", ";
+        }
+        json += encode(values[i]);
+    }
+    json += "]";
+    this->set_raw(key, json);
+}
+
+/**
+ * @brief      Set a value that is already JSON encoded
+ *
+ * @param[in]  key   The key
+ * @param[in]  json  JSON encoded value
+ */
+void OutputMetadata::set_raw(const std::string& key, const std::string& json) {
+    for(auto& entry : this->entries) {
+        if(entry.first == key) {
+            entry.second = json;
+            return;
+        }
+    }
+
+    this->entries.emplace_back(key, json);
+}
+
+/**
+ * @brief      Write metadata to file
+ *
+ * @param[in]  filename  The filename
+ */
+void OutputMetadata::write(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::out | std::ios::trunc);
+    if(!out.is_open()) {
+        throw std::runtime_error("Cannot open " + filename + " for writing");
+    }
+
+    out << "{" << std::endl;
+    for(unsigned int i=0; i<this->entries.size(); i++) {
+        out << "    " << encode(this->entries[i].first) << ": " << this->entries[i].second;
+        if(i != this->entries.size() - 1) {
+            out << ",";
+        }
+        out << std::endl;
+    }
+    out << "}" << std::endl;
+
+    out.close();
+}
+
+/**
+ * @brief      Encode a floating point value as JSON
+ *
+ * @param[in]  value  The value
+ *
+ * @return     JSON representation
+ */
+std::string OutputMetadata::encode(double value) {
+    // JSON has no representation for inf and nan
+    if(!std::isfinite(value)) {
+        return "null";
+    }
+
+    std::ostringstream ss;
+    ss.precision(std::numeric_limits<double>::max_digits10);
+    ss << value;
+    return ss.str();
+}
+
+/**
+ * @brief      Encode a string as JSON
+ *
+ * @param[in]  value  The value
+ *
+ * @return     JSON representation
+ */
+std::string OutputMetadata::encode(const std::string& value) {
+    std::string json = "\"";
+    for(char c : value) {
+        switch(c) {
+            case '"':
+                json += "\\\"";
+            break;
+            case '\\':
+                json += "\\\\";
+            break;
+            case '\n':
+                json += "\\n";
+            break;
+            case '\t':
+                json += "\\t";
+            break;
+            case '\r':
+                json += "\\r";
+            break;
+            case '\b':
+                json += "\\b";
+            break;
+            case '\f':
+                json += "\\f";
+            break;
+            default:
+                // other control characters are not allowed in a JSON string
+                if((unsigned char)c < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)c);
+                    json += escaped;
+                } else {
+                    json += c;
+                }
+            break;
+        }
+    }
+    json += "\"";
+    return json;
+}
@@ -0,0 +1,140 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief      Metadata of a simulation run, written as a flat JSON object
+ *
+ * The metadata accompanies the binary output file and records everything
+ * that does not fit in its fixed header.
+ */
+class OutputMetadata {
+private:
+    std::vector<std::pair<std::string, std::string>> entries;  //!< keys and JSON encoded values
+
+public:
+    /**
+     * @brief      Constructs the object.
+     */
+    OutputMetadata();
+
+    /**
+     * @brief      Set a floating point value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, double value);
+
+    /**
+     * @brief      Set an integer value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, long long value);
+
+    /**
+     * @brief      Set an unsigned integer value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, unsigned int value);
+
+    /**
+     * @brief      Set a boolean value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, bool value);
+
+    /**
+     * @brief      Set a string value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, const std::string& value);
+
+    /**
+     * @brief      Set a string value
+     *
+     * @param[in]  key    The key
+     * @param[in]  value  The value
+     */
+    void set(const std::string& key, const char* value);
+
+    /**
+     * @brief      Set an array of floating point values
+     *
+     * @param[in]  key     The key
+     * @param[in]  values  The values
+     */
+    void set(const std::string& key, const std::vector<double>& values);
+
+    /**
+     * @brief      Set an array of strings
+     *
+     * @param[in]  key     The key
+     * @param[in]  values  The values
+     */
+    void set(const std::string& key, const std::vector<std::string>& values);
+
+    /**
+     * @brief      Set a value that is already JSON encoded
+     *
+     * @param[in]  key   The key
+     * @param[in]  json  JSON encoded value
+     */
+    void set_raw(const std::string& key, const std::string& json);
+
+    /**
+     * @brief      Write metadata to file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write(const std::string& filename) const;
+
+    /**
+     * @brief      Encode a floating point value as JSON
+     *
+     * @param[in]  value  The value
+     *
+     * @return     JSON representation
+     */
+    static std::string encode(double value);
+
+    /**
+     * @brief      Encode a string as JSON
+     *
+     * @param[in]  value  The value
+     *
+     * @return     JSON representation
+     */
+    static std::string encode(const std::string& value);
+};
@@ -0,0 +1,370 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "output_spec.h"
+#include "frame_writer.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec           specification of the output
+ * @param[in]  species_names  names of all species
+ * @param[in]  _width         width of the system
+ * @param[in]  _height        height of the system
+ */
+OutputSpec::OutputSpec(const std::string& spec, const std::vector<std::string>& species_names,
+                       unsigned int _width, unsigned int _height) :
+    width(_width),
+    height(_height),
+    names(species_names),
+    roi_width(_width),
+    roi_height(_height) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid output specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "fields" && key != "roi" && key != "stride" && key != "filter" && key != "every") {
+            throw std::runtime_error("Invalid output specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    auto split_list = [](const std::string& list) {
+        std::vector<std::string> items;
+        boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+        for(std::string& item : items) {
+            boost::trim(item);
+        }
+        return items;
+    };
+
+    // species are given by name or by index
+    auto find_species = [&](const std::string& name) {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            if(this->names[s] == name) {
+                return s;
+            }
+        }
+        if(!name.empty() && name.find_first_not_of("0123456789") == std::string::npos &&
+           std::stoul(name) < this->names.size()) {
+            return (unsigned int)std::stoul(name);
+        }
+        throw std::runtime_error("Invalid output specification: unknown species " + name);
+    };
+
+    // selected species; none when only the analysis of the frames is of interest
+    if(params.count("fields") > 0 && params["fields"] == "none") {
+        this->fields.clear();
+    } else if(params.count("fields") > 0) {
+        for(const std::string& name : split_list(params["fields"])) {
+            this->fields.push_back(find_species(name));
+        }
+    } else {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            this->fields.push_back(s);
+        }
+    }
+
+    // region of interest
+    if(params.count("roi") > 0) {
+        const std::vector<std::string> roi = split_list(params["roi"]);
+        if(roi.size() != 4) {
+            throw std::runtime_error("Invalid output specification: roi requires x,y,width,height");
+        }
+        this->x0 = boost::lexical_cast<unsigned int>(roi[0]);
+        this->y0 = boost::lexical_cast<unsigned int>(roi[1]);
+        this->roi_width = boost::lexical_cast<unsigned int>(roi[2]);
+        this->roi_height = boost::lexical_cast<unsigned int>(roi[3]);
+        if(this->roi_width == 0 || this->roi_height == 0 ||
+           this->x0 + this->roi_width > this->width || this->y0 + this->roi_height > this->height) {
+            throw std::runtime_error("Invalid output specification: roi exceeds the system");
+        }
+    }
+
+    // downsampling
+    if(params.count("stride") > 0) {
+        this->stride = boost::lexical_cast<unsigned int>(params["stride"]);
+    }
+    if(this->stride == 0 || this->stride > this->roi_width || this->stride > this->roi_height) {
+        throw std::runtime_error("Invalid output specification: stride has to lie between 1 and the size of the region");
+    }
+    if(params.count("filter") > 0) {
+        if(params["filter"] == "box") {
+            this->box = true;
+        } else if(params["filter"] != "sample") {
+            throw std::runtime_error("Invalid output specification: filter " + params["filter"] + " (choose sample or box)");
+        }
+    }
+    this->out_width = this->roi_width / this->stride;
+    this->out_height = this->roi_height / this->stride;
+
+    // output cadence per species
+    this->every.assign(this->fields.size(), 1);
+    if(params.count("every") > 0) {
+        for(const std::string& item : split_list(params["every"])) {
+            const size_t colon = item.find(':');
+            if(colon == std::string::npos) {
+                std::fill(this->every.begin(), this->every.end(), boost::lexical_cast<unsigned int>(item));
+                continue;
+            }
+            const unsigned int s = find_species(boost::trim_copy(item.substr(0, colon)));
+            const unsigned int n = boost::lexical_cast<unsigned int>(boost::trim_copy(item.substr(colon + 1)));
+            bool found = false;
+            for(unsigned int f=0; f<this->fields.size(); f++) {
+                if(this->fields[f] == s) {
+                    this->every[f] = n;
+                    found = true;
+                }
+            }
+            if(!found) {
+                throw std::runtime_error("Invalid output specification: species " + this->names[s] + " is not written");
+            }
+        }
+        for(unsigned int n : this->every) {
+            if(n == 0) {
+                throw std::runtime_error("Invalid output specification: every has to be positive");
+            }
+        }
+    }
+
+    this->last_frame.assign(this->fields.size(), -1);
+}
+
+/**
+ * @brief      Reduce the species that are due at a frame
+ *
+ * @param[in]  frame  frame number
+ * @param[in]  c      concentrations of all species (column-major, width x height)
+ * @param[in]  final  whether this is the last frame, at which all selected species are written
+ */
+void OutputSpec::record(unsigned int frame, const std::vector<const double*>& c, bool final) {
+    std::vector<unsigned int> due;
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        if(this->last_frame[f] == (int)frame) {
+            continue;
+        }
+        if(frame == 0 || final || frame % this->every[f] == 0) {
+            due.push_back(f);
+        }
+    }
+
+    if(due.empty()) {
+        return;
+    }
+
+    Snapshot snapshot;
+    snapshot.frame = frame;
+    for(unsigned int f : due) {
+        snapshot.fields.push_back(this->fields[f]);
+        snapshot.data.emplace_back((size_t)this->out_width * this->out_height);
+        this->last_frame[f] = frame;
+    }
+
+    // all columns of all due species are reduced in a single parallel loop
+    const unsigned int n = due.size() * this->out_height;
+    #pragma omp parallel for
+    for(unsigned int k=0; k<n; k++) {
+        const unsigned int f = k / this->out_height;
+        this->reduce_column(c[snapshot.fields[f]], snapshot.data[f].data(), k % this->out_height);
+    }
+
+    // a final frame that coincides with a regular frame extends it, keeping
+    // the species in the order of the selection
+    if(!this->snapshots.empty() && this->snapshots.back().frame == frame) {
+        Snapshot& last = this->snapshots.back();
+        Snapshot merged;
+        merged.frame = frame;
+        for(unsigned int s : this->fields) {
+            for(Snapshot* part : {&last, &snapshot}) {
+                for(unsigned int f=0; f<part->fields.size(); f++) {
+                    if(part->fields[f] == s) {
+                        merged.fields.push_back(s);
+                        merged.data.push_back(std::move(part->data[f]));
+                    }
+                }
+            }
+        }
+        last = std::move(merged);
+        return;
+    }
+
+    this->snapshots.push_back(std::move(snapshot));
+}
+
+/**
+ * @brief      Write the reduced frames to the file
+ *
+ * Nothing is written when no species are selected.
+ *
+ * @param[in]  filename     The filename
+ * @param[in]  chunk_size    edge length of a chunk (0 = contiguous frames)
+ * @param[in]  compression   zlib compression level of the chunks
+ * @param[in]  quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+ */
+void OutputSpec::write(const std::string& filename, unsigned int chunk_size, int compression,
+                       const std::string& quantization) const {
+    if(this->fields.empty()) {
+        return;
+    }
+
+    FrameWriter writer(filename, this->out_width, this->out_height, chunk_size, compression, quantization);
+
+    for(const Snapshot& snapshot : this->snapshots) {
+        std::vector<const double*> data;
+        for(const auto& field : snapshot.data) {
+            data.push_back(field.data());
+        }
+        writer.write_frame(data, (size_t)this->out_width * this->out_height);
+    }
+
+    writer.close();
+}
+
+/**
+ * @brief      Add the selection and the index of the frames to the metadata
+ *
+ * @param      metadata    The metadata
+ * @param[in]  chunk_size  edge length of the chunks of the output (0 = contiguous frames)
+ */
+void OutputSpec::add_metadata(OutputMetadata& metadata, unsigned int chunk_size) const {
+    std::vector<std::string> selected;
+    for(unsigned int s : this->fields) {
+        selected.push_back(this->names[s]);
+    }
+    metadata.set("output_fields", selected);
+    metadata.set("output_every", std::vector<double>(this->every.begin(), this->every.end()));
+    metadata.set("output_roi", std::vector<double>{(double)this->x0, (double)this->y0,
+                                                   (double)this->roi_width, (double)this->roi_height});
+    metadata.set("output_stride", this->stride);
+    metadata.set("output_filter", this->box ? "box" : "sample");
+    metadata.set("output_width", this->out_width);
+    metadata.set("output_height", this->out_height);
+
+    // frames stored in the file, their species and (for contiguous frames) their offset in bytes;
+    // the chunked layout has its own index in the file
+    std::ostringstream index;
+    const size_t field_bytes = (size_t)this->out_width * this->out_height * sizeof(double);
+    size_t offset = 3 * sizeof(unsigned int);
+    index << "[";
+    for(unsigned int i=0; i<this->snapshots.size(); i++) {
+        const Snapshot& snapshot = this->snapshots[i];
+        index << (i == 0 ? "" : ", ") << "{\"frame\": " << snapshot.frame;
+        if(chunk_size == 0) {
+            index << ", \"offset\": " << offset;
+        }
+        index << ", \"fields\": [";
+        for(unsigned int f=0; f<snapshot.fields.size(); f++) {
+            index << (f == 0 ? "" : ", ") << OutputMetadata::encode(this->names[snapshot.fields[f]]);
+        }
+        index << "]}";
+        offset += snapshot.fields.size() * field_bytes;
+    }
+    index << "]";
+    metadata.set_raw("output_index", index.str());
+}
+
+/**
+ * @brief      Get a description of the output
+ */
+std::string OutputSpec::get_description() const {
+    if(this->fields.empty()) {
+        return "no frames";
+    }
+
+    std::ostringstream ss;
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        ss << (f == 0 ? "" : ", ") << this->names[this->fields[f]];
+        if(this->every[f] > 1) {
+            ss << " (every " << this->every[f] << " frames)";
+        }
+    }
+    ss << " on " << this->out_width << "x" << this->out_height;
+    if(this->roi_width != this->width || this->roi_height != this->height) {
+        ss << " from region " << this->roi_width << "x" << this->roi_height
+           << " at (" << this->x0 << "," << this->y0 << ")";
+    }
+    if(this->stride > 1) {
+        if(this->box) {
+            ss << " averaging blocks of " << this->stride << "x" << this->stride;
+        } else {
+            ss << " sampling every " << this->stride << " grid points";
+        }
+    }
+    return ss.str();
+}
+
+/**
+ * @brief      Reduce a single field
+ *
+ * @param[in]  c     concentration (column-major, width x height)
+ * @param      out   reduced field (column-major, out_width x out_height)
+ * @param[in]  q     column of the reduced field
+ */
+void OutputSpec::reduce_column(const double* c, double* out, unsigned int q) const {
+    const unsigned int s = this->stride;
+    const size_t W = this->width;
+    double* dst = out + (size_t)q * this->out_width;
+
+    if(!this->box) {
+        const double* src = c + (this->y0 + (size_t)q * s) * W + this->x0;
+        for(unsigned int p=0; p<this->out_width; p++) {
+            dst[p] = src[(size_t)p * s];
+        }
+        return;
+    }
+
+    // sum the columns of the block first, which keeps the inner loop contiguous
+    const double norm = 1.0 / (double)(s * s);
+    for(unsigned int p=0; p<this->out_width; p++) {
+        dst[p] = 0.0;
+    }
+    for(unsigned int jj=0; jj<s; jj++) {
+        const double* src = c + (this->y0 + (size_t)q * s + jj) * W + this->x0;
+        for(unsigned int p=0; p<this->out_width; p++) {
+            double sum = 0.0;
+            for(unsigned int ii=0; ii<s; ii++) {
+                sum += src[(size_t)p * s + ii];
+            }
+            dst[p] += sum;
+        }
+    }
+    for(unsigned int p=0; p<this->out_width; p++) {
+        dst[p] *= norm;
+    }
+}
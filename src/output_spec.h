@@ -0,0 +1,151 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "output_metadata.h"
+
+/**
+ * @brief      Selects, crops and downsamples the fields that are written
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     fields=A,B       species that are written by name or index (default: all, none = no file)
+ *     roi=x,y,w,h      region of interest in grid points (default: system)
+ *     stride=s         keep every s-th grid point along both directions
+ *     filter=box       average blocks of s x s grid points rather than sampling
+ *     every=A:1,B:10   write a species every n frames (or every=n for all; different
+ *                      cadences require the chunked layout)
+ *
+ * Snapshots are reduced as soon as a frame is completed, such that only the
+ * reduced data is kept in memory and written to the file. The initial and
+ * final frame always hold all selected species.
+ */
+class OutputSpec {
+private:
+    /**
+     * @brief      Reduced fields of a single frame
+     */
+    struct Snapshot {
+        unsigned int frame;                     //!< frame number
+        std::vector<unsigned int> fields;       //!< species held by the snapshot
+        std::vector<std::vector<double>> data;  //!< reduced field per species
+    };
+
+    unsigned int width;                     //!< width of the system
+    unsigned int height;                    //!< height of the system
+    std::vector<std::string> names;         //!< names of all species
+
+    std::vector<unsigned int> fields;       //!< selected species
+    std::vector<unsigned int> every;        //!< number of frames between writes per selected species
+    unsigned int x0 = 0;                    //!< first grid point of the region along the width
+    unsigned int y0 = 0;                    //!< first grid point of the region along the height
+    unsigned int roi_width;                 //!< width of the region
+    unsigned int roi_height;                //!< height of the region
+    unsigned int stride = 1;                //!< downsampling factor
+    bool box = false;                       //!< whether blocks are averaged rather than sampled
+
+    unsigned int out_width;                 //!< width of the written fields
+    unsigned int out_height;                //!< height of the written fields
+
+    std::vector<Snapshot> snapshots;        //!< reduced frames
+    std::vector<int> last_frame;            //!< last frame written per selected species
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec           specification of the output
+     * @param[in]  species_names  names of all species
+     * @param[in]  _width         width of the system
+     * @param[in]  _height        height of the system
+     */
+    OutputSpec(const std::string& spec, const std::vector<std::string>& species_names,
+               unsigned int _width, unsigned int _height);
+
+    /**
+     * @brief      Reduce the species that are due at a frame
+     *
+     * @param[in]  frame  frame number
+     * @param[in]  c      concentrations of all species (column-major, width x height)
+     * @param[in]  final  whether this is the last frame, at which all selected species are written
+     */
+    void record(unsigned int frame, const std::vector<const double*>& c, bool final = false);
+
+    /**
+     * @brief      Write the reduced frames to the file
+     *
+     * Nothing is written when no species are selected.
+     *
+     * @param[in]  filename     The filename
+     * @param[in]  chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  compression   zlib compression level of the chunks
+     * @param[in]  quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    void write(const std::string& filename, unsigned int chunk_size = 0, int compression = 0,
+               const std::string& quantization = "") const;
+
+    /**
+     * @brief      Add the selection and the index of the frames to the metadata
+     *
+     * @param      metadata    The metadata
+     * @param[in]  chunk_size  edge length of the chunks of the output (0 = contiguous frames)
+     */
+    void add_metadata(OutputMetadata& metadata, unsigned int chunk_size = 0) const;
+
+    /**
+     * @brief      Get a description of the output
+     */
+    std::string get_description() const;
+
+    /**
+     * @brief      Get the number of bytes of a frame holding all selected species
+     */
+    inline size_t get_frame_bytes() const {
+        return (size_t)this->out_width * this->out_height * this->fields.size() * sizeof(double);
+    }
+
+    /**
+     * @brief      Whether the species are written at different cadences
+     *
+     * The frames then hold different species, which only the chunked
+     * layout can describe.
+     */
+    inline bool has_mixed_cadence() const {
+        return std::adjacent_find(this->every.begin(), this->every.end(),
+                                  std::not_equal_to<unsigned int>()) != this->every.end();
+    }
+
+private:
+    /**
+     * @brief      Reduce a single field
+     *
+     * @param[in]  c     concentration (column-major, width x height)
+     * @param      out   reduced field (column-major, out_width x out_height)
+     * @param[in]  q     column of the reduced field
+     */
+    void reduce_column(const double* c, double* out, unsigned int q) const;
+};
@@ -0,0 +1,410 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "probe_recorder.h"
+#include "output_metadata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object and starts the output thread
+ *
+ * @param[in]  spec           specification of the probes
+ * @param[in]  species_names  names of all species
+ * @param[in]  _width         width of the system
+ * @param[in]  _height        height of the system
+ * @param[in]  outfile        output file of the frames; the records are written to <outfile>.probes.bin or .csv
+ */
+ProbeRecorder::ProbeRecorder(const std::string& spec, const std::vector<std::string>& species_names,
+                             unsigned int _width, unsigned int _height, const std::string& outfile) :
+    width(_width),
+    height(_height),
+    metadata_filename(outfile + ".probes.json"),
+    names(species_names) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid probe specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "points" && key != "lines" && key != "fields" && key != "every" &&
+           key != "format" && key != "buffer") {
+            throw std::runtime_error("Invalid probe specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    auto split_list = [](const std::string& list, const char* separators) {
+        std::vector<std::string> items;
+        boost::split(items, list, boost::is_any_of(separators), boost::token_compress_on);
+        for(std::string& item : items) {
+            boost::trim(item);
+        }
+        return items;
+    };
+
+    // grid points are given as i:j
+    auto parse_location = [&](const std::string& item) {
+        const std::vector<std::string> ij = split_list(item, ":");
+        if(ij.size() != 2) {
+            throw std::runtime_error("Invalid probe specification: " + item + " is not a grid point i:j");
+        }
+        Location loc;
+        try {
+            loc.i = boost::lexical_cast<unsigned int>(ij[0]);
+            loc.j = boost::lexical_cast<unsigned int>(ij[1]);
+        } catch(const boost::bad_lexical_cast&) {
+            throw std::runtime_error("Invalid probe specification: " + item + " is not a grid point i:j");
+        }
+        if(loc.i >= this->width || loc.j >= this->height) {
+            throw std::runtime_error("Invalid probe specification: " + item + " lies outside of the system");
+        }
+        return loc;
+    };
+
+    if(params.count("points") > 0) {
+        for(const std::string& item : split_list(params["points"], ",")) {
+            this->points.push_back(parse_location(item));
+            this->locations.push_back(this->points.back());
+        }
+    }
+
+    if(params.count("lines") > 0) {
+        for(const std::string& item : split_list(params["lines"], ",")) {
+            const std::vector<std::string> ends = split_list(item, "-");
+            if(ends.size() != 2) {
+                throw std::runtime_error("Invalid probe specification: " + item + " is not a transect i0:j0-i1:j1");
+            }
+            const Location start = parse_location(ends[0]);
+            const Location end = parse_location(ends[1]);
+
+            // one sample per grid point along the longest axis
+            const int di = (int)end.i - (int)start.i;
+            const int dj = (int)end.j - (int)start.j;
+            const unsigned int n = std::max(std::abs(di), std::abs(dj)) + 1;
+            for(unsigned int k=0; k<n; k++) {
+                const double s = (n > 1) ? (double)k / (double)(n - 1) : 0.0;
+                this->locations.push_back({(unsigned int)std::lround(start.i + s * di),
+                                           (unsigned int)std::lround(start.j + s * dj)});
+            }
+            this->lines.push_back(item);
+            this->line_lengths.push_back(n);
+        }
+    }
+
+    if(this->locations.empty()) {
+        throw std::runtime_error("Invalid probe specification: no points or lines are given");
+    }
+    for(const Location& loc : this->locations) {
+        this->index.push_back(loc.i + (size_t)loc.j * this->width);
+    }
+
+    // species are given by name or by index
+    auto find_species = [&](const std::string& name) {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            if(this->names[s] == name) {
+                return s;
+            }
+        }
+        if(!name.empty() && name.find_first_not_of("0123456789") == std::string::npos &&
+           std::stoul(name) < this->names.size()) {
+            return (unsigned int)std::stoul(name);
+        }
+        throw std::runtime_error("Invalid probe specification: unknown species " + name);
+    };
+
+    if(params.count("fields") > 0) {
+        for(const std::string& name : split_list(params["fields"], ",")) {
+            this->fields.push_back(find_species(name));
+        }
+    } else {
+        for(unsigned int s=0; s<this->names.size(); s++) {
+            this->fields.push_back(s);
+        }
+    }
+
+    if(params.count("every") > 0) {
+        this->every = boost::lexical_cast<unsigned int>(params["every"]);
+        if(this->every == 0) {
+            throw std::runtime_error("Invalid probe specification: every has to be at least 1");
+        }
+    }
+
+    if(params.count("buffer") > 0) {
+        this->block_records = boost::lexical_cast<unsigned int>(params["buffer"]);
+        if(this->block_records == 0) {
+            throw std::runtime_error("Invalid probe specification: buffer has to be at least 1");
+        }
+    }
+
+    if(params.count("format") > 0) {
+        if(params["format"] != "bin" && params["format"] != "csv") {
+            throw std::runtime_error("Invalid probe specification: unknown format " + params["format"]);
+        }
+        this->csv = (params["format"] == "csv");
+    }
+
+    this->nr_columns = 1 + this->fields.size() * this->index.size();
+    this->block.reserve(this->block_records * this->nr_columns);
+
+    this->filename = outfile + (this->csv ? ".probes.csv" : ".probes.bin");
+    this->out.open(this->filename, std::ios::binary);
+    if(!this->out) {
+        throw std::runtime_error("Cannot open " + this->filename + " for writing");
+    }
+    if(this->csv) {
+        const std::vector<std::string> columns = this->get_columns();
+        for(unsigned int k=0; k<columns.size(); k++) {
+            this->out << (k == 0 ? "" : ",") << columns[k];
+        }
+        this->out << "\n";
+    }
+
+    this->writer = std::thread(&ProbeRecorder::work, this);
+}
+
+/**
+ * @brief      Destroys the object, waiting for the output thread
+ */
+ProbeRecorder::~ProbeRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+    }
+    this->cv.notify_all();
+
+    if(this->writer.joinable()) {
+        this->writer.join();
+    }
+}
+
+/**
+ * @brief      Take a record
+ *
+ * @param[in]  t     time
+ * @param[in]  c     concentrations of all species (column-major, width x height)
+ */
+void ProbeRecorder::record(double t, const double* const* c) {
+    this->block.push_back(t);
+    for(unsigned int s : this->fields) {
+        const double* field = c[s];
+        for(size_t k : this->index) {
+            this->block.push_back(field[k]);
+        }
+    }
+    this->nr_records++;
+
+    if(this->block.size() >= this->block_records * this->nr_columns) {
+        this->flush_block();
+    }
+}
+
+/**
+ * @brief      Write the remaining records, stop the output thread and list the columns
+ */
+void ProbeRecorder::finish() {
+    if(!this->writer.joinable()) {
+        return;
+    }
+
+    if(!this->block.empty()) {
+        this->flush_block();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+    }
+    this->cv.notify_all();
+    this->writer.join();
+    this->out.close();
+
+    if(this->error) {
+        std::exception_ptr e = this->error;
+        this->error = nullptr;
+        std::rethrow_exception(e);
+    }
+
+    OutputMetadata metadata;
+    metadata.set("file", this->filename);
+    metadata.set("format", this->csv ? "csv" : "bin");
+    metadata.set("records", (long long)this->nr_records);
+    metadata.set("every", this->every);
+    metadata.set("columns", this->get_columns());
+
+    std::vector<std::string> selected;
+    for(unsigned int s : this->fields) {
+        selected.push_back(this->names[s]);
+    }
+    metadata.set("fields", selected);
+
+    std::vector<std::string> point_list;
+    for(const Location& loc : this->points) {
+        point_list.push_back(std::to_string(loc.i) + ":" + std::to_string(loc.j));
+    }
+    metadata.set("points", point_list);
+    metadata.set("lines", this->lines);
+
+    std::ostringstream lengths;
+    lengths << "[";
+    for(unsigned int k=0; k<this->line_lengths.size(); k++) {
+        lengths << (k == 0 ? "" : ", ") << this->line_lengths[k];
+    }
+    lengths << "]";
+    metadata.set_raw("line_lengths", lengths.str());
+
+    metadata.write(this->metadata_filename);
+}
+
+/**
+ * @brief      Get the number of blocks waiting to be written
+ */
+size_t ProbeRecorder::get_backlog() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->queue.size();
+}
+
+/**
+ * @brief      Get the names of the columns of a record
+ */
+std::vector<std::string> ProbeRecorder::get_columns() const {
+    std::vector<std::string> columns = {"t"};
+    for(unsigned int s : this->fields) {
+        for(const Location& loc : this->locations) {
+            columns.push_back(this->names[s] + "(" + std::to_string(loc.i) + ":" + std::to_string(loc.j) + ")");
+        }
+    }
+    return columns;
+}
+
+/**
+ * @brief      Get a description of the probes
+ */
+std::string ProbeRecorder::get_description() const {
+    std::ostringstream ss;
+    ss << this->points.size() << " point" << (this->points.size() == 1 ? "" : "s") << " and "
+       << this->lines.size() << " transect" << (this->lines.size() == 1 ? "" : "s") << " of ";
+    for(unsigned int f=0; f<this->fields.size(); f++) {
+        ss << (f == 0 ? "" : ", ") << this->names[this->fields[f]];
+    }
+    ss << " every " << this->every << " step" << (this->every == 1 ? "" : "s") << " to " << this->filename;
+    return ss.str();
+}
+
+/**
+ * @brief      Hand the current block to the output thread
+ */
+void ProbeRecorder::flush_block() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cv.wait(lock, [this]() {
+        return this->queue.size() < 4 || this->error;
+    });
+
+    // the error is reported by finish()
+    if(this->error) {
+        this->block.clear();
+        return;
+    }
+
+    this->queue.push_back(std::move(this->block));
+
+    // reuse a written block, such that no memory is allocated while integrating
+    if(!this->spare.empty()) {
+        this->block = std::move(this->spare.back());
+        this->spare.pop_back();
+    } else {
+        this->block = std::vector<double>();
+        this->block.reserve(this->block_records * this->nr_columns);
+    }
+    lock.unlock();
+    this->cv.notify_all();
+}
+
+/**
+ * @brief      Main loop of the output thread
+ */
+void ProbeRecorder::work() {
+    std::string text;
+    char number[32];
+
+    while(true) {
+        std::vector<double> records;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->cv.wait(lock, [this]() {
+                return !this->queue.empty() || this->done;
+            });
+            if(this->queue.empty()) {
+                return;
+            }
+            records = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+        this->cv.notify_all();
+
+        try {
+            if(this->csv) {
+                text.clear();
+                for(size_t k=0; k<records.size(); k++) {
+                    const int len = std::snprintf(number, sizeof(number), "%.17g", records[k]);
+                    text.append(number, len);
+                    text += ((k + 1) % this->nr_columns == 0) ? '\n' : ',';
+                }
+                this->out.write(text.data(), text.size());
+            } else {
+                this->out.write((const char*)records.data(), records.size() * sizeof(double));
+            }
+            if(!this->out) {
+                throw std::runtime_error("Cannot write to " + this->filename);
+            }
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if(!this->error) {
+                this->error = std::current_exception();
+            }
+            this->cv.notify_all();
+            return;
+        }
+
+        records.clear();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->spare.push_back(std::move(records));
+    }
+}
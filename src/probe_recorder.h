@@ -0,0 +1,179 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief      Records the concentrations at a few points every time step
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     points=32:32,16:48   grid points i:j
+ *     lines=0:32-63:32     line transects i0:j0-i1:j1, sampled at every grid point along the longest axis
+ *     fields=A,B           species that are recorded, by name or index (default: all)
+ *     every=1              record every k-th time step
+ *     format=bin           bin (raw doubles) or csv
+ *     buffer=1024          number of records that are handed to the output thread at once
+ *
+ * Every record holds the time followed by the values of the first field at
+ * all points and transects, then those of the second field, and so on. The
+ * records are collected in a block that is handed to an output thread when
+ * full, such that the file is written while the integration proceeds. The
+ * binary file holds the records as consecutive doubles without a header;
+ * the columns are listed in <outfile>.probes.json.
+ */
+class ProbeRecorder {
+public:
+    /**
+     * @brief      Grid point
+     */
+    struct Location {
+        unsigned int i;     //!< row
+        unsigned int j;     //!< column
+    };
+
+private:
+    unsigned int width;                     //!< width of the system
+    unsigned int height;                    //!< height of the system
+    std::string filename;                   //!< output file of the records
+    std::string metadata_filename;          //!< file listing the columns
+    std::vector<std::string> names;         //!< names of all species
+    std::vector<unsigned int> fields;       //!< species that are recorded
+    std::vector<Location> points;           //!< sampled grid points
+    std::vector<std::string> lines;         //!< specification of the transects
+    std::vector<unsigned int> line_lengths; //!< number of grid points per transect
+    std::vector<Location> locations;        //!< points followed by the grid points of the transects
+    std::vector<size_t> index;              //!< position of the locations in the matrices
+    unsigned int every = 1;                 //!< record every k-th time step
+    bool csv = false;                       //!< whether the records are written as text
+    unsigned int block_records = 1024;      //!< number of records per block
+
+    size_t nr_columns;                      //!< number of values per record, including the time
+    unsigned long long nr_steps = 0;        //!< number of time steps seen
+    size_t nr_records = 0;                  //!< number of records taken
+    std::vector<double> block;              //!< records that are being collected
+
+    std::ofstream out;                          //!< output file
+    std::thread writer;                         //!< output thread
+    std::deque<std::vector<double>> queue;      //!< full blocks waiting to be written
+    std::vector<std::vector<double>> spare;     //!< written blocks that can be reused
+    std::mutex mutex;                           //!< guards the queue and the spare blocks
+    std::condition_variable cv;                 //!< signals changes of the queue
+    bool done = false;                          //!< whether no more blocks will be queued
+    std::exception_ptr error;                   //!< first error raised by the output thread
+
+public:
+    /**
+     * @brief      Constructs the object and starts the output thread
+     *
+     * @param[in]  spec           specification of the probes
+     * @param[in]  species_names  names of all species
+     * @param[in]  _width         width of the system
+     * @param[in]  _height        height of the system
+     * @param[in]  outfile        output file of the frames; the records are written to <outfile>.probes.bin or .csv
+     */
+    ProbeRecorder(const std::string& spec, const std::vector<std::string>& species_names,
+                  unsigned int _width, unsigned int _height, const std::string& outfile);
+
+    /**
+     * @brief      Destroys the object, waiting for the output thread
+     */
+    ~ProbeRecorder();
+
+    /**
+     * @brief      Count a time step and record it when due
+     *
+     * @param[in]  t     time
+     * @param[in]  c     concentrations of all species (column-major, width x height)
+     */
+    inline void step(double t, const double* const* c) {
+        if(++this->nr_steps % this->every == 0) {
+            this->record(t, c);
+        }
+    }
+
+    /**
+     * @brief      Take a record
+     *
+     * @param[in]  t     time
+     * @param[in]  c     concentrations of all species (column-major, width x height)
+     */
+    void record(double t, const double* const* c);
+
+    /**
+     * @brief      Write the remaining records, stop the output thread and list the columns
+     *
+     * Rethrows the first error raised while writing.
+     */
+    void finish();
+
+    /**
+     * @brief      Get the number of records taken
+     */
+    inline size_t get_nr_records() const {
+        return this->nr_records;
+    }
+
+    /**
+     * @brief      Get the number of blocks waiting to be written
+     */
+    size_t get_backlog();
+
+    /**
+     * @brief      Get the output file of the records
+     */
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+
+    /**
+     * @brief      Get the names of the columns of a record
+     */
+    std::vector<std::string> get_columns() const;
+
+    /**
+     * @brief      Get a description of the probes
+     */
+    std::string get_description() const;
+
+private:
+    /**
+     * @brief      Hand the current block to the output thread
+     *
+     * Blocks while the queue is full.
+     */
+    void flush_block();
+
+    /**
+     * @brief      Main loop of the output thread
+     */
+    void work();
+};
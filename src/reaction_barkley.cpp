@@ -34,6 +34,54 @@ void ReactionBarkley::reaction(double a, double b, double *ra, double *rb) const
     *rb = a*a*a - b;
 }
 
+/**
+ * @brief      Perform a reaction step for a batch of grid points
+ *
+ * @param[in]  c     concentrations per species
+ * @param      r     reaction terms per species
+ * @param[in]  n     number of grid points
+ */
+void ReactionBarkley::reaction_batch(const double* const* c, double* const* r, unsigned int n) const {
+    const double* a = c[0];
+    const double* b = c[1];
+    double* ra = r[0];
+    double* rb = r[1];
+
+    for(unsigned int k=0; k<n; k++) {
+        ra[k] = epsilon * a[k] * (1.0 - a[k]) * (a[k] - (b[k] + this->beta)/this->alpha);
+        rb[k] = a[k]*a[k]*a[k] - b[k];
+    }
+}
+
+/**
+ * @brief      Jacobian of the reaction terms at a single grid point
+ *
+ * @param[in]  a     Concentration of A
+ * @param[in]  b     Concentration of B
+ * @param      jac   d(ra,rb)/d(a,b), stored as {dra/da, dra/db, drb/da, drb/db}
+ */
+void ReactionBarkley::jacobian(double a, double b, double* jac) const {
+    const double threshold = (b + this->beta) / this->alpha;
+    jac[0] = epsilon * ((1.0 - 2.0 * a) * (a - threshold) + a * (1.0 - a));
+    jac[1] = -epsilon * a * (1.0 - a) / this->alpha;
+    jac[2] = 3.0 * a * a;
+    jac[3] = -1.0;
+}
+
+/**
+ * @brief      Project the concentrations onto the range of the exact reaction terms
+ *
+ * a = 0 and a = 1 are fixed points for any b, but a = 1 becomes unstable
+ * once b exceeds alpha - beta, such that an overshoot beyond 1 would run
+ * away instead of decaying.
+ *
+ * @param      a     Concentration of A
+ * @param      b     Concentration of B
+ */
+void ReactionBarkley::project(double& a, double& b) const {
+    a = std::min(1.0, std::max(0.0, a));
+}
+
 /**
  * @brief      Sets the parameters.
  *
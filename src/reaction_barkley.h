@@ -50,6 +50,32 @@ public:
      */
     void reaction(double a, double b, double *ra, double *rb) const;
 
+    /**
+     * @brief      Perform a reaction step for a batch of grid points
+     *
+     * @param[in]  c     concentrations per species
+     * @param      r     reaction terms per species
+     * @param[in]  n     number of grid points
+     */
+    void reaction_batch(const double* const* c, double* const* r, unsigned int n) const;
+
+    /**
+     * @brief      Jacobian of the reaction terms at a single grid point
+     *
+     * @param[in]  a     Concentration of A
+     * @param[in]  b     Concentration of B
+     * @param      jac   d(ra,rb)/d(a,b), stored as {dra/da, dra/db, drb/da, drb/db}
+     */
+    void jacobian(double a, double b, double* jac) const;
+
+    /**
+     * @brief      Project the concentrations onto the range of the exact reaction terms
+     *
+     * @param      a     Concentration of A
+     * @param      b     Concentration of B
+     */
+    void project(double& a, double& b) const;
+
     /**
      * @brief      Initialize the system
      *
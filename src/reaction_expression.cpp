@@ -0,0 +1,147 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "reaction_expression.h"
+
+ReactionExpression::ReactionExpression() :
+    program({"a", "b"}) {
+
+}
+
+void ReactionExpression::reaction(double a, double b, double *ra, double *rb) const {
+    const double* c[2] = {&a, &b};
+    double* r[2] = {ra, rb};
+    this->program.evaluate(c, r, 2, 1);
+}
+
+/**
+ * @brief      Perform a reaction step for a batch of grid points
+ *
+ * @param[in]  c     concentrations per species
+ * @param      r     reaction terms per species
+ * @param[in]  n     number of grid points
+ */
+void ReactionExpression::reaction_batch(const double* const* c, double* const* r, unsigned int n) const {
+    this->program.evaluate(c, r, 2, n);
+}
+
+void ReactionExpression::init(MatrixXXd& a, MatrixXXd& b) const {
+    if(this->init_type == "random") {
+        this->init_random(a, b, this->a0, this->b0, this->noise);
+    } else if(this->init_type == "half-screen") {
+        this->init_half_screen(a, b, this->a0, this->b0);
+    } else if(this->init_type == "circle") {
+        this->init_central_circle(a, b, this->a0, this->b0);
+    } else if(this->init_type == "dual-circle") {
+        this->init_dual_central_circle(a, b, this->a0, this->b0);
+    } else if(this->init_type == "rectangles") {
+        this->init_random_rectangles(a, b);
+    } else {
+        throw std::runtime_error("Invalid initial condition: " + this->init_type);
+    }
+}
+
+/**
+ * @brief      Sets the parameters.
+ *
+ * The reaction terms are expressions rather than numbers, hence the
+ * parameters are split here rather than by parse_parameters(). Constants
+ * are evaluated in the order in which they are given and may refer to
+ * earlier constants. The reaction terms are compiled anew on every call,
+ * such that continuation scans and branches can change the constants.
+ *
+ * @param[in]  params  The parameters
+ */
+void ReactionExpression::set_parameters(const std::string& params) {
+    this->program = ExpressionProgram({"a", "b"});
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, params, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::string expr_a;
+    std::string expr_b;
+    std::vector<std::pair<std::string, double>> paramlist;
+
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+
+        const size_t eq = piece.find('=');
+        if(eq == std::string::npos) {
+            throw std::runtime_error("Invalid parameter (expected name=value): " + piece);
+        }
+        const std::string name = boost::trim_copy(piece.substr(0, eq));
+        const std::string value = boost::trim_copy(piece.substr(eq + 1));
+
+        if(name == "ra") {
+            expr_a = value;
+        } else if(name == "rb") {
+            expr_b = value;
+        } else if(name == "init") {
+            this->init_type = value;
+        } else {
+            // constants may themselves be (constant) expressions
+            ExpressionProgram constant({});
+            for(const auto& p : paramlist) {
+                constant.set_constant(p.first, p.second);
+            }
+            const unsigned int output = constant.add_output(value);
+            if(!constant.is_constant(output)) {
+                throw std::runtime_error("Parameter " + name + " does not evaluate to a constant");
+            }
+            const double v = constant.get_constant(output);
+
+            if(name == "a0") {
+                this->a0 = v;
+            } else if(name == "b0") {
+                this->b0 = v;
+            } else if(name == "noise") {
+                this->noise = v;
+            }
+
+            paramlist.emplace_back(name, v);
+            this->program.set_constant(name, v);
+        }
+    }
+
+    if(expr_a.empty()) {
+        throw std::runtime_error("Cannot find parameter ra");
+    }
+    if(expr_b.empty()) {
+        throw std::runtime_error("Cannot find parameter rb");
+    }
+
+    this->program.add_output(expr_a);
+    this->program.add_output(expr_b);
+    this->program.compile();
+
+    std::cout << "Succesfully loaded the following parameters" << std::endl;
+    std::cout << "    ra = " << expr_a << std::endl;
+    std::cout << "    rb = " << expr_b << std::endl;
+    std::cout << "    init = " << this->init_type << std::endl;
+    for(const auto& p : paramlist) {
+        std::cout << "    " << p.first << " = " << p.second << std::endl;
+    }
+    std::cout << "Compiled reaction terms into " << this->program.get_nr_instructions()
+              << " instructions using " << this->program.get_nr_registers() << " registers" << std::endl;
+}
@@ -0,0 +1,94 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include "reaction_system.h"
+#include "expression_program.h"
+
+/**
+ * @brief      Class for a reaction system defined by expressions at runtime
+ *
+ * The reaction terms are given as parameters, e.g.
+ *
+ *     ra=-a*b*b+f*(1-a);rb=a*b*b-(f+k)*b;f=0.06;k=0.0609
+ *
+ * All other parameters are named constants that may be used in the
+ * expressions. The expressions are compiled once into bytecode which is
+ * evaluated over a full row of grid points at a time.
+ *
+ * The initial condition is selected by the parameter init (random,
+ * half-screen, circle, dual-circle or rectangles) together with the
+ * concentrations a0 and b0 and, for random initialization, the deviation
+ * noise.
+ */
+class ReactionExpression : public ReactionSystem {
+private:
+    ExpressionProgram program;          //!< compiled reaction terms
+
+    std::string init_type = "random";   //!< type of initial condition
+    double a0 = 0.5;                    //!< initial concentration of A
+    double b0 = 0.25;                   //!< initial concentration of B
+    double noise = 0.1;                 //!< random deviation of the initial concentrations
+
+public:
+    /**
+     * @brief      Constructs the object.
+     */
+    ReactionExpression();
+
+    /**
+     * @brief      Perform a reaction step
+     *
+     * @param[in]  a     Concentration matrix A
+     * @param[in]  b     Concentration matrix B
+     * @param      ra    Pointer to reaction term for A
+     * @param      rb    Pointer to reaction term for B
+     */
+    void reaction(double a, double b, double *ra, double *rb) const;
+
+    /**
+     * @brief      Perform a reaction step for a batch of grid points
+     *
+     * @param[in]  c     concentrations per species
+     * @param      r     reaction terms per species
+     * @param[in]  n     number of grid points
+     */
+    void reaction_batch(const double* const* c, double* const* r, unsigned int n) const;
+
+    /**
+     * @brief      Initialize the system
+     *
+     * @param      a     Concentration matrix A
+     * @param      b     Concentration matrix B
+     */
+    void init(MatrixXXd& a, MatrixXXd& b) const;
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    void set_parameters(const std::string& params);
+
+private:
+};
@@ -0,0 +1,126 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "reaction_oregonator.h"
+
+ReactionOregonator::ReactionOregonator() {
+
+}
+
+void ReactionOregonator::init(MatrixXXd& a, MatrixXXd& b) const {
+    throw std::logic_error("The Oregonator has three species and requires init_species()");
+}
+
+/**
+ * @brief      Initialize the system for all species
+ *
+ * An excited half plane next to a refractory half plane, which curls up
+ * into a spiral.
+ *
+ * @param      c     Concentration matrices per species
+ */
+void ReactionOregonator::init_species(std::vector<MatrixXXd>& c) const {
+    this->init_half_screen(c[0], c[2], 0.8, 0.2);
+
+    // bromide at the level of the resting medium
+    c[1] = MatrixXXd::Constant(c[0].rows(), c[0].cols(), this->q);
+}
+
+void ReactionOregonator::reaction(double a, double b, double *ra, double *rb) const {
+    throw std::logic_error("The Oregonator has three species and requires reaction_batch()");
+}
+
+/**
+ * @brief      Perform a reaction step for a batch of grid points
+ *
+ * @param[in]  c     concentrations per species
+ * @param      r     reaction terms per species
+ * @param[in]  n     number of grid points
+ */
+void ReactionOregonator::reaction_batch(const double* const* c, double* const* r, unsigned int n) const {
+    const double ieps = 1.0 / this->epsilon;
+    const double idelta = 1.0 / this->delta;
+    const double q = this->q;
+    const double f = this->f;
+
+    const double* x = c[0];
+    const double* y = c[1];
+    const double* z = c[2];
+    double* rx = r[0];
+    double* ry = r[1];
+    double* rz = r[2];
+
+    for(unsigned int k=0; k<n; k++) {
+        rx[k] = ieps * (q * y[k] - x[k] * y[k] + x[k] * (1.0 - x[k]));
+        ry[k] = idelta * (-q * y[k] - x[k] * y[k] + f * z[k]);
+        rz[k] = x[k] - z[k];
+    }
+}
+
+/**
+ * @brief      Sets the parameters.
+ *
+ * @param[in]  params  The parameters
+ */
+void ReactionOregonator::set_parameters(const std::string& params) {
+    auto map = this->parse_parameters(params);
+
+    auto got = map.find("epsilon");
+    if(got != map.end()) {
+        this->epsilon = got->second;
+    } else {
+        throw std::runtime_error("Cannot find parameter epsilon");
+    }
+
+    got = map.find("delta");
+    if(got != map.end()) {
+        this->delta = got->second;
+    } else {
+        throw std::runtime_error("Cannot find parameter delta");
+    }
+
+    got = map.find("q");
+    if(got != map.end()) {
+        this->q = got->second;
+    } else {
+        throw std::runtime_error("Cannot find parameter q");
+    }
+
+    got = map.find("f");
+    if(got != map.end()) {
+        this->f = got->second;
+    } else {
+        throw std::runtime_error("Cannot find parameter f");
+    }
+
+    std::vector<std::string> paramlist = {"epsilon", "delta", "q", "f"};
+    std::cout << "Succesfully loaded the following parameters" << std::endl;
+    for(const std::string& variable : paramlist) {
+        try {
+            auto got = map.find(variable);
+            std::cout << "    " << variable << " = " << got->second << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Found error: " << e.what() << std::endl;
+        }
+
+    }
+}
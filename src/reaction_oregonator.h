@@ -0,0 +1,114 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include "reaction_system.h"
+
+/**
+ * @brief      Class for the three-variable Oregonator
+ *
+ * Scaled Field-Koros-Noyes model of the Belousov-Zhabotinsky reaction
+ * for HBrO2 (X), Br- (Y) and the oxidized catalyst (Z):
+ *
+ *     epsilon dX/dt = qY - XY + X(1 - X)
+ *     delta   dY/dt = -qY - XY + f Z
+ *             dZ/dt = X - Z
+ *
+ * See: Tyson, J.J. & Fife, P.C. J. Chem. Phys. 73 (1980) 2224-2237
+ */
+class ReactionOregonator : public ReactionSystem {
+private:
+    double epsilon = 0.1;
+    double delta = 0.002;
+    double q = 0.002;
+    double f = 1.0;
+
+public:
+    /**
+     * @brief      Constructs the object.
+     */
+    ReactionOregonator();
+
+    /**
+     * @brief      Perform a reaction step
+     *
+     * The Oregonator has three species and can only be evaluated in batches.
+     *
+     * @param[in]  a     Concentration matrix A
+     * @param[in]  b     Concentration matrix B
+     * @param      ra    Pointer to reaction term for A
+     * @param      rb    Pointer to reaction term for B
+     */
+    void reaction(double a, double b, double *ra, double *rb) const;
+
+    /**
+     * @brief      Perform a reaction step for a batch of grid points
+     *
+     * @param[in]  c     concentrations per species
+     * @param      r     reaction terms per species
+     * @param[in]  n     number of grid points
+     */
+    void reaction_batch(const double* const* c, double* const* r, unsigned int n) const;
+
+    /**
+     * @brief      Get the number of species
+     *
+     * @return     number of species
+     */
+    inline unsigned int get_nr_species() const {
+        return 3;
+    }
+
+    /**
+     * @brief      Get the names of the species
+     *
+     * @return     names of the species
+     */
+    inline std::vector<std::string> get_species_names() const {
+        return {"HBrO2", "Br-", "Ce(IV)"};
+    }
+
+    /**
+     * @brief      Initialize the system
+     *
+     * @param      a     Concentration matrix A
+     * @param      b     Concentration matrix B
+     */
+    void init(MatrixXXd& a, MatrixXXd& b) const;
+
+    /**
+     * @brief      Initialize the system for all species
+     *
+     * @param      c     Concentration matrices per species
+     */
+    void init_species(std::vector<MatrixXXd>& c) const;
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    void set_parameters(const std::string& params);
+
+private:
+};
@@ -0,0 +1,169 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "reaction_plugin.h"
+
+#include <dlfcn.h>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _handle  handle of the shared library (kept open while in use)
+ * @param[in]  _plugin  descriptor of the plugin
+ */
+ReactionPlugin::ReactionPlugin(const std::shared_ptr<void>& _handle, const turing_reaction_plugin_t* _plugin) :
+    handle(_handle),
+    plugin(_plugin) {
+
+    this->params.assign(this->plugin->parameter_defaults,
+                        this->plugin->parameter_defaults + this->plugin->nr_parameters);
+}
+
+/**
+ * @brief      Open a plugin
+ *
+ * @param[in]  path    path to the shared library
+ * @param      handle  handle of the shared library
+ *
+ * @return     descriptor of the plugin
+ */
+const turing_reaction_plugin_t* ReactionPlugin::open(const std::string& path, std::shared_ptr<void>* handle) {
+    void* lib = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(lib == nullptr) {
+        throw std::runtime_error("Cannot load reaction plugin: " + std::string(dlerror()));
+    }
+    *handle = std::shared_ptr<void>(lib, [](void* h) { dlclose(h); });
+
+    auto entry = reinterpret_cast<turing_reaction_plugin_entry>(dlsym(lib, TURING_PLUGIN_SYMBOL));
+    if(entry == nullptr) {
+        throw std::runtime_error("Reaction plugin " + path + " does not export " + TURING_PLUGIN_SYMBOL);
+    }
+
+    const turing_reaction_plugin_t* plugin = entry();
+    if(plugin == nullptr || plugin->abi_version != TURING_PLUGIN_ABI_VERSION) {
+        throw std::runtime_error("Reaction plugin " + path + " was built for a different version of the plugin interface");
+    }
+    if(plugin->name == nullptr || plugin->reaction == nullptr || plugin->nr_species < 2 ||
+       (plugin->nr_parameters > 0 && (plugin->parameter_names == nullptr || plugin->parameter_defaults == nullptr))) {
+        throw std::runtime_error("Reaction plugin " + path + " has an incomplete descriptor");
+    }
+
+    return plugin;
+}
+
+void ReactionPlugin::reaction(double a, double b, double *ra, double *rb) const {
+    if(this->plugin->nr_species != 2) {
+        throw std::logic_error("Reaction plugin has more than two species and requires reaction_batch()");
+    }
+
+    const double* c[2] = {&a, &b};
+    double* r[2] = {ra, rb};
+    this->plugin->reaction(c, r, 1, this->params.data());
+}
+
+/**
+ * @brief      Perform a reaction step for a batch of grid points
+ *
+ * @param[in]  c     concentrations per species
+ * @param      r     reaction terms per species
+ * @param[in]  n     number of grid points
+ */
+void ReactionPlugin::reaction_batch(const double* const* c, double* const* r, unsigned int n) const {
+    this->plugin->reaction(c, r, n, this->params.data());
+}
+
+/**
+ * @brief      Get the names of the species
+ *
+ * @return     names of the species
+ */
+std::vector<std::string> ReactionPlugin::get_species_names() const {
+    std::vector<std::string> names;
+    for(unsigned int s=0; s<this->plugin->nr_species; s++) {
+        if(this->plugin->species_names != nullptr) {
+            names.push_back(this->plugin->species_names[s]);
+        } else {
+            names.push_back(std::string(1, 'A' + s));
+        }
+    }
+    return names;
+}
+
+void ReactionPlugin::init(MatrixXXd& a, MatrixXXd& b) const {
+    std::vector<MatrixXXd> c = {a, b};
+    this->init_species(c);
+    a = c[0];
+    b = c[1];
+}
+
+/**
+ * @brief      Initialize the system for all species
+ *
+ * Without an initial condition in the plugin, all concentrations are
+ * drawn uniformly from [0,1).
+ *
+ * @param      c     Concentration matrices per species
+ */
+void ReactionPlugin::init_species(std::vector<MatrixXXd>& c) const {
+    if(this->plugin->init == nullptr) {
+        for(MatrixXXd& m : c) {
+            m = m.unaryExpr([](double) { return uniform_dist(); });
+        }
+        return;
+    }
+
+    std::vector<double*> cp;
+    for(MatrixXXd& m : c) {
+        cp.push_back(m.data());
+    }
+    this->plugin->init(cp.data(), c[0].rows(), c[0].cols(), this->params.data());
+}
+
+/**
+ * @brief      Sets the parameters.
+ *
+ * Parameters that are not given retain the default value of the plugin.
+ *
+ * @param[in]  params  The parameters
+ */
+void ReactionPlugin::set_parameters(const std::string& params) {
+    auto map = this->parse_parameters(params);
+
+    for(const auto& item : map) {
+        bool found = false;
+        for(unsigned int p=0; p<this->plugin->nr_parameters; p++) {
+            if(item.first == this->plugin->parameter_names[p]) {
+                this->params[p] = item.second;
+                found = true;
+            }
+        }
+        if(!found) {
+            throw std::runtime_error("Reaction plugin " + std::string(this->plugin->name) +
+                                     " has no parameter " + item.first);
+        }
+    }
+
+    std::cout << "Succesfully loaded the following parameters" << std::endl;
+    for(unsigned int p=0; p<this->plugin->nr_parameters; p++) {
+        std::cout << "    " << this->plugin->parameter_names[p] << " = " << this->params[p] << std::endl;
+    }
+}
@@ -0,0 +1,120 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <memory>
+
+#include "reaction_system.h"
+#include "turing_plugin.h"
+
+/**
+ * @brief      Class for a reaction system provided by a plugin
+ *
+ * The plugin is a shared library implementing the C interface in
+ * turing_plugin.h. Its kernel is called directly for every row of the
+ * grid.
+ */
+class ReactionPlugin : public ReactionSystem {
+private:
+    std::shared_ptr<void> handle;               //!< handle of the shared library
+    const turing_reaction_plugin_t* plugin;     //!< descriptor of the plugin
+    std::vector<double> params;                 //!< parameter block
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _handle  handle of the shared library (kept open while in use)
+     * @param[in]  _plugin  descriptor of the plugin
+     */
+    ReactionPlugin(const std::shared_ptr<void>& _handle, const turing_reaction_plugin_t* _plugin);
+
+    /**
+     * @brief      Open a plugin
+     *
+     * @param[in]  path    path to the shared library
+     * @param      handle  handle of the shared library
+     *
+     * @return     descriptor of the plugin
+     */
+    static const turing_reaction_plugin_t* open(const std::string& path, std::shared_ptr<void>* handle);
+
+    /**
+     * @brief      Perform a reaction step
+     *
+     * @param[in]  a     Concentration matrix A
+     * @param[in]  b     Concentration matrix B
+     * @param      ra    Pointer to reaction term for A
+     * @param      rb    Pointer to reaction term for B
+     */
+    void reaction(double a, double b, double *ra, double *rb) const;
+
+    /**
+     * @brief      Perform a reaction step for a batch of grid points
+     *
+     * @param[in]  c     concentrations per species
+     * @param      r     reaction terms per species
+     * @param[in]  n     number of grid points
+     */
+    void reaction_batch(const double* const* c, double* const* r, unsigned int n) const;
+
+    /**
+     * @brief      Get the number of species
+     *
+     * @return     number of species
+     */
+    inline unsigned int get_nr_species() const {
+        return this->plugin->nr_species;
+    }
+
+    /**
+     * @brief      Get the names of the species
+     *
+     * @return     names of the species
+     */
+    std::vector<std::string> get_species_names() const;
+
+    /**
+     * @brief      Initialize the system
+     *
+     * @param      a     Concentration matrix A
+     * @param      b     Concentration matrix B
+     */
+    void init(MatrixXXd& a, MatrixXXd& b) const;
+
+    /**
+     * @brief      Initialize the system for all species
+     *
+     * @param      c     Concentration matrices per species
+     */
+    void init_species(std::vector<MatrixXXd>& c) const;
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    void set_parameters(const std::string& params);
+
+private:
+};
@@ -0,0 +1,122 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "reaction_registry.h"
+
+#include <stdexcept>
+
+#include "reaction_fitzhugh_nagumo.h"
+#include "reaction_gray_scott.h"
+#include "reaction_lotka_volterra.h"
+#include "reaction_gierer_meinhardt.h"
+#include "reaction_brusselator.h"
+#include "reaction_barkley.h"
+#include "reaction_oregonator.h"
+#include "reaction_expression.h"
+#include "reaction_plugin.h"
+
+/**
+ * @brief      Constructs the object and registers the built-in reaction systems
+ */
+ReactionRegistry::ReactionRegistry() {
+    this->add("lotka-volterra", "Lotka-Volterra", []() { return new ReactionLotkaVolterra(); });
+    this->add("gierer-meinhardt", "Gierer-Meinhardt", []() { return new ReactionGiererMeinhardt(); });
+    this->add("gray-scott", "Gray-Scott", []() { return new ReactionGrayScott(); });
+    this->add("fitzhugh-nagumo", "Fitzhugh-Nagumo", []() { return new ReactionFitzhughNagumo(); });
+    this->add("brusselator", "Brusselator", []() { return new ReactionBrusselator(); });
+    this->add("barkley", "Barkley", []() { return new ReactionBarkley(); });
+    this->add("oregonator", "Oregonator", []() { return new ReactionOregonator(); });
+    this->add("expr", "expressions", []() { return new ReactionExpression(); });
+}
+
+/**
+ * @brief      Register a reaction system
+ *
+ * @param[in]  name         name used for --reaction
+ * @param[in]  description  human-readable name
+ * @param[in]  factory      constructs the reaction system
+ */
+void ReactionRegistry::add(const std::string& name, const std::string& description, const Factory& factory) {
+    if(this->has(name)) {
+        throw std::runtime_error("Reaction system " + name + " is already registered");
+    }
+
+    this->entries.emplace(name, Entry{description, factory});
+}
+
+/**
+ * @brief      Load a plugin and register its reaction system
+ *
+ * @param[in]  path  path to the shared library
+ *
+ * @return     name of the reaction system
+ */
+std::string ReactionRegistry::load_plugin(const std::string& path) {
+    std::shared_ptr<void> handle;
+    const turing_reaction_plugin_t* plugin = ReactionPlugin::open(path, &handle);
+
+    const std::string description = plugin->description != nullptr ? plugin->description : plugin->name;
+    this->add(plugin->name, description + " (plugin)", [handle, plugin]() {
+        return new ReactionPlugin(handle, plugin);
+    });
+
+    return plugin->name;
+}
+
+/**
+ * @brief      Get the human-readable name of a reaction system
+ *
+ * @param[in]  name  The name
+ */
+const std::string& ReactionRegistry::get_description(const std::string& name) const {
+    auto got = this->entries.find(name);
+    if(got == this->entries.end()) {
+        throw std::runtime_error("Unknown reaction system: " + name);
+    }
+    return got->second.description;
+}
+
+/**
+ * @brief      Construct a reaction system
+ *
+ * @param[in]  name  The name
+ *
+ * @return     the reaction system (ownership is transferred to the caller)
+ */
+ReactionSystem* ReactionRegistry::create(const std::string& name) const {
+    auto got = this->entries.find(name);
+    if(got == this->entries.end()) {
+        throw std::runtime_error("Unknown reaction system: " + name);
+    }
+    return got->second.factory();
+}
+
+/**
+ * @brief      Get the names of all registered reaction systems
+ */
+std::vector<std::string> ReactionRegistry::get_names() const {
+    std::vector<std::string> names;
+    for(const auto& entry : this->entries) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
@@ -0,0 +1,107 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "reaction_system.h"
+
+/**
+ * @brief      Registry of the available reaction systems
+ *
+ * Every reaction system is registered under the name used for --reaction,
+ * together with a factory that constructs it. The built-in systems are
+ * registered on construction; plugins are added by load_plugin().
+ */
+class ReactionRegistry {
+public:
+    typedef std::function<ReactionSystem*()> Factory;
+
+private:
+    /**
+     * @brief      Registered reaction system
+     */
+    struct Entry {
+        std::string description;    //!< human-readable name
+        Factory factory;            //!< constructs the reaction system
+    };
+
+    std::map<std::string, Entry> entries;   //!< reaction systems by name
+
+public:
+    /**
+     * @brief      Constructs the object and registers the built-in reaction systems
+     */
+    ReactionRegistry();
+
+    /**
+     * @brief      Register a reaction system
+     *
+     * @param[in]  name         name used for --reaction
+     * @param[in]  description  human-readable name
+     * @param[in]  factory      constructs the reaction system
+     */
+    void add(const std::string& name, const std::string& description, const Factory& factory);
+
+    /**
+     * @brief      Load a plugin and register its reaction system
+     *
+     * @param[in]  path  path to the shared library
+     *
+     * @return     name of the reaction system
+     */
+    std::string load_plugin(const std::string& path);
+
+    /**
+     * @brief      Whether a reaction system is registered
+     *
+     * @param[in]  name  The name
+     */
+    inline bool has(const std::string& name) const {
+        return this->entries.find(name) != this->entries.end();
+    }
+
+    /**
+     * @brief      Get the human-readable name of a reaction system
+     *
+     * @param[in]  name  The name
+     */
+    const std::string& get_description(const std::string& name) const;
+
+    /**
+     * @brief      Construct a reaction system
+     *
+     * @param[in]  name  The name
+     *
+     * @return     the reaction system (ownership is transferred to the caller)
+     */
+    ReactionSystem* create(const std::string& name) const;
+
+    /**
+     * @brief      Get the names of all registered reaction systems
+     */
+    std::vector<std::string> get_names() const;
+};
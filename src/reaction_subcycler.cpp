@@ -0,0 +1,534 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "reaction_subcycler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  spec  specification of the sub-cycling
+ */
+ReactionSubcycler::ReactionSubcycler(const std::string& spec) :
+    description(spec),
+    histogram(NR_BINS, 0) {
+
+    std::vector<std::string> pieces;
+    boost::split(pieces, spec, boost::is_any_of(";"), boost::token_compress_on);
+
+    std::unordered_map<std::string, std::string> params;
+    for(const std::string& piece : pieces) {
+        if(boost::trim_copy(piece).empty()) {
+            continue;
+        }
+        std::vector<std::string> vars;
+        boost::split(vars, piece, boost::is_any_of("="), boost::token_compress_on);
+        if(vars.size() != 2) {
+            throw std::runtime_error("Invalid sub-cycling specification: " + piece);
+        }
+        const std::string key = boost::trim_copy(vars[0]);
+        if(key != "method" && key != "rtol" && key != "atol" && key != "max_substeps") {
+            throw std::runtime_error("Invalid sub-cycling specification: unknown key " + key);
+        }
+        params.emplace(key, boost::trim_copy(vars[1]));
+    }
+
+    if(params.count("method") > 0) {
+        if(params["method"] == "rosenbrock") {
+            this->method = METHOD_ROSENBROCK;
+        } else if(params["method"] == "rk23") {
+            this->method = METHOD_RK23;
+        } else {
+            throw std::runtime_error("Invalid sub-cycling specification: unknown method " + params["method"] +
+                                     " (choose rosenbrock or rk23)");
+        }
+    }
+    if(params.count("rtol") > 0) {
+        this->rtol = boost::lexical_cast<double>(params["rtol"]);
+    }
+    if(params.count("atol") > 0) {
+        this->atol = boost::lexical_cast<double>(params["atol"]);
+    }
+    if(params.count("max_substeps") > 0) {
+        this->max_substeps = boost::lexical_cast<unsigned int>(params["max_substeps"]);
+    }
+
+    if(this->rtol < 0.0 || this->atol < 0.0 || !(this->rtol + this->atol > 0.0)) {
+        throw std::runtime_error("Invalid sub-cycling specification: the tolerances have to be non-negative "
+                                 "and at least one of them positive");
+    }
+    if(this->max_substeps == 0) {
+        throw std::runtime_error("Invalid sub-cycling specification: max_substeps has to be positive");
+    }
+}
+
+/**
+ * @brief      Prepare the step sizes for a grid of n points
+ *
+ * The step sizes are reset when the number of grid points changes.
+ *
+ * @param[in]  n     number of grid points
+ */
+void ReactionSubcycler::prepare(size_t n) {
+    if(this->step_sizes.size() != n) {
+        this->step_sizes.assign(n, 0.0);
+    }
+}
+
+/**
+ * @brief      Integrate the reaction terms of a column of grid points
+ *
+ * All grid points first attempt the time span in a single sub-step,
+ * using the batched reaction terms; only the grid points whose error is
+ * too large continue with adaptive sub-steps.
+ *
+ * @param[in]  reaction_system  The reaction system
+ * @param      a                Concentrations of A
+ * @param      b                Concentrations of B
+ * @param      h                proposed sub-step per grid point (updated, 0 = choose one)
+ * @param[in]  n                number of grid points
+ * @param[in]  tau              time span to integrate
+ * @param      tally            counts of the sub-steps (incremented)
+ */
+void ReactionSubcycler::advance_column(const ReactionSystem& reaction_system, double* a, double* b, double* h,
+                                       unsigned int n, double tau, Tally& tally) const {
+    // attempt of the full time span and scratch space of the stages
+    thread_local std::vector<double> buffer;
+    buffer.resize(14 * n);
+    double* y1[2] = {buffer.data(), buffer.data() + n};
+    double* err[2] = {buffer.data() + 2 * n, buffer.data() + 3 * n};
+    const double* y[2] = {a, b};
+    this->step_batch(reaction_system, y, tau, n, y1, err, buffer.data() + 4 * n);
+
+    for(unsigned int k=0; k<n; k++) {
+        const double yk[2] = {a[k], b[k]};
+        const double y1k[2] = {y1[0][k], y1[1][k]};
+        const double errk[2] = {err[0][k], err[1][k]};
+        const double norm = this->error_norm(yk, y1k, errk);
+
+        if(norm <= 1.0) {
+            a[k] = y1k[0];
+            b[k] = y1k[1];
+            reaction_system.project(a[k], b[k]);
+
+            // the proposal only matters once it drops below the time span
+            if(h[k] < tau) {
+                h[k] = tau * std::min(5.0, std::max(0.2, this->step_factor(norm)));
+            }
+            tally.counts[0]++;
+            tally.substeps++;
+            tally.max_count = std::max(tally.max_count, 1u);
+            continue;
+        }
+
+        // the grid point continues from a shorter sub-step
+        unsigned int rejected = 1;
+        const double shorter = tau * std::max(0.2, std::min(1.0, this->step_factor(norm)));
+        h[k] = h[k] > 0.0 ? std::min(h[k], shorter) : shorter;
+        const unsigned int m = this->advance(reaction_system, a[k], b[k], tau, h[k], rejected);
+
+        tally.rejected += rejected;
+        if(m == 0) {
+            tally.failed++;
+            continue;
+        }
+        tally.counts[get_bin(m)]++;
+        tally.substeps += m;
+        tally.max_count = std::max(tally.max_count, m);
+    }
+}
+
+/**
+ * @brief      Integrate the reaction terms of a single grid point
+ *
+ * @param[in]  reaction_system  The reaction system
+ * @param      a                Concentration of A
+ * @param      b                Concentration of B
+ * @param[in]  tau              time span to integrate
+ * @param      h                proposed sub-step (updated, 0 = choose one)
+ * @param      rejected         number of rejected sub-steps (incremented)
+ *
+ * @return     number of accepted sub-steps (0 when max_substeps was exceeded)
+ */
+unsigned int ReactionSubcycler::advance(const ReactionSystem& reaction_system, double& a, double& b,
+                                        double tau, double& h, unsigned int& rejected) const {
+    double y[2] = {a, b};
+    double y1[2], err[2];
+    double t = 0.0;
+    unsigned int accepted = 0;
+    unsigned int attempts = 0;
+
+    if(!(h > 0.0)) {
+        h = tau;
+    }
+
+    while(t < tau) {
+        if(++attempts > this->max_substeps) {
+            return 0;
+        }
+
+        // the last sub-step ends exactly at the end of the time span
+        const bool last = h >= (tau - t) * (1.0 - 1e-12);
+        const double hs = last ? tau - t : h;
+
+        if(this->method == METHOD_ROSENBROCK) {
+            step_rosenbrock(reaction_system, y, hs, y1, err);
+        } else {
+            step_rk23(reaction_system, y, hs, y1, err);
+        }
+
+        const double norm = this->error_norm(y, y1, err);
+        const double factor = this->step_factor(norm);
+        if(norm <= 1.0) {
+            y[0] = y1[0];
+            y[1] = y1[1];
+            reaction_system.project(y[0], y[1]);
+            t = last ? tau : t + hs;
+            accepted++;
+
+            // a shortened last sub-step does not reduce the proposal of the next time span
+            const double proposal = hs * std::min(5.0, std::max(0.2, factor));
+            h = last ? std::max(h, proposal) : proposal;
+        } else {
+            rejected++;
+            h = hs * std::max(0.2, std::min(1.0, factor));
+            if(h < 1e-14 * tau) {
+                return 0;
+            }
+        }
+    }
+
+    a = y[0];
+    b = y[1];
+
+    return accepted;
+}
+
+/**
+ * @brief      Add the counts of a thread to the totals
+ *
+ * @param[in]  tally  counts of the sub-steps
+ */
+void ReactionSubcycler::record(const Tally& tally) {
+    for(unsigned int k=0; k<NR_BINS; k++) {
+        this->histogram[k] += tally.counts[k];
+    }
+    this->nr_substeps += tally.substeps;
+    this->nr_rejected += tally.rejected;
+    this->max_count = std::max(this->max_count, tally.max_count);
+}
+
+/**
+ * @brief      Get the bin of the histogram for a number of sub-steps
+ *
+ * Bin 0 holds a single sub-step and bin k > 0 holds 2^(k-1)+1 to 2^k
+ * sub-steps; the last bin holds all larger numbers.
+ *
+ * @param[in]  n     number of sub-steps (at least 1)
+ *
+ * @return     bin
+ */
+unsigned int ReactionSubcycler::get_bin(unsigned int n) {
+    unsigned int k = 0;
+    while(k < NR_BINS - 1 && (1u << k) < n) {
+        k++;
+    }
+    return k;
+}
+
+/**
+ * @brief      Print the distribution of the number of sub-steps
+ *
+ * @param      out   The output stream
+ */
+void ReactionSubcycler::report(std::ostream& out) const {
+    unsigned long long total = 0;
+    for(unsigned long long count : this->histogram) {
+        total += count;
+    }
+    if(total == 0) {
+        return;
+    }
+
+    out << "Reaction sub-steps per grid point and half step (mean "
+        << (double)this->nr_substeps / total << ", max " << this->max_count << ", "
+        << this->nr_rejected << " rejected):" << std::endl;
+    for(unsigned int k=0; k<NR_BINS; k++) {
+        if(this->histogram[k] == 0) {
+            continue;
+        }
+        std::string label;
+        if(k == 0) {
+            label = "1";
+        } else if(k == 1) {
+            label = "2";
+        } else if(k == NR_BINS - 1) {
+            label = ">" + std::to_string(1u << (k - 1));
+        } else {
+            label = std::to_string((1u << (k - 1)) + 1) + "-" + std::to_string(1u << k);
+        }
+        out << "    " << std::setw(13) << label << ": " << std::fixed << std::setprecision(3)
+            << 100.0 * this->histogram[k] / total << " %" << std::defaultfloat << std::endl;
+    }
+}
+
+/**
+ * @brief      Add the distribution of the number of sub-steps to the metadata
+ *
+ * @param      metadata  The metadata
+ */
+void ReactionSubcycler::add_metadata(OutputMetadata& metadata) const {
+    unsigned long long total = 0;
+    for(unsigned long long count : this->histogram) {
+        total += count;
+    }
+
+    std::vector<double> fractions;
+    for(unsigned long long count : this->histogram) {
+        fractions.push_back(total > 0 ? (double)count / total : 0.0);
+    }
+
+    metadata.set("split_reaction", this->description);
+    metadata.set("split_reaction_histogram", fractions);
+    metadata.set("split_reaction_mean", total > 0 ? (double)this->nr_substeps / total : 0.0);
+    metadata.set("split_reaction_max", this->max_count);
+    metadata.set("split_reaction_substeps", (long long)this->nr_substeps);
+    metadata.set("split_reaction_rejected", (long long)this->nr_rejected);
+}
+
+/**
+ * @brief      Square of the scaled (root-mean-square) norm of the error of a sub-step
+ *
+ * @param[in]  y     concentrations at the start of the sub-step
+ * @param[in]  y1    concentrations at the end of the sub-step
+ * @param[in]  err   estimate of the local error
+ *
+ * @return     squared norm (infinite when the sub-step failed)
+ */
+double ReactionSubcycler::error_norm(const double* y, const double* y1, const double* err) const {
+    double norm = 0.0;
+    for(unsigned int s=0; s<2; s++) {
+        const double scale = this->atol + this->rtol * std::max(std::fabs(y[s]), std::fabs(y1[s]));
+        norm += (err[s] / scale) * (err[s] / scale);
+    }
+    norm *= 0.5;
+
+    if(!std::isfinite(norm) || !std::isfinite(y1[0]) || !std::isfinite(y1[1])) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return norm;
+}
+
+/**
+ * @brief      Factor by which the next sub-step grows or shrinks
+ *
+ * The error estimate of the Rosenbrock method is of second order and
+ * the one of RK23 of third order.
+ *
+ * @param[in]  norm  squared scaled norm of the error of the last sub-step
+ *
+ * @return     factor (not yet limited)
+ */
+double ReactionSubcycler::step_factor(double norm) const {
+    if(!(norm > 0.0)) {
+        return 5.0;
+    }
+    return 0.9 / (this->method == METHOD_ROSENBROCK ? std::sqrt(std::sqrt(norm)) : std::cbrt(std::sqrt(norm)));
+}
+
+/**
+ * @brief      Attempt a single sub-step for a column of grid points
+ *
+ * Uses the same stages as step_rosenbrock() and step_rk23(), but
+ * evaluates the reaction terms for the whole column at once.
+ *
+ * @param[in]  reaction_system  The reaction system
+ * @param[in]  y                concentrations per species at the start of the sub-step
+ * @param[in]  h                sub-step
+ * @param[in]  n                number of grid points
+ * @param      y1               concentrations per species at the end of the sub-step
+ * @param      err              estimate of the local error per species
+ * @param      work             scratch space of 10 n values
+ */
+void ReactionSubcycler::step_batch(const ReactionSystem& reaction_system, const double* const* y, double h,
+                                   unsigned int n, double* const* y1, double* const* err, double* work) const {
+    if(this->method == METHOD_ROSENBROCK) {
+        static const double gamma = 1.0 + 1.0 / std::sqrt(2.0);
+        double* f[2] = {work, work + n};
+        double* k1[2] = {work + 2 * n, work + 3 * n};
+        double* ys[2] = {work + 4 * n, work + 5 * n};
+        double* w[4] = {work + 6 * n, work + 7 * n, work + 8 * n, work + 9 * n};
+
+        // W = I - gamma h J per grid point, stored as (w11, -w01, -w10, w00) / det
+        reaction_system.reaction_batch(y, f, n);
+        for(unsigned int k=0; k<n; k++) {
+            double jac[4];
+            reaction_system.jacobian(y[0][k], y[1][k], jac);
+            const double w00 = 1.0 - gamma * h * jac[0];
+            const double w01 = -gamma * h * jac[1];
+            const double w10 = -gamma * h * jac[2];
+            const double w11 = 1.0 - gamma * h * jac[3];
+            const double det = w00 * w11 - w01 * w10;
+            w[0][k] = w11 / det;
+            w[1][k] = -w01 / det;
+            w[2][k] = -w10 / det;
+            w[3][k] = w00 / det;
+        }
+
+        for(unsigned int k=0; k<n; k++) {
+            k1[0][k] = w[0][k] * f[0][k] + w[1][k] * f[1][k];
+            k1[1][k] = w[2][k] * f[0][k] + w[3][k] * f[1][k];
+            ys[0][k] = y[0][k] + h * k1[0][k];
+            ys[1][k] = y[1][k] + h * k1[1][k];
+        }
+
+        reaction_system.reaction_batch(ys, f, n);
+        for(unsigned int k=0; k<n; k++) {
+            const double g0 = f[0][k] - 2.0 * k1[0][k];
+            const double g1 = f[1][k] - 2.0 * k1[1][k];
+            const double k20 = w[0][k] * g0 + w[1][k] * g1;
+            const double k21 = w[2][k] * g0 + w[3][k] * g1;
+            y1[0][k] = y[0][k] + h * (1.5 * k1[0][k] + 0.5 * k20);
+            y1[1][k] = y[1][k] + h * (1.5 * k1[1][k] + 0.5 * k21);
+            const double e0 = 0.5 * h * (k1[0][k] + k20);
+            const double e1 = 0.5 * h * (k1[1][k] + k21);
+            err[0][k] = w[0][k] * e0 + w[1][k] * e1;
+            err[1][k] = w[2][k] * e0 + w[3][k] * e1;
+        }
+    } else {
+        double* k1[2] = {work, work + n};
+        double* k2[2] = {work + 2 * n, work + 3 * n};
+        double* k3[2] = {work + 4 * n, work + 5 * n};
+        double* ys[2] = {work + 6 * n, work + 7 * n};
+
+        reaction_system.reaction_batch(y, k1, n);
+        for(unsigned int s=0; s<2; s++) {
+            for(unsigned int k=0; k<n; k++) {
+                ys[s][k] = y[s][k] + 0.5 * h * k1[s][k];
+            }
+        }
+        reaction_system.reaction_batch(ys, k2, n);
+        for(unsigned int s=0; s<2; s++) {
+            for(unsigned int k=0; k<n; k++) {
+                ys[s][k] = y[s][k] + 0.75 * h * k2[s][k];
+            }
+        }
+        reaction_system.reaction_batch(ys, k3, n);
+        for(unsigned int s=0; s<2; s++) {
+            for(unsigned int k=0; k<n; k++) {
+                y1[s][k] = y[s][k] + h * (2.0 / 9.0 * k1[s][k] + 1.0 / 3.0 * k2[s][k] + 4.0 / 9.0 * k3[s][k]);
+            }
+        }
+
+        // the last stage is evaluated at the end of the sub-step
+        reaction_system.reaction_batch(y1, ys, n);
+        for(unsigned int s=0; s<2; s++) {
+            for(unsigned int k=0; k<n; k++) {
+                err[s][k] = h * (-5.0 / 72.0 * k1[s][k] + 1.0 / 12.0 * k2[s][k] +
+                                 1.0 / 9.0 * k3[s][k] - 1.0 / 8.0 * ys[s][k]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Attempt a single Rosenbrock (ROS2) sub-step
+ *
+ * Two-stage, L-stable method with gamma = 1 + 1/sqrt(2); the difference
+ * with the linearly implicit Euler step serves as error estimate, filtered
+ * by the inverse of I - gamma h J (as proposed by Shampine), such that the
+ * estimate vanishes for stiff components that have decayed.
+ *
+ * @param[in]  reaction_system  The reaction system
+ * @param[in]  y                concentrations at the start of the sub-step
+ * @param[in]  h                sub-step
+ * @param      y1               concentrations at the end of the sub-step
+ * @param      err              estimate of the local error
+ */
+void ReactionSubcycler::step_rosenbrock(const ReactionSystem& reaction_system, const double* y, double h,
+                                        double* y1, double* err) {
+    static const double gamma = 1.0 + 1.0 / std::sqrt(2.0);
+
+    double jac[4];
+    reaction_system.jacobian(y[0], y[1], jac);
+
+    // W = I - gamma h J, solved directly for two species
+    const double w00 = 1.0 - gamma * h * jac[0];
+    const double w01 = -gamma * h * jac[1];
+    const double w10 = -gamma * h * jac[2];
+    const double w11 = 1.0 - gamma * h * jac[3];
+    const double det = w00 * w11 - w01 * w10;
+
+    double f[2];
+    reaction_system.reaction(y[0], y[1], &f[0], &f[1]);
+    const double k10 = (w11 * f[0] - w01 * f[1]) / det;
+    const double k11 = (w00 * f[1] - w10 * f[0]) / det;
+
+    reaction_system.reaction(y[0] + h * k10, y[1] + h * k11, &f[0], &f[1]);
+    f[0] -= 2.0 * k10;
+    f[1] -= 2.0 * k11;
+    const double k20 = (w11 * f[0] - w01 * f[1]) / det;
+    const double k21 = (w00 * f[1] - w10 * f[0]) / det;
+
+    y1[0] = y[0] + h * (1.5 * k10 + 0.5 * k20);
+    y1[1] = y[1] + h * (1.5 * k11 + 0.5 * k21);
+    const double e0 = 0.5 * h * (k10 + k20);
+    const double e1 = 0.5 * h * (k11 + k21);
+    err[0] = (w11 * e0 - w01 * e1) / det;
+    err[1] = (w00 * e1 - w10 * e0) / det;
+}
+
+/**
+ * @brief      Attempt a single Bogacki-Shampine (RK23) sub-step
+ *
+ * @param[in]  reaction_system  The reaction system
+ * @param[in]  y                concentrations at the start of the sub-step
+ * @param[in]  h                sub-step
+ * @param      y1               concentrations at the end of the sub-step
+ * @param      err              estimate of the local error
+ */
+void ReactionSubcycler::step_rk23(const ReactionSystem& reaction_system, const double* y, double h,
+                                  double* y1, double* err) {
+    double k1[2], k2[2], k3[2], k4[2];
+    reaction_system.reaction(y[0], y[1], &k1[0], &k1[1]);
+    reaction_system.reaction(y[0] + 0.5 * h * k1[0], y[1] + 0.5 * h * k1[1], &k2[0], &k2[1]);
+    reaction_system.reaction(y[0] + 0.75 * h * k2[0], y[1] + 0.75 * h * k2[1], &k3[0], &k3[1]);
+
+    for(unsigned int s=0; s<2; s++) {
+        y1[s] = y[s] + h * (2.0 / 9.0 * k1[s] + 1.0 / 3.0 * k2[s] + 4.0 / 9.0 * k3[s]);
+    }
+
+    reaction_system.reaction(y1[0], y1[1], &k4[0], &k4[1]);
+    for(unsigned int s=0; s<2; s++) {
+        err[s] = h * (-5.0 / 72.0 * k1[s] + 1.0 / 12.0 * k2[s] + 1.0 / 9.0 * k3[s] - 1.0 / 8.0 * k4[s]);
+    }
+}
@@ -0,0 +1,273 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "reaction_system.h"
+#include "output_metadata.h"
+
+/**
+ * @brief      Per-cell sub-cycling of the reaction terms in a Strang splitting
+ *
+ * Every time step is split into half a step of the reaction terms, a full
+ * (explicit) step of the diffusion terms and another half step of the
+ * reaction terms. The reaction half steps are integrated at every grid
+ * point independently with an adaptive step size, such that only the grid
+ * points with fast (stiff) kinetics, e.g. near an excited front, take many
+ * sub-steps, while the time step of the grid only has to satisfy the
+ * stability limit of the diffusion terms.
+ *
+ * The specification is a list of key=value pairs separated by semicolons:
+ *
+ *     method=rk23          rk23 (explicit Bogacki-Shampine, 3rd order) or
+ *                          rosenbrock (linearly implicit ROS2, 2nd order, for
+ *                          very stiff kinetics) (default: rk23)
+ *     rtol=1e-3            relative tolerance of a sub-step (default: 1e-3)
+ *     atol=1e-4            absolute tolerance of a sub-step (default: 1e-4)
+ *     max_substeps=N       maximum number of sub-steps of a grid point per
+ *                          half step (default: 100000)
+ *
+ * The number of sub-steps per grid point and half step is collected in a
+ * histogram with bins of powers of two.
+ */
+class ReactionSubcycler {
+public:
+    /**
+     * @brief      Integrator of the sub-steps
+     */
+    enum Method {
+        METHOD_ROSENBROCK,
+        METHOD_RK23
+    };
+
+    static const unsigned int NR_BINS = 18;    //!< bins of the histogram: 1, 2, 3-4, ..., more than 2^16
+
+    /**
+     * @brief      Counts of the sub-steps, collected per thread
+     */
+    struct Tally {
+        std::vector<unsigned long long> counts = std::vector<unsigned long long>(NR_BINS, 0); //!< half steps per bin
+        unsigned long long substeps = 0;    //!< number of accepted sub-steps
+        unsigned long long rejected = 0;    //!< number of rejected sub-steps
+        unsigned int max_count = 0;         //!< largest number of sub-steps of a single half step
+        long int failed = 0;                //!< number of grid points that exceeded max_substeps
+    };
+
+private:
+    std::string description;            //!< specification of the sub-cycling
+    Method method = METHOD_RK23;        //!< integrator of the sub-steps
+    double rtol = 1e-3;                 //!< relative tolerance of a sub-step
+    double atol = 1e-4;                 //!< absolute tolerance of a sub-step
+    unsigned int max_substeps = 100000; //!< maximum number of sub-steps of a grid point per half step
+
+    std::vector<double> step_sizes;     //!< last proposed sub-step per grid point (0 = none yet)
+
+    std::vector<unsigned long long> histogram;  //!< number of grid point half steps per bin
+    unsigned long long nr_substeps = 0;         //!< total number of accepted sub-steps
+    unsigned long long nr_rejected = 0;         //!< total number of rejected sub-steps
+    unsigned int max_count = 0;                 //!< largest number of sub-steps of a single half step
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  spec  specification of the sub-cycling
+     */
+    ReactionSubcycler(const std::string& spec);
+
+    /**
+     * @brief      Prepare the step sizes for a grid of n points
+     *
+     * The step sizes are reset when the number of grid points changes.
+     *
+     * @param[in]  n     number of grid points
+     */
+    void prepare(size_t n);
+
+    /**
+     * @brief      Integrate the reaction terms of a column of grid points
+     *
+     * All grid points first attempt the time span in a single sub-step,
+     * using the batched reaction terms; only the grid points whose error is
+     * too large continue with adaptive sub-steps.
+     *
+     * @param[in]  reaction_system  The reaction system
+     * @param      a                Concentrations of A
+     * @param      b                Concentrations of B
+     * @param      h                proposed sub-step per grid point (updated, 0 = choose one)
+     * @param[in]  n                number of grid points
+     * @param[in]  tau              time span to integrate
+     * @param      tally            counts of the sub-steps (incremented)
+     */
+    void advance_column(const ReactionSystem& reaction_system, double* a, double* b, double* h,
+                        unsigned int n, double tau, Tally& tally) const;
+
+    /**
+     * @brief      Integrate the reaction terms of a single grid point
+     *
+     * @param[in]  reaction_system  The reaction system
+     * @param      a                Concentration of A
+     * @param      b                Concentration of B
+     * @param[in]  tau              time span to integrate
+     * @param      h                proposed sub-step (updated, 0 = choose one)
+     * @param      rejected         number of rejected sub-steps (incremented)
+     *
+     * @return     number of accepted sub-steps (0 when max_substeps was exceeded)
+     */
+    unsigned int advance(const ReactionSystem& reaction_system, double& a, double& b,
+                         double tau, double& h, unsigned int& rejected) const;
+
+    /**
+     * @brief      Add the counts of a thread to the totals
+     *
+     * @param[in]  tally  counts of the sub-steps
+     */
+    void record(const Tally& tally);
+
+    /**
+     * @brief      Get the bin of the histogram for a number of sub-steps
+     *
+     * @param[in]  n     number of sub-steps (at least 1)
+     *
+     * @return     bin
+     */
+    static unsigned int get_bin(unsigned int n);
+
+    /**
+     * @brief      Print the distribution of the number of sub-steps
+     *
+     * @param      out   The output stream
+     */
+    void report(std::ostream& out) const;
+
+    /**
+     * @brief      Add the distribution of the number of sub-steps to the metadata
+     *
+     * @param      metadata  The metadata
+     */
+    void add_metadata(OutputMetadata& metadata) const;
+
+    /**
+     * @brief      Get the last proposed sub-step per grid point
+     */
+    inline double* get_step_sizes() {
+        return this->step_sizes.data();
+    }
+
+    /**
+     * @brief      Get the number of grid point half steps per bin
+     */
+    inline const std::vector<unsigned long long>& get_histogram() const {
+        return this->histogram;
+    }
+
+    /**
+     * @brief      Get the total number of accepted sub-steps
+     */
+    inline unsigned long long get_nr_substeps() const {
+        return this->nr_substeps;
+    }
+
+    /**
+     * @brief      Get the total number of rejected sub-steps
+     */
+    inline unsigned long long get_nr_rejected() const {
+        return this->nr_rejected;
+    }
+
+    /**
+     * @brief      Get the integrator of the sub-steps
+     */
+    inline Method get_method() const {
+        return this->method;
+    }
+
+    /**
+     * @brief      Get the specification of the sub-cycling
+     */
+    inline const std::string& get_description() const {
+        return this->description;
+    }
+
+private:
+    /**
+     * @brief      Square of the scaled (root-mean-square) norm of the error of a sub-step
+     *
+     * @param[in]  y     concentrations at the start of the sub-step
+     * @param[in]  y1    concentrations at the end of the sub-step
+     * @param[in]  err   estimate of the local error
+     *
+     * @return     squared norm (infinite when the sub-step failed)
+     */
+    double error_norm(const double* y, const double* y1, const double* err) const;
+
+    /**
+     * @brief      Factor by which the next sub-step grows or shrinks
+     *
+     * @param[in]  norm  squared scaled norm of the error of the last sub-step
+     *
+     * @return     factor (not yet limited)
+     */
+    double step_factor(double norm) const;
+
+    /**
+     * @brief      Attempt a single sub-step for a column of grid points
+     *
+     * @param[in]  reaction_system  The reaction system
+     * @param[in]  y                concentrations per species at the start of the sub-step
+     * @param[in]  h                sub-step
+     * @param[in]  n                number of grid points
+     * @param      y1               concentrations per species at the end of the sub-step
+     * @param      err              estimate of the local error per species
+     * @param      work             scratch space of 10 n values
+     */
+    void step_batch(const ReactionSystem& reaction_system, const double* const* y, double h, unsigned int n,
+                    double* const* y1, double* const* err, double* work) const;
+
+    /**
+     * @brief      Attempt a single Rosenbrock (ROS2) sub-step
+     *
+     * @param[in]  reaction_system  The reaction system
+     * @param[in]  y                concentrations at the start of the sub-step
+     * @param[in]  h                sub-step
+     * @param      y1               concentrations at the end of the sub-step
+     * @param      err              estimate of the local error
+     */
+    static void step_rosenbrock(const ReactionSystem& reaction_system, const double* y, double h,
+                                double* y1, double* err);
+
+    /**
+     * @brief      Attempt a single Bogacki-Shampine (RK23) sub-step
+     *
+     * @param[in]  reaction_system  The reaction system
+     * @param[in]  y                concentrations at the start of the sub-step
+     * @param[in]  h                sub-step
+     * @param      y1               concentrations at the end of the sub-step
+     * @param      err              estimate of the local error
+     */
+    static void step_rk23(const ReactionSystem& reaction_system, const double* y, double h,
+                          double* y1, double* err);
+};
@@ -24,6 +24,8 @@
 #include <Eigen/Dense>
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <iostream>
 #include <unordered_map>
@@ -52,6 +54,80 @@ public:
      */
     virtual void reaction(double a, double b, double *ra, double *rb) const = 0;
 
+    /**
+     * @brief      Perform a reaction step for a batch of grid points
+     *
+     * The concentrations and reaction terms are stored per species
+     * (structure of arrays). By default, reaction() is called for every
+     * grid point, which is only valid for two species; systems with more
+     * species override this function.
+     *
+     * @param[in]  c     concentrations per species
+     * @param      r     reaction terms per species
+     * @param[in]  n     number of grid points
+     */
+    virtual void reaction_batch(const double* const* c, double* const* r, unsigned int n) const {
+        for(unsigned int k=0; k<n; k++) {
+            this->reaction(c[0][k], c[1][k], &r[0][k], &r[1][k]);
+        }
+    }
+
+    /**
+     * @brief      Jacobian of the reaction terms at a single grid point
+     *
+     * By default, the Jacobian is approximated by forward differences of
+     * reaction(); systems with stiff kinetics may provide the exact one.
+     *
+     * @param[in]  a     Concentration of A
+     * @param[in]  b     Concentration of B
+     * @param      jac   d(ra,rb)/d(a,b), stored as {dra/da, dra/db, drb/da, drb/db}
+     */
+    virtual void jacobian(double a, double b, double* jac) const {
+        double ra, rb, ra1, rb1;
+        this->reaction(a, b, &ra, &rb);
+
+        const double ha = 1.49e-8 * std::max(1.0, std::fabs(a));
+        this->reaction(a + ha, b, &ra1, &rb1);
+        jac[0] = (ra1 - ra) / ha;
+        jac[2] = (rb1 - rb) / ha;
+
+        const double hb = 1.49e-8 * std::max(1.0, std::fabs(b));
+        this->reaction(a, b + hb, &ra1, &rb1);
+        jac[1] = (ra1 - ra) / hb;
+        jac[3] = (rb1 - rb) / hb;
+    }
+
+    /**
+     * @brief      Project the concentrations onto the range of the exact reaction terms
+     *
+     * Adaptive sub-steps of the reaction terms may overshoot by up to their
+     * tolerance. Kinetics whose exact solution stays within a range (e.g.
+     * between two fixed points) can restore it here; by default, nothing
+     * is changed.
+     *
+     * @param      a     Concentration of A
+     * @param      b     Concentration of B
+     */
+    virtual void project(double& a, double& b) const {}
+
+    /**
+     * @brief      Get the number of species
+     *
+     * @return     number of species
+     */
+    virtual unsigned int get_nr_species() const {
+        return 2;
+    }
+
+    /**
+     * @brief      Get the names of the species
+     *
+     * @return     names of the species
+     */
+    virtual std::vector<std::string> get_species_names() const {
+        return {"A", "B"};
+    }
+
     /**
      * @brief      Initialize the system
      *
@@ -60,6 +136,31 @@ public:
      */
     virtual void init(MatrixXXd& a, MatrixXXd& b) const = 0;
 
+    /**
+     * @brief      Initialize the system for an arbitrary number of species
+     *
+     * By default, the first two species are initialized using init().
+     *
+     * @param      c     Concentration matrices per species
+     */
+    virtual void init_species(std::vector<MatrixXXd>& c) const {
+        this->init(c[0], c[1]);
+    }
+
+    /**
+     * @brief      Initialize a single layer of a three-dimensional system
+     *
+     * By default, every layer receives the two-dimensional initial condition.
+     *
+     * @param      a      Concentration matrix A of the layer
+     * @param      b      Concentration matrix B of the layer
+     * @param[in]  layer  index of the layer
+     * @param[in]  depth  number of layers
+     */
+    virtual void init_layer(MatrixXXd& a, MatrixXXd& b, unsigned int layer, unsigned int depth) const {
+        this->init(a, b);
+    }
+
     /**
      * @brief      Sets the parameters.
      *
@@ -125,11 +226,8 @@ protected:
      * @return     returns value at normal distribution
      */
     static double normal_dist(double dummy) {
-        static std::mt19937 rng;
-        // center at zero and scale is 0.05
-        static std::normal_distribution<> nd(0.50, 0.50);
-
-        return std::min(1.0, std::max(0.0, nd(rng)));
+        RandomState& state = random_state();
+        return std::min(1.0, std::max(0.0, state.normal(state.normal_rng)));
     }
 
     /**
@@ -138,13 +236,44 @@ protected:
      * @return     returns value at uniform distribution
      */
     static double uniform_dist() {
-        static std::mt19937 rng;
-        // center at zero and scale is 0.05
-        static std::uniform_real_distribution<> nd(0.0, 1.0);
+        RandomState& state = random_state();
+        return state.uniform(state.uniform_rng);
+    }
 
-        return nd(rng);
+public:
+    /**
+     * @brief      Restart the random number generators of the calling thread
+     *
+     * Every thread draws from its own generators, which start from the same
+     * seed, such that simulations running one after the other in a single
+     * process (see JobServer) start from the same initial state as separate
+     * processes.
+     */
+    static void reset_random() {
+        random_state() = RandomState();
+    }
+
+private:
+    /**
+     * @brief      Random number generators and distributions of a thread
+     */
+    struct RandomState {
+        std::mt19937 normal_rng;                                //!< generator of normal_dist()
+        std::normal_distribution<> normal{0.50, 0.50};          //!< center at 0.5 with a scale of 0.5
+        std::mt19937 uniform_rng;                               //!< generator of uniform_dist()
+        std::uniform_real_distribution<> uniform{0.0, 1.0};     //!< uniform on [0, 1)
+    };
+
+    /**
+     * @brief      Get the random number generators of the calling thread
+     */
+    static RandomState& random_state() {
+        thread_local RandomState state;
+        return state;
     }
 
+protected:
+
     /**
      * @brief      Parse parameters
      *
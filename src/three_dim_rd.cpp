@@ -0,0 +1,433 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "three_dim_rd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <omp.h>
+
+/**
+ * @brief      Constructs the object.
+ *
+ * @param[in]  _Da      Diffusion coefficient of compound A
+ * @param[in]  _Db      Diffusion coefficient of compound B
+ * @param[in]  _width   width of the system
+ * @param[in]  _height  height of the system
+ * @param[in]  _depth   depth of the system
+ * @param[in]  _dx      size of the space interval
+ * @param[in]  _dt      size of the time interval
+ * @param[in]  _steps   number of frames
+ * @param[in]  _tsteps  number of time steps when to write a frame
+ */
+ThreeDimRD::ThreeDimRD(double _Da, double _Db,
+                       unsigned int _width, unsigned int _height, unsigned int _depth,
+                       double _dx, double _dt, unsigned int _steps, unsigned int _tsteps) :
+    Da(_Da),
+    Db(_Db),
+    width(_width),
+    height(_height),
+    depth(_depth),
+    dx(_dx),
+    dt(_dt),
+    steps(_steps),
+    tsteps(_tsteps) {
+
+    // a band of a plane should fit comfortably in the L2 cache, as a sweep
+    // keeps about ten of these alive; use at least one band per thread
+    const unsigned int threads = omp_get_max_threads();
+    this->band_rows = std::max(32u, 12288u / std::max(1u, this->width));
+    this->band_rows = std::min(this->band_rows, (this->height + threads - 1) / threads);
+    this->band_rows = std::max(1u, this->band_rows);
+    this->nr_bands = (this->height + this->band_rows - 1) / this->band_rows;
+}
+
+void ThreeDimRD::set_reaction(ReactionSystem* _reaction_system) {
+    this->reaction_system = std::unique_ptr<ReactionSystem>(_reaction_system);
+}
+
+/**
+ * @brief      Sets the convergence monitor.
+ *
+ * @param      _convergence_monitor  The convergence monitor
+ */
+void ThreeDimRD::set_convergence_monitor(ConvergenceMonitor* _convergence_monitor) {
+    this->convergence_monitor = std::unique_ptr<ConvergenceMonitor>(_convergence_monitor);
+}
+
+/**
+ * @brief      Periodically write the progress of the integration to a status file
+ *
+ * @param      _metrics  The metrics exporter
+ */
+void ThreeDimRD::set_metrics(MetricsExporter* _metrics) {
+    this->metrics = std::unique_ptr<MetricsExporter>(_metrics);
+}
+
+/**
+ * @brief      Perform time integration
+ *
+ * @param[in]  filename  The filename
+ */
+void ThreeDimRD::time_integrate(const std::string& filename) {
+    this->t = 0;
+
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+
+    // the layers of a frame are stacked along the height
+    FrameWriter writer(filename, this->width, this->height * this->depth, this->chunk_size, this->compression,
+                       this->quantization);
+    writer.write_frame(this->a.data(), this->b.data(), this->a.size());
+
+    if(this->metrics) {
+        this->metrics->start();
+    }
+
+    for(int i : tq::trange(this->steps)) {
+        for(unsigned int j=0; j<this->tsteps; j++) {
+            // the rate of change is only needed at the end of a frame
+            this->track_rates = (monitor != nullptr && j == this->tsteps - 1);
+            this->update();
+
+            if(this->metrics) {
+                this->metrics->progress(this->t);
+            }
+
+            if(monitor != nullptr && monitor->detects_periodic()) {
+                monitor->add_sample(this->t, this->sample_probes());
+            }
+        }
+
+        writer.write_frame(this->a.data(), this->b.data(), this->a.size());
+
+        if(monitor != nullptr) {
+            const bool steady = monitor->check_frame(this->t, this->rate_a, this->rate_b);
+            if(this->metrics) {
+                this->metrics->set_norm(std::max(this->rate_a, this->rate_b));
+            }
+            if(steady) {
+                break;
+            }
+        }
+    }
+
+    this->nframes = writer.get_nr_frames();
+    writer.close();
+
+    if(this->metrics) {
+        this->metrics->finish();
+    }
+
+    // give newline after tqdm progress bar
+    std::cout << std::endl;
+
+    if(monitor != nullptr && monitor->is_converged()) {
+        if(monitor->is_periodic()) {
+            std::cout << "Periodic steady state reached at t = " << monitor->get_convergence_time()
+                      << " (period T = " << monitor->get_period() << ")." << std::endl;
+        } else {
+            std::cout << "Steady state reached at t = " << monitor->get_convergence_time()
+                      << "." << std::endl;
+        }
+        std::cout << "Terminating after " << (this->nframes - 1) << " of " << this->steps
+                  << " frames." << std::endl;
+    }
+}
+
+/**
+ * @brief      Write run metadata (JSON) to file
+ *
+ * @param[in]  filename  The filename
+ */
+void ThreeDimRD::write_metadata_to_file(const std::string& filename) {
+    OutputMetadata metadata;
+
+    metadata.set("width", this->width);
+    metadata.set("height", this->height);
+    metadata.set("depth", this->depth);
+    metadata.set("frames", this->nframes > 0 ? this->nframes - 1 : 0);
+    metadata.set("frames_requested", this->steps);
+    metadata.set("tsteps", this->tsteps);
+    metadata.set("dx", this->dx);
+    metadata.set("dt", this->dt);
+    metadata.set("Da", this->Da);
+    metadata.set("Db", this->Db);
+    metadata.set("species", this->reaction_system->get_nr_species());
+    metadata.set("species_names", this->reaction_system->get_species_names());
+    metadata.set("pbc", this->pbc);
+    metadata.set("t_final", this->t);
+
+    const ConvergenceMonitor* monitor = this->convergence_monitor.get();
+    if(monitor != nullptr) {
+        metadata.set("converged", monitor->is_converged());
+        metadata.set("periodic", monitor->is_periodic());
+        if(monitor->is_converged()) {
+            metadata.set("convergence_time", monitor->get_convergence_time());
+        }
+        if(monitor->is_periodic()) {
+            metadata.set("period", monitor->get_period());
+        }
+        metadata.set("rate_a", monitor->get_rate_a());
+        metadata.set("rate_b", monitor->get_rate_b());
+    }
+
+    if(this->chunk_size > 0) {
+        metadata.set("layout", "chunked");
+        metadata.set("chunk_size", this->chunk_size);
+        metadata.set("compression", (unsigned int)this->compression);
+        if(!this->quantization.empty()) {
+            metadata.set("quantization", this->quantization);
+        }
+    }
+
+    metadata.write(filename);
+}
+
+/**
+ * @brief      Initialize the system
+ */
+void ThreeDimRD::init() {
+    const size_t plane = (size_t)this->width * (size_t)this->height;
+
+    this->a.assign(plane * this->depth, 0.0);
+    this->b.assign(plane * this->depth, 0.0);
+
+    for(unsigned int k=0; k<this->depth; k++) {
+        MatrixXXd la = MatrixXXd::Zero(this->width, this->height);
+        MatrixXXd lb = MatrixXXd::Zero(this->width, this->height);
+        this->reaction_system->init_layer(la, lb, k, this->depth);
+        std::copy(la.data(), la.data() + plane, this->a.begin() + k * plane);
+        std::copy(lb.data(), lb.data() + plane, this->b.begin() + k * plane);
+    }
+
+    const size_t edge = (size_t)this->nr_bands * this->width * this->depth;
+    this->edge_lo_a.assign(edge, 0.0);
+    this->edge_hi_a.assign(edge, 0.0);
+    this->edge_lo_b.assign(edge, 0.0);
+    this->edge_hi_b.assign(edge, 0.0);
+
+    // two buffers for the new values and a copy of the first plane
+    this->scratch.resize(this->nr_bands);
+    for(unsigned int n=0; n<this->nr_bands; n++) {
+        this->scratch[n].assign(6 * (size_t)this->band_rows * this->width + 2 * this->width, 0.0);
+    }
+}
+
+/**
+ * @brief      Perform a time-step
+ */
+void ThreeDimRD::update() {
+    const int nb = this->nr_bands;
+    const int depth = this->depth;
+    const unsigned int width = this->width;
+
+    // store the old values of the rows that are shared between bands
+    #pragma omp parallel for schedule(static) collapse(2)
+    for(int n=0; n<nb; n++) {
+        for(int k=0; k<depth; k++) {
+            const unsigned int j0 = n * this->band_rows;
+            const unsigned int j1 = std::min(this->height, j0 + this->band_rows) - 1;
+            const size_t e = ((size_t)n * depth + k) * width;
+            std::memcpy(&this->edge_lo_a[e], &this->a[this->idx(0, j0, k)], width * sizeof(double));
+            std::memcpy(&this->edge_hi_a[e], &this->a[this->idx(0, j1, k)], width * sizeof(double));
+            std::memcpy(&this->edge_lo_b[e], &this->b[this->idx(0, j0, k)], width * sizeof(double));
+            std::memcpy(&this->edge_hi_b[e], &this->b[this->idx(0, j1, k)], width * sizeof(double));
+        }
+    }
+
+    double max_ra = 0.0;
+    double max_rb = 0.0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(max:max_ra,max_rb)
+    for(int n=0; n<nb; n++) {
+        double ra = 0.0;
+        double rb = 0.0;
+        this->update_band(n, &ra, &rb);
+        max_ra = std::max(max_ra, ra);
+        max_rb = std::max(max_rb, rb);
+    }
+
+    if(this->track_rates) {
+        this->rate_a = max_ra;
+        this->rate_b = max_rb;
+    }
+
+    this->t += this->dt;
+}
+
+/**
+ * @brief      Perform a time-step for a single band of rows
+ *
+ * @param[in]  n     index of the band
+ * @param      ra    max|da/dt| in the band (if rates are tracked)
+ * @param      rb    max|db/dt| in the band (if rates are tracked)
+ */
+void ThreeDimRD::update_band(unsigned int n, double* ra, double* rb) {
+    const unsigned int W = this->width;
+    const unsigned int D = this->depth;
+    const unsigned int j0 = n * this->band_rows;
+    const unsigned int j1 = std::min(this->height, j0 + this->band_rows);
+    const unsigned int nr = j1 - j0;
+    const size_t P = (size_t)nr * W;
+
+    const double idx2 = 1.0 / (this->dx * this->dx);
+    const double dt = this->dt;
+    const double Da = this->Da;
+    const double Db = this->Db;
+    const bool pbc = this->pbc;
+    const bool track = this->track_rates;
+
+    double* buf = this->scratch[n].data();
+    double* new_a[2] = {buf, buf + P};
+    double* new_b[2] = {buf + 2 * P, buf + 3 * P};
+    double* first_a = buf + 4 * P;
+    double* first_b = buf + 5 * P;
+    double* rx_a = buf + 6 * P;
+    double* rx_b = rx_a + W;
+
+    double* pa = this->a.data();
+    double* pb = this->b.data();
+
+    // the first plane is overwritten before it is needed as the neighbour
+    // of the last plane
+    if(pbc) {
+        std::memcpy(first_a, &pa[this->idx(0, j0, 0)], P * sizeof(double));
+        std::memcpy(first_b, &pb[this->idx(0, j0, 0)], P * sizeof(double));
+    }
+
+    // old values of the rows adjacent to the band
+    const unsigned int nlo = (n == 0) ? this->nr_bands - 1 : n - 1;
+    const unsigned int nhi = (n == this->nr_bands - 1) ? 0 : n + 1;
+
+    double max_da = 0.0;
+    double max_db = 0.0;
+
+    for(unsigned int k=0; k<D; k++) {
+        const size_t off = this->idx(0, j0, k);
+
+        // neighbouring planes; the new values of plane k-1 are only written
+        // after plane k has been evaluated
+        const size_t off_lo = (k > 0) ? this->idx(0, j0, k-1) : (pbc ? this->idx(0, j0, D-1) : off);
+        const double* za_lo = &pa[off_lo];
+        const double* zb_lo = &pb[off_lo];
+        const double* za_hi = (k < D-1) ? &pa[this->idx(0, j0, k+1)] : (pbc ? first_a : &pa[off]);
+        const double* zb_hi = (k < D-1) ? &pb[this->idx(0, j0, k+1)] : (pbc ? first_b : &pb[off]);
+
+        for(unsigned int r=0; r<nr; r++) {
+            const double* ca = &pa[off + r * W];
+            const double* cb = &pb[off + r * W];
+
+            // neighbouring rows; rows outside the band are taken from the stored copies
+            const double* ya_lo;
+            const double* yb_lo;
+            const double* ya_hi;
+            const double* yb_hi;
+            if(r > 0) {
+                ya_lo = ca - W;
+                yb_lo = cb - W;
+            } else if(j0 > 0 || pbc) {
+                ya_lo = &this->edge_hi_a[((size_t)nlo * D + k) * W];
+                yb_lo = &this->edge_hi_b[((size_t)nlo * D + k) * W];
+            } else {
+                ya_lo = ca;
+                yb_lo = cb;
+            }
+            if(r < nr - 1) {
+                ya_hi = ca + W;
+                yb_hi = cb + W;
+            } else if(j1 < this->height || pbc) {
+                ya_hi = &this->edge_lo_a[((size_t)nhi * D + k) * W];
+                yb_hi = &this->edge_lo_b[((size_t)nhi * D + k) * W];
+            } else {
+                ya_hi = ca;
+                yb_hi = cb;
+            }
+
+            const double* xa_lo = za_lo + r * W;
+            const double* xb_lo = zb_lo + r * W;
+            const double* xa_hi = za_hi + r * W;
+            const double* xb_hi = zb_hi + r * W;
+
+            double* na = new_a[k & 1] + r * W;
+            double* nb = new_b[k & 1] + r * W;
+
+            // the Laplacian is stored in the new plane, after which the
+            // reaction terms of the row are evaluated in a single batch
+            auto lap = [&](unsigned int i, unsigned int il, unsigned int ir) {
+                na[i] = (-6.0 * ca[i] + ca[il] + ca[ir] + ya_lo[i] + ya_hi[i] + xa_lo[i] + xa_hi[i]) * idx2;
+                nb[i] = (-6.0 * cb[i] + cb[il] + cb[ir] + yb_lo[i] + yb_hi[i] + xb_lo[i] + xb_hi[i]) * idx2;
+            };
+
+            if(W == 1) {
+                lap(0, 0, 0);
+            } else {
+                lap(0, pbc ? W-1 : 0, 1);
+                for(unsigned int i=1; i<W-1; i++) {
+                    lap(i, i-1, i+1);
+                }
+                lap(W-1, W-2, pbc ? 0 : W-1);
+            }
+
+            const double* cp[2] = {ca, cb};
+            double* rp[2] = {rx_a, rx_b};
+            this->reaction_system->reaction_batch(cp, rp, W);
+
+            for(unsigned int i=0; i<W; i++) {
+                const double da = dt * (Da * na[i] + rx_a[i]);
+                const double db = dt * (Db * nb[i] + rx_b[i]);
+                na[i] = ca[i] + da;
+                nb[i] = cb[i] + db;
+
+                if(track) {
+                    max_da = std::max(max_da, std::fabs(da));
+                    max_db = std::max(max_db, std::fabs(db));
+                }
+            }
+        }
+
+        if(k > 0) {
+            const size_t prev = this->idx(0, j0, k-1);
+            std::memcpy(&pa[prev], new_a[(k-1) & 1], P * sizeof(double));
+            std::memcpy(&pb[prev], new_b[(k-1) & 1], P * sizeof(double));
+        }
+    }
+
+    const size_t last = this->idx(0, j0, D-1);
+    std::memcpy(&pa[last], new_a[(D-1) & 1], P * sizeof(double));
+    std::memcpy(&pb[last], new_b[(D-1) & 1], P * sizeof(double));
+
+    *ra = max_da / dt;
+    *rb = max_db / dt;
+}
+
+/**
+ * @brief      Sample concentration A at the probe points of the convergence monitor
+ *
+ * @return     probe values
+ */
+std::vector<double> ThreeDimRD::sample_probes() const {
+    return {
+        this->a[this->idx(this->width / 2, this->height / 2, this->depth / 2)],
+        this->a[this->idx(this->width / 4, this->height / 4, this->depth / 4)],
+        this->a[this->idx(3 * this->width / 4, 3 * this->height / 4, 3 * this->depth / 4)]
+    };
+}
@@ -0,0 +1,216 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#pragma once
+
+#include <Eigen/Dense>
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "reaction_system.h"
+#include "convergence_monitor.h"
+#include "metrics_exporter.h"
+#include "output_metadata.h"
+#include "frame_writer.h"
+#include "tqdm.hpp"
+
+/**
+ * @brief      Three-dimensional reaction-diffusion system
+ *
+ * Only the concentrations themselves are stored (two doubles per cell).
+ * A time step sweeps the volume plane by plane: the new values of a plane
+ * are held in a small buffer until the next plane has been evaluated, after
+ * which they replace the old values. To keep the planes in cache, the
+ * system is divided into bands of rows that are swept independently (and
+ * in parallel); the old values of the first and last row of every band
+ * are copied before the sweep, as these are needed by the neighbouring
+ * bands.
+ */
+class ThreeDimRD {
+private:
+    double Da;              //!< Diffusion coefficient of compound A
+    double Db;              //!< Diffusion coefficient of compound B
+
+    unsigned int width;     //!< width of the system
+    unsigned int height;    //!< height of the system
+    unsigned int depth;     //!< depth of the system
+    double dx;              //!< size of the space interval
+    double dt;              //!< size of the time interval
+    unsigned int steps;     //!< number of frames
+    unsigned int tsteps;    //!< number of time steps when to write a frame
+
+    std::vector<double> a;  //!< concentration of A
+    std::vector<double> b;  //!< concentration of B
+
+    unsigned int band_rows = 0;         //!< number of rows in a band
+    unsigned int nr_bands = 0;          //!< number of bands
+    std::vector<double> edge_lo_a;      //!< old values of A in the first row of every band
+    std::vector<double> edge_hi_a;      //!< old values of A in the last row of every band
+    std::vector<double> edge_lo_b;      //!< old values of B in the first row of every band
+    std::vector<double> edge_hi_b;      //!< old values of B in the last row of every band
+    std::vector<std::vector<double>> scratch;   //!< plane buffers per band
+
+    unsigned int nframes = 0;   //!< number of frames written
+    double t = 0.0;             //!< Total time t
+
+    std::unique_ptr<ReactionSystem> reaction_system;    //!< Pointer to reaction system
+
+    bool pbc = true;    //!< Whether to employ periodic boundary conditions
+
+    unsigned int chunk_size = 0;    //!< edge length of the chunks of the output (0 = contiguous frames)
+    int compression = 0;            //!< zlib compression level of the chunks
+    std::string quantization;       //!< quantization of the chunks (see FrameQuantizer, empty = none)
+
+    std::unique_ptr<ConvergenceMonitor> convergence_monitor;   //!< Optional steady-state detection
+
+    std::unique_ptr<MetricsExporter> metrics;   //!< Optional status file, rewritten while integrating
+
+    bool track_rates = false;   //!< Whether update() tracks the rate of change
+    double rate_a = 0.0;        //!< max|da/dt| of the last tracked time step
+    double rate_b = 0.0;        //!< max|db/dt| of the last tracked time step
+
+public:
+    /**
+     * @brief      Constructs the object.
+     *
+     * @param[in]  _Da      Diffusion coefficient of compound A
+     * @param[in]  _Db      Diffusion coefficient of compound B
+     * @param[in]  _width   width of the system
+     * @param[in]  _height  height of the system
+     * @param[in]  _depth   depth of the system
+     * @param[in]  _dx      size of the space interval
+     * @param[in]  _dt      size of the time interval
+     * @param[in]  _steps   number of frames
+     * @param[in]  _tsteps  number of time steps when to write a frame
+     */
+    ThreeDimRD(double _Da, double _Db,
+               unsigned int _width, unsigned int _height, unsigned int _depth,
+               double _dx, double _dt, unsigned int _steps, unsigned int _tsteps);
+
+    /**
+     * @brief      Sets the reaction.
+     *
+     * @param      _reaction_system  The reaction system
+     */
+    void set_reaction(ReactionSystem* _reaction_system);
+
+    /**
+     * @brief      Set whether system has periodic boundary conditions
+     *
+     * @param[in]  _pbc  Periodic boundary conditions
+     */
+    inline void set_pbc(bool _pbc) {
+        this->pbc = _pbc;
+    }
+
+    /**
+     * @brief      Sets the convergence monitor.
+     *
+     * @param      _convergence_monitor  The convergence monitor
+     */
+    void set_convergence_monitor(ConvergenceMonitor* _convergence_monitor);
+
+    /**
+     * @brief      Periodically write the progress of the integration to a status file
+     *
+     * @param      _metrics  The metrics exporter
+     */
+    void set_metrics(MetricsExporter* _metrics);
+
+    /**
+     * @brief      Store the output as (optionally compressed) chunks
+     *
+     * The chunks tile the layers stacked along the height.
+     *
+     * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  _compression   zlib compression level of the chunks
+     * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    inline void set_chunking(unsigned int _chunk_size, int _compression, const std::string& _quantization = "") {
+        this->chunk_size = _chunk_size;
+        this->compression = _compression;
+        this->quantization = _quantization;
+    }
+
+    /**
+     * @brief      Sets the parameters.
+     *
+     * @param[in]  params  The parameters
+     */
+    inline void set_parameters(const std::string& params) {
+        this->reaction_system->set_parameters(params);
+        this->init();
+    }
+
+    /**
+     * @brief      Perform time integration
+     *
+     * A volume is typically too large to keep all frames in memory, hence
+     * the frames are written to the file as soon as they are available.
+     *
+     * @param[in]  filename  The filename
+     */
+    void time_integrate(const std::string& filename);
+
+    /**
+     * @brief      Write run metadata (JSON) to file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_metadata_to_file(const std::string& filename);
+
+private:
+    /**
+     * @brief      Initialize the system
+     */
+    void init();
+
+    /**
+     * @brief      Perform a time-step
+     */
+    void update();
+
+    /**
+     * @brief      Perform a time-step for a single band of rows
+     *
+     * @param[in]  n     index of the band
+     * @param      ra    max|da/dt| in the band (if rates are tracked)
+     * @param      rb    max|db/dt| in the band (if rates are tracked)
+     */
+    void update_band(unsigned int n, double* ra, double* rb);
+
+    /**
+     * @brief      Sample concentration A at the probe points of the convergence monitor
+     *
+     * @return     probe values
+     */
+    std::vector<double> sample_probes() const;
+
+    /**
+     * @brief      Index of a cell
+     */
+    inline size_t idx(unsigned int i, unsigned int j, unsigned int k) const {
+        return (size_t)i + (size_t)this->width * ((size_t)j + (size_t)this->height * (size_t)k);
+    }
+};
@@ -25,6 +25,7 @@
  *OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -69,6 +70,14 @@ public:
     time_point_t start_;
 };
 
+// progress bars can be switched off for the whole process, e.g. when the
+// output is collected by a batch scheduler
+inline std::atomic<bool>& enabled()
+{
+    static std::atomic<bool> flag{true};
+    return flag;
+}
+
 // -------------------- iter_wrapper --------------------
 
 template <class ForwardIter>
@@ -158,8 +167,9 @@ public:
 
     void update()
     {
-        if (time_since_refresh() > min_time_per_update_ || iters_done_ == 0 ||
-            iters_left() == 0)
+        if (enabled().load(std::memory_order_relaxed) &&
+            (time_since_refresh() > min_time_per_update_ || iters_done_ == 0 ||
+             iters_left() == 0))
         {
             reset_refresh_timer();
             print_progress();
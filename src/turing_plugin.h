@@ -0,0 +1,92 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+#pragma once
+
+/*
+ * C interface for reaction systems that are compiled separately and loaded
+ * at runtime (see --reaction-plugin). A plugin is a shared library that
+ * exports the function turing_reaction_plugin(), which returns a pointer to
+ * a statically allocated descriptor. Only plain C types cross the library
+ * boundary, such that plugins can be built with any compiler.
+ *
+ * All concentrations and reaction terms are stored per species (structure
+ * of arrays). The kernel is called for a contiguous span of n grid points
+ * at a time, and may be called concurrently from multiple threads.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TURING_PLUGIN_ABI_VERSION 1
+#define TURING_PLUGIN_SYMBOL "turing_reaction_plugin"
+
+/**
+ * @brief      Batch reaction kernel
+ *
+ * @param[in]  c       concentrations per species (n values each)
+ * @param      r       reaction terms per species (n values each)
+ * @param[in]  n       number of grid points
+ * @param[in]  params  parameter block (in the order of parameter_names)
+ */
+typedef void (*turing_reaction_kernel)(const double* const* c, double* const* r,
+                                       unsigned int n, const double* params);
+
+/**
+ * @brief      Initial condition (optional)
+ *
+ * The concentration of species s at grid point (i,j) is stored at
+ * c[s][i + j * width].
+ *
+ * @param      c       concentrations per species
+ * @param[in]  width   width of the system
+ * @param[in]  height  height of the system
+ * @param[in]  params  parameter block (in the order of parameter_names)
+ */
+typedef void (*turing_reaction_init)(double* const* c, unsigned int width, unsigned int height,
+                                     const double* params);
+
+/**
+ * @brief      Descriptor of a reaction plugin
+ */
+typedef struct {
+    unsigned int abi_version;               /* TURING_PLUGIN_ABI_VERSION */
+    const char* name;                       /* name used for --reaction */
+    const char* description;                /* human-readable name */
+    unsigned int nr_species;                /* number of species */
+    const char* const* species_names;       /* names of the species */
+    unsigned int nr_parameters;             /* number of parameters */
+    const char* const* parameter_names;     /* names of the parameters */
+    const double* parameter_defaults;       /* default values of the parameters */
+    turing_reaction_kernel reaction;        /* batch reaction kernel */
+    turing_reaction_init init;              /* initial condition, NULL for random */
+} turing_reaction_plugin_t;
+
+/**
+ * @brief      Entry point of a plugin
+ */
+typedef const turing_reaction_plugin_t* (*turing_reaction_plugin_entry)(void);
+
+#ifdef __cplusplus
+}
+#endif
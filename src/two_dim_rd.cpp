@@ -53,23 +53,656 @@ void TwoDimRD::set_reaction(ReactionSystem* _reaction_system) {
     this->reaction_system = std::unique_ptr<ReactionSystem>(_reaction_system);
 }
 
+/**
+ * @brief      Set a spatially varying (and possibly anisotropic) medium
+ *
+ * @param      _diffusion_field  The diffusion field
+ */
+void TwoDimRD::set_diffusion_field(DiffusionField* _diffusion_field) {
+    this->diffusion_field = std::unique_ptr<DiffusionField>(_diffusion_field);
+    this->diffusion_field->prepare(this->pbc);
+}
+
+/**
+ * @brief      Restrict the system to an irregular domain
+ *
+ * @param      _mask  The domain mask
+ */
+void TwoDimRD::set_mask(DomainMask* _mask) {
+    this->mask = std::unique_ptr<DomainMask>(_mask);
+    this->mask->prepare(this->pbc);
+
+    // the system may already have been initialized on the full grid
+    this->mask->clear_outside(this->a);
+    this->mask->clear_outside(this->b);
+    if(!this->ta.empty()) {
+        this->mask->clear_outside(this->ta.back());
+        this->mask->clear_outside(this->tb.back());
+    }
+}
+
+/**
+ * @brief      Select, crop and downsample the fields that are written
+ *
+ * @param      _output_spec  The output specification
+ */
+void TwoDimRD::set_output_spec(OutputSpec* _output_spec) {
+    this->output_spec = std::unique_ptr<OutputSpec>(_output_spec);
+}
+
+/**
+ * @brief      Store the output as (optionally compressed) chunks
+ *
+ * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+ * @param[in]  _compression   zlib compression level of the chunks
+ * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+ */
+void TwoDimRD::set_chunking(unsigned int _chunk_size, int _compression, const std::string& _quantization) {
+    this->chunk_size = _chunk_size;
+    this->compression = _compression;
+    this->quantization = _quantization;
+}
+
+/**
+ * @brief      Render the frames to images while integrating
+ *
+ * @param      _renderer  The renderer
+ */
+void TwoDimRD::set_renderer(FrameRenderer* _renderer) {
+    this->renderer = std::unique_ptr<FrameRenderer>(_renderer);
+}
+
+/**
+ * @brief      Compute statistics and power spectra of the frames while integrating
+ *
+ * @param      _analysis  The analysis
+ */
+void TwoDimRD::set_analysis(FieldAnalysis* _analysis) {
+    this->analysis = std::unique_ptr<FieldAnalysis>(_analysis);
+}
+
+/**
+ * @brief      Extract spots and spiral tips from the frames while integrating
+ *
+ * @param      _features  The feature extractor
+ */
+void TwoDimRD::set_features(FeatureExtractor* _features) {
+    this->features = std::unique_ptr<FeatureExtractor>(_features);
+}
+
+/**
+ * @brief      Record the concentrations at points and transects every time step
+ *
+ * @param      _probes  The probe recorder
+ */
+void TwoDimRD::set_probes(ProbeRecorder* _probes) {
+    this->probes = std::unique_ptr<ProbeRecorder>(_probes);
+}
+
+/**
+ * @brief      Periodically write the progress of the integration to a status file
+ *
+ * @param      _metrics  The metrics exporter
+ */
+void TwoDimRD::set_metrics(MetricsExporter* _metrics) {
+    this->metrics = std::unique_ptr<MetricsExporter>(_metrics);
+}
+
+/**
+ * @brief      Sets the convergence monitor.
+ *
+ * @param      _convergence_monitor  The convergence monitor
+ */
+void TwoDimRD::set_convergence_monitor(ConvergenceMonitor* _convergence_monitor) {
+    this->convergence_monitor = std::unique_ptr<ConvergenceMonitor>(_convergence_monitor);
+}
+
+/**
+ * @brief      Only update tiles that are not at rest
+ *
+ * @param[in]  _tile_size       edge length of a tile in grid points (0 disables tiling)
+ * @param[in]  _tile_tolerance  max|dc| per time step below which a tile is at rest
+ */
+void TwoDimRD::set_tiling(unsigned int _tile_size, double _tile_tolerance) {
+    this->tile_size = _tile_size;
+    this->tile_tolerance = _tile_tolerance;
+
+    if(this->tile_size == 0) {
+        return;
+    }
+
+    // rows of the matrices run along the width of the system
+    this->tiles_i = (this->width + this->tile_size - 1) / this->tile_size;
+    this->tiles_j = (this->height + this->tile_size - 1) / this->tile_size;
+
+    this->tile_active.assign(this->tiles_i * this->tiles_j, 1);
+    this->tile_changed.assign(this->tiles_i * this->tiles_j, 1);
+    this->active_tiles.reserve(this->tiles_i * this->tiles_j);
+}
+
+/**
+ * @brief      Replace the time integration by a continuation scan
+ *
+ * @param      _continuation  The continuation scan
+ */
+void TwoDimRD::set_continuation(ContinuationScan* _continuation) {
+    this->continuation = std::unique_ptr<ContinuationScan>(_continuation);
+}
+
+/**
+ * @brief      Share the first frames among branches with different parameters
+ *
+ * @param[in]  _frame       number of frames of the shared prefix
+ * @param[in]  _parameters  parameters of the reaction system per branch
+ * @param[in]  _outfile     output file of the shared prefix
+ */
+void TwoDimRD::set_branches(unsigned int _frame, const std::vector<std::string>& _parameters, const std::string& _outfile) {
+    if(_frame >= this->steps) {
+        throw std::runtime_error("The branches have to split off before the last frame");
+    }
+    this->branch_frame = _frame;
+    this->branch_parameters = _parameters;
+    this->branch_outfile = _outfile;
+}
+
+/**
+ * @brief      Spin up the pattern on coarser grids before integrating the frames
+ *
+ * @param      _spinup  The spin-up
+ */
+void TwoDimRD::set_spin_up(MultiresSpinUp* _spinup) {
+    this->spinup = std::unique_ptr<MultiresSpinUp>(_spinup);
+}
+
+/**
+ * @brief      Split every time step into reaction and diffusion (Strang splitting)
+ *
+ * @param      _subcycler  The sub-cycling of the reaction terms
+ */
+void TwoDimRD::set_subcycler(ReactionSubcycler* _subcycler) {
+    this->subcycler = std::unique_ptr<ReactionSubcycler>(_subcycler);
+}
+
+/**
+ * @brief      Get the output file of a branch
+ *
+ * @param[in]  outfile  output file of the shared prefix
+ * @param[in]  i        branch
+ *
+ * @return     filename
+ */
+std::string TwoDimRD::get_branch_filename(const std::string& outfile, unsigned int i) {
+    const size_t slash = outfile.find_last_of('/');
+    const size_t dot = outfile.find_last_of('.');
+    const std::string tag = ".branch" + std::to_string(i);
+    if(dot == std::string::npos || dot == 0 || (slash != std::string::npos && dot < slash + 2)) {
+        return outfile + tag;
+    }
+    return outfile.substr(0, dot) + tag + outfile.substr(dot);
+}
+
 /**
  * @brief      Perform time integration
  */
 void TwoDimRD::time_integrate() {
     this->t = 0;
 
+    if(this->metrics) {
+        if(this->renderer) {
+            this->metrics->add_backlog_source([this]() { return this->renderer->get_backlog(); });
+        }
+        if(this->probes) {
+            this->metrics->add_backlog_source([this]() { return this->probes->get_backlog(); });
+        }
+        this->metrics->start();
+    }
+
+    if(this->continuation) {
+        this->continuation_scan();
+        if(this->metrics) {
+            this->metrics->finish();
+        }
+        return;
+    }
+
+    if(!this->branch_parameters.empty()) {
+        this->branched_integration();
+        if(this->metrics) {
+            this->metrics->finish();
+        }
+        return;
+    }
+
+    if(this->diffusion_field) {
+        std::cout << "Fraction of tiles with a uniform medium: "
+                  << this->diffusion_field->get_uniform_fraction() << std::endl;
+    }
+
+    if(this->spinup) {
+        this->multires_spin_up();
+    }
+
+    if(this->renderer) {
+        this->renderer->push(0, {this->a.data(), this->b.data()});
+    }
+
+    if(this->analysis) {
+        this->analysis->analyze(0, this->t, {this->a.data(), this->b.data()});
+    }
+
+    if(this->features) {
+        this->features->extract(0, this->t, {this->a.data(), this->b.data()});
+    }
+
+    if(this->probes) {
+        const double* c[2] = {this->a.data(), this->b.data()};
+        this->probes->record(this->t, c);
+    }
+
+    // only the reduced initial frame is kept
+    if(this->output_spec) {
+        this->output_spec->record(0, {this->ta[0].data(), this->tb[0].data()});
+        this->ta.clear();
+        this->tb.clear();
+    }
+
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+    const auto start = std::chrono::steady_clock::now();
+
     for(int i : tq::trange(this->steps)) {
-        for(unsigned int j=0; j<this->tsteps; j++) {
-            this->update();
+        const bool steady = this->integrate_frame();
+
+        this->nr_frames++;
+        if(this->output_spec) {
+            this->output_spec->record(this->nr_frames, {this->a.data(), this->b.data()});
+        } else {
+            this->ta.push_back(this->a);
+            this->tb.push_back(this->b);
+        }
+
+        if(this->renderer) {
+            this->renderer->push(this->nr_frames, {this->a.data(), this->b.data()});
+        }
+
+        if(this->analysis) {
+            this->analysis->analyze(this->nr_frames, this->t, {this->a.data(), this->b.data()});
+        }
+
+        if(this->features) {
+            this->features->extract(this->nr_frames, this->t, {this->a.data(), this->b.data()});
+        }
+
+        if(steady) {
+            break;
+        }
+    }
+
+    // give newline after tqdm progress bar
+    std::cout << std::endl;
+
+    // compare the spin-up with the cost of a time step on the requested grid
+    if(this->spinup && this->nr_frames > 0) {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        this->spinup->set_step_cost(seconds / ((double)this->nr_frames * this->tsteps), this->dt);
+        const double saved = this->spinup->get_direct_seconds() - this->spinup->get_seconds();
+        std::cout << "The spin-up to t = " << this->spinup->get_time() << " took " << this->spinup->get_seconds()
+                  << " s instead of about " << this->spinup->get_direct_seconds()
+                  << " s on the requested grid (" << saved << " s saved)." << std::endl;
+    }
+
+    if(this->output_spec) {
+        this->output_spec->record(this->nr_frames, {this->a.data(), this->b.data()}, true);
+    }
+
+    if(this->renderer) {
+        this->renderer->finish();
+        std::cout << "Rendered " << this->renderer->get_nr_frames() << " frames." << std::endl;
+    }
+
+    if(this->analysis) {
+        this->analysis->write();
+        std::cout << "Wrote the analysis of " << this->analysis->get_nr_frames() << " frames to "
+                  << this->analysis->get_filename() << "." << std::endl;
+    }
+
+    if(this->features) {
+        this->features->write();
+        std::cout << "Wrote the features of " << this->features->get_nr_frames() << " frames to "
+                  << this->features->get_filename() << "." << std::endl;
+    }
+
+    if(this->probes) {
+        this->probes->finish();
+        std::cout << "Wrote " << this->probes->get_nr_records() << " probe records to "
+                  << this->probes->get_filename() << "." << std::endl;
+    }
+
+    if(monitor != nullptr && monitor->is_converged()) {
+        if(monitor->is_periodic()) {
+            std::cout << "Periodic steady state reached at t = " << monitor->get_convergence_time()
+                      << " (period T = " << monitor->get_period() << ")." << std::endl;
+        } else {
+            std::cout << "Steady state reached at t = " << monitor->get_convergence_time()
+                      << "." << std::endl;
+        }
+        std::cout << "Terminating after " << this->nr_frames << " of " << this->steps
+                  << " frames." << std::endl;
+    }
+
+    if(this->metrics) {
+        this->metrics->finish();
+    }
+
+    if(this->tile_size > 0 && !this->active_fraction.empty()) {
+        double sum = 0.0;
+        for(double f : this->active_fraction) {
+            sum += f;
         }
+        std::cout << "Average fraction of active tiles: "
+                  << sum / (double)this->active_fraction.size() << std::endl;
+    }
+
+    if(this->subcycler) {
+        this->subcycler->report(std::cout);
+    }
+}
 
+/**
+ * @brief      Integrate every case of the continuation scan up to its steady state
+ */
+void TwoDimRD::continuation_scan() {
+    ContinuationScan* scan = this->continuation.get();
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+    if(monitor == nullptr) {
+        throw std::runtime_error("A continuation scan requires steady-state detection");
+    }
+
+    if(this->diffusion_field) {
+        std::cout << "Fraction of tiles with a uniform medium: "
+                  << this->diffusion_field->get_uniform_fraction() << std::endl;
+    }
+
+    // the first frame holds the initial state, every next frame the final state of a case
+    unsigned int total_frames = 0;
+    for(int c : tq::trange(scan->get_nr_cases())) {
+        this->reaction_system->set_parameters(scan->get_parameters(c));
+        monitor->reset();
+        const double t0 = this->t;
+
+        unsigned int frames = 0;
+        while(frames < this->steps) {
+            frames++;
+            if(this->integrate_frame()) {
+                break;
+            }
+        }
+        total_frames += frames;
+
+        this->nr_frames++;
         this->ta.push_back(this->a);
         this->tb.push_back(this->b);
+        scan->record(c, frames, this->t - t0, monitor->is_converged(), monitor->is_periodic(),
+                     monitor->get_period(), {this->a.data(), this->b.data()});
     }
 
     // give newline after tqdm progress bar
     std::cout << std::endl;
+
+    unsigned int nr_converged = 0;
+    for(size_t c=0; c<scan->get_nr_cases(); c++) {
+        nr_converged += scan->get_case(c).converged ? 1 : 0;
+    }
+    std::cout << nr_converged << " of " << scan->get_nr_cases() << " cases reached a steady state, using "
+              << total_frames << " of at most " << scan->get_nr_cases() * this->steps << " frames." << std::endl;
+
+    scan->write();
+    std::cout << "Wrote the bifurcation diagram to " << scan->get_filename() << "." << std::endl;
+}
+
+/**
+ * @brief      Integrate the shared prefix once and every branch from a copy of its final state
+ */
+void TwoDimRD::branched_integration() {
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+
+    if(this->diffusion_field) {
+        std::cout << "Fraction of tiles with a uniform medium: "
+                  << this->diffusion_field->get_uniform_fraction() << std::endl;
+    }
+
+    // the shared prefix runs to its end, a steady state only ends the branches
+    std::cout << "Integrating " << this->branch_frame << " frames shared by "
+              << this->branch_parameters.size() << " branches." << std::endl;
+    for(int i : tq::trange(this->branch_frame)) {
+        this->integrate_frame();
+        this->nr_frames++;
+        this->ta.push_back(this->a);
+        this->tb.push_back(this->b);
+    }
+    std::cout << std::endl;
+
+    // the frames of the prefix are set aside, every branch starts from a copy of its final state
+    const MatrixXXd a0 = this->a;
+    const MatrixXXd b0 = this->b;
+    const unsigned int prefix_frames = this->nr_frames;
+    this->branch_time = this->t;
+    std::vector<MatrixXXd> prefix_a, prefix_b;
+    std::swap(prefix_a, this->ta);
+    std::swap(prefix_b, this->tb);
+    std::vector<double> prefix_active;
+    std::swap(prefix_active, this->active_fraction);
+
+    for(unsigned int k=0; k<this->branch_parameters.size(); k++) {
+        this->branch = k;
+        this->a = a0;
+        this->b = b0;
+        this->t = this->branch_time;
+        this->ta.assign(1, a0);
+        this->tb.assign(1, b0);
+        this->nr_frames = 0;
+        this->active_fraction.clear();
+        this->reaction_system->set_parameters(this->branch_parameters[k]);
+        if(monitor != nullptr) {
+            monitor->reset();
+        }
+
+        std::cout << "Integrating branch " << k << " (" << this->branch_parameters[k] << ")." << std::endl;
+        for(int i : tq::trange(this->steps - this->branch_frame)) {
+            const bool steady = this->integrate_frame();
+            this->nr_frames++;
+            this->ta.push_back(this->a);
+            this->tb.push_back(this->b);
+            if(steady) {
+                break;
+            }
+        }
+        std::cout << std::endl;
+
+        if(monitor != nullptr && monitor->is_converged()) {
+            std::cout << "Steady state reached at t = " << monitor->get_convergence_time() << "." << std::endl;
+        }
+
+        const std::string filename = get_branch_filename(this->branch_outfile, k);
+        std::cout << "Writing the frames of branch " << k << " to " << filename << "." << std::endl;
+        this->write_state_to_file(filename);
+        this->write_metadata_to_file(filename + ".json");
+    }
+
+    // restore the shared prefix for the output of the caller
+    this->branch = -1;
+    this->reaction_system->set_parameters(this->parameters);
+    this->a = a0;
+    this->b = b0;
+    this->t = this->branch_time;
+    std::swap(prefix_a, this->ta);
+    std::swap(prefix_b, this->tb);
+    std::swap(prefix_active, this->active_fraction);
+    this->nr_frames = prefix_frames;
+    if(monitor != nullptr) {
+        monitor->reset();
+    }
+}
+
+/**
+ * @brief      Integrate the levels of the spin-up from coarse to fine
+ */
+void TwoDimRD::multires_spin_up() {
+    MultiresSpinUp* spin = this->spinup.get();
+
+    // the levels use the plain update on coarser copies of the grid
+    const unsigned int fine_width = this->width;
+    const unsigned int fine_height = this->height;
+    const double fine_dx = this->dx;
+    const double fine_dt = this->dt;
+    const unsigned int fine_tile_size = this->tile_size;
+    this->tile_size = 0;
+
+    const double interval = spin->get_interval() > 0.0 ? spin->get_interval() : this->tsteps * fine_dt;
+    const double max_time = spin->get_max_time() > 0.0 ? spin->get_max_time() : this->steps * this->tsteps * fine_dt;
+    const std::vector<std::string> names = this->reaction_system->get_species_names();
+
+    std::cout << "Spinning up on " << spin->get_levels() << " coarser grids (" << spin->get_description() << ")."
+              << std::endl;
+    for(unsigned int l=spin->get_levels(); l>=1; l--) {
+        const auto start = std::chrono::steady_clock::now();
+
+        this->width = fine_width >> l;
+        this->height = fine_height >> l;
+        this->dx = fine_dx * (1u << l);
+        this->dt = spin->get_time_step(fine_dt, l, this->dx, std::max(this->Da, this->Db));
+
+        // the coarsest level starts from the initial condition, every next one from the previous level
+        if(l == spin->get_levels()) {
+            this->a = MatrixXXd::Zero(this->width, this->height);
+            this->b = MatrixXXd::Zero(this->width, this->height);
+            this->reaction_system->init(this->a, this->b);
+        } else {
+            MultiresSpinUp::prolongate(MatrixXXd(this->a), this->a, this->pbc);
+            MultiresSpinUp::prolongate(MatrixXXd(this->b), this->b, this->pbc);
+        }
+        this->delta_a = MatrixXXd::Zero(this->width, this->height);
+        this->delta_b = MatrixXXd::Zero(this->width, this->height);
+
+        FieldAnalysis spectra("fields=" + spin->get_field() + ";bins=0", names,
+                               this->width, this->height, this->dx, "");
+        const unsigned int nsteps = std::max(1l, std::lround(interval / this->dt));
+        std::vector<double> wavelengths;
+
+        MultiresSpinUp::Level level;
+        level.width = this->width;
+        level.height = this->height;
+        level.dx = this->dx;
+        level.dt = this->dt;
+        // every level runs at least one check interval, also when the run itself has no time steps
+        do {
+            for(unsigned int k=0; k<nsteps; k++) {
+                this->update();
+            }
+            level.nsteps += nsteps;
+            level.time += nsteps * this->dt;
+
+            if(!this->a.allFinite() || !this->b.allFinite()) {
+                throw std::runtime_error("The spin-up diverged on the " + std::to_string(this->width) + "x" +
+                                         std::to_string(this->height) + " grid (time step " +
+                                         std::to_string(this->dt) + "); use a smaller dt_factor");
+            }
+
+            spectra.analyze(wavelengths.size(), this->t, {this->a.data(), this->b.data()});
+            const double k_peak = spectra.get_sample(spectra.get_nr_frames() - 1, 0).k_peak;
+            wavelengths.push_back(k_peak > 0.0 ? 2.0 * M_PI / k_peak : 0.0);
+        } while(level.time < max_time && !spin->is_stable(wavelengths));
+        level.wavelength = wavelengths.back();
+        level.stable = spin->is_stable(wavelengths);
+        level.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        spin->add_level(level);
+
+        std::cout << "  " << level.width << "x" << level.height << " (dx = " << level.dx << ", dt = " << level.dt
+                  << "): " << level.nsteps << " steps to t = " << this->t << ", wavelength " << level.wavelength
+                  << (level.stable ? "" : " (not stable)") << ", " << level.seconds << " s" << std::endl;
+
+        // a wavelength of only a few grid points is a grid artefact rather than the pattern
+        if(level.wavelength > 0.0 && level.wavelength < 4.0 * level.dx) {
+            std::cout << "  WARNING: the pattern is not resolved on the " << level.width << "x" << level.height
+                      << " grid; consider fewer levels" << std::endl;
+        }
+    }
+
+    // the frames continue on the requested grid
+    this->width = fine_width;
+    this->height = fine_height;
+    this->dx = fine_dx;
+    this->dt = fine_dt;
+    this->tile_size = fine_tile_size;
+    MultiresSpinUp::prolongate(MatrixXXd(this->a), this->a, this->pbc);
+    MultiresSpinUp::prolongate(MatrixXXd(this->b), this->b, this->pbc);
+    this->delta_a = MatrixXXd::Zero(this->width, this->height);
+    this->delta_b = MatrixXXd::Zero(this->width, this->height);
+
+    this->ta.assign(1, this->a);
+    this->tb.assign(1, this->b);
+}
+
+/**
+ * @brief      Integrate the time steps of a single frame
+ *
+ * @return     true when the convergence monitor reports a steady state
+ */
+bool TwoDimRD::integrate_frame() {
+    ConvergenceMonitor* monitor = this->convergence_monitor.get();
+
+    // tiles at rest are re-evaluated at the start of every frame
+    if(this->tile_size > 0) {
+        this->activate_all_tiles();
+    }
+
+    for(unsigned int j=0; j<this->tsteps; j++) {
+        // the rate of change is only needed at the end of a frame
+        this->track_rates = (monitor != nullptr && j == this->tsteps - 1);
+        this->update();
+
+        if(this->probes) {
+            const double* c[2] = {this->a.data(), this->b.data()};
+            this->probes->step(this->t, c);
+        }
+
+        if(this->metrics) {
+            this->metrics->progress(this->t);
+        }
+
+        if(monitor != nullptr && monitor->detects_periodic()) {
+            monitor->add_sample(this->t, this->sample_probes());
+        }
+    }
+
+    if(this->tile_size > 0) {
+        this->active_fraction.push_back(this->active_sum / (double)this->tsteps);
+        this->active_sum = 0.0;
+    }
+
+    if(monitor == nullptr) {
+        return false;
+    }
+
+    const bool steady = monitor->check_frame(this->t, this->rate_a, this->rate_b);
+    if(this->metrics) {
+        this->metrics->set_norm(std::max(this->rate_a, this->rate_b));
+    }
+    return steady;
+}
+
+/**
+ * @brief      Perform a number of time steps without storing frames
+ *
+ * @param[in]  n     number of time steps
+ */
+void TwoDimRD::advance(unsigned int n) {
+    if(this->tile_size > 0) {
+        this->activate_all_tiles();
+    }
+
+    for(unsigned int i=0; i<n; i++) {
+        this->update();
+    }
 }
 
 /**
@@ -78,35 +711,127 @@ void TwoDimRD::time_integrate() {
  * @param[in]  filename  The filename
  */
 void TwoDimRD::write_state_to_file(const std::string& filename) {
-    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(this->output_spec) {
+        this->output_spec->write(filename, this->chunk_size, this->compression, this->quantization);
+        return;
+    }
 
-    typename MatrixXXd::Index rows, cols;
+    FrameWriter writer(filename, this->width, this->height, this->chunk_size, this->compression,
+                       this->quantization);
 
-    // store width and height
-    out.write((char*) (&this->width), sizeof(unsigned int) );
-    out.write((char*) (&this->height), sizeof(unsigned int) );
+    // the number of frames is less than the number of requested frames
+    // when a steady state was reached
+    for(unsigned int i=0; i<this->ta.size(); i++) {
+        writer.write_frame(this->ta[i], this->tb[i]);
+    }
 
-    // store number of frames
-    out.write((char*) (&this->steps), sizeof(unsigned int) );
+    writer.close();
+}
 
-    for(unsigned int i=0; i<this->ta.size(); i++) {
-        const auto& a = this->ta[i];
-        const auto& b = this->tb[i];
+/**
+ * @brief      Write run metadata (JSON) to file
+ *
+ * @param[in]  filename  The filename
+ */
+void TwoDimRD::write_metadata_to_file(const std::string& filename) {
+    OutputMetadata metadata;
 
-        // store a
-        rows = a.rows();
-        cols = a.cols();
+    metadata.set("width", this->width);
+    metadata.set("height", this->height);
+    metadata.set("frames", this->nr_frames);
+    metadata.set("frames_requested", this->steps);
+    metadata.set("tsteps", this->tsteps);
+    metadata.set("dx", this->dx);
+    metadata.set("dt", this->dt);
+    metadata.set("Da", this->Da);
+    metadata.set("Db", this->Db);
+    metadata.set("species", this->reaction_system->get_nr_species());
+    metadata.set("species_names", this->reaction_system->get_species_names());
+    metadata.set("pbc", this->pbc);
+    metadata.set("stencil", (unsigned int)this->stencil);
+    metadata.set("t_final", this->t);
 
-        out.write((char*) a.data(), rows * cols * sizeof(typename MatrixXXd::Scalar) );
+    const ConvergenceMonitor* monitor = this->convergence_monitor.get();
+    if(monitor != nullptr) {
+        metadata.set("converged", monitor->is_converged());
+        metadata.set("periodic", monitor->is_periodic());
+        if(monitor->is_converged()) {
+            metadata.set("convergence_time", monitor->get_convergence_time());
+        }
+        if(monitor->is_periodic()) {
+            metadata.set("period", monitor->get_period());
+        }
+        metadata.set("rate_a", monitor->get_rate_a());
+        metadata.set("rate_b", monitor->get_rate_b());
+    }
 
-        // store b
-        rows = b.rows();
-        cols = b.cols();
+    if(this->continuation) {
+        metadata.set("continuation", this->continuation->get_description());
+        metadata.set("continuation_parameter", this->continuation->get_parameter());
+        metadata.set("continuation_values", this->continuation->get_values());
+    }
+
+    if(!this->branch_parameters.empty()) {
+        metadata.set("branch_frame", this->branch_frame);
+        metadata.set("branch_time", this->branch_time);
+        if(this->branch >= 0) {
+            metadata.set("branch", (unsigned int)this->branch);
+            metadata.set("branch_parameters", this->branch_parameters[this->branch]);
+            metadata.set("branch_of", this->branch_outfile);
+        } else {
+            std::vector<std::string> files;
+            for(unsigned int k=0; k<this->branch_parameters.size(); k++) {
+                files.push_back(get_branch_filename(this->branch_outfile, k));
+            }
+            metadata.set("branch_parameters", this->branch_parameters);
+            metadata.set("branch_files", files);
+        }
+    }
 
-        out.write((char*) b.data(), rows * cols * sizeof(typename MatrixXXd::Scalar) );
+    if(this->diffusion_field) {
+        metadata.set("diffusion_field", this->diffusion_field->get_description());
+        metadata.set("diffusion_uniform_fraction", this->diffusion_field->get_uniform_fraction());
     }
 
-    out.close();
+    if(this->probes) {
+        metadata.set("probes", this->probes->get_description());
+        metadata.set("probes_file", this->probes->get_filename());
+    }
+
+    if(this->spinup) {
+        this->spinup->add_metadata(metadata);
+    }
+
+    if(this->subcycler) {
+        this->subcycler->add_metadata(metadata);
+    }
+
+    if(this->mask) {
+        metadata.set("mask", this->mask->get_description());
+        metadata.set("mask_active_fraction", this->mask->get_active_fraction());
+        metadata.set("mask_interior_fraction", this->mask->get_interior_fraction());
+    }
+
+    if(this->output_spec) {
+        this->output_spec->add_metadata(metadata, this->chunk_size);
+    }
+
+    if(this->chunk_size > 0) {
+        metadata.set("layout", "chunked");
+        metadata.set("chunk_size", this->chunk_size);
+        metadata.set("compression", (unsigned int)this->compression);
+        if(!this->quantization.empty()) {
+            metadata.set("quantization", this->quantization);
+        }
+    }
+
+    if(this->tile_size > 0) {
+        metadata.set("tile_size", this->tile_size);
+        metadata.set("tile_tolerance", this->tile_tolerance);
+        metadata.set("active_fraction", this->active_fraction);
+    }
+
+    metadata.write(filename);
 }
 
 /**
@@ -119,6 +844,11 @@ void TwoDimRD::init() {
 
     this->reaction_system->init(this->a, this->b);
 
+    if(this->mask) {
+        this->mask->clear_outside(this->a);
+        this->mask->clear_outside(this->b);
+    }
+
     this->delta_a = MatrixXXd::Zero(this->width, this->height);
     this->delta_b = MatrixXXd::Zero(this->width, this->height);
 
@@ -130,15 +860,28 @@ void TwoDimRD::init() {
  * @brief      Perform a time-step
  */
 void TwoDimRD::update() {
-    // calculate laplacian
-    if(this->pbc) {
-        this->laplacian_2d_pbc(this->delta_a, this->a);
-        this->laplacian_2d_pbc(this->delta_b, this->b);
-    } else {
-        this->laplacian_2d_zeroflux(this->delta_a, this->a);
-        this->laplacian_2d_zeroflux(this->delta_b, this->b);
+    if(this->mask) {
+        this->update_masked();
+        this->t += this->dt;
+        return;
+    }
+
+    if(this->tile_size > 0) {
+        this->update_tiles();
+        this->t += this->dt;
+        return;
     }
 
+    if(this->subcycler) {
+        this->update_split();
+        this->t += this->dt;
+        return;
+    }
+
+    // calculate laplacian
+    this->laplacian_2d(this->delta_a, this->a);
+    this->laplacian_2d(this->delta_b, this->b);
+
     // multiply with diffusion coefficient
     this->delta_a *= this->Da;
     this->delta_b *= this->Db;
@@ -146,113 +889,350 @@ void TwoDimRD::update() {
     // add reaction term
     this->add_reaction();
 
-    // multiply with time step
-    this->delta_a *= this->dt;
-    this->delta_b *= this->dt;
-
-    // add delta term to concentrations
-    this->a += this->delta_a;
-    this->b += this->delta_b;
+    // multiply with time step and add delta term to concentrations
+    this->apply_increments();
 
     // update time step
     this->t += this->dt;
 }
 
 /**
- * @brief      Calculate Laplacian using central finite difference with periodic boundary conditions
- *
- * @param      delta_c  Concentration update matrix
- * @param      c        Current concentration matrix
+ * @brief      Add the time-scaled increments to the concentrations
  *
- * Note that this overwrites the current delta matrices!
+ * When rates are tracked, max|da/dt| and max|db/dt| are obtained in the
+ * same pass over the data.
  */
-void TwoDimRD::laplacian_2d_pbc(MatrixXXd& delta_c, MatrixXXd& c) {
-    const double idx2 = 1.0 / (this->dx * this->dx);
+void TwoDimRD::apply_increments() {
+    const double dt = this->dt;
+    const long int n = this->a.size();
 
-    #pragma omp parallel for schedule(static)
-    for(int i=0; i<this->height; i++) {
-        // indices
-        unsigned i1;
-        unsigned i2;
-
-        if(i == 0) {
-            i1 = this->height-1;
-            i2 = i+1;
-        } else if(i == (this->height-1)) {
-            i1 = i-1;
-            i2 = 0;
-        } else {
-            i1 = i-1;
-            i2 = i+1;
-        }
-
-        // loop over x axis
-        for(int j=0; j<this->width; j++) {
-            // indices
-            unsigned j1;
-            unsigned j2;
-
-            if(j == 0) {
-                j1 = this->width-1;
-                j2 = j+1;
-            } else if(j == (this->width-1)) {
-                j1 = j-1;
-                j2 = 0;
-            } else {
-                j1 = j-1;
-                j2 = j+1;
+    double* pa = this->a.data();
+    double* pb = this->b.data();
+    const double* pda = this->delta_a.data();
+    const double* pdb = this->delta_b.data();
+
+    if(this->track_rates) {
+        double max_da = 0.0;
+        double max_db = 0.0;
+
+        #pragma omp parallel for schedule(static) reduction(max:max_da,max_db)
+        for(long int k=0; k<n; k++) {
+            const double da = dt * pda[k];
+            const double db = dt * pdb[k];
+            pa[k] += da;
+            pb[k] += db;
+            max_da = std::max(max_da, std::fabs(da));
+            max_db = std::max(max_db, std::fabs(db));
+        }
+
+        this->rate_a = max_da / dt;
+        this->rate_b = max_db / dt;
+    } else {
+        #pragma omp parallel for schedule(static)
+        for(long int k=0; k<n; k++) {
+            pa[k] += dt * pda[k];
+            pb[k] += dt * pdb[k];
+        }
+    }
+}
+
+/**
+ * @brief      Perform a time-step only over the active tiles
+ */
+void TwoDimRD::update_tiles() {
+    const unsigned int rows = this->a.rows();
+    const unsigned int cols = this->a.cols();
+    const unsigned int ts = this->tile_size;
+    const double dt = this->dt;
+    const double tol = this->tile_tolerance;
+
+    // collect the tiles that need to be updated
+    this->active_tiles.clear();
+    for(unsigned int k=0; k<this->tile_active.size(); k++) {
+        if(this->tile_active[k]) {
+            this->active_tiles.push_back(k);
+        }
+    }
+    const int nactive = this->active_tiles.size();
+    this->active_sum += (double)nactive / (double)this->tile_active.size();
+
+    // evaluate the increments of the active tiles
+    #pragma omp parallel for schedule(dynamic)
+    for(int n=0; n<nactive; n++) {
+        const unsigned int k = this->active_tiles[n];
+        const unsigned int i0 = (k % this->tiles_i) * ts;
+        const unsigned int i1 = std::min(i0 + ts, rows);
+        const unsigned int j0 = (k / this->tiles_i) * ts;
+        const unsigned int j1 = std::min(j0 + ts, cols);
+
+        this->diffusion_block(this->delta_a, this->a, i0, i1, j0, j1);
+        this->diffusion_block(this->delta_b, this->b, i0, i1, j0, j1);
+
+        this->scale_and_react_block(i0, i1, j0, j1);
+    }
+
+    // add the increments; this can only be done once all active tiles have
+    // been evaluated as the stencil reads across tile boundaries. A tile is
+    // at rest when none of its increments exceeds the tolerance.
+    double max_da = 0.0;
+    double max_db = 0.0;
+    #pragma omp parallel for schedule(dynamic) reduction(max:max_da,max_db)
+    for(int n=0; n<nactive; n++) {
+        const unsigned int k = this->active_tiles[n];
+        const unsigned int i0 = (k % this->tiles_i) * ts;
+        const unsigned int i1 = std::min(i0 + ts, rows);
+        const unsigned int j0 = (k / this->tiles_i) * ts;
+        const unsigned int j1 = std::min(j0 + ts, cols);
+
+        double tile_da = 0.0;
+        double tile_db = 0.0;
+
+        for(unsigned int j=j0; j<j1; j++) {
+            double* pa = &this->a(0,j);
+            double* pb = &this->b(0,j);
+            const double* pda = &this->delta_a(0,j);
+            const double* pdb = &this->delta_b(0,j);
+
+            for(unsigned int i=i0; i<i1; i++) {
+                const double da = dt * pda[i];
+                const double db = dt * pdb[i];
+                pa[i] += da;
+                pb[i] += db;
+                tile_da = std::max(tile_da, std::fabs(da));
+                tile_db = std::max(tile_db, std::fabs(db));
             }
+        }
 
-            // calculate laplacian
-            delta_c(i,j) = (-4.0 * c(i,j)
-                                 + c(i1, j)
-                                 + c(i2, j)
-                                 + c(i, j1)
-                                 + c(i, j2) ) * idx2;
+        this->tile_changed[k] = (tile_da > tol || tile_db > tol);
+        max_da = std::max(max_da, tile_da);
+        max_db = std::max(max_db, tile_db);
+    }
+
+    if(this->track_rates) {
+        this->rate_a = max_da / dt;
+        this->rate_b = max_db / dt;
+    }
+
+    // a tile is updated in the next step when it or any of its neighbours changed
+    std::fill(this->tile_active.begin(), this->tile_active.end(), 0);
+    for(int n=0; n<nactive; n++) {
+        const unsigned int k = this->active_tiles[n];
+        if(!this->tile_changed[k]) {
+            continue;
+        }
+
+        const int ti = k % this->tiles_i;
+        const int tj = k / this->tiles_i;
+        for(int dj=-1; dj<=1; dj++) {
+            for(int di=-1; di<=1; di++) {
+                int ni = ti + di;
+                int nj = tj + dj;
+                if(this->pbc) {
+                    ni = (ni + this->tiles_i) % this->tiles_i;
+                    nj = (nj + this->tiles_j) % this->tiles_j;
+                } else if(ni < 0 || nj < 0 || ni >= (int)this->tiles_i || nj >= (int)this->tiles_j) {
+                    continue;
+                }
+                this->tile_active[ni + nj * this->tiles_i] = 1;
+            }
         }
     }
 }
 
 /**
- * @brief      Calculate Laplacian using central finite difference with zero-flux boundaries
+ * @brief      Scale the diffusion term and add the reaction term on a block of the grid
  *
- * @param      delta_c  Concentration update matrix
- * @param      c        Current concentration matrix
+ * The reaction term is evaluated per column of the block.
  *
- * Note that this overwrites the current delta matrices!
+ * @param[in]  i0    first row of the block
+ * @param[in]  i1    last row (exclusive) of the block
+ * @param[in]  j0    first column of the block
+ * @param[in]  j1    last column (exclusive) of the block
  */
-void TwoDimRD::laplacian_2d_zeroflux(MatrixXXd& delta_c, MatrixXXd& c) {
-    unsigned int height = c.rows();
-    unsigned int width = c.cols();
+void TwoDimRD::scale_and_react_block(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1) {
+    const unsigned int n = i1 - i0;
+
+    thread_local std::vector<double> buffer;
+    buffer.resize(2 * n);
+    double* ra = buffer.data();
+    double* rb = ra + n;
 
-    const double idx2 = 1.0 / (dx * dx);
+    for(unsigned int j=j0; j<j1; j++) {
+        const double* cp[2] = {&this->a(i0,j), &this->b(i0,j)};
+        double* rp[2] = {ra, rb};
+        this->reaction_system->reaction_batch(cp, rp, n);
 
-    #pragma omp parallel for
-    for(unsigned int i=0; i<height; i++) {
-        for(unsigned int j=0; j<width; j++) {
+        double* pda = &this->delta_a(i0,j);
+        double* pdb = &this->delta_b(i0,j);
+        for(unsigned int i=0; i<n; i++) {
+            pda[i] = pda[i] * this->Da + ra[i];
+            pdb[i] = pdb[i] * this->Db + rb[i];
+        }
+    }
+}
 
-            double ddx = 0;
-            double ddy = 0;
+/**
+ * @brief      Perform a time-step only over the cells inside the domain mask
+ */
+void TwoDimRD::update_masked() {
+    const std::vector<DomainMask::Block>& blocks = this->mask->get_blocks();
+    const int nblocks = blocks.size();
+    const double dt = this->dt;
 
-            if(i == 0) {
-                ddx = c(i+1,j) - c(i, j);
-            } else if(i == (height - 1)) {
-                ddx = c(i-1,j) - c(i, j);
-            } else {
-                ddx = (-2.0 * c(i,j) + c(i-1,j) + c(i+1,j));
-            }
+    // evaluate the increments, block by block
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0; k<nblocks; k++) {
+        const DomainMask::Block& block = blocks[k];
+        this->mask->block_laplacian(this->delta_a, this->a, this->dx, k);
+        this->mask->block_laplacian(this->delta_b, this->b, this->dx, k);
+        this->scale_and_react_block(block.i0, block.i1, block.j0, block.j1);
+    }
 
-            if(j == 0) {
-                ddy = c(i,j+1) - c(i, j);
-            } else if(j == (width - 1)) {
-                ddy = c(i,j-1) - c(i, j);
-            } else {
-                ddy = (-2.0 * c(i,j) + c(i,j-1) + c(i,j+1));
+    // add the increments once all blocks have been evaluated
+    double max_da = 0.0;
+    double max_db = 0.0;
+    #pragma omp parallel for schedule(dynamic) reduction(max:max_da,max_db)
+    for(int k=0; k<nblocks; k++) {
+        const DomainMask::Block& block = blocks[k];
+
+        for(unsigned int j=block.j0; j<block.j1; j++) {
+            double* pa = &this->a(0,j);
+            double* pb = &this->b(0,j);
+            const double* pda = &this->delta_a(0,j);
+            const double* pdb = &this->delta_b(0,j);
+
+            for(unsigned int i=block.i0; i<block.i1; i++) {
+                const double da = dt * pda[i];
+                const double db = dt * pdb[i];
+                pa[i] += da;
+                pb[i] += db;
+                max_da = std::max(max_da, std::fabs(da));
+                max_db = std::max(max_db, std::fabs(db));
             }
+        }
+    }
+
+    if(this->track_rates) {
+        this->rate_a = max_da / dt;
+        this->rate_b = max_db / dt;
+    }
+}
+
+/**
+ * @brief      Perform a Strang-split time-step with sub-cycled reaction terms
+ */
+void TwoDimRD::update_split() {
+    // the rate of change covers the full step rather than only the diffusion terms
+    const bool track = this->track_rates;
+    MatrixXXd a0, b0;
+    if(track) {
+        a0 = this->a;
+        b0 = this->b;
+    }
+
+    this->react_substeps(0.5 * this->dt);
 
-            // calculate laplacian
-            delta_c(i,j) = (ddx + ddy) * idx2;
+    // Heun step of the diffusion terms, which keeps the splitting of second order
+    // (an Euler step would add an error proportional to the square of the diffusion rate)
+    this->split_a = this->a;
+    this->split_b = this->b;
+    this->track_rates = false;
+    for(unsigned int stage=0; stage<2; stage++) {
+        this->laplacian_2d(this->delta_a, this->a);
+        this->laplacian_2d(this->delta_b, this->b);
+        this->delta_a *= this->Da;
+        this->delta_b *= this->Db;
+        this->apply_increments();
+    }
+    this->a = 0.5 * (this->a + this->split_a);
+    this->b = 0.5 * (this->b + this->split_b);
+    this->track_rates = track;
+
+    this->react_substeps(0.5 * this->dt);
+
+    if(track) {
+        this->rate_a = (this->a - a0).cwiseAbs().maxCoeff() / this->dt;
+        this->rate_b = (this->b - b0).cwiseAbs().maxCoeff() / this->dt;
+    }
+}
+
+/**
+ * @brief      Integrate the reaction terms of every grid point over a time span
+ *
+ * @param[in]  tau   time span
+ */
+void TwoDimRD::react_substeps(double tau) {
+    ReactionSubcycler* sub = this->subcycler.get();
+    const ReactionSystem& reaction_system = *this->reaction_system;
+    const unsigned int rows = this->a.rows();
+    const int cols = this->a.cols();
+    sub->prepare(this->a.size());
+
+    double* ph = sub->get_step_sizes();
+    long int failed = 0;
+
+    #pragma omp parallel reduction(+:failed)
+    {
+        ReactionSubcycler::Tally tally;
+
+        // the number of sub-steps varies strongly between columns (e.g. near a front)
+        #pragma omp for schedule(dynamic)
+        for(int j=0; j<cols; j++) {
+            sub->advance_column(reaction_system, &this->a(0,j), &this->b(0,j), ph + (size_t)j * rows,
+                                rows, tau, tally);
         }
+        failed += tally.failed;
+
+        #pragma omp critical
+        sub->record(tally);
+    }
+
+    if(failed > 0) {
+        throw std::runtime_error("The reaction sub-steps did not reach the end of the time step at " +
+                                 std::to_string(failed) + " grid points; increase max_substeps or the tolerances");
+    }
+}
+
+/**
+ * @brief      Mark all tiles as active
+ */
+void TwoDimRD::activate_all_tiles() {
+    std::fill(this->tile_active.begin(), this->tile_active.end(), 1);
+}
+
+/**
+ * @brief      Sample concentration A at the probe points of the convergence monitor
+ *
+ * @return     probe values
+ */
+std::vector<double> TwoDimRD::sample_probes() const {
+    const unsigned int rows = this->a.rows();
+    const unsigned int cols = this->a.cols();
+
+    return {
+        this->a(rows / 2, cols / 2),
+        this->a(rows / 4, cols / 4),
+        this->a(3 * rows / 4, 3 * cols / 4)
+    };
+}
+
+/**
+ * @brief      Calculate the Laplacian over the full grid
+ *
+ * The boundary conditions (periodic or zero-flux) and the stencil are
+ * applied by diffusion_block(), which also handles diffusion fields.
+ *
+ * @param      delta_c  Concentration update matrix
+ * @param      c        Current concentration matrix
+ *
+ * Note that this overwrites the current delta matrices!
+ */
+void TwoDimRD::laplacian_2d(MatrixXXd& delta_c, MatrixXXd& c) {
+    const int cols = c.cols();
+
+    #pragma omp parallel for schedule(static)
+    for(int j=0; j<cols; j++) {
+        this->diffusion_block(delta_c, c, 0, c.rows(), j, j+1);
     }
 }
 
@@ -262,16 +1242,42 @@ void TwoDimRD::laplacian_2d_zeroflux(MatrixXXd& delta_c, MatrixXXd& c) {
  * Add the value to the current delta matrices
  */
 void TwoDimRD::add_reaction() {
+    const unsigned int rows = this->a.rows();
+    const int cols = this->a.cols();
+
     #pragma omp parallel for schedule(static)
-    for(unsigned int i=0; i<this->height; i++) {
-        for(unsigned int j=0; j<this->width; j++) {
-            const double a = this->a(i,j);
-            const double b = this->b(i,j);
-            double ra = 0;
-            double rb = 0;
-            this->reaction_system->reaction(a, b, &ra, &rb);
-            this->delta_a(i,j) += ra;
-            this->delta_b(i,j) += rb;
+    for(int j=0; j<cols; j++) {
+        this->add_reaction_block(0, rows, j, j+1);
+    }
+}
+
+/**
+ * @brief      Calculate reaction term on a block of the grid
+ *
+ * @param[in]  i0    first row of the block
+ * @param[in]  i1    last row (exclusive) of the block
+ * @param[in]  j0    first column of the block
+ * @param[in]  j1    last column (exclusive) of the block
+ *
+ * Add the value to the current delta matrices
+ */
+void TwoDimRD::add_reaction_block(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1) {
+    // reaction terms of a single column
+    thread_local std::vector<double> buffer;
+    buffer.resize(2 * (i1 - i0));
+    double* ra = buffer.data();
+    double* rb = ra + (i1 - i0);
+
+    for(unsigned int j=j0; j<j1; j++) {
+        const double* cp[2] = {&this->a(i0,j), &this->b(i0,j)};
+        double* rp[2] = {ra, rb};
+        this->reaction_system->reaction_batch(cp, rp, i1 - i0);
+
+        double* pda = &this->delta_a(i0,j);
+        double* pdb = &this->delta_b(i0,j);
+        for(unsigned int i=0; i<i1-i0; i++) {
+            pda[i] += ra[i];
+            pdb[i] += rb[i];
         }
     }
 }
@@ -24,12 +24,30 @@
 #include <Eigen/Dense>
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> MatrixXXd;
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <vector>
 
 #include "reaction_system.h"
+#include "laplacian.h"
+#include "diffusion_field.h"
+#include "domain_mask.h"
+#include "convergence_monitor.h"
+#include "output_metadata.h"
+#include "output_spec.h"
+#include "frame_renderer.h"
+#include "field_analysis.h"
+#include "feature_extractor.h"
+#include "probe_recorder.h"
+#include "metrics_exporter.h"
+#include "continuation_scan.h"
+#include "multires_spinup.h"
+#include "reaction_subcycler.h"
+#include "frame_writer.h"
 #include "tqdm.hpp"
 
 class TwoDimRD {
@@ -54,13 +72,61 @@ private:
 
     std::vector<MatrixXXd> ta;  //!< matrix to hold temporal data
     std::vector<MatrixXXd> tb;  //!< matrix to hold temporal data
+    unsigned int nr_frames = 0; //!< number of frames integrated
 
-    double t;   //!< Total time t
+    std::unique_ptr<OutputSpec> output_spec;    //!< Optional selection and reduction of the output
+    std::unique_ptr<FrameRenderer> renderer;    //!< Optional rendering of the frames to images
+    std::unique_ptr<FieldAnalysis> analysis;    //!< Optional statistics and spectra of the frames
+    std::unique_ptr<FeatureExtractor> features; //!< Optional spots and spiral tips of the frames
+    std::unique_ptr<ProbeRecorder> probes;      //!< Optional time series at points and transects
+    std::unique_ptr<MetricsExporter> metrics;   //!< Optional status file, rewritten while integrating
+    unsigned int chunk_size = 0;    //!< edge length of the chunks of the output (0 = contiguous frames)
+    int compression = 0;            //!< zlib compression level of the chunks
+    std::string quantization;       //!< quantization of the chunks (see FrameQuantizer, empty = none)
+
+    double t = 0.0;   //!< Total time t
 
     std::unique_ptr<ReactionSystem> reaction_system;    //!< Pointer to reaction system
 
     bool pbc = true;    //!< Whether to employ periodic boundary conditions
 
+    LaplacianStencil stencil = STENCIL_5POINT;  //!< finite difference stencil of the Laplacian
+
+    std::unique_ptr<DiffusionField> diffusion_field;    //!< Optional heterogeneous medium
+
+    std::unique_ptr<DomainMask> mask;   //!< Optional irregular domain
+
+    std::unique_ptr<ConvergenceMonitor> convergence_monitor;   //!< Optional steady-state detection
+
+    std::unique_ptr<ContinuationScan> continuation; //!< Optional parameter scan along a path
+
+    std::unique_ptr<MultiresSpinUp> spinup;         //!< Optional coarse-to-fine spin-up
+
+    std::unique_ptr<ReactionSubcycler> subcycler;   //!< Optional Strang splitting with sub-cycled reaction terms
+    MatrixXXd split_a;                              //!< concentration of A at the start of the diffusion step
+    MatrixXXd split_b;                              //!< concentration of B at the start of the diffusion step
+
+    unsigned int branch_frame = 0;                  //!< frame after which the branches split off
+    std::string parameters;                         //!< parameters of the reaction system (of the shared prefix)
+    std::vector<std::string> branch_parameters;     //!< parameters of the reaction system per branch
+    std::string branch_outfile;                     //!< output file of the shared prefix
+    double branch_time = 0.0;                       //!< time at which the branches split off
+    int branch = -1;                                //!< branch being integrated (-1 = shared prefix)
+
+    bool track_rates = false;   //!< Whether update() tracks the rate of change
+    double rate_a = 0.0;        //!< max|da/dt| of the last tracked time step
+    double rate_b = 0.0;        //!< max|db/dt| of the last tracked time step
+
+    unsigned int tile_size = 0;                 //!< edge length of a tile (0 = tiling disabled)
+    double tile_tolerance = 0.0;                //!< max|dc| per step below which a tile is at rest
+    unsigned int tiles_i = 0;                   //!< number of tiles along the rows
+    unsigned int tiles_j = 0;                   //!< number of tiles along the columns
+    std::vector<unsigned char> tile_active;     //!< whether a tile is updated in the next step
+    std::vector<unsigned char> tile_changed;    //!< whether a tile changed in the last step
+    std::vector<unsigned int> active_tiles;     //!< tiles that are updated in the current step
+    double active_sum = 0.0;                    //!< sum of active fractions in the current frame
+    std::vector<double> active_fraction;        //!< average fraction of active tiles per frame
+
 public:
     /**
      * @brief      Constructs the object.
@@ -92,13 +158,225 @@ public:
      */
     inline void set_pbc(bool _pbc) {
         this->pbc = _pbc;
+
+        // the face coefficients depend on the boundary conditions
+        if(this->diffusion_field) {
+            this->diffusion_field->prepare(this->pbc);
+        }
+        if(this->mask) {
+            this->mask->prepare(this->pbc);
+        }
+    }
+
+    /**
+     * @brief      Set the finite difference stencil of the Laplacian
+     *
+     * @param[in]  _stencil  The stencil
+     */
+    inline void set_stencil(LaplacianStencil _stencil) {
+        this->stencil = _stencil;
     }
 
+    /**
+     * @brief      Set a spatially varying (and possibly anisotropic) medium
+     *
+     * The diffusion terms become Da div(K grad a) and Db div(K grad b).
+     *
+     * @param      _diffusion_field  The diffusion field
+     */
+    void set_diffusion_field(DiffusionField* _diffusion_field);
+
+    /**
+     * @brief      Restrict the system to an irregular domain
+     *
+     * Cells outside of the domain are zero and never evaluated; the
+     * boundary of the domain is zero-flux.
+     *
+     * @param      _mask  The domain mask
+     */
+    void set_mask(DomainMask* _mask);
+
+    /**
+     * @brief      Select, crop and downsample the fields that are written
+     *
+     * @param      _output_spec  The output specification
+     */
+    void set_output_spec(OutputSpec* _output_spec);
+
+    /**
+     * @brief      Store the output as (optionally compressed) chunks
+     *
+     * @param[in]  _chunk_size    edge length of a chunk (0 = contiguous frames)
+     * @param[in]  _compression   zlib compression level of the chunks
+     * @param[in]  _quantization  quantization of the chunks (see FrameQuantizer, empty = none)
+     */
+    void set_chunking(unsigned int _chunk_size, int _compression, const std::string& _quantization = "");
+
+    /**
+     * @brief      Render the frames to images while integrating
+     *
+     * @param      _renderer  The renderer
+     */
+    void set_renderer(FrameRenderer* _renderer);
+
+    /**
+     * @brief      Compute statistics and power spectra of the frames while integrating
+     *
+     * @param      _analysis  The analysis
+     */
+    void set_analysis(FieldAnalysis* _analysis);
+
+    /**
+     * @brief      Extract spots and spiral tips from the frames while integrating
+     *
+     * @param      _features  The feature extractor
+     */
+    void set_features(FeatureExtractor* _features);
+
+    /**
+     * @brief      Record the concentrations at points and transects every time step
+     *
+     * @param      _probes  The probe recorder
+     */
+    void set_probes(ProbeRecorder* _probes);
+
+    /**
+     * @brief      Periodically write the progress of the integration to a status file
+     *
+     * @param      _metrics  The metrics exporter
+     */
+    void set_metrics(MetricsExporter* _metrics);
+
+    /**
+     * @brief      Sets the convergence monitor.
+     *
+     * @param      _convergence_monitor  The convergence monitor
+     */
+    void set_convergence_monitor(ConvergenceMonitor* _convergence_monitor);
+
+    /**
+     * @brief      Replace the time integration by a continuation scan
+     *
+     * Every case of the scan continues from the final state of the previous
+     * one and stops at a steady state, which requires a convergence monitor.
+     * A frame holding the final state is stored for every case.
+     *
+     * @param      _continuation  The continuation scan
+     */
+    void set_continuation(ContinuationScan* _continuation);
+
+    /**
+     * @brief      Share the first frames among branches with different parameters
+     *
+     * The first frames are integrated once, after which every branch
+     * continues from a copy of the state with its own parameters for the
+     * remaining frames. Each branch writes its frames (starting with the
+     * shared state) and metadata to its own file, see get_branch_filename().
+     * The frames of the shared prefix remain for write_state_to_file().
+     *
+     * @param[in]  _frame       number of frames of the shared prefix
+     * @param[in]  _parameters  parameters of the reaction system per branch
+     * @param[in]  _outfile     output file of the shared prefix
+     */
+    void set_branches(unsigned int _frame, const std::vector<std::string>& _parameters, const std::string& _outfile);
+
+    /**
+     * @brief      Spin up the pattern on coarser grids before integrating the frames
+     *
+     * The frames start from the state and the time reached by the spin-up,
+     * which replaces the initial condition of the reaction system.
+     *
+     * @param      _spinup  The spin-up
+     */
+    void set_spin_up(MultiresSpinUp* _spinup);
+
+    /**
+     * @brief      Split every time step into reaction and diffusion (Strang splitting)
+     *
+     * The reaction terms are integrated per grid point with adaptive
+     * sub-steps over half a time step before and after an explicit step of
+     * the diffusion terms, such that the time step only has to satisfy the
+     * stability limit of the diffusion terms.
+     *
+     * @param      _subcycler  The sub-cycling of the reaction terms
+     */
+    void set_subcycler(ReactionSubcycler* _subcycler);
+
+    /**
+     * @brief      Get the output file of a branch
+     *
+     * The index of the branch is inserted before the extension, e.g.
+     * data.bin becomes data.branch0.bin.
+     *
+     * @param[in]  outfile  output file of the shared prefix
+     * @param[in]  i        branch
+     *
+     * @return     filename
+     */
+    static std::string get_branch_filename(const std::string& outfile, unsigned int i);
+
+    /**
+     * @brief      Only update tiles that are not at rest
+     *
+     * A tile is skipped when neither itself nor any of its neighbours changed
+     * by more than the tolerance in the previous time step. All tiles are
+     * re-evaluated at the start of every frame.
+     *
+     * @param[in]  _tile_size       edge length of a tile in grid points (0 disables tiling)
+     * @param[in]  _tile_tolerance  max|dc| per time step below which a tile is at rest
+     */
+    void set_tiling(unsigned int _tile_size, double _tile_tolerance);
+
     /**
      * @brief      Perform time integration
      */
     void time_integrate();
 
+    /**
+     * @brief      Perform a number of time steps without storing frames
+     *
+     * The concentrations can be inspected and modified in between calls,
+     * which allows the system to be driven from another program.
+     *
+     * @param[in]  n     number of time steps
+     */
+    void advance(unsigned int n);
+
+    /**
+     * @brief      Get the concentration of A
+     */
+    inline MatrixXXd& get_a() {
+        return this->a;
+    }
+
+    /**
+     * @brief      Get the concentration of B
+     */
+    inline MatrixXXd& get_b() {
+        return this->b;
+    }
+
+    /**
+     * @brief      Get the time
+     */
+    inline double get_time() const {
+        return this->t;
+    }
+
+    /**
+     * @brief      Get the width of the system
+     */
+    inline unsigned int get_width() const {
+        return this->width;
+    }
+
+    /**
+     * @brief      Get the height of the system
+     */
+    inline unsigned int get_height() const {
+        return this->height;
+    }
+
     /**
      * @brief      Write the current state of compound A to the file
      *
@@ -106,12 +384,20 @@ public:
      */
     void write_state_to_file(const std::string& filename);
 
+    /**
+     * @brief      Write run metadata (JSON) to file
+     *
+     * @param[in]  filename  The filename
+     */
+    void write_metadata_to_file(const std::string& filename);
+
     /**
      * @brief      Sets the parameters.
      *
      * @param[in]  params  The parameters
      */
     inline void set_parameters(const std::string& params) {
+        this->parameters = params;
         this->reaction_system->set_parameters(params);
         this->init();
     }
@@ -122,30 +408,121 @@ private:
      */
     void init();
 
+    /**
+     * @brief      Integrate every case of the continuation scan up to its steady state
+     */
+    void continuation_scan();
+
+    /**
+     * @brief      Integrate the shared prefix once and every branch from a copy of its final state
+     */
+    void branched_integration();
+
+    /**
+     * @brief      Integrate the levels of the spin-up from coarse to fine
+     */
+    void multires_spin_up();
+
+    /**
+     * @brief      Integrate the time steps of a single frame
+     *
+     * @return     true when the convergence monitor reports a steady state
+     */
+    bool integrate_frame();
+
     /**
      * @brief      Perform a time-step
      */
     void update();
 
     /**
-     * @brief      Calculate Laplacian using central finite difference with periodic boundary conditions
+     * @brief      Perform a time-step only over the active tiles
+     */
+    void update_tiles();
+
+    /**
+     * @brief      Perform a time-step only over the cells inside the domain mask
+     */
+    void update_masked();
+
+    /**
+     * @brief      Perform a Strang-split time-step with sub-cycled reaction terms
+     */
+    void update_split();
+
+    /**
+     * @brief      Integrate the reaction terms of every grid point over a time span
      *
-     * @param      delta_c  Concentration update matrix
-     * @param      c        Current concentration matrix
+     * @param[in]  tau   time span
+     */
+    void react_substeps(double tau);
+
+    /**
+     * @brief      Mark all tiles as active
+     */
+    void activate_all_tiles();
+
+    /**
+     * @brief      Scale the diffusion term and add the reaction term on a block of the grid
      *
-     * Note that this overwrites the current delta matrices!
+     * The reaction term is evaluated per column of the block.
+     *
+     * @param[in]  i0    first row of the block
+     * @param[in]  i1    last row (exclusive) of the block
+     * @param[in]  j0    first column of the block
+     * @param[in]  j1    last column (exclusive) of the block
      */
-    void laplacian_2d_pbc(MatrixXXd& delta_c, MatrixXXd& c);
+    void scale_and_react_block(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1);
 
     /**
-     * @brief      Calculate Laplacian using central finite difference with zero-flux boundaries
+     * @brief      Add the time-scaled increments to the concentrations
+     *
+     * When rates are tracked, max|da/dt| and max|db/dt| are obtained in the
+     * same pass over the data.
+     */
+    void apply_increments();
+
+    /**
+     * @brief      Sample concentration A at the probe points of the convergence monitor
+     *
+     * @return     probe values
+     */
+    std::vector<double> sample_probes() const;
+
+    /**
+     * @brief      Calculate the diffusion operator on a block of the grid
+     *
+     * This is the Laplacian, or div(K grad c) when a diffusion field is set.
+     *
+     * @param      delta_c  Concentration update matrix
+     * @param[in]  c        Current concentration matrix
+     * @param[in]  i0       first row of the block
+     * @param[in]  i1       last row (exclusive) of the block
+     * @param[in]  j0       first column of the block
+     * @param[in]  j1       last column (exclusive) of the block
+     */
+    inline void diffusion_block(MatrixXXd& delta_c, const MatrixXXd& c,
+                                unsigned int i0, unsigned int i1,
+                                unsigned int j0, unsigned int j1) const {
+        if(this->diffusion_field) {
+            this->diffusion_field->divergence_block(delta_c, c, this->dx, i0, i1, j0, j1);
+        } else {
+            laplacian_block(delta_c, c, this->dx, this->stencil, this->pbc, i0, i1, j0, j1);
+        }
+    }
+
+    /**
+     * @brief      Calculate the Laplacian over the full grid
+     *
+     * The boundary conditions (periodic or zero-flux) and the stencil are
+     * applied by diffusion_block(), which also handles diffusion fields.
      *
      * @param      delta_c  Concentration update matrix
      * @param      c        Current concentration matrix
      *
      * Note that this overwrites the current delta matrices!
      */
-    void laplacian_2d_zeroflux(MatrixXXd& delta_c, MatrixXXd& c);
+    void laplacian_2d(MatrixXXd& delta_c, MatrixXXd& c);
 
     /**
      * @brief      Calculate reaction term
@@ -154,4 +531,16 @@ private:
      */
     void add_reaction();
 
+    /**
+     * @brief      Calculate reaction term on a block of the grid
+     *
+     * @param[in]  i0    first row of the block
+     * @param[in]  i1    last row (exclusive) of the block
+     * @param[in]  j0    first column of the block
+     * @param[in]  j1    last column (exclusive) of the block
+     *
+     * Add the value to the current delta matrices
+     */
+    void add_reaction_block(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1);
+
 };
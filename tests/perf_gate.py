@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+# Measures the throughput (cell updates per second) of a fixed benchmark run
+# and compares it with a baseline that was measured earlier on the same
+# machine. The baseline file holds one entry per host name; on a host without
+# an entry, the measurement is stored and the gate passes. The gate fails when
+# the throughput drops by more than the tolerance (in percent).
+#
+#     perf_gate.py <turing> <scratch directory> <baseline file> <tolerance> [--update]
+#
+# With --update, the baseline of this host is replaced by the measurement.
+
+import json
+import os
+import shutil
+import socket
+import subprocess
+import sys
+
+turing, scratch, baseline_file, tolerance = sys.argv[1:5]
+tolerance = float(tolerance)
+update = '--update' in sys.argv[5:]
+shutil.rmtree(scratch, ignore_errors=True)
+os.makedirs(scratch)
+
+REPEATS = 3
+benchmark = ['--Da', '2', '--Db', '16', '--dx', '1.0', '--dt', '0.001', '--width', '256', '--height', '256',
+             '--steps', '4', '--tsteps', '2000', '--reaction', 'brusselator',
+             '--parameters', 'alpha=4.5;beta=7.50', '--pbc', '--no-progress']
+
+def measure():
+    metrics = os.path.join(scratch, 'metrics.json')
+    cmd = [turing] + benchmark + ['--outfile', os.path.join(scratch, 'data.bin'), '--metrics', metrics]
+    res = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    if res.returncode != 0:
+        print('FAILED: benchmark run failed: ' + res.stderr)
+        sys.exit(1)
+    with open(metrics) as f:
+        m = json.load(f)
+    return 256 * 256 * m['steps'] / m['elapsed_seconds']
+
+# the best of a few runs is the least sensitive to other load on the machine
+rate = max(measure() for _ in range(REPEATS))
+host = socket.gethostname()
+
+baselines = {}
+if os.path.exists(baseline_file):
+    with open(baseline_file) as f:
+        baselines = json.load(f)
+
+if update or host not in baselines:
+    baselines[host] = rate
+    with open(baseline_file, 'w') as f:
+        json.dump(baselines, f, indent=1, sort_keys=True)
+        f.write('\n')
+    print('Stored a baseline of %.4g cell updates/s for %s in %s' % (rate, host, baseline_file))
+    sys.exit(0)
+
+change = 100.0 * (rate / baselines[host] - 1.0)
+print('%.4g cell updates/s against a baseline of %.4g (%+.1f%%, tolerance %.1f%%)' %
+      (rate, baselines[host], change, tolerance))
+if change < -tolerance:
+    print('FAILED: throughput dropped by more than %.1f%%' % tolerance)
+    sys.exit(1)
@@ -0,0 +1,92 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+/*
+ * Test of the bookkeeping of continuation scans
+ *
+ * The path of a scan with a return leg is checked against the requested
+ * values, the varied parameter has to replace its value among the other
+ * parameters of the reaction system, and the order parameters recorded for
+ * a case are compared with the known moments of a square wave.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "continuation_scan.h"
+
+int main() {
+    bool success = true;
+
+    // forward from 0.02 to 0.06 in five steps, then back without repeating the turning point
+    ContinuationScan scan("param=f;from=0.02;to=0.06;n=5;backward=1", "k=0.0609; f=0.035", {"A", "B"},
+                          8, 4, "test_continuation_scan.json");
+    const std::vector<double> expected = {0.02, 0.03, 0.04, 0.05, 0.06, 0.05, 0.04, 0.03, 0.02};
+    if(scan.get_nr_cases() != expected.size()) {
+        std::cerr << "Expected " << expected.size() << " cases, got " << scan.get_nr_cases() << std::endl;
+        return 1;
+    }
+    for(size_t i=0; i<expected.size(); i++) {
+        const ContinuationScan::Case& c = scan.get_case(i);
+        std::cout << c.value << (c.backward ? " backward: " : " forward:  ") << scan.get_parameters(i) << std::endl;
+        if(std::fabs(c.value - expected[i]) > 1e-15 || c.backward != (i >= 5)) {
+            std::cerr << "Case " << i << " does not follow the path" << std::endl;
+            success = false;
+        }
+    }
+
+    // the other parameters are kept, the varied one is replaced in place without loss of precision
+    const std::string params = scan.get_parameters(2);
+    if(params.substr(0, 11) != "k=0.0609;f=" || std::stod(params.substr(11)) != scan.get_case(2).value) {
+        std::cerr << "Unexpected parameters: " << scan.get_parameters(2) << std::endl;
+        success = false;
+    }
+
+    // a square wave in A (mean 1, standard deviation 0.5) and a uniform B
+    std::vector<double> a(32), b(32, 0.25);
+    for(unsigned int k=0; k<a.size(); k++) {
+        a[k] = (k % 2 == 0) ? 0.5 : 1.5;
+    }
+    scan.record(3, 12, 1.2, true, false, 0.0, {a.data(), b.data()});
+    const ContinuationScan::Case& c = scan.get_case(3);
+    if(std::fabs(c.mean[0] - 1.0) > 1e-14 || std::fabs(c.stdev[0] - 0.5) > 1e-14 ||
+       c.min[0] != 0.5 || c.max[0] != 1.5 || c.stdev[1] > 1e-14 || c.mean[1] != 0.25 ||
+       c.frames != 12 || !c.converged) {
+        std::cerr << "Recorded order parameters are wrong" << std::endl;
+        success = false;
+    }
+    scan.write();
+
+    // the varied parameter has to be among the parameters of the reaction system
+    try {
+        ContinuationScan invalid("param=q;from=0;to=1", "k=0.0609;f=0.035", {"A", "B"}, 8, 4, "unused.json");
+        std::cerr << "Unknown parameter was accepted" << std::endl;
+        success = false;
+    } catch(const std::runtime_error&) {
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Analytic checks of the time integration of TwoDimRD
+ *
+ * Without a reaction term, a product of cosines that is an eigenvector of
+ * the discrete Laplacian decays by exactly (1 - dt D lambda) per forward
+ * Euler step, for both periodic and zero-flux boundaries. This pins down
+ * the full update path up to rounding. Furthermore, a Gaussian has to follow
+ * the heat kernel with an error that decreases with the square of the grid
+ * spacing (with dt proportional to dx^2).
+ */
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "two_dim_rd.h"
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * @brief      Reaction system without reactions
+ */
+class PureDiffusion : public ReactionSystem {
+public:
+    void reaction(double a, double b, double *ra, double *rb) const override {
+        *ra = 0.0;
+        *rb = 0.0;
+    }
+
+    void init(MatrixXXd& a, MatrixXXd& b) const override {
+        a.setZero();
+        b.setZero();
+    }
+
+    void set_parameters(const std::string& params) override {}
+};
+
+/**
+ * @brief      Relative deviation of a discrete eigenmode from its exact decay
+ *
+ * @param[in]  pbc   whether to use periodic boundary conditions
+ *
+ * @return     maximum deviation relative to the amplitude
+ */
+static double eigenmode_error(bool pbc) {
+    const unsigned int w = 48;
+    const unsigned int h = 40;
+    const double dx = 0.5;
+    const double dt = 0.01;
+    const double Da = 1.0;
+    const double Db = 2.5;
+    const unsigned int nsteps = 200;
+    const unsigned int kx = 3;
+    const unsigned int ky = 2;
+
+    TwoDimRD rd(Da, Db, w, h, dx, dt, 1, nsteps);
+    rd.set_reaction(new PureDiffusion());
+    rd.set_parameters("");
+    rd.set_pbc(pbc);
+
+    // grid functions and eigenvalues of the periodic and the mirrored (zero-flux) Laplacian
+    auto mode = [pbc](unsigned int k, unsigned int i, unsigned int n) {
+        return pbc ? std::cos(2.0 * pi * k * i / n) : std::cos(pi * k * (i + 0.5) / n);
+    };
+    auto eigenvalue = [pbc, dx](unsigned int k, unsigned int n) {
+        const double s = pbc ? std::sin(pi * k / n) : std::sin(pi * k / (2.0 * n));
+        return 4.0 * s * s / (dx * dx);
+    };
+
+    MatrixXXd shape(w, h);
+    for(unsigned int j=0; j<h; j++) {
+        for(unsigned int i=0; i<w; i++) {
+            shape(i,j) = mode(kx, i, w) * mode(ky, j, h);
+        }
+    }
+    rd.get_a() = shape;
+    rd.get_b() = shape;
+
+    rd.advance(nsteps);
+
+    const double lambda = eigenvalue(kx, w) + eigenvalue(ky, h);
+    const double amp_a = std::pow(1.0 - dt * Da * lambda, nsteps);
+    const double amp_b = std::pow(1.0 - dt * Db * lambda, nsteps);
+    const double err_a = (rd.get_a() - amp_a * shape).cwiseAbs().maxCoeff() / amp_a;
+    const double err_b = (rd.get_b() - amp_b * shape).cwiseAbs().maxCoeff() / amp_b;
+
+    std::cout << "Eigenmode (" << (pbc ? "periodic" : "zero-flux") << "): amplitudes " << amp_a << ", " << amp_b
+              << ", relative deviation " << std::max(err_a, err_b) << std::endl;
+    return std::max(err_a, err_b);
+}
+
+/**
+ * @brief      Maximum deviation of a spreading Gaussian from the heat kernel
+ *
+ * @param[in]  n     number of grid points along each axis
+ *
+ * @return     maximum absolute error (the Gaussian starts at a height of one)
+ */
+static double heat_kernel_error(unsigned int n) {
+    const double L = 16.0;
+    const double dx = L / n;
+    const double dt = 0.1 * dx * dx;
+    const double D = 1.0;
+    const double sigma0 = 0.75;
+    const double tend = 1.0;
+    const unsigned int nsteps = std::lround(tend / dt);
+
+    TwoDimRD rd(D, D, n, n, dx, dt, 1, nsteps);
+    rd.set_reaction(new PureDiffusion());
+    rd.set_parameters("");
+    rd.set_pbc(true);
+
+    // height of a Gaussian that started at a height of one, relative to the center of the system
+    auto gaussian = [](double x, double y, double var, double var0) {
+        return var0 / var * std::exp(-(x * x + y * y) / (2.0 * var));
+    };
+    auto position = [dx, L](unsigned int i) {
+        return (i + 0.5) * dx - 0.5 * L;
+    };
+
+    MatrixXXd& a = rd.get_a();
+    for(unsigned int j=0; j<n; j++) {
+        for(unsigned int i=0; i<n; i++) {
+            a(i,j) = gaussian(position(i), position(j), sigma0 * sigma0, sigma0 * sigma0);
+        }
+    }
+
+    rd.advance(nsteps);
+
+    const double var = sigma0 * sigma0 + 2.0 * D * nsteps * dt;
+    double err = 0.0;
+    for(unsigned int j=0; j<n; j++) {
+        for(unsigned int i=0; i<n; i++) {
+            err = std::max(err, std::fabs(a(i,j) - gaussian(position(i), position(j), var, sigma0 * sigma0)));
+        }
+    }
+    return err;
+}
+
+int main() {
+    bool success = true;
+
+    for(bool pbc : {true, false}) {
+        if(eigenmode_error(pbc) > 1e-10) {
+            std::cerr << "The decay of an eigenmode deviates from forward Euler" << std::endl;
+            success = false;
+        }
+    }
+
+    double previous = 0.0;
+    for(unsigned int n : {32, 64, 128}) {
+        const double err = heat_kernel_error(n);
+        std::cout << "Heat kernel on " << std::setw(3) << n << "x" << n << ": max error " << err;
+        if(previous > 0.0) {
+            const double order = std::log2(previous / err);
+            std::cout << ", order " << order;
+            if(order < 1.8) {
+                std::cerr << std::endl << "The Gaussian does not converge to the heat kernel at second order";
+                success = false;
+            }
+        }
+        std::cout << std::endl;
+        previous = err;
+    }
+    if(previous > 1e-3) {
+        std::cerr << "The Gaussian deviates from the heat kernel" << std::endl;
+        success = false;
+    }
+
+    return success ? 0 : 1;
+}
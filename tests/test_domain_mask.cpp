@@ -0,0 +1,175 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Test of the Laplacian on masked domains
+ *
+ * A mask covering the whole grid has to reproduce the kernel of the full
+ * grid, a rectangular domain has to behave as a system with zero-flux
+ * boundaries of that size, and on a disc the diffusion term has to conserve
+ * mass while leaving the cells outside untouched. Finally, a mask is read
+ * from ASCII and binary PGM images.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "domain_mask.h"
+#include "laplacian.h"
+
+static MatrixXXd pattern(unsigned int w, unsigned int h) {
+    MatrixXXd c(w, h);
+    for(unsigned int j=0; j<h; j++) {
+        for(unsigned int i=0; i<w; i++) {
+            c(i,j) = std::sin(0.37 * i + 0.11 * j * j) + 0.01 * i * j;
+        }
+    }
+    return c;
+}
+
+int main() {
+    bool success = true;
+    const unsigned int w = 75;
+    const unsigned int h = 70;
+    const double dx = 0.5;
+    const MatrixXXd c = pattern(w, h);
+
+    // a full mask equals the kernel of the full grid
+    for(bool pbc : {true, false}) {
+        DomainMask mask(std::vector<unsigned char>(w * h, 1), w, h);
+        mask.prepare(pbc);
+        MatrixXXd ref = MatrixXXd::Zero(w, h), delta = MatrixXXd::Zero(w, h);
+        laplacian_block(ref, c, dx, STENCIL_5POINT, pbc, 0, w, 0, h);
+        mask.laplacian(delta, c, dx);
+        const double err = (ref - delta).cwiseAbs().maxCoeff();
+        std::cout << "Full mask (pbc = " << pbc << "): interior fraction = " << mask.get_interior_fraction()
+                  << ", max error = " << err << std::endl;
+        if(err > 1e-12 || mask.get_interior_fraction() != 1.0) {
+            std::cerr << "A full mask does not reproduce the full grid" << std::endl;
+            success = false;
+        }
+    }
+
+    // a rectangle inside the grid is a zero-flux system of its own; it
+    // holds both interior tiles and runs along its edges
+    {
+        const unsigned int i0 = 7, i1 = 68, j0 = 3, j1 = 69;
+        std::vector<unsigned char> active(w * h, 0);
+        for(unsigned int j=j0; j<j1; j++) {
+            for(unsigned int i=i0; i<i1; i++) {
+                active[i + j * w] = 1;
+            }
+        }
+        DomainMask mask(active, w, h);
+        mask.prepare(true);
+
+        const MatrixXXd sub = c.block(i0, j0, i1 - i0, j1 - j0);
+        MatrixXXd ref = MatrixXXd::Zero(i1 - i0, j1 - j0), delta = MatrixXXd::Zero(w, h);
+        laplacian_block(ref, sub, dx, STENCIL_5POINT, false, 0, i1 - i0, 0, j1 - j0);
+        mask.laplacian(delta, c, dx);
+        const double err = (ref - delta.block(i0, j0, i1 - i0, j1 - j0)).cwiseAbs().maxCoeff();
+        std::cout << "Rectangle: interior fraction = " << mask.get_interior_fraction()
+                  << ", max error = " << err << std::endl;
+        if(err > 1e-12 || mask.get_interior_fraction() <= 0.0) {
+            std::cerr << "A rectangular mask is not a zero-flux system" << std::endl;
+            success = false;
+        }
+    }
+
+    // a disc conserves mass and leaves the cells outside untouched
+    {
+        std::vector<unsigned char> active(w * h, 0);
+        for(unsigned int j=0; j<h; j++) {
+            for(unsigned int i=0; i<w; i++) {
+                const double x = i - 37.0, y = j - 35.0;
+                active[i + j * w] = (x * x + y * y < 33.0 * 33.0);
+            }
+        }
+        DomainMask mask(active, w, h);
+        mask.prepare(false);
+
+        MatrixXXd delta = MatrixXXd::Zero(w, h);
+        mask.laplacian(delta, c, dx);
+        double sum = 0.0, scale = 0.0, outside = 0.0;
+        for(unsigned int j=0; j<h; j++) {
+            for(unsigned int i=0; i<w; i++) {
+                if(mask.is_active(i, j)) {
+                    sum += delta(i,j);
+                    scale += std::fabs(delta(i,j));
+                } else {
+                    outside = std::max(outside, std::fabs(delta(i,j)));
+                }
+            }
+        }
+        std::cout << "Disc: active fraction = " << mask.get_active_fraction() << ", interior fraction = "
+                  << mask.get_interior_fraction() << ", relative mass change = " << sum / scale << std::endl;
+        if(std::fabs(sum) > 1e-12 * scale || outside != 0.0) {
+            std::cerr << "The disc does not conserve mass" << std::endl;
+            success = false;
+        }
+    }
+
+    // the same shape from an ASCII and a binary image; the top row of the image is the last grid row
+    {
+        const unsigned int pw = 4, ph = 3;
+        const unsigned int pixels[] = {255, 0, 0, 0,
+                                       0, 200, 0, 0,
+                                       0, 0, 100, 255};
+        std::ofstream ascii("test_domain_mask_p2.pgm");
+        ascii << "P2\n# test image\n" << pw << " " << ph << "\n255\n";
+        for(unsigned int k=0; k<pw*ph; k++) {
+            ascii << pixels[k] << ((k % pw == pw - 1) ? "\n" : " ");
+        }
+        ascii.close();
+        std::ofstream binary("test_domain_mask_p5.pgm", std::ios::binary);
+        binary << "P5 " << pw << " " << ph << " 255\n";
+        for(unsigned int k=0; k<pw*ph; k++) {
+            binary.put((char)pixels[k]);
+        }
+        binary.close();
+
+        for(const std::string& path : {"test_domain_mask_p2.pgm", "test_domain_mask_p5.pgm"}) {
+            DomainMask mask("path=" + path + ";threshold=0.5", pw, ph);
+            const bool expected[] = {false, false, false, true,
+                                     false, true, false, false,
+                                     true, false, false, false};
+            for(unsigned int j=0; j<ph; j++) {
+                for(unsigned int i=0; i<pw; i++) {
+                    if(mask.is_active(i, j) != expected[i + j * pw]) {
+                        std::cerr << "Wrong mask read from " << path << " at " << i << "," << j << std::endl;
+                        success = false;
+                    }
+                }
+            }
+            std::remove(path.c_str());
+        }
+    }
+
+    return success ? 0 : 1;
+}
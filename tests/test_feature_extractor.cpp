@@ -0,0 +1,177 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+/*
+ * Test of the in-situ feature extraction
+ *
+ * The spots found by the tiled union-find labelling of thresholded random
+ * fields are compared with a sequential flood fill, with and without
+ * periodic boundaries and on grids whose size is not a multiple of the
+ * tiles. The centroid of a disc wrapping around a periodic boundary is
+ * verified, as well as the spiral tips of two rotated linear fields, whose
+ * isolines intersect at a single known point.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "feature_extractor.h"
+
+/**
+ * @brief      Areas of the connected components of a mask found by flood fill
+ */
+static std::vector<double> flood_fill(const std::vector<bool>& mask, unsigned int W, unsigned int H, bool pbc) {
+    std::vector<bool> seen(mask.size(), false);
+    std::vector<double> areas;
+    for(size_t start=0; start<mask.size(); start++) {
+        if(!mask[start] || seen[start]) {
+            continue;
+        }
+        std::vector<size_t> stack = {start};
+        seen[start] = true;
+        double area = 0.0;
+        while(!stack.empty()) {
+            const size_t p = stack.back();
+            stack.pop_back();
+            area += 1.0;
+            const int i = p % W;
+            const int j = p / W;
+            const int di[] = {1, -1, 0, 0};
+            const int dj[] = {0, 0, 1, -1};
+            for(unsigned int k=0; k<4; k++) {
+                int ni = i + di[k];
+                int nj = j + dj[k];
+                if(pbc) {
+                    ni = (ni + W) % W;
+                    nj = (nj + H) % H;
+                } else if(ni < 0 || nj < 0 || ni >= (int)W || nj >= (int)H) {
+                    continue;
+                }
+                const size_t q = (size_t)nj * W + ni;
+                if(mask[q] && !seen[q]) {
+                    seen[q] = true;
+                    stack.push_back(q);
+                }
+            }
+        }
+        areas.push_back(area);
+    }
+    return areas;
+}
+
+int main() {
+    bool success = true;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    // random fields around the percolation threshold give intricate spots spanning many tiles
+    const unsigned int sizes[][2] = {{150, 130}, {64, 64}, {200, 7}};
+    for(const auto& size : sizes) {
+        const unsigned int W = size[0];
+        const unsigned int H = size[1];
+        for(bool pbc : {false, true}) {
+            for(double p : {0.3, 0.55, 0.7}) {
+                std::vector<double> c((size_t)W * H);
+                std::vector<bool> mask(c.size());
+                for(size_t i=0; i<c.size(); i++) {
+                    c[i] = dist(rng);
+                    mask[i] = c[i] < p;
+                }
+
+                FeatureExtractor extractor("spots=A<" + std::to_string(p), {"A", "B"}, W, H, 1.0, pbc, "");
+                const std::vector<FeatureExtractor::Spot> spots = extractor.find_spots(c.data());
+                std::vector<double> areas;
+                for(const auto& spot : spots) {
+                    areas.push_back(spot.area);
+                }
+                std::vector<double> expected = flood_fill(mask, W, H, pbc);
+                std::sort(areas.begin(), areas.end());
+                std::sort(expected.begin(), expected.end());
+
+                std::cout << W << "x" << H << (pbc ? " periodic" : " bounded") << ", p = " << p << ": "
+                          << spots.size() << " spots (flood fill: " << expected.size() << ")" << std::endl;
+                if(areas != expected) {
+                    std::cerr << "Spots differ from the flood fill" << std::endl;
+                    success = false;
+                }
+            }
+        }
+    }
+
+    // a disc centered on the periodic boundary forms a single spot
+    {
+        const unsigned int W = 100;
+        const unsigned int H = 80;
+        const double dx = 0.5;
+        std::vector<double> c((size_t)W * H, 0.0);
+        for(unsigned int j=0; j<H; j++) {
+            for(unsigned int i=0; i<W; i++) {
+                const double di = std::min<double>(i, W - i);
+                const double dj = (double)j - 40.0;
+                c[(size_t)j * W + i] = (di * di + dj * dj < 100.0) ? 1.0 : 0.0;
+            }
+        }
+        FeatureExtractor periodic("spots=A>0.5", {"A"}, W, H, dx, true, "");
+        FeatureExtractor bounded("spots=A>0.5", {"A"}, W, H, dx, false, "");
+        const auto spots = periodic.find_spots(c.data());
+        const auto halves = bounded.find_spots(c.data());
+        const double x = spots.empty() ? -1.0 : std::min(spots[0].x, W * dx - spots[0].x);
+        std::cout << "wrapped disc: " << spots.size() << " spot at (" << (spots.empty() ? 0.0 : spots[0].x) << ", "
+                  << (spots.empty() ? 0.0 : spots[0].y) << "), " << halves.size() << " without periodic boundaries"
+                  << std::endl;
+        if(spots.size() != 1 || x > 1e-9 || std::fabs(spots[0].y - 40.0 * dx) > 1e-9 || halves.size() != 2) {
+            std::cerr << "The wrapped disc is not found correctly" << std::endl;
+            success = false;
+        }
+    }
+
+    // rotated linear fields intersect at a single point, which bilinear interpolation reproduces exactly
+    {
+        const unsigned int W = 90;
+        const unsigned int H = 70;
+        const double dx = 0.25;
+        const double x0 = 37.3;
+        const double y0 = 21.7;
+        const double alpha = 0.6;
+        std::vector<double> u((size_t)W * H);
+        std::vector<double> v((size_t)W * H);
+        for(unsigned int j=0; j<H; j++) {
+            for(unsigned int i=0; i<W; i++) {
+                u[(size_t)j * W + i] = 0.5 + (i - x0) * std::cos(alpha) + (j - y0) * std::sin(alpha);
+                v[(size_t)j * W + i] = 0.3 - (i - x0) * std::sin(alpha) + (j - y0) * std::cos(alpha);
+            }
+        }
+        FeatureExtractor extractor("tips=A:0.5,B:0.3", {"A", "B"}, W, H, dx, false, "");
+        const auto tips = extractor.find_tips(u.data(), v.data());
+        std::cout << "linear fields: " << tips.size() << " tip at (" << (tips.empty() ? 0.0 : tips[0].x) << ", "
+                  << (tips.empty() ? 0.0 : tips[0].y) << ")" << std::endl;
+        if(tips.size() != 1 || std::fabs(tips[0].x - x0 * dx) > 1e-9 || std::fabs(tips[0].y - y0 * dx) > 1e-9) {
+            std::cerr << "The spiral tip is not found correctly" << std::endl;
+            success = false;
+        }
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+/*
+ * Test of the Fourier transform and the in-situ analysis of the fields
+ *
+ * The transform is compared with a direct evaluation of the discrete
+ * Fourier transform for lengths that are powers of two, primes and
+ * composite numbers. The analysis is applied to plane waves on grids of
+ * various sizes, for which the mean, variance and dominant wavenumber are
+ * known, and to a uniform field, whose spectrum vanishes.
+ */
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "fft.h"
+#include "field_analysis.h"
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * @brief      Maximum deviation of the transform from the direct evaluation
+ *
+ * @param[in]  n     length of the transform
+ *
+ * @return     maximum absolute error relative to the length
+ */
+static double fft_error(unsigned int n) {
+    std::vector<std::complex<double>> x(n);
+    for(unsigned int k=0; k<n; k++) {
+        x[k] = std::complex<double>(std::sin(0.3 * k + 1.0), std::cos(1.7 * k * k));
+    }
+
+    FFT fft(n);
+    std::vector<std::complex<double>> y = x;
+    std::vector<std::complex<double>> work(fft.get_work_size());
+    fft.forward(y.data(), work.data());
+
+    double err = 0.0;
+    for(unsigned int j=0; j<n; j++) {
+        std::complex<double> sum = 0.0;
+        for(unsigned int k=0; k<n; k++) {
+            sum += x[k] * std::polar(1.0, -2.0 * pi * (double)(((unsigned long long)j * k) % n) / n);
+        }
+        err = std::max(err, std::abs(sum - y[j]));
+    }
+
+    return err / n;
+}
+
+int main() {
+    bool success = true;
+
+    std::cout << std::setw(6) << "n" << std::setw(14) << "error" << std::endl;
+    for(unsigned int n : {1u, 2u, 3u, 7u, 16u, 30u, 64u, 97u, 100u, 128u, 250u}) {
+        const double err = fft_error(n);
+        std::cout << std::setw(6) << n << std::setw(14) << std::scientific << std::setprecision(4) << err << std::endl;
+        if(err > 1e-12) {
+            std::cerr << "Fourier transform of length " << n << " is inaccurate" << std::endl;
+            success = false;
+        }
+    }
+
+    // plane waves c = 1 + 0.5 cos(k.x) with wavelength 2 pi / |k|
+    std::cout << std::endl << std::setw(6) << "width" << std::setw(8) << "height" << std::setw(10) << "mode"
+              << std::setw(12) << "k" << std::setw(12) << "k_peak" << std::endl;
+    const unsigned int sizes[][4] = {{64, 64, 8, 0}, {128, 96, 6, 8}, {90, 90, 0, 9}, {100, 70, 10, 0}};
+    const double dx = 0.5;
+    for(const auto& s : sizes) {
+        const unsigned int W = s[0];
+        const unsigned int H = s[1];
+        const double kx = 2.0 * pi * s[2] / (W * dx);
+        const double ky = 2.0 * pi * s[3] / (H * dx);
+
+        std::vector<double> c((size_t)W * H);
+        std::vector<double> u((size_t)W * H, 0.25);
+        for(unsigned int j=0; j<H; j++) {
+            for(unsigned int i=0; i<W; i++) {
+                c[(size_t)j * W + i] = 1.0 + 0.5 * std::cos(kx * i * dx + ky * j * dx);
+            }
+        }
+
+        FieldAnalysis analysis("bins=10", {"A", "B"}, W, H, dx, "test_field_analysis.json");
+        analysis.analyze(0, 0.0, {c.data(), u.data()});
+        const FieldAnalysis::Sample& wave = analysis.get_sample(0, 0);
+        const FieldAnalysis::Sample& uniform = analysis.get_sample(0, 1);
+
+        // the peak lies within a quarter of a shell of the exact wavenumber
+        const double k = std::sqrt(kx * kx + ky * ky);
+        const double dk = 2.0 * pi / (std::max(W, H) * dx);
+        std::cout << std::setw(6) << W << std::setw(8) << H << std::setw(5) << s[2] << "," << std::setw(4) << s[3]
+                  << std::fixed << std::setprecision(5) << std::setw(12) << k << std::setw(12) << wave.k_peak
+                  << std::endl;
+
+        double total = 0.0;
+        for(double h : wave.histogram) {
+            total += h;
+        }
+
+        if(std::fabs(wave.k_peak - k) > 0.25 * dk ||
+           std::fabs(wave.mean - 1.0) > 1e-12 || std::fabs(wave.variance - 0.125) > 1e-12 ||
+           std::fabs(wave.max - 1.5) > 1e-12 || std::fabs(total - 1.0) > 1e-12 ||
+           uniform.k_peak != 0.0 || uniform.variance > 1e-24) {
+            std::cerr << "Analysis of the " << W << "x" << H << " plane wave failed" << std::endl;
+            success = false;
+        }
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+/*
+ * Round-trip test of the output layouts
+ *
+ * Frames with a size that is not a multiple of the chunk size are written
+ * in the contiguous layout and in the chunked layout (with and without
+ * compression), after which rectangles spanning several chunks are read
+ * back and compared with the original values. A small region should only
+ * require a fraction of the file to be read. Quantized chunks have to agree
+ * with the original values within the error bound, also where the values
+ * fall outside of a fixed range and the chunks are stored as doubles.
+ * Frames holding different numbers of fields are only accepted by the
+ * chunked layout.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "frame_reader.h"
+#include "frame_writer.h"
+
+/**
+ * @brief      Value of a field at a grid point in a frame
+ */
+static double value(unsigned int frame, unsigned int field, unsigned int i, unsigned int j) {
+    return std::sin(0.1 * i + 0.2 * field) * std::cos(0.07 * j) + 0.01 * frame;
+}
+
+/**
+ * @brief      Write a file in the given layout and verify a set of regions
+ *
+ * @param[in]  chunk_size    edge length of a chunk (0 = contiguous)
+ * @param[in]  compression   zlib compression level
+ * @param[in]  quantization  quantization of the chunks (empty = none)
+ * @param[in]  tolerance     maximum absolute error of the values read back
+ *
+ * @return     whether all regions were read back correctly
+ */
+static bool round_trip(unsigned int chunk_size, int compression,
+                       const std::string& quantization = "", double tolerance = 0.0) {
+    const unsigned int width = 70;
+    const unsigned int height = 45;
+    const unsigned int nframes = 4;
+    const unsigned int nfields = 3;
+    const std::string filename = "test_frame_io_" + std::to_string(chunk_size) + "_" +
+                                 std::to_string(compression) + "_" +
+                                 std::to_string(std::hash<std::string>()(quantization)) + ".bin";
+    uint64_t raw_chunks = 0;
+
+    {
+        FrameWriter writer(filename, width, height, chunk_size, compression, quantization);
+        std::vector<MatrixXXd> fields(nfields, MatrixXXd(width, height));
+        for(unsigned int f=0; f<nframes; f++) {
+            std::vector<const double*> ptrs;
+            for(unsigned int k=0; k<nfields; k++) {
+                for(unsigned int j=0; j<height; j++) {
+                    for(unsigned int i=0; i<width; i++) {
+                        fields[k](i,j) = value(f, k, i, j);
+                    }
+                }
+                ptrs.push_back(fields[k].data());
+            }
+            writer.write_frame(ptrs, width * height);
+        }
+        writer.close();
+        raw_chunks = writer.get_nr_raw_chunks();
+    }
+
+    FrameReader reader(filename);
+    bool success = reader.get_width() == width && reader.get_height() == height &&
+                   reader.get_nr_frames() == nframes && reader.get_nr_fields() == nfields &&
+                   reader.is_chunked() == (chunk_size > 0) &&
+                   reader.get_quantization_bits() == (quantization.empty() ? 0 : FrameQuantizer(quantization).get_bits());
+
+    // full frame, a region crossing chunk boundaries and a region in the edge chunks
+    const unsigned int regions[][4] = {{0, 0, width, height}, {13, 9, 30, 20}, {60, 40, 10, 5}};
+    for(const auto& r : regions) {
+        for(unsigned int k=0; k<nfields; k++) {
+            const std::vector<double> data = reader.read_region(k, 1, nframes, r[0], r[1], r[2], r[3]);
+            for(unsigned int f=1; f<nframes; f++) {
+                for(unsigned int j=0; j<r[3]; j++) {
+                    for(unsigned int i=0; i<r[2]; i++) {
+                        const double v = data[((f - 1) * r[3] + j) * r[2] + i];
+                        if(!(std::fabs(v - value(f, k, r[0] + i, r[1] + j)) <= tolerance)) {
+                            success = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // a small region inside a single chunk only reads that chunk
+    const uint64_t before = reader.get_bytes_read();
+    double probe[4];
+    reader.read(2, 1, 20, 20, 2, 2, probe);
+    const uint64_t probe_bytes = reader.get_bytes_read() - before;
+    const uint64_t chunk_bytes = (uint64_t)chunk_size * chunk_size * sizeof(double);
+    if(chunk_size > 0 && probe_bytes > chunk_bytes) {
+        success = false;
+    }
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    std::cout << "chunk size " << chunk_size << ", compression " << compression;
+    if(!quantization.empty()) {
+        std::cout << ", quantization " << quantization << " (" << raw_chunks << " chunks as doubles)";
+    }
+    std::cout << ": " << file.tellg() << " bytes, " << probe_bytes << " bytes for a 2x2 region, "
+              << (success ? "OK" : "FAILED") << std::endl;
+
+    std::remove(filename.c_str());
+    return success;
+}
+
+/**
+ * @brief      Frames holding different numbers of fields
+ *
+ * The chunked layout stores the number of fields of every frame, which the
+ * reader reports per frame; fields that a frame does not hold cannot be
+ * read. The contiguous layout refuses such frames.
+ *
+ * @return     whether all checks passed
+ */
+static bool mixed_fields() {
+    const unsigned int width = 20;
+    const unsigned int height = 12;
+    const unsigned int counts[] = {3, 1, 2, 3};
+    const std::string filename = "test_frame_io_mixed.bin";
+    bool success = true;
+
+    {
+        FrameWriter writer(filename, width, height, 8, 0);
+        std::vector<MatrixXXd> fields(3, MatrixXXd(width, height));
+        for(unsigned int f=0; f<4; f++) {
+            std::vector<const double*> ptrs;
+            for(unsigned int k=0; k<counts[f]; k++) {
+                for(unsigned int j=0; j<height; j++) {
+                    for(unsigned int i=0; i<width; i++) {
+                        fields[k](i,j) = value(f, k, i, j);
+                    }
+                }
+                ptrs.push_back(fields[k].data());
+            }
+            writer.write_frame(ptrs, width * height);
+        }
+        writer.close();
+    }
+
+    FrameReader reader(filename);
+    for(unsigned int f=0; f<4; f++) {
+        success &= reader.get_nr_fields(f) == counts[f];
+    }
+
+    // there is no single number of fields, and frame 1 only holds a single field
+    double v[4];
+    try {
+        reader.get_nr_fields();
+        success = false;
+    } catch(const std::runtime_error&) {}
+    try {
+        reader.read(1, 1, 0, 0, 2, 2, v);
+        success = false;
+    } catch(const std::runtime_error&) {}
+
+    reader.read(2, 1, 3, 4, 2, 2, v);
+    success &= v[0] == value(2, 1, 3, 4);
+    std::remove(filename.c_str());
+
+    // the header of a contiguous file cannot describe these frames
+    {
+        FrameWriter writer(filename, width, height, 0, 0);
+        MatrixXXd a = MatrixXXd::Zero(width, height);
+        writer.write_frame(std::vector<const double*>{a.data(), a.data()}, width * height);
+        try {
+            writer.write_frame(std::vector<const double*>{a.data()}, width * height);
+            success = false;
+        } catch(const std::runtime_error&) {}
+        writer.close();
+    }
+    std::remove(filename.c_str());
+
+    std::cout << "frames with different fields: " << (success ? "OK" : "FAILED") << std::endl;
+    return success;
+}
+
+int main() {
+    bool success = true;
+
+    success &= round_trip(0, 0);
+    success &= round_trip(16, 0);
+    success &= round_trip(32, 0);
+    success &= round_trip(16, 0, "bits=8", 1.05 / 255.0);
+    success &= round_trip(16, 0, "bits=16;error=1e-4", 1e-4);
+    success &= round_trip(16, 0, "bits=8;range=-0.5:0.5", 0.5 / 255.0 + 1e-15);
+    success &= round_trip(16, 0, "bits=8;error=1e-3", 1e-3);
+#ifdef HAS_ZLIB
+    success &= round_trip(16, 6);
+    success &= round_trip(16, 6, "bits=16", 1.05 / 65535.0);
+#endif
+    success &= mixed_fields();
+
+    return success ? 0 : 1;
+}
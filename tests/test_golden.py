@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+
+# Runs a small simulation of each two-species reaction model with periodic
+# and with zero-flux boundaries and compares fingerprints of every frame
+# (moments, extrema and a weighted checksum per species) with the golden
+# values in golden/reference.json. The same runs are repeated on the tiled
+# update path (--tile-size with a zero rest tolerance), which has to agree
+# with the same golden values.
+#
+#     test_golden.py <turing> <scratch directory> [--update]
+#
+# With --update, the golden values are regenerated from the full-grid path.
+# Only do so after a change to the numerics that is intended.
+
+import json
+import math
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+turing, scratch = sys.argv[1:3]
+update = '--update' in sys.argv[3:]
+shutil.rmtree(scratch, ignore_errors=True)
+os.makedirs(scratch)
+reference = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'golden', 'reference.json')
+
+# values differ from the golden ones by at most RTOL relative to the size of the field
+RTOL = 1e-9
+
+# the example settings of the README on a small grid (gierer-meinhardt has no
+# reaction terms yet and is left out)
+models = {
+    'lotka-volterra':  ['--Da', '2e-5', '--Db', '1e-5', '--dx', '0.005', '--dt', '0.01',
+                        '--parameters', 'alpha=2.3333;beta=2.6666;gamma=1.0;delta=1.0'],
+    'fitzhugh-nagumo': ['--Da', '1', '--Db', '100', '--dx', '1.0', '--dt', '0.001',
+                        '--parameters', 'alpha=-0.005;beta=10.0'],
+    'gray-scott':      ['--Da', '2e-5', '--Db', '1e-5', '--dx', '0.005', '--dt', '0.1',
+                        '--parameters', 'f=0.06;k=0.0609'],
+    'brusselator':     ['--Da', '2', '--Db', '16', '--dx', '1.0', '--dt', '0.001',
+                        '--parameters', 'alpha=4.5;beta=7.50'],
+    'barkley':         ['--Da', '5.0', '--Db', '0.0', '--dx', '1.0', '--dt', '0.001',
+                        '--parameters', 'alpha=0.75;beta=0.06;epsilon=50.0'],
+}
+grid = ['--width', '32', '--height', '32', '--steps', '3', '--tsteps', '200']
+
+def check(condition, msg):
+    if not condition:
+        print('FAILED: ' + msg)
+        sys.exit(1)
+
+def read_frames(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+    w, h, n = struct.unpack_from('iii', data, 0)
+    n += 1  # the header does not count the initial frame
+    size = w * h
+    check(len(data) == 12 + 2 * n * size * 8, '%s has an unexpected size' % filename)
+    frames = []
+    for k in range(n):
+        offset = 12 + 2 * k * size * 8
+        a = struct.unpack_from('%dd' % size, data, offset)
+        b = struct.unpack_from('%dd' % size, data, offset + size * 8)
+        frames.append((a, b))
+    return w, h, frames
+
+def weights(size):
+    # fixed pseudo-random weights, so that the checksum notices displaced values
+    x, res = 12345, []
+    for _ in range(size):
+        x = (1103515245 * x + 12345) % 2147483648
+        res.append(x / 2147483648.0 - 0.5)
+    return res
+
+def fingerprint(c, wgt):
+    n = len(c)
+    mean = math.fsum(c) / n
+    return {
+        'mean': mean,
+        'std': math.sqrt(math.fsum((v - mean) ** 2 for v in c) / n),
+        'min': min(c),
+        'max': max(c),
+        'checksum': math.fsum(v * q for v, q in zip(c, wgt)),
+    }
+
+def run(model, pbc, extra):
+    name = '%s_%s%s' % (model, 'pbc' if pbc else 'zeroflux', '_tiled' if extra else '')
+    out = os.path.join(scratch, name + '.bin')
+    cmd = [turing] + models[model] + grid + ['--reaction', model, '--outfile', out, '--no-progress'] + extra
+    if pbc:
+        cmd.append('--pbc')
+    res = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    check(res.returncode == 0, '%s failed: %s' % (name, res.stderr))
+    w, h, frames = read_frames(out)
+    wgt = weights(w * h)
+    return [{'A': fingerprint(a, wgt), 'B': fingerprint(b, wgt)} for a, b in frames]
+
+def compare(name, result, golden):
+    check(len(result) == len(golden), '%s: %d frames instead of %d' % (name, len(result), len(golden)))
+    worst = 0.0
+    for k, (fr, fg) in enumerate(zip(result, golden)):
+        for species in ('A', 'B'):
+            r, g = fr[species], fg[species]
+            scale = max(abs(g['min']), abs(g['max']), 1e-300)
+            for key in g:
+                dev = abs(r[key] - g[key]) / scale
+                worst = max(worst, dev)
+                check(dev <= RTOL, '%s, frame %d, %s %s: %.17g instead of %.17g' %
+                      (name, k, species, key, r[key], g[key]))
+    print('%-32s max deviation %.3g' % (name, worst))
+
+cases = [(m, pbc) for m in models for pbc in (True, False)]
+results = {'%s_%s' % (m, 'pbc' if pbc else 'zeroflux'): run(m, pbc, []) for m, pbc in cases}
+
+if update:
+    os.makedirs(os.path.dirname(reference), exist_ok=True)
+    with open(reference, 'w') as f:
+        json.dump(results, f, indent=1, sort_keys=True)
+        f.write('\n')
+    print('Wrote %d golden runs to %s' % (len(results), reference))
+    sys.exit(0)
+
+with open(reference) as f:
+    golden = json.load(f)
+check(sorted(golden) == sorted(results), 'the golden file covers other runs than the test')
+
+for m, pbc in cases:
+    name = '%s_%s' % (m, 'pbc' if pbc else 'zeroflux')
+    compare(name, results[name], golden[name])
+    compare(name + '_tiled', run(m, pbc, ['--tile-size', '8', '--tile-tol', '0']), golden[name])
+
+print('All runs agree with the golden values')
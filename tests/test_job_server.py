@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+
+# Runs `turing serve` on a socket and a spool directory and checks that
+# concurrent jobs produce the same output as separate runs of turing, that
+# failing jobs are reported without stopping the server, and that the
+# server shuts down cleanly.
+#
+#     test_job_server.py <turing> <turing_client.py> <scratch directory>
+
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+turing, client, scratch = sys.argv[1:4]
+shutil.rmtree(scratch, ignore_errors=True)
+os.makedirs(os.path.join(scratch, 'spool'))
+sock = os.path.join(scratch, 'turing.sock')
+
+job = ['--Da', '2', '--Db', '16', '--dx', '1.0', '--dt', '0.005', '--width', '48', '--height', '40',
+       '--steps', '4', '--tsteps', '50', '--reaction', 'brusselator',
+       '--parameters', 'alpha=4.5;beta=7.50', '--pbc']
+
+def out(name):
+    return os.path.join(scratch, name)
+
+def check(condition, msg):
+    if not condition:
+        print('FAILED: ' + msg)
+        sys.exit(1)
+
+def read(filename):
+    with open(filename, 'rb') as f:
+        return f.read()
+
+subprocess.run([turing] + job + ['--outfile', out('ref.bin')], check=True, stdout=subprocess.DEVNULL)
+
+server = subprocess.Popen([turing, 'serve', '--socket', sock, '--spool', out('spool'), '--cores', '2'])
+try:
+    for _ in range(100):
+        if os.path.exists(sock):
+            break
+        time.sleep(0.1)
+    check(os.path.exists(sock), 'server did not create its socket')
+
+    # concurrent jobs, each compared with a separate run
+    with open(out('jobs.txt'), 'w') as f:
+        for i in range(4):
+            f.write(' '.join("'%s'" % a for a in job + ['--outfile', out('job%d.bin' % i)]) + '\n')
+    res = subprocess.run([sys.executable, client, sock, '--jobs', out('jobs.txt')],
+                         capture_output=True, text=True)
+    check(res.returncode == 0, 'jobs failed: ' + res.stdout)
+    reports = [json.loads(line) for line in res.stdout.splitlines()]
+    check(len(reports) == 4, 'expected 4 reports: ' + res.stdout)
+    for r in reports:
+        check(r['status'] == 'ok' and r['threads'] >= 1 and r['run_seconds'] > 0.0, 'bad report: %s' % r)
+    for i in range(4):
+        check(read(out('job%d.bin' % i)) == read(out('ref.bin')), 'job %d differs from a separate run' % i)
+
+    # a failing job is reported, the server keeps running
+    res = subprocess.run([sys.executable, client, sock, '--', '--width', '10'], capture_output=True, text=True)
+    r = json.loads(res.stdout)
+    check(res.returncode != 0 and r['status'] == 'failed' and 'Required argument missing' in r['error'], 'bad failure report: %s' % r)
+
+    # a spooled job
+    with open(out('spool/a.job.tmp'), 'w') as f:
+        f.write(' '.join("'%s'" % a for a in job + ['--outfile', out('spooled.bin')]))
+    os.rename(out('spool/a.job.tmp'), out('spool/a.job'))
+    for _ in range(200):
+        if os.path.exists(out('spool/a.job.done')) or os.path.exists(out('spool/a.job.failed')):
+            break
+        time.sleep(0.1)
+    check(os.path.exists(out('spool/a.job.done')), 'spooled job did not finish')
+    with open(out('spool/a.report.json')) as f:
+        check(json.load(f)['status'] == 'ok', 'bad spool report')
+    check(read(out('spooled.bin')) == read(out('ref.bin')), 'spooled job differs from a separate run')
+
+    res = subprocess.run([sys.executable, client, sock, '--status'], capture_output=True, text=True)
+    status = json.loads(res.stdout)
+    check(status['completed'] == 6 and status['running'] == 0, 'bad status: %s' % status)
+
+    subprocess.run([sys.executable, client, sock, '--shutdown'], check=True, stdout=subprocess.DEVNULL)
+    check(server.wait(timeout=30) == 0, 'server did not shut down cleanly')
+    check(not os.path.exists(sock), 'socket was not removed')
+finally:
+    if server.poll() is None:
+        server.kill()
+
+print('job server: all checks passed')
@@ -0,0 +1,147 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+/*
+ * Convergence test of the Laplacian stencils
+ *
+ * The stencils are applied to smooth functions with a known Laplacian on
+ * successively refined grids for both types of boundary conditions. The
+ * observed order of accuracy follows from the ratio of the maximum errors on
+ * consecutive grids. Additionally, the isotropy of the stencils is assessed
+ * by comparing the errors of two plane waves with the same wavelength but
+ * a different orientation with respect to the grid.
+ */
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+
+#include "laplacian.h"
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * @brief      Maximum error of a stencil on an n x n grid over the unit square
+ *
+ * @param[in]  stencil  The stencil
+ * @param[in]  pbc      whether to use periodic boundary conditions
+ * @param[in]  n        number of cells along each axis
+ * @param[in]  f        function
+ * @param[in]  lap_f    Laplacian of the function
+ *
+ * @return     maximum absolute error
+ */
+static double max_error(LaplacianStencil stencil, bool pbc, unsigned int n,
+                        const std::function<double(double,double)>& f,
+                        const std::function<double(double,double)>& lap_f) {
+    const double h = 1.0 / n;
+
+    MatrixXXd c(n, n);
+    MatrixXXd delta_c(n, n);
+    for(unsigned int j=0; j<n; j++) {
+        for(unsigned int i=0; i<n; i++) {
+            c(i,j) = f((i + 0.5) * h, (j + 0.5) * h);
+        }
+    }
+
+    laplacian_block(delta_c, c, h, stencil, pbc, 0, n, 0, n);
+
+    double err = 0.0;
+    for(unsigned int j=0; j<n; j++) {
+        for(unsigned int i=0; i<n; i++) {
+            err = std::max(err, std::fabs(delta_c(i,j) - lap_f((i + 0.5) * h, (j + 0.5) * h)));
+        }
+    }
+
+    return err;
+}
+
+/**
+ * @brief      Relative error of the Laplacian of the plane wave cos(2 pi (kx x + ky y))
+ */
+static double plane_wave_error(LaplacianStencil stencil, unsigned int n, int kx, int ky) {
+    const double k2 = 4.0 * pi * pi * (kx * kx + ky * ky);
+    auto f = [&](double x, double y) { return std::cos(2.0 * pi * (kx * x + ky * y)); };
+    auto lap_f = [&](double x, double y) { return -k2 * f(x, y); };
+
+    return max_error(stencil, true, n, f, lap_f) / k2;
+}
+
+int main() {
+    // periodic: sin(2 pi x) sin(4 pi y); zero-flux: cos(pi x) cos(2 pi y)
+    auto f_pbc = [](double x, double y) { return std::sin(2.0 * pi * x) * std::sin(4.0 * pi * y); };
+    auto lap_pbc = [&](double x, double y) { return -20.0 * pi * pi * f_pbc(x, y); };
+    auto f_zf = [](double x, double y) { return std::cos(pi * x) * std::cos(2.0 * pi * y); };
+    auto lap_zf = [&](double x, double y) { return -5.0 * pi * pi * f_zf(x, y); };
+
+    const LaplacianStencil stencils[] = {STENCIL_5POINT, STENCIL_9POINT, STENCIL_13POINT};
+    const double expected_order[] = {2.0, 2.0, 4.0};
+
+    bool success = true;
+
+    std::cout << std::setw(8) << "stencil" << std::setw(10) << "boundary" << std::setw(6) << "n"
+              << std::setw(14) << "error" << std::setw(8) << "order" << std::endl;
+
+    for(unsigned int s=0; s<3; s++) {
+        for(bool pbc : {true, false}) {
+            double prev = 0.0;
+            double order = 0.0;
+            for(unsigned int n=16; n<=128; n*=2) {
+                const double err = pbc ? max_error(stencils[s], true, n, f_pbc, lap_pbc) :
+                                         max_error(stencils[s], false, n, f_zf, lap_zf);
+                order = (prev > 0.0) ? std::log2(prev / err) : 0.0;
+                prev = err;
+
+                std::cout << std::setw(8) << (int)stencils[s] << std::setw(10) << (pbc ? "periodic" : "zero-flux")
+                          << std::setw(6) << n << std::setw(14) << std::scientific << std::setprecision(4) << err
+                          << std::setw(8) << std::fixed << std::setprecision(2) << order << std::endl;
+            }
+
+            if(order < expected_order[s] - 0.1) {
+                std::cerr << "Stencil " << (int)stencils[s] << " is not of order " << expected_order[s]
+                          << " with " << (pbc ? "periodic" : "zero-flux") << " boundaries" << std::endl;
+                success = false;
+            }
+        }
+    }
+
+    // plane waves along (5,0) and (3,4) have the same wavelength
+    std::cout << std::endl << std::setw(8) << "stencil" << std::setw(14) << "error (5,0)"
+              << std::setw(14) << "error (3,4)" << std::setw(14) << "anisotropy" << std::endl;
+    for(unsigned int s=0; s<3; s++) {
+        const double e_axis = plane_wave_error(stencils[s], 64, 5, 0);
+        const double e_skew = plane_wave_error(stencils[s], 64, 3, 4);
+        const double anisotropy = std::fabs(e_axis - e_skew) / e_axis;
+
+        std::cout << std::setw(8) << (int)stencils[s] << std::scientific << std::setprecision(4)
+                  << std::setw(14) << e_axis << std::setw(14) << e_skew
+                  << std::fixed << std::setprecision(3) << std::setw(14) << anisotropy << std::endl;
+
+        if(stencils[s] == STENCIL_9POINT && anisotropy > 0.05) {
+            std::cerr << "The 9-point stencil is not isotropic" << std::endl;
+            success = false;
+        }
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Test of the prolongation of the multiresolution spin-up
+ *
+ * With periodic boundaries, prolongating a shifted coarse field has to give
+ * the fine field shifted by twice as many cells, which only holds when the
+ * edge cells interpolate towards the opposite edge. With zero-flux
+ * boundaries, the cells along an edge have to keep their value when the
+ * adjacent coarse cells have the same value, irrespective of the opposite edge. In both cases, the mean of the field is conserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "multires_spinup.h"
+
+int main() {
+    bool success = true;
+    const int rows = 6;
+    const int cols = 10;
+
+    // a field without any symmetry
+    MatrixXXd coarse(rows, cols);
+    for(int j=0; j<cols; j++) {
+        for(int i=0; i<rows; i++) {
+            coarse(i,j) = std::sin(1.3 * i + 0.7 * j * j) + 0.1 * i * j;
+        }
+    }
+
+    for(bool pbc : {true, false}) {
+        const char* label = pbc ? "periodic" : "zero-flux";
+        MatrixXXd fine;
+        MultiresSpinUp::prolongate(coarse, fine, pbc);
+        if(fine.rows() != 2 * rows || fine.cols() != 2 * cols) {
+            std::cerr << label << ": fine grid of " << fine.rows() << "x" << fine.cols() << std::endl;
+            return 1;
+        }
+
+        const double dev_mean = std::fabs(fine.mean() - coarse.mean());
+        std::cout << label << ": change of the mean " << dev_mean << std::endl;
+        if(dev_mean > 1e-14) {
+            std::cerr << label << ": the mean is not conserved" << std::endl;
+            success = false;
+        }
+
+        if(pbc) {
+            // shift by one coarse cell in both directions
+            MatrixXXd shifted(rows, cols);
+            for(int j=0; j<cols; j++) {
+                for(int i=0; i<rows; i++) {
+                    shifted((i + 1) % rows, (j + 1) % cols) = coarse(i,j);
+                }
+            }
+            MatrixXXd fine_shifted;
+            MultiresSpinUp::prolongate(shifted, fine_shifted, true);
+
+            double dev = 0.0;
+            for(int J=0; J<2*cols; J++) {
+                for(int I=0; I<2*rows; I++) {
+                    dev = std::max(dev, std::fabs(fine_shifted((I + 2) % (2 * rows), (J + 2) % (2 * cols)) - fine(I,J)));
+                }
+            }
+            std::cout << label << ": deviation after a shift " << dev << std::endl;
+            if(dev > 1e-14) {
+                std::cerr << label << ": the prolongation does not commute with a shift" << std::endl;
+                success = false;
+            }
+        } else {
+            // a field that differs only in the first row
+            MatrixXXd flat = MatrixXXd::Constant(rows, cols, 0.5);
+            flat.row(0).setOnes();
+            MatrixXXd fine_flat;
+            MultiresSpinUp::prolongate(flat, fine_flat, false);
+            for(int J=0; J<2*cols; J++) {
+                if(fine_flat(0,J) != 1.0) {
+                    std::cerr << label << ": edge cell " << fine_flat(0,J) << " instead of 1" << std::endl;
+                    success = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    if(!success) {
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
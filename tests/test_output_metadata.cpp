@@ -0,0 +1,73 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Test of the JSON encoding of the metadata
+ *
+ * Strings with quotes, backslashes and control characters have to be
+ * escaped, such that the metadata file is valid JSON, and values that JSON
+ * cannot represent are written as null.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "output_metadata.h"
+
+int main() {
+    bool success = true;
+
+    const std::string cases[][2] = {
+        {"plain", "\"plain\""},
+        {"a \"quoted\" \\path", "\"a \\\"quoted\\\" \\\\path\""},
+        {"tab\tnewline\nreturn\r", "\"tab\\tnewline\\nreturn\\r\""},
+        {std::string("bell\x07" "escape\x1b" "unit\x1f", 17), "\"bell\\u0007escape\\u001bunit\\u001f\""},
+        {std::string("nul\0end", 7), "\"nul\\u0000end\""},
+        {"utf-8 \xc3\xa9", "\"utf-8 \xc3\xa9\""},
+    };
+    for(const auto& c : cases) {
+        const std::string json = OutputMetadata::encode(c[0]);
+        if(json != c[1]) {
+            std::cerr << "Encoded " << json << " instead of " << c[1] << std::endl;
+            success = false;
+        }
+    }
+
+    if(OutputMetadata::encode(NAN) != "null" || OutputMetadata::encode(INFINITY) != "null") {
+        std::cerr << "Values without a JSON representation are not written as null" << std::endl;
+        success = false;
+    }
+    if(std::stod(OutputMetadata::encode(0.1)) != 0.1) {
+        std::cerr << "Floating point values do not round trip" << std::endl;
+        success = false;
+    }
+
+    if(!success) {
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
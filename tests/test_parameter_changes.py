@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+# Runs that change the parameters of the reaction system during the
+# integration, for the Gray-Scott model built in and given as expressions
+# (--reaction expr with the same initial condition). The expression terms are
+# compiled anew on every change of the parameters and have to follow the
+# built-in model:
+# * a continuation scan over f, comparing the order parameters of every case
+# * two branches with other values of f after a common first frame, comparing
+#   every frame of both branches
+#
+#     test_parameter_changes.py <turing> <scratch directory>
+
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+turing, scratch = sys.argv[1:3]
+shutil.rmtree(scratch, ignore_errors=True)
+os.makedirs(scratch)
+
+# values differ by at most RTOL relative to the size of the field
+RTOL = 1e-9
+
+common = ['--Da', '2e-5', '--Db', '1e-5', '--dx', '0.005', '--dt', '0.1',
+          '--width', '32', '--height', '32', '--steps', '3', '--tsteps', '50', '--no-progress']
+terms = 'ra=-a*b*b+f*(1-a);rb=a*b*b-(f+k)*b;init=rectangles;'
+models = {
+    'gray-scott': ('gray-scott', ''),
+    'expr':       ('expr', terms),
+}
+
+def check(condition, msg):
+    if not condition:
+        print('FAILED: ' + msg)
+        sys.exit(1)
+
+def run(name, model, parameters, args):
+    # the expression terms precede every set of parameters
+    reaction, prefix = models[model]
+    out = os.path.join(scratch, '%s_%s.bin' % (name, model))
+    cmd = [turing] + common + ['--reaction', reaction, '--outfile', out, '--parameters', prefix + parameters] + \
+          [arg.format(prefix=prefix) for arg in args]
+    res = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    check(res.returncode == 0, '%s with %s failed (%d): %s' % (name, model, res.returncode, res.stderr))
+    return out
+
+def read_frames(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+    w, h, n = struct.unpack_from('iii', data, 0)
+    n += 1  # the header does not count the initial frame
+    check(len(data) == 12 + 2 * n * w * h * 8, '%s has an unexpected size' % filename)
+    return struct.unpack_from('%dd' % (2 * n * w * h), data, 12)
+
+def compare(name, result, reference):
+    worst = 0.0
+    for species in ('A', 'B'):
+        r, g = result[species], reference[species]
+        scale = max(max(abs(v) for v in g['min']), max(abs(v) for v in g['max']), 1e-300)
+        for key in g:
+            for k, (x, y) in enumerate(zip(r[key], g[key])):
+                dev = abs(x - y) / scale
+                worst = max(worst, dev)
+                check(dev <= RTOL, '%s, case %d, %s %s: %.17g instead of %.17g' % (name, k, species, key, x, y))
+    print('%-24s max deviation %.3g' % (name, worst))
+
+# continuation scan over f
+scan = ['--steady-tol', '1e-6', '--continuation', 'param=f;from=0.02;to=0.07;n=4']
+results = {}
+for model in models:
+    with open(run('scan', model, 'f=0.06;k=0.0609', scan) + '.continuation.json') as f:
+        results[model] = json.load(f)
+check(results['expr']['cases'] == 4, 'the scan with expressions covers %d cases' % results['expr']['cases'])
+means = results['expr']['A']['mean']
+check(len(set(means)) == len(means), 'the cases of the scan with expressions do not differ: %s' % means)
+compare('continuation', results['expr'], results['gray-scott'])
+
+# branches after the first frame
+branch = ['--branch-frame', '1', '--branch', '{prefix}f=0.03;k=0.0609', '--branch', '{prefix}f=0.05;k=0.0609']
+frames = {model: run('branch', model, 'f=0.06;k=0.0609', branch) for model in models}
+for k in range(2):
+    name = 'branch %d' % k
+    result, reference = [read_frames(frames[model][:-4] + '.branch%d.bin' % k) for model in ('expr', 'gray-scott')]
+    check(len(result) == len(reference), '%s: the runs differ in size' % name)
+    scale = max(abs(v) for v in reference)
+    worst = max(abs(x - y) for x, y in zip(result, reference)) / scale
+    check(worst <= RTOL, '%s: deviation %.3g' % (name, worst))
+    print('%-24s max deviation %.3g' % (name, worst))
+first, second = [read_frames(frames['expr'][:-4] + '.branch%d.bin' % k) for k in range(2)]
+check(first != second, 'the branches with expressions do not differ')
+
+print('All runs with expressions agree with the built-in model')
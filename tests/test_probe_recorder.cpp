@@ -0,0 +1,131 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Test of the probe recorder
+ *
+ * Records of a known field are taken with a block size that does not divide
+ * the number of records, such that full and partial blocks pass through the
+ * output thread. The binary and text files have to hold the values at the
+ * requested points and along the transect, in the order of the columns.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "probe_recorder.h"
+
+int main() {
+    bool success = true;
+    const unsigned int w = 20;
+    const unsigned int h = 10;
+
+    // A(i,j) = 100 j + i, B = -A
+    std::vector<double> a(w * h), b(w * h);
+    for(unsigned int j=0; j<h; j++) {
+        for(unsigned int i=0; i<w; i++) {
+            a[i + j * w] = 100.0 * j + i;
+            b[i + j * w] = -a[i + j * w];
+        }
+    }
+    const double* c[2] = {a.data(), b.data()};
+
+    // two points, followed by the transect from (2,1) to (8,4): seven samples along the rows
+    const std::vector<double> expected_a = {503, 0, 102, 203, 204, 305, 306, 407, 408};
+    const unsigned int ncols = 1 + 2 * (expected_a.size());
+
+    for(const std::string format : {"bin", "csv"}) {
+        const std::string outfile = "test_probe_recorder_" + format;
+        const unsigned int nrecords = 11;
+        {
+            ProbeRecorder probes("points=3:5,0:0;lines=2:1-8:4;every=3;buffer=4;format=" + format,
+                                 {"A", "B"}, w, h, outfile);
+            const std::vector<std::string> columns = probes.get_columns();
+            if(columns.size() != ncols || columns[1] != "A(3:5)" || columns[ncols - 1] != "B(8:4)" ||
+               columns[3] != "A(2:1)" || columns[9] != "A(8:4)") {
+                std::cerr << "Unexpected columns for " << format << std::endl;
+                success = false;
+            }
+
+            probes.record(0.0, c);
+            for(unsigned int step=1; step<=3*(nrecords-1)+2; step++) {
+                probes.step(0.5 * step, c);
+            }
+            probes.finish();
+            if(probes.get_nr_records() != nrecords) {
+                std::cerr << "Expected " << nrecords << " records, got " << probes.get_nr_records() << std::endl;
+                success = false;
+            }
+        }
+
+        // read the records back
+        std::vector<double> values;
+        if(format == "bin") {
+            std::ifstream in(outfile + ".probes.bin", std::ios::binary);
+            double v;
+            while(in.read((char*)&v, sizeof(double))) {
+                values.push_back(v);
+            }
+        } else {
+            std::ifstream in(outfile + ".probes.csv");
+            std::string line;
+            std::getline(in, line);
+            while(std::getline(in, line)) {
+                std::stringstream ss(line);
+                std::string item;
+                while(std::getline(ss, item, ',')) {
+                    values.push_back(std::stod(item));
+                }
+            }
+        }
+
+        std::cout << format << ": " << values.size() / ncols << " records of " << ncols << " columns" << std::endl;
+        if(values.size() != nrecords * ncols) {
+            std::cerr << "Wrong number of values in the " << format << " file" << std::endl;
+            success = false;
+        } else {
+            for(unsigned int r=0; r<nrecords; r++) {
+                const double* rec = &values[r * ncols];
+                bool ok = (rec[0] == 1.5 * r);
+                for(unsigned int k=0; k<expected_a.size(); k++) {
+                    ok = ok && rec[1 + k] == expected_a[k] && rec[1 + expected_a.size() + k] == -expected_a[k];
+                }
+                if(!ok) {
+                    std::cerr << "Record " << r << " of the " << format << " file is wrong" << std::endl;
+                    success = false;
+                }
+            }
+        }
+
+        std::remove((outfile + ".probes." + format).c_str());
+        std::remove((outfile + ".probes.json").c_str());
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+
+# Imports the Python module from the build folder and checks that a new
+# system starts at t = 0, that its time and fields follow the time steps,
+# and that the frame iterator and the callback report the right times.
+#
+#     test_python_bindings.py <folder of the module>
+
+import sys
+
+sys.path.insert(0, sys.argv[1])
+import turing
+
+def check(condition, msg):
+    if not condition:
+        print('FAILED: ' + msg)
+        sys.exit(1)
+
+dt = 0.005
+rd = turing.TwoDimRD(Da=2.0, Db=16.0, width=32, height=24, dx=1.0, dt=dt,
+                     reaction='brusselator', parameters='alpha=4.5;beta=7.50', pbc=True)
+check(rd.t == 0.0, 't = %g before the first step' % rd.t)
+check(rd.a.shape == (24, 32) and rd.b.shape == (24, 32), 'shape of the fields is %s' % str(rd.a.shape))
+
+a0 = rd.a.copy()
+n = 10
+rd.step(n)
+check(abs(rd.t - n * dt) < 1e-12, 't = %g after step(%i), expected %g' % (rd.t, n, n * dt))
+check((rd.a != a0).any(), 'a did not change during step(%i)' % n)
+
+# the arrays are views: writing to them changes the state
+rd.a[0, 0] = 123.0
+check(rd.a[0, 0] == 123.0, 'write to the view of a was lost')
+
+rd = turing.TwoDimRD(Da=2.0, Db=16.0, width=32, height=24, dx=1.0, dt=dt,
+                     reaction='brusselator', parameters='alpha=4.5;beta=7.50', pbc=True)
+times = [t for frame, t in rd.frames(3, 4)]
+check(all(abs(t - 4 * (i + 1) * dt) < 1e-12 for i, t in enumerate(times)), 'times of the frames are %s' % times)
+
+rd = turing.TwoDimRD(Da=2.0, Db=16.0, width=32, height=24, dx=1.0, dt=dt,
+                     reaction='brusselator', parameters='alpha=4.5;beta=7.50', pbc=True)
+calls = []
+done = rd.run(5, 2, lambda frame, t: calls.append((frame, t)) or frame < 2)
+check(done == 2 and len(calls) == 2, 'run() stopped after %i frames, expected 2' % done)
+check(abs(calls[0][1] - 2 * dt) < 1e-12, 'callback received t = %g, expected %g' % (calls[0][1], 2 * dt))
+
+check('brusselator' in turing.reactions(), 'brusselator is not listed in reactions()')
+
+print('Python bindings: all checks passed')
@@ -0,0 +1,126 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+/*
+ * Test of the reaction terms given as expressions
+ *
+ * The Gray-Scott terms are compiled from expressions and compared with the
+ * exact terms over a batch that spans several chunks. The parameters are
+ * then set a second time with other constants, as continuation scans and
+ * branches do, after which the new constants have to take effect. Finally,
+ * an expression program has to refuse an output array of the wrong size.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "reaction_expression.h"
+
+/**
+ * @brief      Compare the reaction terms with the exact Gray-Scott terms
+ *
+ * @param[in]  reaction  The reaction system
+ * @param[in]  f         feed rate
+ * @param[in]  k         kill rate
+ * @param[in]  label     label of the check
+ *
+ * @return     whether all grid points agree
+ */
+static bool check_gray_scott(const ReactionExpression& reaction, double f, double k, const std::string& label) {
+    const unsigned int n = 3 * ExpressionProgram::CHUNK + 5;
+    std::vector<double> a(n), b(n), ra(n), rb(n);
+    for(unsigned int i=0; i<n; i++) {
+        a[i] = 0.25 + 0.5 * std::sin(0.1 * i) * std::sin(0.1 * i);
+        b[i] = 0.5 * std::cos(0.07 * i) * std::cos(0.07 * i);
+    }
+
+    const double* c[2] = {a.data(), b.data()};
+    double* r[2] = {ra.data(), rb.data()};
+    reaction.reaction_batch(c, r, n);
+
+    double dev = 0.0;
+    for(unsigned int i=0; i<n; i++) {
+        const double exact_a = -a[i] * b[i] * b[i] + f * (1.0 - a[i]);
+        const double exact_b = a[i] * b[i] * b[i] - (f + k) * b[i];
+        dev = std::max(dev, std::max(std::fabs(ra[i] - exact_a), std::fabs(rb[i] - exact_b)));
+    }
+
+    // single grid points take the scalar path
+    double sa, sb;
+    reaction.reaction(a[7], b[7], &sa, &sb);
+    dev = std::max(dev, std::max(std::fabs(sa - ra[7]), std::fabs(sb - rb[7])));
+
+    std::cout << label << ": maximum deviation " << dev << std::endl;
+    if(dev > 1e-12) {
+        std::cerr << label << ": the reaction terms do not match f = " << f << ", k = " << k << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    bool success = true;
+    const std::string terms = "ra=-a*b*b+f*(1-a);rb=a*b*b-(f+k)*b;";
+
+    ReactionExpression reaction;
+    reaction.set_parameters(terms + "f=0.06;k=0.0609");
+    success &= check_gray_scott(reaction, 0.06, 0.0609, "first parameters");
+
+    // a second call replaces the reaction terms instead of adding to them
+    reaction.set_parameters(terms + "f=0.03;k=0.055");
+    success &= check_gray_scott(reaction, 0.03, 0.055, "second parameters");
+
+    // the number of output arrays has to match the number of outputs
+    ExpressionProgram program({"a", "b"});
+    program.add_output("a*b");
+    program.add_output("a+b");
+    program.compile();
+    const double x = 2.0, y = 3.0;
+    const double* in[2] = {&x, &y};
+    double out0, out1;
+    double* out[2] = {&out0, &out1};
+    try {
+        program.evaluate(in, out, 1, 1);
+        std::cerr << "A single output array was accepted for two outputs" << std::endl;
+        success = false;
+    } catch(const std::logic_error& e) {
+        std::cout << "Refused: " << e.what() << std::endl;
+    }
+    program.evaluate(in, out, 2, 1);
+    if(out0 != 6.0 || out1 != 5.0) {
+        std::cerr << "Evaluated " << out0 << ", " << out1 << " instead of 6, 5" << std::endl;
+        success = false;
+    }
+
+    if(!success) {
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**************************************************************************
+ *   This file is part of TURING.                                         *
+ *                                                                        *
+ *   Author: Ivo Filot <ivo@ivofilot.nl>                                  *
+ *                                                                        *
+ *   TURING is free software:                                             *
+ *   you can redistribute it and/or modify it under the terms of the      *
+ *   GNU General Public License as published by the Free Software         *
+ *   Foundation, either version 3 of the License, or (at your option)     *
+ *   any later version.                                                   *
+ *                                                                        *
+ *   TURING is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+
+/*
+ * Test of the sub-cycling of the reaction terms
+ *
+ * In a linear system, A decays slowly and B relaxes quickly (stiffly) to A.
+ * A column of grid points is integrated over a few time spans, where half of
+ * the grid points are at rest (A = B = 0) and the others decay. Both
+ * integrators have to reproduce the exact solution within their tolerance,
+ * the grid points at rest have to take a single sub-step per time span, and
+ * the linearly implicit method has to take fewer sub-steps than the explicit
+ * one, whose sub-steps are limited by the stability of the fast relaxation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "reaction_subcycler.h"
+
+/**
+ * @brief      Slow decay of A, to which B relaxes quickly
+ */
+class LinearDecay : public ReactionSystem {
+public:
+    static constexpr double LAMBDA_A = -2.0;
+    static constexpr double LAMBDA_B = -500.0;
+
+    void reaction(double a, double b, double *ra, double *rb) const override {
+        *ra = LAMBDA_A * a;
+        *rb = LAMBDA_B * (b - a);
+    }
+
+    void init(MatrixXXd& a, MatrixXXd& b) const override {
+        a.setZero();
+        b.setZero();
+    }
+
+    void set_parameters(const std::string& params) override {}
+};
+
+int main() {
+    bool success = true;
+    const LinearDecay decay;
+    const double tau = 0.1;
+    const double rtol = 1e-3;
+    const unsigned int n = 8;
+
+    // the histogram bins hold 1, 2, 3-4, 5-8, ... sub-steps
+    const unsigned int counts[] = {1, 2, 3, 4, 5, 8, 9, 65536, 65537, 1000000};
+    const unsigned int bins[] = {0, 1, 2, 2, 3, 3, 4, 16, 17, 17};
+    for(unsigned int k=0; k<10; k++) {
+        if(ReactionSubcycler::get_bin(counts[k]) != bins[k]) {
+            std::cerr << counts[k] << " sub-steps in bin " << ReactionSubcycler::get_bin(counts[k])
+                      << " instead of " << bins[k] << std::endl;
+            success = false;
+        }
+    }
+
+    double mean_stiff[2] = {0.0, 0.0};
+    for(const std::string method : {"rk23", "rosenbrock"}) {
+        ReactionSubcycler sub("method=" + method + ";rtol=" + std::to_string(rtol) + ";atol=1e-6");
+        sub.prepare(n);
+
+        // even grid points are at rest
+        std::vector<double> a(n, 0.0), b(n, 0.0);
+        for(unsigned int k=1; k<n; k+=2) {
+            a[k] = 1.0;
+            b[k] = 1.0;
+        }
+
+        // integrate a few time spans, such that the proposed sub-steps are reused
+        std::vector<unsigned int> substeps(n, 0);
+        const unsigned int nspans = 4;
+        for(unsigned int s=0; s<nspans; s++) {
+            for(unsigned int k=0; k<n; k++) {
+                // single grid points, to count their sub-steps
+                ReactionSubcycler::Tally tally;
+                sub.advance_column(decay, &a[k], &b[k], sub.get_step_sizes() + k, 1, tau, tally);
+                substeps[k] += tally.substeps;
+                sub.record(tally);
+            }
+        }
+
+        // the transient of B has decayed to far below the tolerance after the first time span
+        const double exact_a = std::exp(LinearDecay::LAMBDA_A * nspans * tau);
+        const double exact_b = exact_a * LinearDecay::LAMBDA_B / (LinearDecay::LAMBDA_B - LinearDecay::LAMBDA_A);
+        unsigned long long total = 0;
+        double mean_active = 0.0;
+        for(unsigned int k=0; k<n; k++) {
+            const bool active = (k % 2 == 1);
+            const double dev = std::max(std::fabs(a[k] - (active ? exact_a : 0.0)),
+                                        std::fabs(b[k] - (active ? exact_b : 0.0))) / exact_a;
+            if(dev > 10.0 * rtol) {
+                std::cerr << method << ", grid point " << k << ": A = " << a[k] << ", B = " << b[k]
+                          << " instead of " << (active ? exact_a : 0.0) << ", " << (active ? exact_b : 0.0) << std::endl;
+                success = false;
+            }
+            if(!active && substeps[k] != nspans) {
+                std::cerr << method << ", grid point " << k << " at rest took " << substeps[k]
+                          << " sub-steps in " << nspans << " time spans" << std::endl;
+                success = false;
+            }
+            if(active) {
+                mean_active += substeps[k] / (0.5 * n);
+            }
+            total += substeps[k];
+        }
+
+        std::cout << method << ": " << mean_active << " sub-steps per decaying grid point in " << nspans
+                  << " time spans (" << sub.get_nr_rejected() << " rejected)" << std::endl;
+        if(sub.get_nr_substeps() != total) {
+            std::cerr << method << ": the totals do not match the counts of the grid points" << std::endl;
+            success = false;
+        }
+
+        unsigned long long spans = 0;
+        for(unsigned long long count : sub.get_histogram()) {
+            spans += count;
+        }
+        if(spans != nspans * n) {
+            std::cerr << method << ": the histogram holds " << spans << " instead of " << nspans * n
+                      << " time spans" << std::endl;
+            success = false;
+        }
+
+        mean_stiff[method == "rk23" ? 0 : 1] = mean_active;
+    }
+
+    if(!(mean_stiff[1] < mean_stiff[0])) {
+        std::cerr << "The Rosenbrock method takes as many sub-steps as RK23 on the decaying grid points" << std::endl;
+        success = false;
+    }
+
+    if(!success) {
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}